@@ -16,6 +16,27 @@ using namespace std;
 //------------------------------------------------------------------------------
 #include "CODE.h"
 //------------------------------------------------------------------------------
+#include "CExampleOptions.h"
+#include "CRecordedHapticDevice.h"
+#include "CSyntheticHapticDevice.h"
+#include "CHapticLoopProfiler.h"
+#include "CGlobalFrameUpdater.h"
+#include "CTelemetryOverlay.h"
+#include "CFramePacer.h"
+#include "CShadowMapCache.h"
+#include "COffscreenRenderer.h"
+#include "CSeqLock.h"
+#include "CPoseInterpolator.h"
+#include "CDistanceField.h"
+#include "CODEDistanceFieldGeom.h"
+#include "CAssetCache.h"
+#include "CStepScheduler.h"
+#include "CRotationalDrift.h"
+#include "CWearMap.h"
+#include "CMeshDecimator.h"
+#include "CODEIslandThreads.h"
+#include "CStartupTasks.h"
+//------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
 // GENERAL SETTINGS
@@ -70,21 +91,17 @@ double angG;
 double linStiffness = 800;
 double angStiffness = 30;
 
-// Computed force and torque feedbcak
+// Coupling force and torque applied to the ODE tool; their reaction is the
+// force feedback of the device
 cVector3d force, torque;
 
 // properties of haptic device and workspace
 double workspaceScaleFactor;
-double RotScaleFactor;
 double maxStiffness;
 double maxRotStiffness;
 double maxLinearForce;
 double maxRotTorque;
 
-// Virtual workspace force in device coordinates
-cVector3d VirtualWSTorque;
-// Avatar virtual workspace force in device coordinates
-cVector3d VirtualAvatarWSTorque;
 // Virtual workspace stiffness factor
 double KVirtual=1.0;
 
@@ -94,48 +111,27 @@ double KvR = 0.1; // rotational drift controller gain
 double ThetaMax = 20.0; // device max angular motion range
 double ThetaE = 85.0; // virtual environment max angular motion range
 
-// drift velocity in device coordinates
-cVector3d RotDriftVel;
-// avatar velocity in device coordinates
-cVector3d RotAvatarVel;
-// drift force in device coordinates
-cVector3d RotDriftForce;
-//avatar rotation in device coordinates
-cVector3d avatarRotVect;
-cMatrix3d avatarRot;
-cMatrix3d avatarGlobalRot;
+// rotational drift, computed with quaternions or with rotation matrices
+cQuaternionRotationalDrift quaternionDrift;
+cMatrixRotationalDrift matrixDrift;
+bool useQuaternionDrift = true;
 
-// orientation of the avatar workspace (Theta_w)
-cVector3d centerRot;
-double angleCenter;
-cMatrix3d VirtualWSRot;
+// state and outputs of the rotational drift, in device coordinates
+cRotationalDriftState rotDrift;
+
+// avatar rotation in world coordinates
+cMatrix3d avatarGlobalRot;
 cVector3d posAvatar;
 cMatrix3d rotAvatar;
 
-// initial orientation of the haptic device (Theta_d0)
-cVector3d deviceRotIni; 
 // orientation of the haptic device (Theta_d)
-cVector3d deviceRot;
 cMatrix3d deviceRotMat;
-
-
-// cross rotational vector (Theta_d x Theta_d0) 
-cVector3d RotCrossVector;
 // rotational velocity of the haptic device
 cVector3d RotDeviceVel;
-cVector3d TiltDeviceVel;
 
 //State machine of the haptic loop
 int stateHaptic = 0;
 
-// Rotation
-double angle;
-double angleTheta;
-double angleAvatar;
-cVector3d axis;
-cVector3d axisTheta;
-cVector3d axisThetaPast;
-
 
 
 
@@ -150,6 +146,34 @@ cODEWorld* ODEWorld;
 cODEGenericBody* ODEBlade;
 cODEGenericBody* ODETool;
 
+// scale of the blade and of the tool models
+const double C_BLADE_SCALE = 0.012;
+const double C_TOOL_SCALE = 0.065;
+
+// cells of the distance field of the blade along its largest side, and width of its band [cells]
+const int C_BLADE_FIELD_CELLS = 256;
+const int C_BLADE_FIELD_BAND = 4;
+
+// spacing of the tool points tested against the distance field [cells], and their maximum number
+const double C_TOOL_POINT_SPACING = 2.0;
+const int C_TOOL_MAX_POINTS = 512;
+
+// objects of the asset cache
+const int C_CACHE_BLADE = 0;
+const int C_CACHE_TOOL = 1;
+
+// preprocessed meshes, distance field and tool points mapped from the asset cache (--asset-cache)
+cAssetCache assetCache;
+
+// distance field of the blade and its ODE geometry (--blade-collider sdf)
+cSparseDistanceField bladeField;
+cODEDistanceFieldGeom* bladeFieldGeom = NULL;
+
+// collision mesh of the blade decimated within options.m_collisionError,
+// which the haptic point and ODE collide with while the full blade is only
+// rendered (--collision-error)
+cQuadricDecimator bladeDecimator;
+
 cODEGenericBody* ODEGPlane0;
 cODEGenericBody* ODEGPlane1;
 cODEGenericBody* ODEGPlane2;
@@ -157,6 +181,22 @@ cODEGenericBody* ODEGPlane3;
 cODEGenericBody* ODEGPlane4;
 cODEGenericBody* ODEGPlane5;
 
+// parts resting on the floor in stacks of two, each stack an island of the
+// ODE world (--bodies)
+vector<cODEGenericBody*> ODEParts;
+
+// threads stepping the islands of the ODE world in parallel (--ode-threads)
+cODEIslandThreads odeIslandThreads;
+
+// models of the blade and of the tool, and the collision mesh of the blade
+// (the blade itself, or its decimated copy)
+cMultiMesh* blade = NULL;
+cMultiMesh* bladeCollision = NULL;
+cMultiMesh* imgTool = NULL;
+
+// points of the tool tested against the distance field of the blade
+vector<cVector3d> toolPoints;
+
 
 //---------------------------------------------------------------------------
 // GENERAL VARIABLES
@@ -168,6 +208,19 @@ bool simulationRunning = false;
 // flag to indicate if the haptic simulation has terminated
 bool simulationFinished = true;
 
+// flag to indicate if the scene is built; until then the haptic loop holds
+// the device in its idle mode
+atomic<bool> sceneReady(false);
+
+// damping [N s/m] and largest force [N] of the idle mode of the device
+const double C_IDLE_DAMPING = 2.0;
+const double C_IDLE_MAX_FORCE = 1.0;
+
+// timed phases of the startup, the models being loaded and preprocessed by
+// background tasks, and their progress shown in the window meanwhile
+cStartupTasks startup;
+cStartupScreen startupScreen;
+
 // a frequency counter to measure the simulation graphic rate
 cFrequencyCounter freqCounterGraphics;
 
@@ -177,6 +230,19 @@ cFrequencyCounter freqCounterHaptics;
 // haptic thread
 cThread* hapticsThread;
 
+// a frequency counter to measure the ODE simulation rate
+cFrequencyCounter freqCounterPhysics;
+
+// ODE thread (--physics-rate > 0)
+cThread* physicsThread = NULL;
+
+// period of the record replayed (--replay), by which the haptic loop ramps
+// its gains and steps ODE instead of the real time; 0 if not replaying
+double replayTickPeriod = 0.0;
+
+// flag to indicate if the ODE thread has terminated
+bool physicsFinished = true;
+
 // a handle to window display context
 GLFWwindow* window = NULL;
 
@@ -192,6 +258,54 @@ int swapInterval = 1;
 // root resource path
 string resourceRoot;
 
+// command line options
+cExampleOptions options;
+
+// rate and per-tick latency of the haptic loop
+cHapticLoopProfiler hapticProfiler;
+
+// global frames of the objects moved by the haptic loop
+cGlobalFrameUpdater frames;
+
+// live latency percentiles of the haptic loop
+cHapticLoopMonitor hapticMonitor;
+
+// rate and per-step latency of the ODE thread, and its live percentiles
+cHapticLoopProfiler physicsProfiler;
+cHapticLoopMonitor physicsMonitor;
+
+// global frames of the ODE bodies moved by the ODE thread
+cGlobalFrameUpdater physicsFrames;
+
+// avatar pose published by the haptic loop, to which the ODE thread couples the ODE tool
+cSeqLock<cTimedPose> avatarPose;
+
+// ODE tool pose published by the ODE thread after each step
+cSeqLock<cTimedPose> odeToolPose;
+
+// ODE tool poses read by the haptic loop, interpolated between the ODE steps
+cPoseInterpolator odeToolInterpolator;
+
+// fixed ODE steps for the real time elapsed, within a time budget per tick of
+// the loop that steps ODE (ODE thread, or haptic loop if --physics-rate 0)
+cStepScheduler odeScheduler;
+
+// text of labelFeedback, refreshed at options.m_hudRate
+cTelemetryOverlay hud;
+
+// frames in flight on the GPU and frame latency
+cFramePacer framePacer;
+
+// shadow maps, rendered again only when the light, the tool or an ODE body moves
+cShadowMapCache shadowCache;
+
+// wear of the blade (pressure x time on each triangle), accumulated by the
+// haptic loop and shown as vertex colors at options.m_hudRate
+cWearMap bladeWear;
+
+// frame buffer and camera orbit of the offscreen benchmark (--offscreen)
+cOffscreenRenderer offscreen;
+
 
 //---------------------------------------------------------------------------
 // DECLARED MACROS
@@ -220,6 +334,29 @@ void updateGraphics(void);
 // this function contains the main haptics simulation loop
 void updateHaptics(void);
 
+// this function contains the ODE simulation loop, run at --physics-rate
+void updatePhysics(void);
+
+// this function computes the spring that couples the ODE tool to the avatar
+void computeToolCoupling(const cVector3d& a_posAvatar, const cMatrix3d& a_rotAvatar,
+                         const cVector3d& a_posTool, const cMatrix3d& a_rotTool,
+                         cVector3d& a_force, cVector3d& a_torque);
+
+// this function adds the contacts of the last ODE steps between the tool and the blade to its wear
+void addBladeWear(const cVector3d& a_toolForce, double a_duration);
+
+// this function loads the blade and builds its collision models (startup task)
+void loadBlade(bool a_cacheHit);
+
+// this function loads the tool (startup task)
+void loadTool(bool a_cacheHit);
+
+// this function creates the ODE bodies and writes the asset cache (startup task)
+void createBodies(bool a_cacheHit, bool a_cacheWrite, unsigned long long a_cacheKey);
+
+// this function shows the progress of the startup tasks until they are done; it returns false if the window was closed meanwhile
+bool waitForStartupTasks(void);
+
 // this function closes the application
 void close(void);
 
@@ -255,89 +392,111 @@ int main(int argc, char* argv[])
     cout << "[7] - decrease linear stiffness" << endl;
     cout << "[8] - increase linear stiffness" << endl;
     cout << "[9] - decrease angular stiffness" << endl;
-    cout << "[0] - increase angular stiffness" << endl << endl;
+    cout << "[0] - increase angular stiffness" << endl;
+    cout << "[w] - clear the wear map of the blade" << endl << endl;
     cout << "[q] - Exit application\n" << endl;
     cout << endl << endl;
 
+    // parse command line options
+    if (!options.parse(argc, argv))
+    {
+        return 1;
+    }
+
 
     //-----------------------------------------------------------------------
     // OPEN GL - WINDOW DISPLAY
     //-----------------------------------------------------------------------
 
-    // initialize GLFW library
-    if (!glfwInit())
+    int phase = startup.beginPhase("window");
+
+    // no window is created when the haptic loop runs headless
+    if (!options.m_headless)
     {
-        cout << "failed initialization" << endl;
-        cSleepMs(1000);
-        return 1;
-    }
+        // initialize GLFW library
+        if (!glfwInit())
+        {
+            cout << "failed initialization" << endl;
+            cSleepMs(1000);
+            return 1;
+        }
 
-    // set error callback
-    glfwSetErrorCallback(errorCallback);
+        // set error callback
+        glfwSetErrorCallback(errorCallback);
 
-    // compute desired size of window
-    const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
-    int w = 0.8 * mode->height;
-    int h = 0.5 * mode->height;
-    int x = 0.5 * (mode->width - w);
-    int y = 0.5 * (mode->height - h);
+        // compute desired size of window
+        const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+        int w = 0.8 * mode->height;
+        int h = 0.5 * mode->height;
+        int x = 0.5 * (mode->width - w);
+        int y = 0.5 * (mode->height - h);
 
-    // set OpenGL version
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+        // set OpenGL version
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
 
-    // set active stereo mode
-    if (stereoMode == C_STEREO_ACTIVE)
-    {
-        glfwWindowHint(GLFW_STEREO, GL_TRUE);
-    }
-    else
-    {
-        glfwWindowHint(GLFW_STEREO, GL_FALSE);
-    }
+        // set active stereo mode
+        if (stereoMode == C_STEREO_ACTIVE)
+        {
+            glfwWindowHint(GLFW_STEREO, GL_TRUE);
+        }
+        else
+        {
+            glfwWindowHint(GLFW_STEREO, GL_FALSE);
+        }
 
-    // create display context
-    window = glfwCreateWindow(w, h, "CHAI3D", NULL, NULL);
-    if (!window)
-    {
-        cout << "failed to create window" << endl;
-        cSleepMs(1000);
-        glfwTerminate();
-        return 1;
-    }
+        // the offscreen benchmark only needs the OpenGL context of the window
+        if (options.m_offscreen)
+        {
+            glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+        }
+
+        // create display context
+        window = glfwCreateWindow(w, h, "CHAI3D", NULL, NULL);
+        if (!window)
+        {
+            cout << "failed to create window" << endl;
+            cSleepMs(1000);
+            glfwTerminate();
+            return 1;
+        }
 
-    // get width and height of window
-    glfwGetWindowSize(window, &width, &height);
+        // get width and height of window
+        glfwGetWindowSize(window, &width, &height);
 
-    // set position of window
-    glfwSetWindowPos(window, x, y);
+        // set position of window
+        glfwSetWindowPos(window, x, y);
 
-    // set key callback
-    glfwSetKeyCallback(window, keyCallback);
+        // set key callback
+        glfwSetKeyCallback(window, keyCallback);
 
-    // set resize callback
-    glfwSetWindowSizeCallback(window, windowSizeCallback);
+        // set resize callback
+        glfwSetWindowSizeCallback(window, windowSizeCallback);
 
-    // set current display context
-    glfwMakeContextCurrent(window);
+        // set current display context
+        glfwMakeContextCurrent(window);
 
-    // sets the swap interval for the current display context
-    glfwSwapInterval(swapInterval);
+        // sets the swap interval for the current display context
+        glfwSwapInterval(swapInterval);
 
-    // initialize GLEW library
+        // initialize GLEW library
 #ifdef GLEW_VERSION
-    if (glewInit() != GLEW_OK)
-    {
-        cout << "failed to initialize GLEW library" << endl;
-        glfwTerminate();
-        return 1;
-    }
+        if (glewInit() != GLEW_OK)
+        {
+            cout << "failed to initialize GLEW library" << endl;
+            glfwTerminate();
+            return 1;
+        }
 #endif
+    }
+    startup.endPhase(phase);
 
 
     //-----------------------------------------------------------------------
     // 3D - SCENEGRAPH
     //-----------------------------------------------------------------------
+    phase = startup.beginPhase("scene graph");
+
     // create a new world.
     world = new cWorld();
 
@@ -391,13 +550,23 @@ int main(int argc, char* argv[])
     light->m_shadowMap->setQualityLow();
     //light->m_shadowMap->setQualityMedium();
 
+    // or the resolution requested on the command line
+    if (!options.m_shadowQuality.empty() && !cSetShadowMapQuality(light, options.m_shadowQuality))
+    {
+        cout << "Error - unknown shadow quality: " << options.m_shadowQuality << " (verylow, low, medium, high or veryhigh)" << endl;
+        glfwTerminate();
+        return 1;
+    }
+
     // set light cone half angle
     light->setCutOffAngleDeg(45);
+    startup.endPhase(phase);
 
 
     //-----------------------------------------------------------------------
     // HAPTIC DEVICES / TOOLS
     //-----------------------------------------------------------------------
+    phase = startup.beginPhase("haptic device");
 
     // create a haptic device handler
     handler = new cHapticDeviceHandler();
@@ -405,6 +574,32 @@ int main(int argc, char* argv[])
     // get access to the first available haptic device
     handler->getDevice(hapticDevice, 0);
 
+    // simulate the haptic device when running headless or offscreen without a record to replay
+    if ((options.m_headless || options.m_offscreen) && options.m_replayFile.empty())
+    {
+        hapticDevice = cSyntheticHapticDevice::create();
+    }
+
+    // replay and/or record the haptic device as requested on the command line
+    if (!cSetupRecordedDevice(hapticDevice, options.m_replayFile, options.m_recordFile, !options.m_headless))
+    {
+        cSleepMs(1000);
+        glfwTerminate();
+        return 1;
+    }
+
+    // a replay is timed by the ticks of its record, so that it reproduces the
+    // recorded forces; the ODE thread is timed by the real time regardless
+    cReplayHapticDevicePtr replayDevice = cGetReplayDevice(hapticDevice);
+    if (replayDevice != NULL)
+    {
+        replayTickPeriod = 1.0 / replayDevice->getTickRate();
+        if (options.m_physicsRate > 0.0)
+        {
+            cout << "Warning - the ODE thread is timed by the real time: use --physics-rate 0 to reproduce the recorded forces" << endl;
+        }
+    }
+
     // retrieve information about the current haptic device
     cHapticDeviceInfo hapticDeviceInfo = hapticDevice->getSpecifications();
 
@@ -434,6 +629,7 @@ int main(int argc, char* argv[])
 
     // start the haptic tool
     tool->start();
+    startup.endPhase(phase);
 
 
     //--------------------------------------------------------------------------
@@ -447,6 +643,7 @@ int main(int argc, char* argv[])
     labelFeedback = new cLabel(font);
     labelFeedback->m_fontColor.setBlack();
     camera->m_frontLayer->addChild(labelFeedback);
+    hud.setRefreshRate(options.m_hudRate);
 
 
     //////////////////////////////////////////////////////////////////////////
@@ -468,6 +665,7 @@ int main(int argc, char* argv[])
     linGain = cMin(linGain, maxStiffness / linStiffness);
 
     // create an ODE world to simulate dynamic bodies
+    phase = startup.beginPhase("ODE world");
     ODEWorld = new cODEWorld(world);
 
     // add ODE world as a node inside world
@@ -479,6 +677,7 @@ int main(int argc, char* argv[])
     // define damping properties
     ODEWorld->setAngularDamping(0.00002);
     ODEWorld->setLinearDamping(0.00002);
+    startup.endPhase(phase);
 
 
     //////////////////////////////////////////////////////////////////////////
@@ -486,15 +685,13 @@ int main(int argc, char* argv[])
     //////////////////////////////////////////////////////////////////////////
 
 
-    // Set device initial orientation Theta_d0 (in local coordinates)
-    deviceRotIni.set(0.0,0.0,1.0);
-    
-    // Initialize avatar orientation center
-    centerRot.set(0.0,0.0,1.0);
-    VirtualWSRot.identity();
-
-    axisThetaPast.set(1.0,0.0,0.0);
-    avatarRot.identity();
+    // device initial orientation Theta_d0 (0,0,1) and avatar orientation
+    // center are set by the drift state; the drift parameters depend on
+    // the device
+    cRotationalDriftParams driftParams(KdR, KvR, ThetaMax, ThetaE, KVirtual, maxRotTorque, maxRotStiffness, 4000.0); //frequency of the Omega.7
+    quaternionDrift.setParams(driftParams);
+    matrixDrift.setParams(driftParams);
+    useQuaternionDrift = (options.m_rotationalDrift != "matrix");
 
     // update position and orientation of tool
     tool->updateFromDevice();
@@ -510,84 +707,82 @@ int main(int argc, char* argv[])
 
 
     //////////////////////////////////////////////////////////////////////////
-    // BLADE
+    // ASSET CACHE
     //////////////////////////////////////////////////////////////////////////
 
-    // create a new ODE object representing the blade
-    ODEBlade = new cODEGenericBody(ODEWorld);
-
-    // create a virtual mesh  that will be used for the geometry representation of the dynamic body
-    cMultiMesh* blade = new cMultiMesh();
-
-    // load model
-    bool fileload;
-    fileload = blade->loadFromFile(RESOURCE_PATH("../resources/models/Polishing/blade.3ds"));
-    if (!fileload)
+    // the scaled meshes of the blade and the tool, the distance field of the
+    // blade and the points of the tool are read from the asset cache if it
+    // was written from the same model files and parameters
+    bool cacheHit = false;
+    unsigned long long cacheKey = 0;
+    if (!options.m_assetCache.empty())
     {
-        #if defined(_MSVC)
-        fileload = blade->loadFromFile("../../../bin/resources/models/Polishing/blade.3ds");
-        #endif
+        phase = startup.beginPhase("asset cache read");
+        vector<string> modelFiles;
+        modelFiles.push_back(RESOURCE_PATH("../resources/models/Polishing/blade.3ds"));
+        modelFiles.push_back(RESOURCE_PATH("../resources/models/Polishing/ToolPoli2.3ds"));
+        char parameters[128];
+        snprintf(parameters, sizeof(parameters), "%g %g %d %d %g %d %s", C_BLADE_SCALE, C_TOOL_SCALE, C_BLADE_FIELD_CELLS,
+                 C_BLADE_FIELD_BAND, C_TOOL_POINT_SPACING, C_TOOL_MAX_POINTS, options.m_bladeCollider.c_str());
+        cacheKey = cAssetCache::computeKey(modelFiles, parameters);
+        cacheHit = (cacheKey != 0) && assetCache.load(options.m_assetCache, cacheKey);
+        startup.endPhase(phase);
     }
-    
-    // scale object
-    blade->scale(0.012);
-   
-    // create collision detector
-    blade->createAABBCollisionDetector(0.0);
-
-    // assign haptic properties
-    cMaterial matBlade;
-    matBlade.setStiffness(0.3 * maxStiffness);
-    matBlade.setHapticTriangleSides(true, false);
-    blade->setMaterial(matBlade);
-   
-    // add mesh to ODE object
-    ODEBlade->setImageModel(blade);
-
-    // create a dynamic model of the ODE object. Here we decide to use a box just like
-    // the object mesh we just defined
-    ODEBlade->createDynamicMesh(true);
-
-    // position and orient model
-    ODEBlade->setLocalPos( 0.0, 0.0,-0.5);
-    ODEBlade->rotateAboutGlobalAxisDeg(cVector3d(1,0,0), 90);
+    bool cacheWrite = !options.m_assetCache.empty() && !cacheHit && (cacheKey != 0);
+    string startupTitle = string("10-ODE-PolishingTask startup (") +
+                          (options.m_assetCache.empty() ? "no asset cache" : (cacheHit ? "asset cache hit" : "asset cache miss")) + ")";
 
 
     //////////////////////////////////////////////////////////////////////////
-    // TOOL
+    // BLADE, TOOL AND PARTS
     //////////////////////////////////////////////////////////////////////////
 
-    // create a virtual tool
-   ODETool = new cODEGenericBody(ODEWorld);
-    cMultiMesh* imgTool = new cMultiMesh();
+    // simulation in now running
+    simulationRunning = true;
 
-    fileload = imgTool->loadFromFile(RESOURCE_PATH("../resources/models/Polishing/ToolPoli2.3ds"));
-    if (!fileload)
+    // the haptic loop starts at once, and holds the device in its idle mode
+    // until the scene is ready (when headless, it runs in the main thread
+    // once the scene is ready)
+    if (!options.m_headless)
     {
-        #if defined(_MSVC)
-        fileload = imgTool->loadFromFile("../../../bin/resources/models/Polishing/ToolPoli2.3ds");
-        #endif
+        hapticsThread = new cThread();
+        hapticsThread->start(updateHaptics, CTHREAD_PRIORITY_HAPTICS);
+
+        // setup callback when application exits
+        atexit(close);
     }
-    imgTool->scale(0.065);
 
-    // define material properties
-    cMaterial matTool;
-    matTool.setGrayLevel(0.3);
-    matTool.setRedIndian();
-    matTool.m_specular.set(0.0, 0.0, 0.0);
-    matTool.setDynamicFriction(0.2);
-    matTool.setStaticFriction(0.2);
-    imgTool->setMaterial(matTool, true);
-    imgTool->setHapticEnabled(false);
+    // the window shows the progress of the startup tasks instead of the
+    // world they build
+    if (!options.m_headless && !options.m_offscreen)
+    {
+        startupScreen.initialize(font);
+    }
 
-    // add mesh to ODE object
-    ODETool->setImageModel(imgTool);
-    ODETool->createDynamicMesh(false);
+    // phases of the tasks below: blade model, blade collision detector, tool
+    // model, blade ODE geometry and tool ODE mesh, and the optional ones
+    startup.expectPhases(startup.getNumPhases() + 5 + ((options.m_collisionError > 0.0) ? 1 : 0) +
+                         ((options.m_bladeCollider == "sdf") ? 2 : 0) + (cacheWrite ? 1 : 0) + ((options.m_numBodies > 0) ? 1 : 0));
+
+    // the blade and the tool are loaded and preprocessed in parallel; their
+    // ODE bodies and the parts are then created in the ODE world
+    startup.run([=]() { loadBlade(cacheHit); });
+    startup.run([=]() { loadTool(cacheHit); });
+    bool loaded = waitForStartupTasks();
+    if (loaded)
+    {
+        startup.run([=]() { createBodies(cacheHit, cacheWrite, cacheKey); });
+        loaded = waitForStartupTasks();
+    }
 
-    // define mass properties
-    ODETool->setMass(0.01);
-    dBodySetAngularDamping(ODETool->m_ode_body, 0.06);
-    dBodySetLinearDamping(ODETool->m_ode_body, 0.06);
+    // the window was closed while loading: exit without starting the
+    // simulation (close() stops the haptic loop at exit)
+    if (!loaded)
+    {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return 0;
+    }
 
 
 //   // create a virtual tool
@@ -641,15 +836,74 @@ int main(int argc, char* argv[])
     // START SIMULATION
     //-----------------------------------------------------------------------
 
-    // simulation in now running
-    simulationRunning = true;
+    phase = startup.beginPhase("start simulation");
+
+    // compute global reference frames for each object; the haptic loop then
+    // updates the frames of the tool and of the ODE bodies only
+    world->computeGlobalPositions(true);
+
+    // the shadows change when the light, the tool or an ODE body moves
+    shadowCache.track(light);
+    shadowCache.trackTool(tool);
+    shadowCache.track(ODETool);
+    shadowCache.track(ODEBlade);
+    for (size_t i=0; i<ODEParts.size(); i++)
+    {
+        shadowCache.track(ODEParts[i]);
+    }
+
+    // ODE steps of the period of the loop that steps ODE by default, within
+    // 60% of that period
+    double odeRate = (options.m_physicsRate > 0.0) ? options.m_physicsRate : C_DEVICE_RECORD_TICK_RATE;
+    odeScheduler.setStepSize((options.m_odeStep > 0.0) ? options.m_odeStep : 1.0 / odeRate);
+    odeScheduler.setBudget((options.m_odeBudget > 0.0) ? options.m_odeBudget : 0.6 / odeRate);
+
+    // create a thread which steps ODE at its own rate, coupled to the avatar
+    // pose published by the haptic loop
+    if (options.m_physicsRate > 0.0)
+    {
+        cTimedPose pose;
+        pose.set(cPoseInterpolator::now(), posAvatar, rotAvatar);
+        avatarPose.write(pose);
+        pose.set(cPoseInterpolator::now(), ODETool->getGlobalPos(), ODETool->getGlobalRot());
+        odeToolPose.write(pose);
+
+        if (options.m_headless)
+        {
+            physicsProfiler.reserve(options.m_ticks);
+        }
+        physicsFinished = false;
+        physicsThread = new cThread();
+        physicsThread->start(updatePhysics, CTHREAD_PRIORITY_HAPTICS);
+    }
+
+    // the scene is ready: the haptic loop leaves its idle mode
+    sceneReady = true;
+    startup.endPhase(phase);
 
-    // create a thread which starts the main haptics rendering loop
-    hapticsThread = new cThread();
-    hapticsThread->start(updateHaptics, CTHREAD_PRIORITY_HAPTICS);
+    // when headless, run the haptic loop in the main thread and report its timing
+    if (options.m_headless)
+    {
+        startup.setInteractive();
+        startup.printReport(startupTitle);
+        hapticProfiler.reserve(options.m_ticks);
+        if (options.m_paced)
+        {
+            hapticProfiler.setPacingRate(C_DEVICE_RECORD_TICK_RATE);
+        }
+        updateHaptics();
+        hapticProfiler.printReport("10-ODE-PolishingTask haptic loop");
+        printf("global frames: %.1f nodes updated per tick, %d nodes in the world\n",
+               frames.getMeanNodesPerTick(), cGlobalFrameUpdater::countNodes(world));
+        if (options.m_physicsRate > 0.0)
+        {
+            while (!physicsFinished) { cSleepMs(10); }
+            physicsProfiler.printReport("10-ODE-PolishingTask ODE thread");
+        }
+        close();
+        return 0;
+    }
 
-    // setup callback when application exits
-    atexit(close);
 
 
     //--------------------------------------------------------------------------
@@ -659,23 +913,93 @@ int main(int argc, char* argv[])
     // call window size callback at initialization
     windowSizeCallback(window, width, height);
 
+    // the offscreen benchmark renders one orbit of the camera around the
+    // target of the initial view, at the same distance and elevation
+    if (options.m_offscreen)
+    {
+        if (options.m_frames == 0) { options.m_frames = 360; }
+        offscreen.initialize(camera);
+        offscreen.setOrbit(cVector3d(0.0, 0.0,-0.5), 2.625, 72.3, 0, options.m_frames);
+        width = cOffscreenRenderer::C_WIDTH;
+        height = cOffscreenRenderer::C_HEIGHT;
+    }
+
+    // pace the frames with fences if the context supports them
+    framePacer.initialize(options.m_framesInFlight);
+    framePacer.reserve((options.m_frames > 0) ? options.m_frames : 36000);
+
     // main graphic loop
     while (!glfwWindowShouldClose(window))
     {
-        // get width and height of window
-        glfwGetWindowSize(window, &width, &height);
+        // get width and height of window, or move the camera along the orbit
+        if (options.m_offscreen)
+        {
+            offscreen.moveCamera(framePacer.getNumFrames());
+        }
+        else
+        {
+            glfwGetWindowSize(window, &width, &height);
+        }
+
+        // mark the beginning of the frame
+        framePacer.beginFrame();
 
         // render graphics
         updateGraphics();
 
         // swap buffers
-        glfwSwapBuffers(window);
+        if (!options.m_offscreen)
+        {
+            glfwSwapBuffers(window);
+        }
+
+        // limit the frames in flight on the GPU and measure the frame latency
+        framePacer.endFrame();
+
+        // the example is interactive from its first frame
+        if (framePacer.getNumFrames() == 1)
+        {
+            startup.setInteractive();
+            startup.printReport(startupTitle);
+        }
 
         // process events
         glfwPollEvents();
 
         // signal frequency counter
         freqCounterGraphics.signal(1);
+
+        // exit after the requested number of frames
+        if ((options.m_frames > 0) && (framePacer.getNumFrames() >= options.m_frames))
+        {
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
+    }
+
+    // report the frame timing
+    if (options.m_offscreen)
+    {
+        framePacer.printReport("10-ODE-PolishingTask offscreen frames (shadows " +
+                               (options.m_shadowQuality.empty() ? string("low") : options.m_shadowQuality) + ")");
+    }
+    else
+    {
+        framePacer.printReport("10-ODE-PolishingTask frames");
+    }
+    printf("shadow maps rendered: %.1f%% of the frames\n", 100.0 * shadowCache.getUpdateRatio());
+
+    // save the reference images, after the timed frames since reading them back waits for the GPU
+    if (options.m_offscreen && !options.m_referencePrefix.empty())
+    {
+        for (int i=0; i<cOffscreenRenderer::C_NUM_REFERENCE_IMAGES; i++)
+        {
+            offscreen.moveCamera(offscreen.getReferenceFrame(i));
+            updateGraphics();
+            if (!offscreen.saveReferenceImage(options.m_referencePrefix, i))
+            {
+                cout << "Error - failed to save reference image " << i << endl;
+            }
+        }
     }
 
     // close window
@@ -690,51 +1014,397 @@ int main(int argc, char* argv[])
 
 //---------------------------------------------------------------------------
 
-void windowSizeCallback(GLFWwindow* a_window, int a_width, int a_height)
+void loadBlade(bool a_cacheHit)
 {
-    // update window size
-    width  = a_width;
-    height = a_height;
-}
-
-//------------------------------------------------------------------------------
+    // create a virtual mesh  that will be used for the geometry representation of the dynamic body
+    blade = new cMultiMesh();
 
-void errorCallback(int a_error, const char* a_description)
-{
-    cout << "Error: " << a_description << endl;
-}
+    // load model, or copy it from the asset cache
+    int phase = startup.beginPhase("blade model");
+    bool fileload = false;
+    if (a_cacheHit)
+    {
+        fileload = assetCache.createMesh(C_CACHE_BLADE, blade);
+        if (!fileload)
+        {
+            printf("Error - failed to read the blade from the asset cache, loading blade.3ds\n");
+        }
+    }
+    if (!fileload)
+    {
+        fileload = blade->loadFromFile(RESOURCE_PATH("../resources/models/Polishing/blade.3ds"));
+        if (!fileload)
+        {
+            #if defined(_MSVC)
+            fileload = blade->loadFromFile("../../../bin/resources/models/Polishing/blade.3ds");
+            #endif
+        }
+        if (!fileload)
+        {
+            printf("Error - failed to load blade.3ds\n");
+        }
 
-//---------------------------------------------------------------------------
+        // scale object
+        blade->scale(C_BLADE_SCALE);
+    }
+    startup.endPhase(phase);
 
-void keyCallback(GLFWwindow* a_window, int a_key, int a_scancode, int a_action, int a_mods)
-{
-    // filter calls that only include a key press
-    if ((a_action != GLFW_PRESS) && (a_action != GLFW_REPEAT))
+    // collision mesh: the blade itself, or a copy decimated within the error
+    // bound, holding the blade as a child that is rendered but not touched
+    bladeCollision = blade;
+    if (options.m_collisionError > 0.0)
     {
-        return;
+        phase = startup.beginPhase("blade collision mesh");
+        vector<cVector3d> vertices;
+        vector<unsigned int> triangles;
+        cGetMeshTriangles(blade, vertices, triangles);
+        bladeDecimator.decimate(vertices, triangles, options.m_collisionError);
+        bladeCollision = new cMultiMesh();
+        bladeDecimator.createMesh(bladeCollision);
+        bladeCollision->setShowEnabled(false, false);
+        bladeCollision->addChild(blade);
+        blade->setHapticEnabled(false);
+        startup.endPhase(phase);
+        printf("blade collision mesh: %lu of %lu triangles, error bound %.3f mm, largest collapse %.3f mm\n",
+               (unsigned long)(bladeDecimator.getTriangles().size() / 3), (unsigned long)(triangles.size() / 3),
+               1e3 * options.m_collisionError, 1e3 * bladeDecimator.getMaxError());
     }
 
-    // option - exit
-    else if ((a_key == GLFW_KEY_ESCAPE) || (a_key == GLFW_KEY_Q))
+    // create collision detector
+    phase = startup.beginPhase("blade collision detector");
+    bladeCollision->createAABBCollisionDetector(0.0);
+    startup.endPhase(phase);
+
+    // assign haptic properties
+    cMaterial matBlade;
+    matBlade.setStiffness(0.3 * maxStiffness);
+    matBlade.setHapticTriangleSides(true, false);
+    blade->setMaterial(matBlade);
+    if (bladeCollision != blade)
     {
-        glfwSetWindowShouldClose(a_window, GLFW_TRUE);
+        bladeCollision->setMaterial(matBlade);
     }
 
-    // help menu:
-    else if (a_key == GLFW_KEY_H)
+    // distance field of the blade, against which the tool collides by points
+    // sampled on its surface (see createBodies())
+    if (options.m_bladeCollider == "sdf")
     {
-        cout << "Keyboard Options:" << endl << endl;
-        cout << "[h] - Display help menu" << endl;
-        cout << "[1] - Enable gravity" << endl;
-        cout << "[2] - Disable gravity" << endl << endl;
-        cout << "[3] - decrease linear haptic gain" << endl;
-        cout << "[4] - increase linear haptic gain" << endl;
-        cout << "[5] - decrease angular haptic gain" << endl;
+        phase = startup.beginPhase("blade distance field");
+        if (!a_cacheHit || !assetCache.getField(C_CACHE_BLADE, bladeField))
+        {
+            vector<cVector3d> vertices;
+            vector<unsigned int> triangles;
+            cGetMeshTriangles(blade, vertices, triangles);
+            blade->computeBoundaryBox(true);
+            cVector3d size = blade->getBoundaryMax() - blade->getBoundaryMin();
+            double cellSize = cMax(size(0), cMax(size(1), size(2))) / (double)C_BLADE_FIELD_CELLS;
+            bladeField.build(vertices, triangles, cellSize, C_BLADE_FIELD_BAND);
+        }
+        startup.endPhase(phase);
+    }
+}
+
+//---------------------------------------------------------------------------
+
+void loadTool(bool a_cacheHit)
+{
+    // create a virtual tool
+    imgTool = new cMultiMesh();
+
+    // load model, or copy it from the asset cache
+    int phase = startup.beginPhase("tool model");
+    bool fileload = false;
+    if (a_cacheHit)
+    {
+        fileload = assetCache.createMesh(C_CACHE_TOOL, imgTool);
+        if (!fileload)
+        {
+            printf("Error - failed to read the tool from the asset cache, loading ToolPoli2.3ds\n");
+        }
+    }
+    if (!fileload)
+    {
+        fileload = imgTool->loadFromFile(RESOURCE_PATH("../resources/models/Polishing/ToolPoli2.3ds"));
+        if (!fileload)
+        {
+            #if defined(_MSVC)
+            fileload = imgTool->loadFromFile("../../../bin/resources/models/Polishing/ToolPoli2.3ds");
+            #endif
+        }
+        if (!fileload)
+        {
+            printf("Error - failed to load ToolPoli2.3ds\n");
+        }
+        imgTool->scale(C_TOOL_SCALE);
+    }
+    startup.endPhase(phase);
+
+    // define material properties
+    cMaterial matTool;
+    matTool.setGrayLevel(0.3);
+    matTool.setRedIndian();
+    matTool.m_specular.set(0.0, 0.0, 0.0);
+    matTool.setDynamicFriction(0.2);
+    matTool.setStaticFriction(0.2);
+    imgTool->setMaterial(matTool, true);
+    imgTool->setHapticEnabled(false);
+}
+
+//---------------------------------------------------------------------------
+
+void createBodies(bool a_cacheHit, bool a_cacheWrite, unsigned long long a_cacheKey)
+{
+    // ODE data of this thread, for the trimesh and collision functions
+    dAllocateODEDataForThread(dAllocateMaskAll);
+
+    //////////////////////////////////////////////////////////////////////////
+    // BLADE
+    //////////////////////////////////////////////////////////////////////////
+
+    // create a new ODE object representing the blade
+    int phase = startup.beginPhase("blade ODE geometry");
+    ODEBlade = new cODEGenericBody(ODEWorld);
+
+    // add mesh to ODE object
+    ODEBlade->setImageModel(bladeCollision);
+
+    // create a dynamic model of the ODE object: either the mesh itself, or
+    // the distance field of the mesh
+    if (options.m_bladeCollider == "sdf")
+    {
+        bladeFieldGeom = new cODEDistanceFieldGeom(&bladeField);
+        bladeFieldGeom->create(ODEWorld->m_ode_space, ODEBlade);
+
+        // the contact patch moves little between steps: test only the tool
+        // points within half the band of the blade until the tool moves as much
+        if (options.m_contactCache)
+        {
+            bladeFieldGeom->setCoherenceMargin(0.5 * bladeField.getBandWidth());
+        }
+    }
+    else
+    {
+        ODEBlade->createDynamicMesh(true);
+    }
+
+    // wear map of the blade, colored as unworn; contacts on the collision
+    // mesh are shown on the vertices of the blade that collapsed into theirs
+    if (bladeCollision != blade)
+    {
+        bladeWear.init(bladeCollision, blade, &bladeDecimator.getVertexMap());
+    }
+    else
+    {
+        bladeWear.init(blade);
+    }
+
+    // the ODE contacts with the distance field, in the frame of the blade,
+    // wear the nearest triangle within the band
+    if (bladeFieldGeom != NULL)
+    {
+        bladeWear.initContactSearch(bladeField.getBandWidth());
+    }
+
+    // position and orient model
+    ODEBlade->setLocalPos( 0.0, 0.0,-0.5);
+    ODEBlade->rotateAboutGlobalAxisDeg(cVector3d(1,0,0), 90);
+    if (bladeFieldGeom != NULL)
+    {
+        bladeFieldGeom->setPose(ODEBlade->getLocalPos(), ODEBlade->getLocalRot());
+    }
+    startup.endPhase(phase);
+
+
+    //////////////////////////////////////////////////////////////////////////
+    // TOOL
+    //////////////////////////////////////////////////////////////////////////
+
+    // add mesh to ODE object
+    phase = startup.beginPhase("tool ODE mesh");
+    ODETool = new cODEGenericBody(ODEWorld);
+    ODETool->setImageModel(imgTool);
+    ODETool->createDynamicMesh(false);
+
+    // define mass properties
+    ODETool->setMass(0.01);
+    dBodySetAngularDamping(ODETool->m_ode_body, 0.06);
+    dBodySetLinearDamping(ODETool->m_ode_body, 0.06);
+    startup.endPhase(phase);
+
+    // points of the tool tested against the distance field of the blade
+    if (bladeFieldGeom != NULL)
+    {
+        phase = startup.beginPhase("tool points");
+        if (!a_cacheHit || !assetCache.getPoints(C_CACHE_TOOL, toolPoints))
+        {
+            vector<cVector3d> vertices;
+            vector<unsigned int> triangles;
+            cGetMeshTriangles(imgTool, vertices, triangles);
+            cSampleSurface(vertices, triangles, C_TOOL_POINT_SPACING * bladeField.getCellSize(), C_TOOL_MAX_POINTS, toolPoints);
+        }
+        bladeFieldGeom->addSampledGeom(ODETool->m_ode_geom, toolPoints);
+        startup.endPhase(phase);
+        printf("blade distance field: %lu bricks, %.1f MB, cell %.2f mm, %lu tool points\n",
+               (unsigned long)bladeField.getNumBricks(), 1e-6 * (double)bladeField.getMemorySize(),
+               1e3 * bladeField.getCellSize(), (unsigned long)toolPoints.size());
+    }
+
+    // write the asset cache if it was missing or out of date
+    if (a_cacheWrite)
+    {
+        phase = startup.beginPhase("asset cache write");
+        cAssetCacheWriter writer;
+        writer.addMesh(C_CACHE_BLADE, blade);
+        writer.addMesh(C_CACHE_TOOL, imgTool);
+        if (bladeFieldGeom != NULL)
+        {
+            writer.addField(C_CACHE_BLADE, bladeField);
+            writer.addPoints(C_CACHE_TOOL, toolPoints);
+        }
+        if (!writer.save(options.m_assetCache, a_cacheKey))
+        {
+            printf("Error - failed to write asset cache: %s\n", options.m_assetCache.c_str());
+        }
+        startup.endPhase(phase);
+    }
+
+
+    //////////////////////////////////////////////////////////////////////////
+    // PARTS
+    //////////////////////////////////////////////////////////////////////////
+
+    // floor of the cell and parts resting on it in stacks of two, under the
+    // blade; static geometries do not link bodies, so each stack is an
+    // island that the ODE threads can step apart from the others
+    if (options.m_numBodies > 0)
+    {
+        phase = startup.beginPhase("parts");
+        ODEGPlane1 = new cODEGenericBody(ODEWorld);
+        ODEGPlane1->createStaticPlane(cVector3d(0.0, 0.0, -1.0), cVector3d(0.0, 0.0 , 1.0));
+
+        cMaterial matPart;
+        matPart.setGrayLevel(0.5);
+        matPart.setDynamicFriction(0.4);
+        matPart.setStaticFriction(0.4);
+
+        const double size = 0.04;
+        int numStacks = (options.m_numBodies + 1) / 2;
+        int side = (int)ceil(sqrt((double)numStacks));
+        for (int i=0; i<options.m_numBodies; i++)
+        {
+            int stack = i / 2;
+            cMesh* mesh = new cMesh();
+            cCreateBox(mesh, size, size, size);
+            mesh->setMaterial(matPart);
+            mesh->setHapticEnabled(false);
+
+            cODEGenericBody* part = new cODEGenericBody(ODEWorld);
+            part->setImageModel(mesh);
+            part->createDynamicBox(size, size, size);
+            part->setMass(0.05);
+            part->setLocalPos(3.0 * size * ((double)(stack % side) - 0.5 * (double)(side - 1)),
+                              3.0 * size * ((double)(stack / side) - 0.5 * (double)(side - 1)),
+                              -1.0 + (0.5 + 1.05 * (double)(i % 2)) * size);
+            ODEParts.push_back(part);
+        }
+        startup.endPhase(phase);
+    }
+
+    // threads stepping the islands of the ODE world
+    if ((options.m_odeThreads > 1) && !odeIslandThreads.start(ODEWorld->m_ode_world, options.m_odeThreads))
+    {
+        printf("ODE has no threading implementation (built without --enable-builtin-threading-impl): the islands are stepped on 1 thread\n");
+    }
+
+    dCleanupODEAllDataForThread();
+}
+
+//---------------------------------------------------------------------------
+
+bool waitForStartupTasks(void)
+{
+    // render the progress of the tasks, as long as they run; the world they
+    // build is not rendered until they are done. Once the window is closed
+    // (exit key or close button), it is hidden while the tasks finish, since
+    // they cannot be interrupted
+    bool closed = false;
+    while (!startup.isDone())
+    {
+        if (startupScreen.isInitialized() && !closed)
+        {
+            glfwGetWindowSize(window, &width, &height);
+            startupScreen.render(startup, width, height);
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+            closed = (glfwWindowShouldClose(window) != 0);
+            if (closed)
+            {
+                glfwHideWindow(window);
+            }
+        }
+        else
+        {
+            cSleepMs(1);
+        }
+    }
+    startup.wait();
+    return (!closed);
+}
+
+//---------------------------------------------------------------------------
+
+void windowSizeCallback(GLFWwindow* a_window, int a_width, int a_height)
+{
+    // update window size
+    width  = a_width;
+    height = a_height;
+}
+
+//------------------------------------------------------------------------------
+
+void errorCallback(int a_error, const char* a_description)
+{
+    cout << "Error: " << a_description << endl;
+}
+
+//---------------------------------------------------------------------------
+
+void keyCallback(GLFWwindow* a_window, int a_key, int a_scancode, int a_action, int a_mods)
+{
+    // filter calls that only include a key press
+    if ((a_action != GLFW_PRESS) && (a_action != GLFW_REPEAT))
+    {
+        return;
+    }
+
+    // option - exit
+    else if ((a_key == GLFW_KEY_ESCAPE) || (a_key == GLFW_KEY_Q))
+    {
+        glfwSetWindowShouldClose(a_window, GLFW_TRUE);
+    }
+
+    // only exit and fullscreen until the scene is ready
+    else if (!sceneReady && (a_key != GLFW_KEY_F))
+    {
+        return;
+    }
+
+    // help menu:
+    else if (a_key == GLFW_KEY_H)
+    {
+        cout << "Keyboard Options:" << endl << endl;
+        cout << "[h] - Display help menu" << endl;
+        cout << "[1] - Enable gravity" << endl;
+        cout << "[2] - Disable gravity" << endl << endl;
+        cout << "[3] - decrease linear haptic gain" << endl;
+        cout << "[4] - increase linear haptic gain" << endl;
+        cout << "[5] - decrease angular haptic gain" << endl;
         cout << "[6] - increase angular haptic gain" << endl  << endl;
         cout << "[7] - decrease linear stiffness" << endl;
         cout << "[8] - increase linear stiffness" << endl;
         cout << "[9] - decrease angular stiffness" << endl;
-        cout << "[0] - increase angular stiffness" << endl << endl;
+        cout << "[0] - increase angular stiffness" << endl;
+        cout << "[w] - clear the wear map of the blade" << endl << endl;
         cout << "[q] - Exit application\n" << endl;
         cout << endl << endl;
     }
@@ -819,6 +1489,13 @@ void keyCallback(GLFWwindow* a_window, int a_key, int a_scancode, int a_action,
         printf("angular stiffness:  %f\n", angStiffness);
     }
 
+    // option - clear the wear map
+    else if (a_key == GLFW_KEY_W)
+    {
+        bladeWear.reset();
+        printf("wear map cleared\n");
+    }
+
     // option - toggle fullscreen
     else if (a_key == GLFW_KEY_F)
     {
@@ -863,14 +1540,41 @@ void close(void)
     // stop the simulation
     simulationRunning = false;
 
-    // wait for graphics and haptics loops to terminate
+    // wait for graphics, haptics and ODE loops to terminate
     while (!simulationFinished) { cSleepMs(100); }
+    while (!physicsFinished) { cSleepMs(100); }
+
+    // report the ODE steps, their overruns and the simulated time dropped
+    odeScheduler.printReport("10-ODE-PolishingTask ODE steps");
+
+    // report the area of the blade polished and its largest wear
+    bladeWear.updateColors();
+    printf("blade wear: %.1f%% of the surface polished, max %.3g Pa s\n", 100.0 * bladeWear.getCoverage(), bladeWear.getMaxWear());
+
+    // report the collisions of the tool with the distance field of the blade
+    // served by the contact cache, and the time they saved
+    if ((bladeFieldGeom != NULL) && (bladeFieldGeom->getNumCollisions() > 0))
+    {
+        unsigned long numCollisions = bladeFieldGeom->getNumCollisions();
+        unsigned long numHits = bladeFieldGeom->getNumCacheHits();
+        unsigned long numFull = numCollisions - numHits;
+        double fullTime = (numFull > 0) ? bladeFieldGeom->getFullTestTime() / (double)numFull : 0.0;
+        double savedTime = (double)numHits * fullTime - bladeFieldGeom->getCachedTestTime();
+        printf("blade contact cache: %.1f%% hits over %lu collisions, %.1f point tests per collision, %.2f us per full test, %.2f us saved per collision\n",
+               100.0 * (double)numHits / (double)numCollisions, numCollisions,
+               (double)bladeFieldGeom->getNumPointTests() / (double)numCollisions, 1e6 * fullTime, 1e6 * savedTime / (double)numCollisions);
+    }
 
     // close haptic device
     hapticDevice->close();
 
+    // stop the threads stepping the ODE islands
+    odeIslandThreads.stop();
+
     // delete resources
     delete hapticsThread;
+    delete physicsThread;
+    delete bladeFieldGeom;
     delete world;
     delete handler;
 }
@@ -884,7 +1588,32 @@ void updateGraphics(void)
     /////////////////////////////////////////////////////////////////////
 
     // update haptic and graphic rate data
-    labelFeedback->setText(RotDriftForce.str(3) + "Nm" + TiltDeviceVel.str(3) + "rad/w" +  centerRot.str(3) + "NU" + avatarRotVect.str(3) + "NU" + cStr(angleTheta*180/3.14,5) + "deg");
+    if (hud.isRefreshDue())
+    {
+        hapticMonitor.update(hapticProfiler);
+        hud.clear();
+        hud.append("%.0f Hz / %.0f Hz %.1f/%.1f us ", freqCounterGraphics.getFrequency(), freqCounterHaptics.getFrequency(),
+                   1e6 * hapticMonitor.m_p50, 1e6 * hapticMonitor.m_p99);
+        if (options.m_physicsRate > 0.0)
+        {
+            physicsMonitor.update(physicsProfiler);
+            hud.append("/ ODE %.0f Hz %.1f/%.1f us ", freqCounterPhysics.getFrequency(),
+                       1e6 * physicsMonitor.m_p50, 1e6 * physicsMonitor.m_p99);
+        }
+        hud.appendVector(rotDrift.m_driftTorque, 3);
+        hud.append("Nm");
+        hud.appendVector(rotDrift.m_tiltVel, 3);
+        hud.append("rad/w");
+        hud.appendVector(rotDrift.m_centerRot, 3);
+        hud.append("NU");
+        hud.appendVector(rotDrift.m_avatarRotVect, 3);
+        hud.append("NU%.5fdeg %d nodes", rotDrift.m_angleTheta*180/3.14, frames.getNumNodesLastTick());
+
+        // update the colors of the blade from its wear
+        bladeWear.updateColors();
+        hud.append(" polished %.1f%%", 100.0 * bladeWear.getCoverage());
+        hud.applyTo(labelFeedback);
+    }
 
     // update position of label
     labelFeedback->setLocalPos((int)(0.5 * (width - labelFeedback->getWidth())), 15);
@@ -894,17 +1623,21 @@ void updateGraphics(void)
     // RENDER SCENE
     /////////////////////////////////////////////////////////////////////
 
-    // update shadow maps (if any)
-    world->updateShadowMaps(false, mirroredDisplay);
+    // update shadow maps (if any), only when they are out of date
+    shadowCache.update(world, mirroredDisplay);
 
-    // render world
-    camera->renderView(width, height);
-
-    // wait until all GL commands are completed
-    glFinish();
+    // render world, into the frame buffer of the offscreen benchmark if any
+    if (offscreen.isInitialized())
+    {
+        offscreen.renderView();
+    }
+    else
+    {
+        camera->renderView(width, height);
+    }
 
-    // check for any OpenGL errors
-    GLenum err = glGetError();
+    // check for any OpenGL errors (batched by the frame pacer in release builds)
+    GLenum err = framePacer.checkErrors();
     if (err != GL_NO_ERROR) cout << "Error: " << gluErrorString(err) << endl;
 }
 
@@ -912,32 +1645,68 @@ void updateGraphics(void)
 
 void updateHaptics(void)
 {
+    // ODE data of this thread, which steps ODE when it has no thread of its own
+    dAllocateODEDataForThread(dAllocateMaskAll);
+
     // start haptic device
     hapticDevice->open();
 
-    // simulation clock
+    // until the scene is ready, only damp the motion of the device, within
+    // a force small enough to be safe wherever it is held; a recorded device
+    // is damped directly and a replayed or simulated one waits, so that the
+    // ticks of the session start with the scene
+    cGenericHapticDevicePtr idleDevice = cGetPhysicalDevice(hapticDevice);
+    double idleMaxForce = cMin(C_IDLE_MAX_FORCE, maxLinearForce);
+    while (simulationRunning && !sceneReady)
+    {
+        if (idleDevice != NULL)
+        {
+            cHoldDeviceIdle(idleDevice, C_IDLE_DAMPING, idleMaxForce);
+        }
+        else
+        {
+            cSleepMs(1);
+        }
+    }
+
+    // simulation clock, and number of ticks
     cPrecisionClock simClock;
     simClock.start(true);
-
-    cMatrix3d prevRotTool;
-    prevRotTool.identity();
+    unsigned long numTicks = 0;
 
     // main haptic simulation loop
     while(simulationRunning)
     {
+        // mark the beginning of the tick
+        hapticProfiler.beginTick();
+
         // update frequency counter
         freqCounterHaptics.signal(1);
 
-        // retrieve simulation time and compute next interval
+        // retrieve the time elapsed since the previous tick, which ramps up
+        // the force gains (ODE is stepped by odeScheduler)
         double time = simClock.getCurrentTimeSeconds();
-        double nextSimInterval = 0.00025;//cClamp(time, 0.00001, 0.0002);
-        
+
         // reset clock
         simClock.reset();
         simClock.start();
 
-        // compute global reference frames for each object
-        world->computeGlobalPositions(true);
+        // when replaying, the ticks are those of the record
+        if (replayTickPeriod > 0.0)
+        {
+            time = (numTicks > 0) ? replayTickPeriod : 0.0;
+        }
+        numTicks++;
+
+        // compute global reference frames of the tool and of the ODE bodies,
+        // the only objects moved by the haptic loop (the ODE thread updates
+        // the frames of the ODE bodies when it runs)
+        frames.markDirty(tool);
+        if (options.m_physicsRate <= 0.0)
+        {
+            frames.markDirty(ODEWorld);
+        }
+        frames.update();
 
         // update position and orientation of tool
         tool->updateFromDevice();
@@ -945,31 +1714,81 @@ void updateHaptics(void)
         // compute interaction forces
         tool->computeInteractionForces();
 
+        // add the contacts of the tool with the blade to its wear; those of
+        // the ODE tool are only known with the distance field, whose
+        // contacts are added by the loop that steps ODE, while the triangle
+        // mesh collides inside the ODE module
+        if (bladeFieldGeom == NULL)
+        {
+            bladeWear.addContacts(tool->m_hapticPoint, time);
+        }
+
 	/////////////////////////////////////////////////////////////////////
-        // COMPUTE ODE INTERACTION FORCES
+        // WORKSPACE DRIFT CONTROL
         /////////////////////////////////////////////////////////////////////
+	
+	// get orientation theta_d and rotational velocity wd of the device (in local coordinates)
+ 	hapticDevice->getRotation(deviceRotMat);
+	hapticDevice->getAngularVelocity(RotDeviceVel);
 
-        // read position of tool
-        cVector3d posTool = ODETool->getGlobalPos();
-        cMatrix3d rotTool = ODETool->getGlobalRot();
+	// rotational drift velocity, scaling factor and avatar orientation,
+	// and the torques of the workspace limits
+	if (useQuaternionDrift)
+	{
+		quaternionDrift.update(rotDrift, deviceRotMat, RotDeviceVel);
+	}
+	else
+	{
+		matrixDrift.update(rotDrift, deviceRotMat, RotDeviceVel);
+	}
 
-        // compute position and angular error between tool and haptic device
-        cVector3d deltaPos = (posAvatar - posTool);
-        cMatrix3d deltaRot = cMul(cTranspose(rotTool), rotAvatar);
-        deltaRot.toAxisAngle(axis, angle);
-        
-        // compute force and torque to apply to tool
-        force = linStiffness * deltaPos;
-        torque = cMul((angStiffness * angle), axis);
-        rotTool.mul(torque);  
+	// set avatar rotational velocity and orientation in device coordinates
+	tool->setDeviceLocalAngVel(rotDrift.m_avatarVel);
+	tool->setDeviceLocalRot(rotDrift.m_avatarRot);
+	avatarGlobalRot = tool->getDeviceGlobalRot();
 
-        // compute force and torque to apply to haptic device
-        force = -linG * force;
-        torque = -angG * torque;
+	// drift of the device
+	tool->addDeviceLocalTorque(rotDrift.m_driftTorque);
+
+
+
+      	/////////////////////////////////////////////////////////////////////
+        // ODE TOOL COUPLING
+        /////////////////////////////////////////////////////////////////////
+
+        // update new position and orientation of tool after the rotational drift
+        posAvatar = tool->m_hapticPoint->getGlobalPosProxy();
+	rotAvatar = avatarGlobalRot;
+
+        // read position of the ODE tool, interpolated one ODE step in the
+        // past between the last two steps when ODE runs in its own thread,
+        // which couples the tool to the avatar at its own rate
+        cVector3d posTool;
+        cMatrix3d rotTool;
+        if (options.m_physicsRate > 0.0)
+        {
+            cTimedPose pose;
+            pose.set(cPoseInterpolator::now(), posAvatar, rotAvatar);
+            avatarPose.write(pose);
+
+            odeToolPose.read(pose);
+            odeToolInterpolator.update(pose);
+            odeToolInterpolator.interpolate(cPoseInterpolator::now() - 1.0 / options.m_physicsRate, posTool, rotTool);
+        }
+        else
+        {
+            posTool = ODETool->getGlobalPos();
+            rotTool = ODETool->getGlobalRot();
+        }
+
+        // compute the coupling force and torque once, against the avatar
+        // after the drift: they pull the ODE tool (before each ODE step when
+        // the haptic loop steps ODE), and their reaction is sent to the device
+        computeToolCoupling(posAvatar, rotAvatar, posTool, rotTool, force, torque);
 
        // add force contribution from ODE model
-	tool->addDeviceGlobalForce(force);
-	tool->addDeviceGlobalTorque(torque);
+	tool->addDeviceGlobalForce(-linG * force);
+	tool->addDeviceGlobalTorque(-angG * torque);
 
         if (linG < linGain)
         {
@@ -991,146 +1810,175 @@ void updateHaptics(void)
 
 
 	/////////////////////////////////////////////////////////////////////
-        // WORKSPACE DRIFT CONTROL
+        // CHECK WORKSPACE LIMITS
         /////////////////////////////////////////////////////////////////////
-	
-	// get orientation of the device theta_d (in local coordinates)
- 	hapticDevice->getRotation(deviceRotMat);
-	deviceRot = deviceRotMat * deviceRotIni;
 
-	// get rotational velocity of the device wd (in local coordinates)
-	hapticDevice->getAngularVelocity(RotDeviceVel);
-	// get tilt velocity of the device 
-	TiltDeviceVel=RotDeviceVel - deviceRot.dot(RotDeviceVel)*deviceRot;
 
-	// cross rotational vector (Theta_d x Theta_d0)
-	deviceRot.crossr(deviceRotIni,RotCrossVector);
-	// dot product (Theta_d . Theta_d0)
-	double RotDot=deviceRot.dot(deviceRotIni);
-
-        // calculation of the rotational drift velocity
-	RotDriftVel = KdR*TiltDeviceVel.length()*RotCrossVector/(sin(ThetaMax*3.14/180));
+	// Set the virtual workspace force to the device, computed by the drift
+	// once the device went beyond ThetaMax
+	tool->addDeviceLocalTorque(rotDrift.m_wsTorque);
 
 
 	/////////////////////////////////////////////////////////////////////
-        // SCALING FACTOR
+        // CHECK VIRTUAL WORKSPACE LIMITS
         /////////////////////////////////////////////////////////////////////
 
-	// Modification of the rotational scaling factor according to the orientation
-	RotScaleFactor = (1 + RotCrossVector.length()*(ThetaE/ThetaMax-1)/(sin(ThetaMax*3.14/180)));
+	// Set the virtual workspace force to the device, computed by the drift
+	// once the avatar went beyond ThetaE
+	tool->addDeviceLocalTorque(rotDrift.m_avatarWSTorque);
 
-
-        /////////////////////////////////////////////////////////////////////
-        // DRIFT TORQUE COMPUTATION
+	/////////////////////////////////////////////////////////////////////
+        // APPLY FORCE /TORQUE AND UPDATE SIMULATION
         /////////////////////////////////////////////////////////////////////
 
-	// set avatar rotational velocity in device coordinates
-	RotAvatarVel = RotScaleFactor * (RotDeviceVel-RotDriftVel);
-	tool->setDeviceLocalAngVel(RotAvatarVel);
-	
-	
-	// Virtual workspace orientation
-	angleCenter = RotScaleFactor*RotDriftVel.length()/4000.0; //frequency of the Omega.7
-
-	// Rotation axis in the virtual workspace local coordinates
-	axisTheta = VirtualWSRot*RotCrossVector;
-	if (axisTheta.length()!=0.0)
-	{
-		axisTheta.normalize();
-	}
-	else
-	{
-		axisTheta=axisThetaPast;
-	}
-	axisThetaPast=axisTheta;
-
-	avatarRot.setAxisAngleRotationRad(-axisTheta, angleCenter);
-	// Update new virtual workspace rotation matrix and z_axis
-	VirtualWSRot=VirtualWSRot*avatarRot;
-	centerRot = avatarRot * centerRot;
-
-	// set avatar orientation in device coordinates
-	angleTheta = atan2(RotCrossVector.length(),RotDot);
-	
-	avatarRot.setAxisAngleRotationRad(-axisTheta, RotScaleFactor*angleTheta);
-	// Update new avatar orientation axis and rotation matrix
-	avatarRotVect = avatarRot * centerRot;
-	avatarRot=VirtualWSRot*avatarRot;
-
-	tool->setDeviceLocalRot(avatarRot);
-	avatarGlobalRot = tool->getDeviceGlobalRot();
-
-	// drift of the device
-	RotDriftForce = KvR*maxRotTorque*(RotDriftVel-TiltDeviceVel);
-	//RotDriftForce = KvR*maxRotTorque*(RotDriftVel);	
-	tool->addDeviceLocalTorque(RotDriftForce);
-
-
+        // send forces to device
+        tool->applyToDevice();
 
-      	/////////////////////////////////////////////////////////////////////
-        // ODE TOOL FORCES
-        /////////////////////////////////////////////////////////////////////
+        // update simulation, unless the ODE thread does: fixed steps for the
+        // real time elapsed, within the time budget of the tick
+        if (options.m_physicsRate <= 0.0)
+        {
+            if (replayTickPeriod > 0.0)
+            {
+                odeScheduler.beginTick(replayTickPeriod);
+            }
+            else
+            {
+                odeScheduler.beginTick();
+            }
+            while (odeScheduler.nextStep())
+            {
+                // ODE clears the external forces at each step
+                ODETool->addExternalForce(force);
+                ODETool->addExternalTorque(torque);
+                ODEWorld->updateDynamics(odeScheduler.getStepSize());
+                addBladeWear(force, odeScheduler.getStepSize());
+                odeScheduler.endStep();
+            }
+            odeScheduler.endTick();
+        }
 
-        // update new position and orientation of tool after the rotational drift
-        posAvatar = tool->m_hapticPoint->getGlobalPosProxy();
-	rotAvatar = avatarGlobalRot;
+        // mark the end of the tick and stop after the requested number of ticks when headless
+        frames.endTick();
+        hapticProfiler.endTick();
+        if (options.m_headless && (hapticProfiler.getNumTicks() >= options.m_ticks))
+        {
+            simulationRunning = false;
+        }
+    }
 
-        // compute position and angular error between tool and haptic device
-        deltaPos = (posAvatar - posTool);
-        deltaRot = cMul(cTranspose(rotTool), rotAvatar);
-        deltaRot.toAxisAngle(axis, angle);
-        
-        // compute force and torque to apply to tool
-        force = linStiffness * deltaPos;
-        torque = cMul((angStiffness * angle), axis);
-        rotTool.mul(torque);	
-        
-        // Apply force to the ODE tool
-        ODETool->addExternalForce(force);	
-        ODETool->addExternalTorque(torque);
+    // exit haptics thread
+    dCleanupODEAllDataForThread();
+    simulationFinished = true;
+}
 
+//---------------------------------------------------------------------------
 
-	/////////////////////////////////////////////////////////////////////
-        // CHECK WORKSPACE LIMITS
-        /////////////////////////////////////////////////////////////////////
+void computeToolCoupling(const cVector3d& a_posAvatar, const cMatrix3d& a_rotAvatar,
+                         const cVector3d& a_posTool, const cMatrix3d& a_rotTool,
+                         cVector3d& a_force, cVector3d& a_torque)
+{
+    // compute position and angular error between tool and avatar
+    cVector3d axis(1.0, 0.0, 0.0);
+    double angle = 0.0;
+    cVector3d deltaPos = (a_posAvatar - a_posTool);
+    cMatrix3d deltaRot = cMul(cTranspose(a_rotTool), a_rotAvatar);
+    deltaRot.toAxisAngle(axis, angle);
+
+    // compute force and torque to apply to tool
+    a_force = linStiffness * deltaPos;
+    a_torque = cMul((angStiffness * angle), axis);
+    a_rotTool.mul(a_torque);
+}
 
+//---------------------------------------------------------------------------
 
-	if (angleTheta>=(ThetaMax*3.14/180))
-	{
-		VirtualWSTorque = KVirtual*(angleTheta-(ThetaMax*3.14/180))*maxRotStiffness*RotCrossVector;
+void addBladeWear(const cVector3d& a_toolForce, double a_duration)
+{
+    if (bladeFieldGeom == NULL) { return; }
 
-	}
+    // the coupling force presses the tool on the blade; it is shared among
+    // the contacts by their depth
+    double totalDepth = 0.0;
+    for (size_t i=0; i<bladeFieldGeom->getNumLastContacts(); i++)
+    {
+        totalDepth += bladeFieldGeom->getLastContact(i).m_depth;
+    }
+    if (totalDepth > 0.0)
+    {
+        double force = a_toolForce.length() / totalDepth;
+        for (size_t i=0; i<bladeFieldGeom->getNumLastContacts(); i++)
+        {
+            const cODEDistanceFieldGeom::cContact& contact = bladeFieldGeom->getLastContact(i);
+            bladeWear.addContactAt(contact.m_pos, force * contact.m_depth, a_duration);
+        }
+    }
+    bladeFieldGeom->clearLastContacts();
+}
 
-	// Set the virtual workspace force to the device
-	tool->addDeviceLocalTorque(VirtualWSTorque);
+//---------------------------------------------------------------------------
 
+void updatePhysics(void)
+{
+    // ODE data of this thread, for the collision and step functions
+    dAllocateODEDataForThread(dAllocateMaskAll);
 
-	/////////////////////////////////////////////////////////////////////
-        // CHECK VIRTUAL WORKSPACE LIMITS
-        /////////////////////////////////////////////////////////////////////
+    // the thread is paced in real time, and each tick steps ODE for the time
+    // elapsed since the previous one
+    physicsProfiler.setPacingRate(options.m_physicsRate);
 
-	avatarRot.toAxisAngle(axis, angleAvatar);
+    // main ODE simulation loop
+    while(simulationRunning)
+    {
+        // wait for the time slot of the step
+        physicsProfiler.beginTick();
 
-	if (angleAvatar>=(ThetaE*3.14/180))
-	{
-		VirtualAvatarWSTorque = KVirtual*(angleAvatar-(ThetaE*3.14/180))*maxRotStiffness*RotCrossVector;
-	}
+        // update frequency counter
+        freqCounterPhysics.signal(1);
 
-	// Set the virtual workspace force to the device
-	tool->addDeviceLocalTorque(VirtualAvatarWSTorque);
+        // read the avatar pose published by the haptic loop
+        cTimedPose pose;
+        avatarPose.read(pose);
+        cVector3d posTarget = pose.getPos();
+        cMatrix3d rotTarget = pose.getRot();
 
-	/////////////////////////////////////////////////////////////////////
-        // APPLY FORCE /TORQUE AND UPDATE SIMULATION
-        /////////////////////////////////////////////////////////////////////
+        odeScheduler.beginTick();
+        while (odeScheduler.nextStep())
+        {
+            // compute force and torque to apply to tool; its global frame is
+            // only updated after the steps, but the ODE world is not moved in
+            // the world
+            cVector3d toolForce, toolTorque;
+            computeToolCoupling(posTarget, rotTarget, ODETool->getLocalPos(), ODETool->getLocalRot(), toolForce, toolTorque);
+
+            // Apply force to the ODE tool
+            ODETool->addExternalForce(toolForce);
+            ODETool->addExternalTorque(toolTorque);
+
+            // update simulation
+            ODEWorld->updateDynamics(odeScheduler.getStepSize());
+            addBladeWear(toolForce, odeScheduler.getStepSize());
+            odeScheduler.endStep();
+        }
+        odeScheduler.endTick();
 
-        // send forces to device
-        tool->applyToDevice();
+        // compute global reference frames of the ODE bodies and publish the
+        // pose of the tool to the haptic loop, if ODE was stepped
+        if (odeScheduler.getNumStepsInTick() > 0)
+        {
+            physicsFrames.markDirty(ODEWorld);
+            physicsFrames.update();
+            pose.set(cPoseInterpolator::now(), ODETool->getGlobalPos(), ODETool->getGlobalRot());
+            odeToolPose.write(pose);
+        }
+        physicsFrames.endTick();
 
-        // update simulation
-        ODEWorld->updateDynamics(nextSimInterval);
+        // mark the end of the step
+        physicsProfiler.endTick();
     }
 
-    // exit haptics thread
-    simulationFinished = true;
+    // exit ODE thread
+    dCleanupODEAllDataForThread();
+    physicsFinished = true;
 }
 
@@ -0,0 +1,2005 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <GLFW/glfw3.h>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+#include "CExampleOptions.h"
+#include "CRecordedHapticDevice.h"
+#include "CSyntheticHapticDevice.h"
+#include "CHapticLoopProfiler.h"
+#include "CWorkspaceDrift.h"
+#include "CWorkspaceConstraint.h"
+#include "CSpinLock.h"
+#include "CThreadAffinity.h"
+#include "CGlobalFrameUpdater.h"
+#include "CSceneCommandQueue.h"
+#include "CTelemetryOverlay.h"
+#include "CFramePacer.h"
+#include "CShadowMapCache.h"
+#include "COffscreenRenderer.h"
+#include "CPosePredictor.h"
+#include "CStartupTasks.h"
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// GENERAL SETTINGS
+//------------------------------------------------------------------------------
+
+// stereo Mode
+/*
+    C_STEREO_DISABLED:            Stereo is disabled 
+    C_STEREO_ACTIVE:              Active stereo for OpenGL NVDIA QUADRO cards
+    C_STEREO_PASSIVE_LEFT_RIGHT:  Passive stereo where L/R images are rendered next to each other
+    C_STEREO_PASSIVE_TOP_BOTTOM:  Passive stereo where L/R images are rendered above each other
+*/
+cStereoMode stereoMode = C_STEREO_DISABLED;
+
+// fullscreen mode
+bool fullscreen = false;
+
+// mirrored display
+bool mirroredDisplay = false;
+
+// state machine states
+const int STATE_IDLE            = 1;
+const int STATE_MODIFY_MAP      = 2;
+const int STATE_MOVE_CAMERA     = 3;
+
+// workspace drift variants
+const int VARIANT_DRIFT         = 0;    // drift proportional to the device speed
+const int VARIANT_EDGE          = 1;    // larger drift factor on the workspace edge
+const int VARIANT_BUBBLE        = 2;    // drift inside the workspace, rate control on its boundaries
+const int VARIANT_EXPANSION     = 3;    // scale factor growing with the distance to rd0
+
+
+//------------------------------------------------------------------------------
+// DECLARED TYPES
+//------------------------------------------------------------------------------
+
+// a haptic device, its tool and its haptic thread
+struct cHapticDeviceContext
+{
+    // index of the device
+    int m_index;
+
+    // the haptic device
+    cGenericHapticDevicePtr m_hapticDevice;
+
+    // a virtual tool representing the haptic device in the scene
+    cToolCursor* m_tool;
+
+    // a small magnetic line used to constrain the tool along the vertical axis
+    cShapeLine* m_magneticLine;
+
+    // two sphere placed at both end of the magnetic line
+    cShapeSphere* m_sphereA;
+    cShapeSphere* m_sphereB;
+
+    // a box to display the device workspace
+    cShapeBox* m_boxDeviceWS;
+
+    // a sphere drawn at the predicted position of the proxy, instead of the tool (--predict)
+    cShapeSphere* m_cursor;
+
+    // proxy and workspace box positions published by the haptic thread for the prediction
+    cPosePredictor m_cursorPredictor;
+    cPosePredictor m_boxPredictor;
+
+    // properties of haptic device and workspace
+    double m_workspaceScaleFactor;
+    double m_maxLinearForce;
+
+    // workspace drift state: rd0, rw, rd-rd0, drift velocity and force in device coordinates
+    cWorkspaceDriftState m_drift;
+
+    // virtual workspace of the device (box of half-size R around rd0)
+    cWorkspaceConstraint m_workspaceConstraint;
+
+    // home position of the haptic device
+    cVector3d m_deviceHomePos;
+
+    // position of the haptic device (rd) and avatar position, read by the graphics
+    cVector3d m_devicePos;
+    cVector3d m_avatarGlobalPos;
+
+    // state machine of the haptic loop (0: homing, 1: drift) and of the interaction
+    int m_stateHaptic;
+    int m_state;
+
+    // revision of the camera the tool is oriented with
+    unsigned int m_cameraRevision;
+
+    // global frames of the objects moved by the haptic thread
+    cGlobalFrameUpdater m_frames;
+
+    // changes of the displayed-only objects, applied by the graphics thread
+    cSceneCommandQueue m_sceneCommands;
+
+    // haptic thread
+    cThread* m_thread;
+
+    // a frequency counter to measure the haptic rate
+    cFrequencyCounter m_freqCounter;
+
+    // rate and per-tick latency of the haptic loop
+    cHapticLoopProfiler m_profiler;
+
+    // live latency percentiles displayed by the graphics thread
+    cHapticLoopMonitor m_monitor;
+
+    // a flag that indicates if the haptic loop has terminated
+    bool m_finished;
+};
+
+
+//------------------------------------------------------------------------------
+// DECLARED VARIABLES
+//------------------------------------------------------------------------------
+
+// a world that contains all objects of the virtual environment
+cWorld* world;
+
+// a camera to render the world in the window display
+cCamera* camera;
+
+// a light source to illuminate the objects in the world
+cSpotLight *light;
+
+// a haptic device handler
+cHapticDeviceHandler* handler;
+
+// radius of tool for graphic and haptic representation
+double hapticRadius;
+double displayRadius;
+
+// a virtual mesh like object
+cMesh* object;
+
+// a colored background
+cBackground* background;
+
+// a font for rendering text
+cFontPtr font;
+
+// a label to display the rate [Hz] at which the simulation is running
+cLabel* labelRates;
+
+// a label to explain what is happening
+cLabel* labelMessage;
+
+// a flag that indicates if the haptic simulation is currently running
+bool simulationRunning = false;
+
+// a frequency counter to measure the simulation graphic rate
+cFrequencyCounter freqCounterGraphics;
+
+// camera status
+bool flagCameraInMotion = false;
+
+// informs the graphic display callback to update the display list
+// when the topology of the 3D height map is changed.
+bool flagMarkForUpdate = false;
+
+// a handle to window display context
+GLFWwindow* window = NULL;
+
+// current width of window
+int width  = 0;
+
+// current height of window
+int height = 0;
+
+// swap interval for the display context (vertical synchronization)
+int swapInterval = 1;
+
+// root resource path
+string resourceRoot;
+
+// command line options
+cExampleOptions options;
+
+// haptic devices, their tools and haptic threads
+vector<cHapticDeviceContext*> devices;
+
+// serializes between haptic threads the collision queries, which write the
+// interaction state of the objects, the sculpting of the map and the camera
+cSpinLock worldLock;
+
+// number of devices sculpting the map or moving the camera (worldLock held)
+int numDevicesHoldingMap = 0;
+
+// number of devices sculpting the map (worldLock held)
+int numDevicesSculpting = 0;
+
+// incremented each time a device moves the camera (worldLock held)
+unsigned int cameraRevision = 0;
+
+// selected workspace drift variant
+int variant = VARIANT_DRIFT;
+string variantName = "drift";
+
+// workspace drift parameters (set by selectVariant())
+double Kd = 0.2; // drift factor
+double Kv = 0.2; //drift controller gain
+double R = 0.025; // device workspace radius
+double KdEdge = 0.8; // drift factor on the workspace edge (edge)
+double Kb = 0.05; //rate-control factor (bubble)
+double Re = 1.0; // virtual environment radius (expansion)
+
+//Position controller parameters
+double Kp = 0.2; //position controller proportional gain
+double Kde = 0.001; //position controller derivative gain
+double homingTolerance = 0.04; // distance to the home position at which homing ends
+
+//label to display the device relative position, drift velocity, drift force
+cLabel* labelDevicePosVelDrift;
+
+// text of labelDevicePosVelDrift, refreshed at options.m_hudRate
+cTelemetryOverlay hud;
+
+// frames in flight on the GPU and frame latency
+cFramePacer framePacer;
+
+// shadow maps, rendered again only when the light, a tool, a marker or the map changes
+cShadowMapCache shadowCache;
+
+// frame buffer and camera orbit of the offscreen benchmark (--offscreen)
+cOffscreenRenderer offscreen;
+
+// stiffness of the map, set for the least stiff device
+double maxStiffness;
+
+// Virtual workspace stiffness factor
+double KVirtual=1.5;
+
+// flag to indicate if the map is built; until then the haptic threads hold
+// their device in its idle mode
+atomic<bool> sceneReady(false);
+
+// damping [N s/m] and largest force [N] of the idle mode of the devices
+const double C_IDLE_DAMPING = 2.0;
+const double C_IDLE_MAX_FORCE = 1.0;
+
+// timed phases of the startup, the map being built by a background task,
+// and its progress shown in the window meanwhile
+cStartupTasks startup;
+cStartupScreen startupScreen;
+
+
+//------------------------------------------------------------------------------
+// DECLARED MACROS
+//------------------------------------------------------------------------------
+
+// convert to resource path
+#define RESOURCE_PATH(p)    (char*)((resourceRoot+string(p)).c_str())
+
+
+//------------------------------------------------------------------------------
+// DECLARED FUNCTIONS
+//------------------------------------------------------------------------------
+
+// callback when the window display is resized
+void windowSizeCallback(GLFWwindow* a_window, int a_width, int a_height);
+
+// callback when a key is pressed
+void keyCallback(GLFWwindow* a_window, int a_key, int a_scancode, int a_action, int a_mods);
+
+// callback when an error GLFW occurs
+void errorCallback(int error, const char* a_description);
+
+// this function renders the scene
+void updateGraphics(void);
+
+// this function contains the main haptics simulation loop of a device
+void updateHaptics(void* a_device);
+
+// haptic loop compiled for workspace drift controller T
+template <class T> void runHaptics(cHapticDeviceContext* a_device, const T& a_workspaceDrift);
+
+// this function creates a haptic device, its tool and the objects attached to it
+bool createDevice(cHapticDeviceContext* a_device, int a_index);
+
+// this function holds or releases the haptic interaction with the map (worldLock held)
+void holdMap(bool a_hold);
+
+// this function moves the camera to frame a_frame of the offscreen orbit
+void moveOffscreenCamera(unsigned long a_frame);
+
+// this function selects the workspace drift variant and its parameters
+bool selectVariant(const string& a_name);
+
+// this function shows the progress of the startup tasks until they are done; it returns false if the window was closed meanwhile
+bool waitForStartupTasks(void);
+
+// this function closes the application
+void close(void);
+
+// loads a bitmap file and create 3D height map based on pixel color
+int loadHeightMap();
+
+
+//==============================================================================
+/*
+    DEMO:    200-TransMap.cpp
+
+    Translational mapping of a small device workspace on a large height
+    map. The avatar workspace follows the hand with one of four workspace
+    drift variants, selected with --variant drift|edge|bubble|expansion.
+    With --devices N, N devices share the map, each with its own tool and
+    haptic thread.
+*/
+//==============================================================================
+
+int main(int argc, char* argv[])
+{
+    //--------------------------------------------------------------------------
+    // INITIALIZATION
+    //--------------------------------------------------------------------------
+
+    cout << endl;
+    cout << "-----------------------------------" << endl;
+    cout << "CHAI3D" << endl;
+    cout << "Demo: 20-map" << endl;
+    cout << "Copyright 2003-2016" << endl;
+    cout << "-----------------------------------" << endl << endl << endl;
+    cout << "Instructions:" << endl << endl;
+    cout << "- Use haptic device and user switch to move" << endl;
+    cout << "  camera or deform terrain." << endl << endl;
+    cout << "Keyboard Options:" << endl << endl;
+    cout << "[1] - Haptic Shading (ON/OFF)" << endl;
+    cout << "[2] - Wireframe (ON/OFF)" << endl;
+    cout << "[3] - Save map to 3D files: map3d.obj, map3d.3ds, map3d.stl" << endl;
+    cout << "[f] - Enable/Disable full screen mode" << endl;
+    cout << "[m] - Enable/Disable vertical mirroring" << endl;
+    cout << "[q] - Exit application" << endl;
+    cout << endl << endl;
+
+    // parse first arg to try and locate resources
+    resourceRoot = string(argv[0]).substr(0,string(argv[0]).find_last_of("/\\")+1);
+
+    // parse command line options
+    if (!options.parse(argc, argv))
+    {
+        return 1;
+    }
+
+    // select the workspace drift variant
+    if (!options.m_variant.empty() && !selectVariant(options.m_variant))
+    {
+        return 1;
+    }
+
+
+    //--------------------------------------------------------------------------
+    // OPEN GL - WINDOW DISPLAY
+    //--------------------------------------------------------------------------
+
+    int phase = startup.beginPhase("window");
+
+    // no window is created when the haptic loop runs headless
+    if (!options.m_headless)
+    {
+        // initialize GLFW library
+        if (!glfwInit())
+        {
+            cout << "failed initialization" << endl;
+            cSleepMs(1000);
+            return 1;
+        }
+
+        // set error callback
+        glfwSetErrorCallback(errorCallback);
+
+        // compute desired size of window
+        const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+        int w = 0.8 * mode->height;
+        int h = 0.5 * mode->height;
+        int x = 0.5 * (mode->width - w);
+        int y = 0.5 * (mode->height - h);
+
+        // set OpenGL version
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+
+        // set active stereo mode
+        if (stereoMode == C_STEREO_ACTIVE)
+        {
+            glfwWindowHint(GLFW_STEREO, GL_TRUE);
+        }
+        else
+        {
+            glfwWindowHint(GLFW_STEREO, GL_FALSE);
+        }
+
+        // the offscreen benchmark only needs the OpenGL context of the window
+        if (options.m_offscreen)
+        {
+            glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+        }
+
+        // create display context
+        window = glfwCreateWindow(w, h, "CHAI3D", NULL, NULL);
+        if (!window)
+        {
+            cout << "failed to create window" << endl;
+            cSleepMs(1000);
+            glfwTerminate();
+            return 1;
+        }
+
+        // get width and height of window
+        glfwGetWindowSize(window, &width, &height);
+
+        // set position of window
+        glfwSetWindowPos(window, x, y);
+
+        // set key callback
+        glfwSetKeyCallback(window, keyCallback);
+
+        // set resize callback
+        glfwSetWindowSizeCallback(window, windowSizeCallback);
+
+        // set current display context
+        glfwMakeContextCurrent(window);
+
+        // sets the swap interval for the current display context
+        glfwSwapInterval(swapInterval);
+
+#ifdef GLEW_VERSION
+        // initialize GLEW library
+        if (glewInit() != GLEW_OK)
+        {
+            cout << "failed to initialize GLEW library" << endl;
+            glfwTerminate();
+            return 1;
+        }
+#endif
+    }
+    startup.endPhase(phase);
+
+
+    //--------------------------------------------------------------------------
+    // WORLD - CAMERA - LIGHTING
+    //--------------------------------------------------------------------------
+    phase = startup.beginPhase("scene graph");
+
+    // create a new world.
+    world = new cWorld();
+
+    // set the background color of the environment
+    world->m_backgroundColor.setWhite();
+
+    // create a camera and insert it into the virtual world
+    camera = new cCamera(world);
+    world->addChild(camera);
+
+    // define a basis in spherical coordinates for the camera
+    camera->setSphericalReferences(cVector3d(0,0,0),    // origin
+                                   cVector3d(0,0,1),    // zenith direction
+                                   cVector3d(1,0,0));   // azimuth direction
+
+    camera->setSphericalDeg(3.5,    // spherical coordinate radius
+                            60,     // spherical coordinate polar angle
+                            5);     // spherical coordinate azimuth angle
+
+    // set the near and far clipping planes of the camera
+    // anything in front or behind these clipping planes will not be rendered
+    camera->setClippingPlanes(0.01, 10.0);
+
+    // set stereo mode
+    camera->setStereoMode(stereoMode);
+
+    // set stereo eye separation and focal length (applies only if stereo is enabled)
+    camera->setStereoEyeSeparation(0.03);
+    camera->setStereoFocalLength(3.0);
+
+    // set vertical mirrored display mode
+    camera->setMirrorVertical(mirroredDisplay);
+
+    // create a light source
+    light = new cSpotLight(world);
+
+    // attach light to camera
+    world->addChild(light);
+
+    // enable light source
+    light->setEnabled(true);
+
+    // position the light source
+    light->setLocalPos(2.5, 0.0, 2.0);
+
+    // define the direction of the light beam
+    light->setDir(-1.0, 0.0,-1.0);             
+
+    // enable this light source to generate shadows
+    light->setShadowMapEnabled(true);
+
+    // set the resolution of the shadow map
+    light->m_shadowMap->setQualityLow();
+    //light->m_shadowMap->setQualityMedium();
+
+    // or the resolution requested on the command line
+    if (!options.m_shadowQuality.empty() && !cSetShadowMapQuality(light, options.m_shadowQuality))
+    {
+        cout << "Error - unknown shadow quality: " << options.m_shadowQuality << " (verylow, low, medium, high or veryhigh)" << endl;
+        glfwTerminate();
+        return 1;
+    }
+
+    // set light cone half angle
+    light->setCutOffAngleDeg(25);
+    startup.endPhase(phase);
+
+
+    //--------------------------------------------------------------------------
+    // HAPTIC DEVICES / TOOLS
+    //--------------------------------------------------------------------------
+
+    // create a haptic device handler
+    phase = startup.beginPhase("haptic devices");
+    handler = new cHapticDeviceHandler();
+
+    // use the available haptic devices up to the requested number; every requested
+    // device is simulated or replayed when running headless or replaying
+    int numDevices = options.m_numDevices;
+    if (!options.m_headless && options.m_replayFile.empty() && ((int)handler->getNumDevices() < numDevices))
+    {
+        cout << "Warning - only " << handler->getNumDevices() << " haptic device(s) found" << endl;
+        numDevices = cMax(1, (int)handler->getNumDevices());
+    }
+
+    // create the devices, their tools and workspace boxes
+    for (int i=0; i<numDevices; i++)
+    {
+        cHapticDeviceContext* device = new cHapticDeviceContext();
+        devices.push_back(device);
+        if (!createDevice(device, i))
+        {
+            cSleepMs(1000);
+            glfwTerminate();
+            return 1;
+        }
+    }
+
+    // the shadows change when the light, a tool or a displayed marker moves
+    shadowCache.track(light);
+    for (unsigned int i=0; i<devices.size(); i++)
+    {
+        shadowCache.trackTool(devices[i]->m_tool);
+        shadowCache.track(devices[i]->m_boxDeviceWS);
+        shadowCache.track(devices[i]->m_cursor);
+        shadowCache.track(devices[i]->m_sphereA);
+        shadowCache.track(devices[i]->m_sphereB);
+        shadowCache.track(devices[i]->m_magneticLine);
+    }
+    startup.endPhase(phase);
+
+    // simulation in now running
+    simulationRunning = true;
+
+    // create one thread per device which starts its haptics rendering loop;
+    // each holds its device in its idle mode until the map is ready
+    for (unsigned int i=0; i<devices.size(); i++)
+    {
+        cHapticDeviceContext* device = devices[i];
+
+        // when headless, the haptic loop runs a fixed number of ticks and reports its timing
+        if (options.m_headless)
+        {
+            device->m_profiler.reserve(options.m_ticks);
+            if (options.m_paced)
+            {
+                device->m_profiler.setPacingRate(C_DEVICE_RECORD_TICK_RATE);
+            }
+        }
+
+        device->m_finished = false;
+        device->m_thread = new cThread();
+        device->m_thread->start(updateHaptics, CTHREAD_PRIORITY_HAPTICS, device);
+    }
+
+
+    /////////////////////////////////////////////////////////////////////////
+    // MAP
+    /////////////////////////////////////////////////////////////////////////
+
+    // create a virtual mesh
+    object = new cMesh();
+
+    // add object to world
+    world->addChild(object);
+
+    // set the position of the object at the center of the world
+    object->setLocalPos(0.0, 0.0, 0.0);
+
+    // Since we want to see our polygons from both sides, we disable culling.
+    object->setUseCulling(false);
+
+    // load default map in a background task, while the window shows its progress
+    if (!options.m_headless && !options.m_offscreen)
+    {
+        startupScreen.initialize(NEW_CFONTCALIBRI20());
+    }
+    startup.expectPhases(startup.getNumPhases() + 1);
+    int mapResult = 0;
+    startup.run([&]()
+    {
+        int mapPhase = startup.beginPhase("map");
+        mapResult = loadHeightMap();
+        startup.endPhase(mapPhase);
+    });
+    bool loaded = waitForStartupTasks();
+    if ((mapResult != 0) || !loaded)
+    {
+        close();
+        glfwTerminate();
+        return (loaded ? 1 : 0);
+    }
+
+    // set color properties
+    object->m_material->setBlueCornflower();
+
+    // set stiffness
+    object->m_material->setStiffness(0.5 * maxStiffness);
+
+    // enable haptic shading
+    object->m_material->setUseHapticShading(true);
+
+    // use display list to increase graphical rendering performance
+    object->setUseDisplayList(true);
+
+
+    //--------------------------------------------------------------------------
+    // WIDGETS
+    //--------------------------------------------------------------------------
+
+    // create a font
+    phase = startup.beginPhase("widgets");
+    font = NEW_CFONTCALIBRI20();
+    
+    // create a label to display the haptic and graphic rate of the simulation
+    labelRates = new cLabel(font);
+    camera->m_frontLayer->addChild(labelRates);
+
+    // create a label to display the device relative position, drift velocity, drift force
+    labelDevicePosVelDrift = new cLabel(font);
+    camera->m_frontLayer->addChild(labelDevicePosVelDrift);
+    hud.setRefreshRate(options.m_hudRate);
+
+    // set font color
+    labelRates->m_fontColor.setBlack();
+
+    // create a background
+    background = new cBackground();
+    camera->m_backLayer->addChild(background);
+
+    // set background properties
+    background->setCornerColors(cColorf(1.0f, 1.0f, 1.0f),
+                                cColorf(1.0f, 1.0f, 1.0f),
+                                cColorf(0.8f, 0.8f, 0.8f),
+                                cColorf(0.8f, 0.8f, 0.8f));
+    startup.endPhase(phase);
+
+
+    //--------------------------------------------------------------------------
+    // START SIMULATION
+    //--------------------------------------------------------------------------
+
+    // compute global reference frames for each object; the haptic threads
+    // then update the frames of the objects they move only (cGlobalFrameUpdater)
+    phase = startup.beginPhase("start simulation");
+    world->computeGlobalPositions(true);
+
+    // the map is ready: the haptic threads leave their idle mode
+    sceneReady = true;
+    startup.endPhase(phase);
+
+    // title of the report of the startup phases
+    string startupTitle = "200-TransMap startup (map " + ((options.m_mapSize > 0) ? to_string(options.m_mapSize) : string("image")) + ")";
+
+    // when headless, wait for the haptic loops and report their timing
+    if (options.m_headless)
+    {
+        startup.setInteractive();
+        startup.printReport(startupTitle);
+        for (unsigned int i=0; i<devices.size(); i++)
+        {
+            while (!devices[i]->m_finished) { cSleepMs(10); }
+        }
+        for (unsigned int i=0; i<devices.size(); i++)
+        {
+            devices[i]->m_profiler.printReport("200-TransMap (" + variantName + ") device " + to_string(i) + " haptic loop");
+            printf("global frames: %.1f nodes updated per tick, %d nodes in the world\n",
+                   devices[i]->m_frames.getMeanNodesPerTick(), cGlobalFrameUpdater::countNodes(world));
+        }
+        close();
+        return 0;
+    }
+
+    // setup callback when application exits
+    atexit(close);
+
+
+    //--------------------------------------------------------------------------
+    // MAIN GRAPHIC LOOP
+    //--------------------------------------------------------------------------
+
+    // call window size callback at initialization
+    windowSizeCallback(window, width, height);
+
+    // the offscreen benchmark renders one orbit of the camera around the map
+    if (options.m_offscreen)
+    {
+        if (options.m_frames == 0) { options.m_frames = 360; }
+        offscreen.initialize(camera);
+        offscreen.setOrbit(cVector3d(0,0,0), 3.5, 60, 5, options.m_frames);
+        width = cOffscreenRenderer::C_WIDTH;
+        height = cOffscreenRenderer::C_HEIGHT;
+    }
+
+    // pace the frames with fences if the context supports them
+    framePacer.initialize(options.m_framesInFlight);
+    framePacer.reserve((options.m_frames > 0) ? options.m_frames : 36000);
+
+    // measure the error of the predicted positions of every frame
+    if (options.m_predictionError)
+    {
+        for (unsigned int i=0; i<devices.size(); i++)
+        {
+            devices[i]->m_cursorPredictor.reserve((options.m_frames > 0) ? options.m_frames : 36000);
+            devices[i]->m_boxPredictor.reserve((options.m_frames > 0) ? options.m_frames : 36000);
+        }
+    }
+
+    // main graphic loop
+    while (!glfwWindowShouldClose(window))
+    {
+        // get width and height of window, or move the camera along the orbit
+        if (options.m_offscreen)
+        {
+            moveOffscreenCamera(framePacer.getNumFrames());
+        }
+        else
+        {
+            glfwGetWindowSize(window, &width, &height);
+        }
+
+        // mark the beginning of the frame
+        framePacer.beginFrame();
+
+        // render graphics
+        updateGraphics();
+
+        // swap buffers
+        if (!options.m_offscreen)
+        {
+            glfwSwapBuffers(window);
+        }
+
+        // limit the frames in flight on the GPU and measure the frame latency
+        framePacer.endFrame();
+
+        // the example is interactive from its first frame
+        if (framePacer.getNumFrames() == 1)
+        {
+            startup.setInteractive();
+            startup.printReport(startupTitle);
+        }
+
+        // process events
+        glfwPollEvents();
+
+        // signal frequency counter
+        freqCounterGraphics.signal(1);
+
+        // exit after the requested number of frames
+        if ((options.m_frames > 0) && (framePacer.getNumFrames() >= options.m_frames))
+        {
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
+    }
+
+    // report the frame timing
+    if (options.m_offscreen)
+    {
+        framePacer.printReport("200-TransMap offscreen frames (map " +
+                               ((options.m_mapSize > 0) ? to_string(options.m_mapSize) : string("image")) + ", shadows " +
+                               (options.m_shadowQuality.empty() ? string("low") : options.m_shadowQuality) + ")");
+    }
+    else
+    {
+        framePacer.printReport("200-TransMap frames");
+    }
+    printf("shadow maps rendered: %.1f%% of the frames\n", 100.0 * shadowCache.getUpdateRatio());
+
+    // report the scene commands lost while the graphics thread lagged behind
+    for (unsigned int i=0; i<devices.size(); i++)
+    {
+        if (devices[i]->m_sceneCommands.getNumDropped() > 0)
+        {
+            printf("device %d scene commands: %lu applied, %lu coalesced, %lu dropped while the queue was full\n", i,
+                   devices[i]->m_sceneCommands.getNumApplied(), devices[i]->m_sceneCommands.getNumCoalesced(),
+                   devices[i]->m_sceneCommands.getNumDropped());
+        }
+    }
+
+    // report the error of the predicted positions
+    if (options.m_predictionError)
+    {
+        for (unsigned int i=0; i<devices.size(); i++)
+        {
+            devices[i]->m_cursorPredictor.printReport("200-TransMap device " + to_string(i) + " cursor prediction");
+            devices[i]->m_boxPredictor.printReport("200-TransMap device " + to_string(i) + " workspace box prediction");
+        }
+    }
+
+    // save the reference images, after the timed frames since reading them back waits for the GPU
+    if (options.m_offscreen && !options.m_referencePrefix.empty())
+    {
+        for (int i=0; i<cOffscreenRenderer::C_NUM_REFERENCE_IMAGES; i++)
+        {
+            moveOffscreenCamera(offscreen.getReferenceFrame(i));
+            updateGraphics();
+            if (!offscreen.saveReferenceImage(options.m_referencePrefix, i))
+            {
+                cout << "Error - failed to save reference image " << i << endl;
+            }
+        }
+    }
+
+    // close window
+    glfwDestroyWindow(window);
+
+    // terminate GLFW library
+    glfwTerminate();
+
+    // exit
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+
+void windowSizeCallback(GLFWwindow* a_window, int a_width, int a_height)
+{
+    // update window size
+    width  = a_width;
+    height = a_height;
+}
+
+//------------------------------------------------------------------------------
+
+void errorCallback(int a_error, const char* a_description)
+{
+    cout << "Error: " << a_description << endl;
+}
+
+//------------------------------------------------------------------------------
+
+void keyCallback(GLFWwindow* a_window, int a_key, int a_scancode, int a_action, int a_mods)
+{
+    // filter calls that only include a key press
+    if ((a_action != GLFW_PRESS) && (a_action != GLFW_REPEAT))
+    {
+        return;
+    }
+
+    // option - exit
+    else if ((a_key == GLFW_KEY_ESCAPE) || (a_key == GLFW_KEY_Q))
+    {
+        glfwSetWindowShouldClose(a_window, GLFW_TRUE);
+    }
+
+    // only exit and fullscreen until the map is ready
+    else if (!sceneReady && (a_key != GLFW_KEY_F))
+    {
+        return;
+    }
+
+    // option - haptic shading:
+    else if (a_key == GLFW_KEY_1)
+    {
+        bool useHapticShading = !object->m_material->getUseHapticShading();
+        object->m_material->setUseHapticShading(useHapticShading);
+        if (useHapticShading)
+            cout << "> Haptic shading enabled     \r";
+        else
+            cout << "> Haptic shading disabled    \r";
+    }
+
+    // option - wire mode
+    else if (a_key == GLFW_KEY_2)
+    {
+        bool useWireMode = !object->getWireMode();
+        object->setWireMode(useWireMode);
+        shadowCache.invalidate();
+        if (useWireMode)
+            cout << "> Wire mode enabled          \r";
+        else
+            cout << "> Wire mode disabled         \r";
+    }
+
+    // option - save to file
+    else if (a_key == GLFW_KEY_3)
+    {
+        cMultiMesh* multimesh = new cMultiMesh();
+        cMesh* mesh = object->copy();
+        multimesh->addMesh(mesh);
+        multimesh->saveToFile("map3d.3ds");
+        multimesh->saveToFile("map3d.obj");
+        multimesh->saveToFile("map3d.stl");
+        delete multimesh;
+        cout << "> 3D Map has been saved to files \r";
+    }
+
+   // option - display device workspace
+    else if (a_key == GLFW_KEY_W)
+    {
+	bool showBoxes = !devices[0]->m_boxDeviceWS->getEnabled();
+	for (unsigned int i=0; i<devices.size(); i++)
+	{
+		devices[i]->m_boxDeviceWS->setEnabled(showBoxes);
+	}
+        
+    }
+
+
+
+
+    // option - toggle fullscreen
+    else if (a_key == GLFW_KEY_F)
+    {
+        // toggle state variable
+        fullscreen = !fullscreen;
+
+        // get handle to monitor
+        GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+
+        // get information about monitor
+        const GLFWvidmode* mode = glfwGetVideoMode(monitor);
+
+        // set fullscreen or window mode
+        if (fullscreen)
+        {
+            glfwSetWindowMonitor(window, monitor, 0, 0, mode->width, mode->height, mode->refreshRate);
+            glfwSwapInterval(swapInterval);
+        }
+        else
+        {
+            int w = 0.8 * mode->height;
+            int h = 0.5 * mode->height;
+            int x = 0.5 * (mode->width - w);
+            int y = 0.5 * (mode->height - h);
+            glfwSetWindowMonitor(window, NULL, x, y, w, h, mode->refreshRate);
+            glfwSwapInterval(swapInterval);
+        }
+    }
+
+    // option - toggle vertical mirroring
+    else if (a_key == GLFW_KEY_M)
+    {
+        mirroredDisplay = !mirroredDisplay;
+        camera->setMirrorVertical(mirroredDisplay);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+bool waitForStartupTasks(void)
+{
+    // render the progress of the tasks, as long as they run; the world they
+    // build is not rendered until they are done. Once the window is closed
+    // (exit key or close button), it is hidden while the tasks finish, since
+    // they cannot be interrupted
+    bool closed = false;
+    while (!startup.isDone())
+    {
+        if (startupScreen.isInitialized() && !closed)
+        {
+            glfwGetWindowSize(window, &width, &height);
+            startupScreen.render(startup, width, height);
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+            closed = (glfwWindowShouldClose(window) != 0);
+            if (closed)
+            {
+                glfwHideWindow(window);
+            }
+        }
+        else
+        {
+            cSleepMs(1);
+        }
+    }
+    startup.wait();
+    return (!closed);
+}
+
+//------------------------------------------------------------------------------
+
+void close(void)
+{
+    // stop the simulation
+    simulationRunning = false;
+
+    // wait for graphics and haptics loops to terminate
+    for (unsigned int i=0; i<devices.size(); i++)
+    {
+        while (!devices[i]->m_finished) { cSleepMs(100); }
+    }
+
+    // close haptic devices
+    for (unsigned int i=0; i<devices.size(); i++)
+    {
+        devices[i]->m_tool->stop();
+        delete devices[i]->m_thread;
+        delete devices[i];
+    }
+    devices.clear();
+
+    // delete resources
+    delete world;
+    delete handler;
+}
+
+//------------------------------------------------------------------------------
+
+void updateGraphics(void)
+{
+    /////////////////////////////////////////////////////////////////////
+    // UPDATE WIDGETS
+    /////////////////////////////////////////////////////////////////////
+
+    // update haptic and graphic rate data
+    //labelRates->setText(cStr(freqCounterGraphics.getFrequency(), 0) + " Hz / " +
+     //   cStr(freqCounterHaptics.getFrequency(), 0) + " Hz");
+
+    // update position of label
+    //labelRates->setLocalPos((int)(0.5 * (width - labelRates->getWidth())), 15);
+
+    // update position of message label
+    //labelMessage->setLocalPos((int)(0.5 * (width - labelMessage->getWidth())), 50);
+
+    // update rates, latencies and device relative position, drift velocity, drift force
+    if (hud.isRefreshDue())
+    {
+	hud.clear();
+	hud.append("%s %.0f Hz", variantName.c_str(), freqCounterGraphics.getFrequency());
+	for (unsigned int i=0; i<devices.size(); i++)
+	{
+		cHapticDeviceContext* device = devices[i];
+		const cWorkspaceDriftState& drift = device->m_drift;
+		device->m_monitor.update(device->m_profiler);
+		hud.append(" | %.0f Hz %.1f/%.1f us ", device->m_freqCounter.getFrequency(),
+			   1e6 * device->m_monitor.m_p50, 1e6 * device->m_monitor.m_p99);
+		hud.appendVector(drift.m_devicePosRel, 3);
+		hud.append(" m ");
+		hud.appendVector(drift.m_wsCenter, 3);
+		hud.append("m ");
+		hud.appendVector(drift.m_driftForce, 3);
+		hud.append("N x%.0f %dbox%d %d nodes", drift.m_workspaceScaleFactor, device->m_stateHaptic,
+			   (int)device->m_boxDeviceWS->getEnabled(), device->m_frames.getNumNodesLastTick());
+	}
+	hud.applyTo(labelDevicePosVelDrift);
+    }
+
+    // update position of labelDevicePosVelDrift 
+    labelDevicePosVelDrift->setLocalPos((int)(0.5 * (width - labelDevicePosVelDrift->getWidth())), 15);
+
+
+
+
+    /////////////////////////////////////////////////////////////////////
+    // UPDATE MODEL
+    /////////////////////////////////////////////////////////////////////
+
+    // update object normals while a device sculpts the map
+    for (unsigned int i=0; i<devices.size(); i++)
+    {
+        if (devices[i]->m_state == STATE_MODIFY_MAP)
+        {
+            object->computeAllNormals();
+            break;
+        }
+    }
+
+    // apply the changes of the displayed-only objects recorded by the haptic threads
+    for (unsigned int i=0; i<devices.size(); i++)
+    {
+        devices[i]->m_sceneCommands.apply();
+    }
+
+    // draw the cursors and the workspace boxes where they will be when the frame is displayed
+    if (options.m_predict || options.m_predictionError)
+    {
+        double displayTime = cPosePredictor::now() + framePacer.getMeanLatency();
+        for (unsigned int i=0; i<devices.size(); i++)
+        {
+            cHapticDeviceContext* device = devices[i];
+            cVector3d pos;
+            if (device->m_cursorPredictor.predict(displayTime, pos) && options.m_predict)
+            {
+                // the predicted cursor replaces the tool once the haptic thread publishes it
+                if (!device->m_cursor->getShowEnabled())
+                {
+                    device->m_tool->setShowEnabled(false);
+                    device->m_cursor->setShowEnabled(true);
+                }
+                device->m_cursor->setLocalPos(pos);
+            }
+            if (device->m_boxPredictor.predict(displayTime, pos) && options.m_predict)
+            {
+                device->m_boxDeviceWS->setLocalPos(pos);
+            }
+        }
+    }
+
+    // if the mesh has been modified we update the display list
+    if (flagMarkForUpdate)
+    {
+        object->markForUpdate(false);
+        flagMarkForUpdate = false;
+        shadowCache.invalidate();
+    }
+
+
+    /////////////////////////////////////////////////////////////////////
+    // RENDER SCENE
+    /////////////////////////////////////////////////////////////////////
+
+    // update shadow maps (if any), only when they are out of date
+    shadowCache.update(world, mirroredDisplay);
+
+    // render world, into the frame buffer of the offscreen benchmark if any
+    if (offscreen.isInitialized())
+    {
+        offscreen.renderView();
+    }
+    else
+    {
+        camera->renderView(width, height);
+    }
+
+    // check for any OpenGL errors (batched by the frame pacer in release builds)
+    GLenum err = framePacer.checkErrors();
+    if (err != GL_NO_ERROR) cout << "Error: " << gluErrorString(err) << endl;
+}
+
+//------------------------------------------------------------------------------
+
+void updateHaptics(void* a_device)
+{
+    cHapticDeviceContext* device = (cHapticDeviceContext*)a_device;
+    double maxLinearForce = device->m_maxLinearForce;
+
+    // pin each haptic thread to its own core, leaving core 0 to the graphics
+    int numCores = cGetNumCores();
+    if (numCores > 1)
+    {
+        cSetCurrentThreadAffinity(1 + device->m_index % (numCores - 1));
+    }
+
+    // until the map is ready, only damp the motion of the device, within a
+    // force small enough to be safe wherever it is held; a recorded device
+    // is damped directly and a replayed or simulated one waits, so that the
+    // ticks of the session start with the map
+    cGenericHapticDevicePtr idleDevice = cGetPhysicalDevice(device->m_hapticDevice);
+    double idleMaxForce = cMin(C_IDLE_MAX_FORCE, maxLinearForce);
+    while (simulationRunning && !sceneReady)
+    {
+        if (idleDevice != NULL)
+        {
+            cHoldDeviceIdle(idleDevice, C_IDLE_DAMPING, idleMaxForce);
+        }
+        else
+        {
+            cSleepMs(1);
+        }
+    }
+
+    // run the haptic loop compiled for the selected workspace drift variant
+    switch (variant)
+    {
+    case VARIANT_EDGE :
+        runHaptics(device, cEdgeGainDrift(Kv, R, maxLinearForce, cEdgeDriftGain(Kd, KdEdge)));
+        break;
+    case VARIANT_BUBBLE :
+        runHaptics(device, cBubbleDrift(Kv, R, maxLinearForce, cConstantDriftGain(Kd), cBubbleRateControl(Kb)));
+        break;
+    case VARIANT_EXPANSION :
+        runHaptics(device, cExpansionDrift(Kv, R, maxLinearForce, cConstantDriftGain(Kd), cNoRateControl(),
+                                           cExpansionScale(device->m_workspaceScaleFactor, Re)));
+        break;
+    default :
+        runHaptics(device, cTranslationalDrift(Kv, R, maxLinearForce, cConstantDriftGain(Kd)));
+        break;
+    }
+
+    // exit haptics thread
+    device->m_finished = true;
+}
+
+//------------------------------------------------------------------------------
+
+template <class T> void runHaptics(cHapticDeviceContext* a_device, const T& a_workspaceDrift)
+{
+    // objects and state of the device
+    cGenericHapticDevicePtr hapticDevice = a_device->m_hapticDevice;
+    cToolCursor* tool = a_device->m_tool;
+    cShapeLine* magneticLine = a_device->m_magneticLine;
+    cShapeSphere* sphereA = a_device->m_sphereA;
+    cShapeSphere* sphereB = a_device->m_sphereB;
+    cShapeBox* boxDeviceWS = a_device->m_boxDeviceWS;
+    cWorkspaceDriftState& drift = a_device->m_drift;
+    const cWorkspaceConstraint& workspaceConstraint = a_device->m_workspaceConstraint;
+    const cVector3d& deviceHomePos = a_device->m_deviceHomePos;
+    cVector3d& devicePos = a_device->m_devicePos;
+    cVector3d& avatarGlobalPos = a_device->m_avatarGlobalPos;
+    int& stateHaptic = a_device->m_stateHaptic;
+    int& state = a_device->m_state;
+    cHapticLoopProfiler& hapticProfiler = a_device->m_profiler;
+    cGlobalFrameUpdater& frames = a_device->m_frames;
+    cSceneCommandQueue& sceneCommands = a_device->m_sceneCommands;
+    cPosePredictor& cursorPredictor = a_device->m_cursorPredictor;
+    cPosePredictor& boxPredictor = a_device->m_boxPredictor;
+    double maxLinearForce = a_device->m_maxLinearForce;
+
+    // position controller of the homing
+    cVector3d positionError(0.0, 0.0, 0.0);
+    cVector3d newPositionError(0.0, 0.0, 0.0);
+    cVector3d ForcePosControl;
+    int k = 0;
+
+    // device velocity, avatar position, workspace box position and virtual workspace force
+    cVector3d deviceVel;
+    cVector3d avatarPos;
+    cVector3d boxPosition;
+    cVector3d VirtualWSForce;
+
+    // initialize state to idle
+    state = STATE_IDLE;  
+
+    // collision tree of the map to rebuild once the lock is released
+    bool rebuildMap = false;
+
+    // current tool position
+    cVector3d toolGlobalPos;        // global world coordinates
+    cVector3d toolLocalPos;         // local coordinates
+
+    // previous tool position
+    cVector3d prevToolGlobalPos;    // global world coordinates
+    cVector3d prevToolLocalPos;     // local coordinates
+
+    // main haptic simulation loop
+    while(simulationRunning)
+    {
+
+        // mark the beginning of the tick
+        hapticProfiler.beginTick();
+
+	switch (stateHaptic)
+	{
+	case 0 : // Device Homing and parameters initialization
+
+		// compute global reference frames of the objects moved since the last tick
+		frames.markDirty(tool);
+        	frames.update();
+
+		// update position and orientation of tool
+    		tool->updateFromDevice();
+		// Get device position
+		devicePos = tool->getDeviceLocalPos();
+		// Position error
+		newPositionError=deviceHomePos-devicePos;
+
+		if (newPositionError.length()<=homingTolerance)
+		{
+
+		// the collision queries write the interaction state of the objects
+		worldLock.acquire();
+
+		// compute interaction forces
+        	tool->computeInteractionForces();
+ 		// send forces to haptic device
+        	tool->applyToDevice();
+
+		// Get device initial position rd0 (in local coordinates)
+    		hapticDevice->getPosition(drift.m_devicePosIni);
+	
+		// Initialize avatar workspace center
+		drift.m_wsCenter = tool->getDeviceLocalPos();
+
+		// Initialize workspace box position
+		boxPosition = tool->getDeviceGlobalPos();	
+		sceneCommands.setLocalPos(boxDeviceWS, boxPosition);
+
+		worldLock.release();
+
+		stateHaptic = 1;
+		}
+		else // Move to homing position
+		{
+
+		if (k==0)
+		    {positionError=newPositionError;}
+		
+		// PD force controller
+		ForcePosControl=Kp*maxLinearForce*newPositionError+Kde*maxLinearForce*(newPositionError-positionError)*4000; //For omega.7 frequency !
+		// Send forces to haptic device
+        	hapticDevice->setForce(ForcePosControl);
+
+		positionError=newPositionError;
+		k=k+1;
+		}
+				
+		break;
+	case 1 :
+
+        // compute global reference frames of the objects moved since the last tick
+        frames.markDirty(tool);
+        frames.update();
+
+
+	/////////////////////////////////////////////////////////////////////
+        // WORKSPACE DRIFT CONTROL
+        /////////////////////////////////////////////////////////////////////
+
+	// get position of the device rd (in local coordinates)
+	hapticDevice->getPosition(devicePos);
+
+	// get velocity of the device vd (in local coordinates)
+	hapticDevice->getLinearVelocity(deviceVel);
+
+	// compute the drift velocity, the avatar workspace position and the drift force
+	a_workspaceDrift.update(drift, devicePos, deviceVel);
+
+	// set new workspace box size
+	if (T::hasVariableScale())
+	{
+		sceneCommands.setBoxSize(boxDeviceWS, 0.05*drift.m_workspaceScaleFactor, 0.05*drift.m_workspaceScaleFactor, 0.05*drift.m_workspaceScaleFactor);
+	}
+
+
+	/////////////////////////////////////////////////////////////////////
+        // CHECK WORKSPACE LIMITS
+        /////////////////////////////////////////////////////////////////////
+
+	// penalty force that keeps the device inside its workspace
+	workspaceConstraint.computeForce(drift.m_devicePosRel, VirtualWSForce);
+
+        // read user switch
+        bool userSwitch = tool->getUserSwitch(0);
+
+	// the collision queries, the sculpting of the map and the camera are
+	// serialized between the haptic threads
+	worldLock.acquire();
+
+	// oriente tool with camera if another device has moved it
+	if (a_device->m_cameraRevision != cameraRevision)
+	{
+		tool->setLocalRot(camera->getLocalRot());
+		frames.markDirty(tool);
+		a_device->m_cameraRevision = cameraRevision;
+	}
+
+
+        /////////////////////////////////////////////////////////////////////
+        // HAPTIC FORCE COMPUTATION
+        /////////////////////////////////////////////////////////////////////
+
+	// set avatar velocity in device coordinates
+	tool->setDeviceLocalLinVel(drift.m_avatarVel);
+
+	// update the device workspace box position
+	tool->setDeviceLocalPos(drift.m_wsCenter);
+	boxPosition = tool->getDeviceGlobalPos();
+	sceneCommands.setLocalPos(boxDeviceWS, boxPosition);
+
+	// set avatar position in device coordinates
+	avatarPos = drift.m_avatarPos;
+	tool->setDeviceLocalPos(avatarPos);
+	avatarGlobalPos = tool->getDeviceGlobalPos();
+
+        // compute interaction forces
+        tool->computeInteractionForces();
+
+        // update tool position
+        toolGlobalPos = tool->getDeviceGlobalPos();
+        toolLocalPos  = tool->getDeviceLocalPos();
+
+        if ((state == STATE_MOVE_CAMERA) && (!userSwitch))
+        {
+            state = STATE_IDLE;
+
+            // enable haptic interaction with map
+            holdMap(false);
+        }
+
+        else if (((state == STATE_MODIFY_MAP) && (!userSwitch)) ||
+                 ((state == STATE_MODIFY_MAP) && (!tool->isInContact(magneticLine))))
+        {
+            state = STATE_IDLE;
+
+            // disable magnetic line
+            magneticLine->setHapticEnabled(false);
+            sceneCommands.setShowEnabled(magneticLine, false);
+
+            // disable spheres
+            sceneCommands.setShowEnabled(sphereA, false);
+            sceneCommands.setShowEnabled(sphereB, false);
+
+            // the last device to stop sculpting rebuilds the collision tree of
+            // the map once out of the lock, and keeps the map held until then
+            numDevicesSculpting--;
+            if (numDevicesSculpting == 0)
+            {
+                rebuildMap = true;
+            }
+            else
+            {
+                // enable haptic interaction with map
+                holdMap(false);
+            }
+        }
+
+        // user clicks with the mouse
+        else if ((state == STATE_IDLE) && (userSwitch))
+        {
+            // start deforming object
+            if (tool->isInContact(object))
+            {
+                state = STATE_MODIFY_MAP;
+
+                // update position of line
+                cVector3d posA = toolGlobalPos;
+                posA.z(-0.7);
+
+                cVector3d posB = toolGlobalPos;
+                posB.z(0.7);
+
+                magneticLine->m_pointA = posA;
+                magneticLine->m_pointB = posB;
+
+                // update position of spheres
+                sceneCommands.setLocalPos(sphereA, posA);
+                sceneCommands.setLocalPos(sphereB, posB);
+
+                // enable spheres
+                sceneCommands.setShowEnabled(sphereA, true);
+                sceneCommands.setShowEnabled(sphereB, true);
+
+                // enable magnetic line
+                magneticLine->setHapticEnabled(true);
+                sceneCommands.setShowEnabled(magneticLine, true);
+
+                // disable haptic interaction with map
+                numDevicesSculpting++;
+                holdMap(true);
+            }
+
+            // start moving camera
+            else
+            {
+                state = STATE_MOVE_CAMERA;
+                
+                // disable haptic interaction with map
+                holdMap(true);
+            }
+        }
+
+        // modify map
+        else if (state == STATE_MODIFY_MAP)
+        {
+            // compute tool offset
+            cVector3d offset = toolGlobalPos - prevToolGlobalPos;
+
+            // map offset on z axis
+            double offsetHeight = offset.z();
+
+            // apply offset to all vertices through a weighted function
+            int numVertices = object->getNumVertices();
+            for (int i=0; i<numVertices; i++)
+            {
+                // compute distance between vertex and tool
+                cVector3d posTool = tool->m_hapticPoint->getGlobalPosProxy();
+                cVector3d posVertex = object->m_vertices->getLocalPos(i);
+                double distance = cDistance(posTool, posVertex);
+
+                // compute factor
+                double RADIUS = 0.4;
+                double relativeDistance = distance / RADIUS;
+                double clampedRelativeDistance = cClamp01(relativeDistance);
+                double w = 0.5 + 0.5 * cos(clampedRelativeDistance * C_PI);
+
+                // apply offset
+                double offsetVertexHeight = w * offsetHeight;
+                posVertex.z(posVertex.z() + offsetVertexHeight);
+                object->m_vertices->setLocalPos(i, posVertex);
+
+                // mesh has been modified, inform the graphic rendering call back to
+                // update the display list of the map.
+                flagMarkForUpdate = true;
+            }
+        }
+
+        // move camera
+        else if (state == STATE_MOVE_CAMERA)
+        {
+            // compute tool offset
+            cVector3d offset = toolLocalPos - prevToolLocalPos;
+
+            // compute new coordinates for camera in spherical coordinates
+            double radius = camera->getSphericalRadius() - 2 * offset.x();
+            double azimuthDeg = camera->getSphericalAzimuthDeg() - 40 * offset.y();
+            double polarDeg = camera->getSphericalPolarDeg() + 40 * offset.z();
+
+            // update coordinates
+            camera->setSphericalDeg(radius, polarDeg, azimuthDeg);
+            frames.markDirty(camera);
+
+            // oriente tool with camera
+            tool->setLocalRot(camera->getLocalRot());
+            frames.markDirty(tool);
+            cameraRevision++;
+            a_device->m_cameraRevision = cameraRevision;
+        }
+
+        // update the frames of the camera and of the tool moved by the device
+        frames.update();
+
+        worldLock.release();
+
+	// publish the proxy and the workspace box with their velocity, from
+	// which the graphics thread predicts them at the display time
+	if (options.m_predict || options.m_predictionError)
+	{
+		cMatrix3d toolRot = tool->getGlobalRot();
+		cursorPredictor.publish(tool->m_hapticPoint->getGlobalPosProxy(), toolRot * drift.m_avatarVel);
+		boxPredictor.publish(boxPosition, toolRot * drift.m_wsCenterVel);
+	}
+
+	// drift of the device
+	tool->addDeviceLocalForce(drift.m_driftForce);
+
+	// Set the virtual workspace force to the device
+	tool->addDeviceLocalForce(VirtualWSForce);
+
+        // store tool position
+        prevToolLocalPos  = toolLocalPos;
+        prevToolGlobalPos = toolGlobalPos;
+
+        // update bounding box (can take a little time) into a spare tree while
+        // the other devices keep running, then swap it in and release the map
+        if (rebuildMap)
+        {
+            rebuildMap = false;
+
+            // disable forces
+            tool->setForcesOFF();
+
+            cCollisionAABB* collisionTree = new cCollisionAABB();
+            collisionTree->initialize(object->m_triangles, 1.01 * hapticRadius);
+
+            // enable forces again
+            tool->setForcesON();
+
+            worldLock.acquire();
+            cGenericCollision* previousTree = object->getCollisionDetector();
+            object->setCollisionDetector(collisionTree);
+            holdMap(false);
+            worldLock.release();
+
+            // no query can run on the previous tree once it is swapped out under the lock
+            delete previousTree;
+        }
+
+        // send forces to haptic device
+        tool->applyToDevice();
+
+        // update frequency counter
+        a_device->m_freqCounter.signal(1);
+
+	break;
+	}
+
+        // mark the end of the tick and stop after the requested number of ticks when headless
+        frames.endTick();
+        hapticProfiler.endTick();
+        if (options.m_headless && (hapticProfiler.getNumTicks() >= options.m_ticks))
+        {
+            break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+bool createDevice(cHapticDeviceContext* a_device, int a_index)
+{
+    a_device->m_index = a_index;
+    a_device->m_stateHaptic = 0;
+    a_device->m_state = STATE_IDLE;
+    a_device->m_cameraRevision = cameraRevision;
+    a_device->m_thread = NULL;
+    a_device->m_finished = true;
+
+    cGenericHapticDevicePtr& hapticDevice = a_device->m_hapticDevice;
+    cToolCursor*& tool = a_device->m_tool;
+    cShapeBox*& boxDeviceWS = a_device->m_boxDeviceWS;
+    cShapeLine*& magneticLine = a_device->m_magneticLine;
+    cShapeSphere*& sphereA = a_device->m_sphereA;
+    cShapeSphere*& sphereB = a_device->m_sphereB;
+
+    // get access to the haptic device
+    handler->getDevice(hapticDevice, a_index);
+
+    // simulate the haptic device when running headless or offscreen without a record to replay
+    if ((options.m_headless || options.m_offscreen) && options.m_replayFile.empty())
+    {
+        hapticDevice = cSyntheticHapticDevice::create();
+    }
+
+    // replay and/or record the haptic device as requested on the command line
+    if (!cSetupRecordedDevice(hapticDevice,
+                              cGetDeviceRecordFileName(options.m_replayFile, a_index),
+                              cGetDeviceRecordFileName(options.m_recordFile, a_index),
+                              !options.m_headless))
+    {
+        return (false);
+    }
+
+    // retrieve information about the current haptic device
+    cHapticDeviceInfo hapticDeviceInfo = hapticDevice->getSpecifications();
+
+    // if the device has a gripper, then enable it to behave like a user switch
+    hapticDevice->setEnableGripperUserSwitch(true);
+
+    // create a 3D tool and add it to the camera
+    tool = new cToolCursor(world);
+    world->addChild(tool);
+
+    // connect the haptic device to the tool
+    tool->setHapticDevice(hapticDevice);
+
+    // hide the device sphere. only show proxy.
+    tool->setShowContactPoints(true, false);
+
+    // set color of tool
+    tool->m_hapticPoint->m_sphereProxy->m_material->setWhiteAliceBlue();
+
+    // set the physical radius of the proxy.
+    hapticRadius  = 0.00;
+    displayRadius = 0.05;
+    tool->setRadius(displayRadius, hapticRadius);
+
+    // map the physical workspace of the haptic device to a larger virtual workspace.
+    tool->setWorkspaceRadius(Re);
+
+    // oriente tool with camera
+    tool->setLocalRot(camera->getLocalRot());
+
+    // haptic forces are enabled only if small forces are first sent to the device;
+    // this mode avoids the force spike that occurs when the application starts when 
+    // the tool is located inside an object for instance. 
+    tool->setWaitForSmallForce(true);
+
+    // initialize tool by connecting to haptic device
+    tool->start();
+
+    // update position and orientation of tool
+    tool->updateFromDevice();
+    // Get device position
+    a_device->m_devicePos = tool->getDeviceLocalPos();
+    // Set device home position
+    a_device->m_deviceHomePos.set(0.8,0.0,0.0);
+    a_device->m_deviceHomePos=a_device->m_deviceHomePos+a_device->m_devicePos;
+
+
+    //--------------------------------------------------------------------------
+    // DEVICE PROPERTIES
+    //--------------------------------------------------------------------------
+
+    // read the scale factor between the physical workspace of the haptic
+    // device and the virtual workspace defined for the tool
+    double workspaceScaleFactor = tool->getWorkspaceScaleFactor();
+    a_device->m_workspaceScaleFactor = workspaceScaleFactor;
+
+    // get properties of haptic device
+    double maxLinearForce = hapticDeviceInfo.m_maxLinearForce;
+    double maxLinearDamping = hapticDeviceInfo.m_maxLinearDamping;
+    double deviceMaxStiffness = hapticDeviceInfo.m_maxLinearStiffness / workspaceScaleFactor;
+    a_device->m_maxLinearForce = maxLinearForce;
+
+    // the map is rendered with the stiffness of the least stiff device
+    maxStiffness = (a_index == 0) ? deviceMaxStiffness : cMin(maxStiffness, deviceMaxStiffness);
+
+    // initialize the scale factor of the workspace drift
+    a_device->m_drift.m_workspaceScaleFactor = workspaceScaleFactor;
+
+    // set the virtual workspace of the device
+    a_device->m_workspaceConstraint.setBox(cVector3d(R, R, R), KVirtual * deviceMaxStiffness);
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // SHAPE - BOX DEVICE WORKSPACE
+    ////////////////////////////////////////////////////////////////////////////
+
+    // create a box and define its dimensions
+    boxDeviceWS = new cShapeBox(0.05*workspaceScaleFactor, 0.05*workspaceScaleFactor, 0.05*workspaceScaleFactor);
+    world->addChild(boxDeviceWS);
+
+    // set position
+    boxDeviceWS->setLocalPos(0.0,0.0,0.0);
+    
+    // set material color
+    boxDeviceWS->m_material->setRedFireBrick();
+    boxDeviceWS->setTransparencyLevel(0.5);
+    
+    // set stiffness property
+    boxDeviceWS->m_material->setStiffness(0.0);
+
+    boxDeviceWS->setEnabled(0);
+
+    // the box is only displayed
+    boxDeviceWS->setHapticEnabled(false);
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // PREDICTED CURSOR
+    ////////////////////////////////////////////////////////////////////////////
+
+    // create a sphere of the size and color of the proxy, shown with --predict only
+    cShapeSphere*& cursor = a_device->m_cursor;
+    cursor = new cShapeSphere(displayRadius);
+    world->addChild(cursor);
+    cursor->m_material->setWhiteAliceBlue();
+    cursor->setShowEnabled(false);
+
+    // the cursor is only displayed
+    cursor->setHapticEnabled(false);
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // MAGNETIC LINE
+    ////////////////////////////////////////////////////////////////////////////
+
+    // create a small vertical white magnetic line that will be activated when the
+    // user deforms the mesh.
+    magneticLine = new cShapeLine(cVector3d(0,0,0), cVector3d(0,0,0));
+
+    // add line to world
+    world->addChild(magneticLine);
+
+    // set color of line
+    magneticLine->m_colorPointA.setGrayDark();
+    magneticLine->m_colorPointB.setGrayDark();
+
+    // line is not yet enabled
+    magneticLine->setHapticEnabled(false);
+    magneticLine->setShowEnabled(false);
+
+    // set haptic properties
+    magneticLine->m_material->setStiffness(0.05 * deviceMaxStiffness);
+    magneticLine->m_material->setMagnetMaxForce(maxLinearForce);
+    magneticLine->m_material->setMagnetMaxDistance(0.25);
+    magneticLine->m_material->setViscosity(0.05 * maxLinearDamping);
+
+    // create a haptic magnetic effect
+    cEffectMagnet* newEffect = new cEffectMagnet(magneticLine);
+    magneticLine->addEffect(newEffect);
+
+    // create two sphere that will be added at both ends of the line
+    sphereA = new cShapeSphere(0.02);
+    sphereB = new cShapeSphere(0.02);
+
+    // add spheres to world
+    world->addChild(sphereA);
+    world->addChild(sphereB);
+
+    // disable spheres for now
+    sphereA->setShowEnabled(false);
+    sphereB->setShowEnabled(false);
+
+    // the spheres are only displayed
+    sphereA->setHapticEnabled(false);
+    sphereB->setHapticEnabled(false);
+
+    // define some material properties for spheres
+    cMaterial matSphere;
+    matSphere.setWhiteAliceBlue();
+
+    // assign material properties to both spheres
+    sphereA->setMaterial(matSphere);
+    sphereB->setMaterial(matSphere);
+
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+void holdMap(bool a_hold)
+{
+    // the map is felt by no device while one of them sculpts it or moves the camera
+    numDevicesHoldingMap += a_hold ? 1 : -1;
+    object->setHapticEnabled(numDevicesHoldingMap == 0, true);
+}
+
+//------------------------------------------------------------------------------
+
+void moveOffscreenCamera(unsigned long a_frame)
+{
+    // the haptic threads read the camera and orient their tool with it
+    worldLock.acquire();
+    offscreen.moveCamera(a_frame);
+    cameraRevision++;
+    worldLock.release();
+}
+
+//------------------------------------------------------------------------------
+
+bool selectVariant(const string& a_name)
+{
+    variantName = a_name;
+    if (a_name == "drift")
+    {
+        variant = VARIANT_DRIFT;
+    }
+    else if (a_name == "edge")
+    {
+        variant = VARIANT_EDGE;
+        Kp = 0.25;
+    }
+    else if (a_name == "bubble")
+    {
+        variant = VARIANT_BUBBLE;
+        Kp = 0.25;
+    }
+    else if (a_name == "expansion")
+    {
+        variant = VARIANT_EXPANSION;
+        Kd = 0.3;
+        Kv = 0.15;
+        Kp = 0.3;
+        homingTolerance = 0.06;
+    }
+    else
+    {
+        cout << "Error - unknown variant: " << a_name << " (drift, edge, bubble or expansion)" << endl;
+        return (false);
+    }
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+int loadHeightMap()
+{
+    // create an image
+    cImage image;
+
+    // load a file
+    bool fileload = image.loadFromFile(RESOURCE_PATH("../resources/images/map.jpg"));
+    if (!fileload)
+    {
+        #if defined(_MSVC)
+        fileload = image.loadFromFile("../../../bin/resources/images/map.jpg");
+        #endif
+    }
+    if (!fileload)
+    {
+        cout << "Error - Texture image failed to load correctly." << endl;
+        return (-1);
+    }
+
+    // get the size of the image
+    int imageSizeX = image.getWidth();
+    int imageSizeY = image.getHeight();
+
+    // check size of image
+    if ((imageSizeX < 1) || (imageSizeY < 1)) { return (false); }
+
+    // size of the map, resampled to --map-size vertices along the largest side if requested
+    int sizeX = imageSizeX;
+    int sizeY = imageSizeY;
+    if (options.m_mapSize > 0)
+    {
+        double resample = (double)options.m_mapSize / (double)cMax(imageSizeX, imageSizeY);
+        sizeX = cMax(2, (int)(resample * imageSizeX + 0.5));
+        sizeY = cMax(2, (int)(resample * imageSizeY + 0.5));
+    }
+
+    // we look for the largest side
+    int largestSide = cMax(sizeX, sizeY);
+
+    // scale the image to fit the world
+    double scale = 1.0 / (double)largestSide;
+
+    // we will create an triangle based object. For centering puposes we
+    // compute an offset for axis X and Y corresponding to the half size
+    // of the image map.
+    double offsetX = 0.5 * (double)sizeX * scale;
+    double offsetY = 0.5 * (double)sizeY * scale;
+
+    // allocate vertices for this map
+    object->m_vertices->newVertices(sizeX*sizeY);
+    
+    // set position of each vertex
+    int x,y, index;
+    index = 0;
+    for (y=0; y<sizeY; y++)
+    {
+        for (x=0; x<sizeX; x++)
+        {
+            // get color of image pixel
+            cColorb color;
+            int pixelX = (sizeX > 1) ? (x * (imageSizeX - 1)) / (sizeX - 1) : 0;
+            int pixelY = (sizeY > 1) ? (y * (imageSizeY - 1)) / (sizeY - 1) : 0;
+            image.getPixelColor(pixelX, pixelY, color);
+
+            // compute vertex height by averaging the color components RGB and scaling the value.
+            const double HEIGHT_SCALE = 0.03;
+
+            double height = HEIGHT_SCALE * (color.getLuminance() / 255.0);
+
+            // compute the position of the vertex
+            double px = scale * (double)x - offsetX;
+            double py = scale * (double)y - offsetY;
+
+            // set vertex position
+            object->m_vertices->setLocalPos(index, px, py, height);
+            index++;
+        }
+    }
+
+    // Create a triangle based map using the above pixels
+    for (x=0; x<(sizeX-1); x++)
+    {
+        for (y=0; y<(sizeY-1); y++)
+        {
+            // get the indexing numbers of the next four vertices
+            unsigned int index00 = ((y + 0) * sizeX) + (x + 0);
+            unsigned int index01 = ((y + 0) * sizeX) + (x + 1);
+            unsigned int index10 = ((y + 1) * sizeX) + (x + 0);
+            unsigned int index11 = ((y + 1) * sizeX) + (x + 1);
+
+            // create two new triangles
+            object->newTriangle(index00, index01, index10);
+            object->newTriangle(index10, index01, index11);
+        }
+    }
+
+    // compute normals
+    object->computeAllNormals();
+
+    // compute boundary box
+    object->computeBoundaryBox(true);
+    cVector3d min = object->getBoundaryMin();
+    cVector3d max = object->getBoundaryMax();
+
+    // compute size of object (largest side)
+    cVector3d span = cSub(max, min);
+    double size = cMax(span.x(), cMax(span.y(), span.z()));
+
+    // scale object
+    const double DESIRED_MESH_SIZE = 2.0;
+    double scaleFactor = DESIRED_MESH_SIZE / size;
+    object->scale(scaleFactor);
+
+    // compute boundary box again
+    object->computeBoundaryBox(true);
+
+    // create collision detector for haptics interaction
+    object->createAABBCollisionDetector(1.01 * hapticRadius);
+
+    // success
+    return (0);
+}
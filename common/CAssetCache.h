@@ -0,0 +1,502 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CAssetCacheH
+#define CAssetCacheH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CDistanceField.h"
+//------------------------------------------------------------------------------
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CAssetCache.h
+
+    \brief
+    Binary cache of the preprocessed meshes of an example, mapped in memory
+    at startup instead of loading and preprocessing the model files.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \struct     cAssetCacheSection
+    \brief
+    Entry of the table of contents of an asset cache file: an array of the
+    data of an object.
+*/
+//==============================================================================
+struct cAssetCacheSection
+{
+    //! Content of the section (\ref cAssetCache::C_MESH_VERTICES...).
+    unsigned int m_type;
+
+    //! Object, and mesh of the object, of the section.
+    unsigned short m_object;
+    unsigned short m_mesh;
+
+    //! Offset of the array in the file, and its size [bytes].
+    unsigned long long m_offset;
+    unsigned long long m_size;
+};
+
+
+//==============================================================================
+/*!
+    \struct     cAssetCacheHeader
+    \brief
+    Header of an asset cache file, followed by the table of contents.
+*/
+//==============================================================================
+struct cAssetCacheHeader
+{
+    //! "CHAIASST".
+    char m_magic[8];
+
+    //! Version of the file layout.
+    unsigned int m_version;
+
+    //! Number of sections.
+    unsigned int m_numSections;
+
+    //! Key of the source files and parameters of the cached data (\ref cAssetCache::computeKey()).
+    unsigned long long m_key;
+};
+
+
+//==============================================================================
+/*!
+    \class      cAssetCache
+    \brief
+    Binary cache of the preprocessed meshes of an example, mapped in memory
+    at startup instead of loading and preprocessing the model files.
+
+    \details
+    The cache holds, for each object of the example, the vertices (scaled,
+    in the frame of the object), normals, texture coordinates and triangles
+    of its meshes, and optionally its \ref cSparseDistanceField and points
+    sampled on its surface. The file is keyed by a hash of the source files
+    and of the parameters of the preprocessing (\ref computeKey()); a cache
+    with another key, layout version or size is ignored, and the example
+    writes a new one with \ref cAssetCacheWriter.
+
+    \ref load() maps the file with mmap (it is read into memory on
+    Windows). The meshes are copied into CHAI3D meshes, since they own
+    their vertex arrays, but a distance field uses the mapped distances
+    directly, so the cache must outlive it. The collision detectors of
+    CHAI3D and the ODE trimesh data are built from the meshes as before:
+    their internal layout is not accessible from the examples.
+*/
+//==============================================================================
+class cAssetCache
+{
+public:
+
+    //! Version of the file layout.
+    static const unsigned int C_VERSION = 1;
+
+    //! Content of a section.
+    enum cSectionType
+    {
+        C_MESH_VERTICES = 1,    //!< positions of the vertices of a mesh, 3 doubles each
+        C_MESH_NORMALS,         //!< normals of the vertices of a mesh, 3 doubles each
+        C_MESH_TEXCOORDS,       //!< texture coordinates of the vertices of a mesh, 3 doubles each
+        C_MESH_TRIANGLES,       //!< vertex indices of the triangles of a mesh, 3 unsigned ints each
+        C_FIELD_HEADER,         //!< cell size, band width, origin and region of a distance field, 11 doubles
+        C_FIELD_KEYS,           //!< keys of the bricks of a distance field
+        C_FIELD_VALUES,         //!< distances of a distance field, floats
+        C_POINTS                //!< points sampled on an object, 3 doubles each
+    };
+
+    //! Constructor of cAssetCache.
+    cAssetCache() : m_data(NULL), m_size(0), m_header(NULL), m_sections(NULL) {}
+
+    //! Destructor of cAssetCache.
+    ~cAssetCache() { unload(); }
+
+    //! This method computes the key of files __a_filenames__ and parameters __a_parameters__. It returns 0 if a file cannot be read.
+    static unsigned long long computeKey(const std::vector<std::string>& a_filenames, const std::string& a_parameters)
+    {
+        // 64-bit FNV-1a over the contents of the files and the parameters
+        unsigned long long hash = 14695981039346656037ULL;
+        for (size_t i=0; i<a_filenames.size(); i++)
+        {
+            FILE* file = fopen(a_filenames[i].c_str(), "rb");
+            if (file == NULL) { return (0); }
+            unsigned char buffer[65536];
+            size_t count;
+            while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+            {
+                for (size_t j=0; j<count; j++) { hash = (hash ^ buffer[j]) * 1099511628211ULL; }
+            }
+            fclose(file);
+            hash = (hash ^ 0xff) * 1099511628211ULL;
+        }
+        for (size_t j=0; j<a_parameters.size(); j++) { hash = (hash ^ (unsigned char)a_parameters[j]) * 1099511628211ULL; }
+        return ((hash != 0) ? hash : 1);
+    }
+
+    //! This method maps cache file __a_filename__. It returns __false__ if the file is missing, invalid or not of key __a_key__.
+    bool load(const std::string& a_filename, unsigned long long a_key)
+    {
+        unload();
+        if (!map(a_filename)) { return (false); }
+
+        // header, table of contents and sections within the file
+        bool valid = (m_size >= sizeof(cAssetCacheHeader));
+        if (valid)
+        {
+            m_header = (const cAssetCacheHeader*)m_data;
+            m_sections = (const cAssetCacheSection*)(m_data + sizeof(cAssetCacheHeader));
+            valid = (memcmp(m_header->m_magic, "CHAIASST", 8) == 0) && (m_header->m_version == C_VERSION) &&
+                    (m_header->m_key == a_key) &&
+                    (sizeof(cAssetCacheHeader) + (unsigned long long)m_header->m_numSections * sizeof(cAssetCacheSection) <= m_size);
+        }
+        for (unsigned int i=0; valid && (i<m_header->m_numSections); i++)
+        {
+            valid = (m_sections[i].m_offset % 8 == 0) && (m_sections[i].m_offset <= m_size) &&
+                    (m_sections[i].m_size <= m_size - m_sections[i].m_offset);
+        }
+        if (!valid) { unload(); }
+        return (valid);
+    }
+
+    //! This method unmaps the cache file.
+    void unload()
+    {
+        #if !defined(_WIN32)
+        if (m_data != NULL) { munmap((void*)m_data, m_size); }
+        #endif
+        m_buffer.clear();
+        m_data = NULL;
+        m_size = 0;
+        m_header = NULL;
+        m_sections = NULL;
+    }
+
+    //! This method returns __true__ if a cache file is mapped.
+    bool isLoaded() const { return (m_header != NULL); }
+
+    //! This method adds the cached meshes of object __a_object__ to __a_multiMesh__. It returns __false__ if the object has no mesh.
+    bool createMesh(int a_object, cMultiMesh* a_multiMesh) const
+    {
+        int numMeshes = 0;
+        for (unsigned short m=0; ; m++)
+        {
+            size_t numVertices, numNormals, numTexCoords, numTriangles;
+            const double* vertices = (const double*)getSection(C_MESH_VERTICES, a_object, m, numVertices);
+            const unsigned int* triangles = (const unsigned int*)getSection(C_MESH_TRIANGLES, a_object, m, numTriangles);
+            if ((vertices == NULL) || (triangles == NULL)) { break; }
+            const double* normals = (const double*)getSection(C_MESH_NORMALS, a_object, m, numNormals);
+            const double* texCoords = (const double*)getSection(C_MESH_TEXCOORDS, a_object, m, numTexCoords);
+            numVertices /= 3 * sizeof(double);
+            numTriangles /= 3 * sizeof(unsigned int);
+            if (numNormals != numVertices * 3 * sizeof(double)) { normals = NULL; }
+            if (numTexCoords != numVertices * 3 * sizeof(double)) { texCoords = NULL; }
+
+            cMesh* mesh = a_multiMesh->newMesh();
+            for (size_t i=0; i<numVertices; i++)
+            {
+                int index = mesh->newVertex(vertices[3*i], vertices[3*i+1], vertices[3*i+2]);
+                if (normals != NULL) { mesh->m_vertices->setNormal(index, cVector3d(normals[3*i], normals[3*i+1], normals[3*i+2])); }
+                if (texCoords != NULL) { mesh->m_vertices->setTexCoord(index, texCoords[3*i], texCoords[3*i+1], texCoords[3*i+2]); }
+            }
+            for (size_t i=0; i<numTriangles; i++)
+            {
+                if ((triangles[3*i] >= numVertices) || (triangles[3*i+1] >= numVertices) || (triangles[3*i+2] >= numVertices)) { continue; }
+                mesh->newTriangle(triangles[3*i], triangles[3*i+1], triangles[3*i+2]);
+            }
+            numMeshes++;
+        }
+        if (numMeshes > 0)
+        {
+            a_multiMesh->computeBoundaryBox(true);
+        }
+        return (numMeshes > 0);
+    }
+
+    //! This method makes __a_field__ use the cached distance field of object __a_object__. It returns __false__ if the object has none.
+    bool getField(int a_object, cSparseDistanceField& a_field) const
+    {
+        size_t headerSize, keysSize, valuesSize;
+        const double* header = (const double*)getSection(C_FIELD_HEADER, a_object, 0, headerSize);
+        const unsigned long long* keys = (const unsigned long long*)getSection(C_FIELD_KEYS, a_object, 0, keysSize);
+        const float* values = (const float*)getSection(C_FIELD_VALUES, a_object, 0, valuesSize);
+        if ((header == NULL) || (keys == NULL) || (values == NULL) || (headerSize != 11 * sizeof(double))) { return (false); }
+
+        const int numNodes = cSparseDistanceField::C_BRICK_NODES * cSparseDistanceField::C_BRICK_NODES * cSparseDistanceField::C_BRICK_NODES;
+        size_t numBricks = keysSize / sizeof(unsigned long long);
+        if (valuesSize != numBricks * numNodes * sizeof(float)) { return (false); }
+
+        a_field.assign(header[0], header[1], cVector3d(header[2], header[3], header[4]),
+                       cVector3d(header[5], header[6], header[7]), cVector3d(header[8], header[9], header[10]),
+                       keys, numBricks, values);
+        return (true);
+    }
+
+    //! This method copies the cached points of object __a_object__ into __a_points__. It returns __false__ if the object has none.
+    bool getPoints(int a_object, std::vector<cVector3d>& a_points) const
+    {
+        size_t size;
+        const double* points = (const double*)getSection(C_POINTS, a_object, 0, size);
+        if (points == NULL) { return (false); }
+        a_points.resize(size / (3 * sizeof(double)));
+        for (size_t i=0; i<a_points.size(); i++)
+        {
+            a_points[i].set(points[3*i], points[3*i+1], points[3*i+2]);
+        }
+        return (true);
+    }
+
+protected:
+
+    //! This method maps file __a_filename__ into memory.
+    bool map(const std::string& a_filename)
+    {
+        #if !defined(_WIN32)
+        int file = open(a_filename.c_str(), O_RDONLY);
+        if (file < 0) { return (false); }
+        struct stat status;
+        if ((fstat(file, &status) != 0) || (status.st_size <= 0))
+        {
+            close(file);
+            return (false);
+        }
+        void* data = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (data == MAP_FAILED) { return (false); }
+        m_data = (const char*)data;
+        m_size = (size_t)status.st_size;
+        #else
+        FILE* file = fopen(a_filename.c_str(), "rb");
+        if (file == NULL) { return (false); }
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        if (size <= 0)
+        {
+            fclose(file);
+            return (false);
+        }
+        m_buffer.resize(((size_t)size + 7) / 8);
+        bool read = (fread(&m_buffer[0], 1, (size_t)size, file) == (size_t)size);
+        fclose(file);
+        if (!read) { return (false); }
+        m_size = (size_t)size;
+        #endif
+        if (!m_buffer.empty()) { m_data = (const char*)&m_buffer[0]; }
+        return (true);
+    }
+
+    //! This method returns the section of type __a_type__ of mesh __a_mesh__ of object __a_object__, and its size __a_size__ [bytes], or __NULL__.
+    const void* getSection(unsigned int a_type, int a_object, unsigned short a_mesh, size_t& a_size) const
+    {
+        a_size = 0;
+        if (m_header == NULL) { return (NULL); }
+        for (unsigned int i=0; i<m_header->m_numSections; i++)
+        {
+            const cAssetCacheSection& section = m_sections[i];
+            if ((section.m_type == a_type) && (section.m_object == a_object) && (section.m_mesh == a_mesh))
+            {
+                a_size = (size_t)section.m_size;
+                return (m_data + section.m_offset);
+            }
+        }
+        return (NULL);
+    }
+
+    //! Contents of the file.
+    const char* m_data;
+    size_t m_size;
+
+    //! Contents of the file when it is read rather than mapped.
+    std::vector<unsigned long long> m_buffer;
+
+    //! Header and table of contents.
+    const cAssetCacheHeader* m_header;
+    const cAssetCacheSection* m_sections;
+};
+
+
+//==============================================================================
+/*!
+    \class      cAssetCacheWriter
+    \brief
+    Writes the preprocessed meshes of an example to an asset cache file
+    read by \ref cAssetCache.
+*/
+//==============================================================================
+class cAssetCacheWriter
+{
+public:
+
+    //! This method adds the meshes of __a_multiMesh__ as object __a_object__, in the frame of __a_multiMesh__.
+    void addMesh(int a_object, cMultiMesh* a_multiMesh)
+    {
+        for (int m=0; m<a_multiMesh->getNumMeshes(); m++)
+        {
+            cMesh* mesh = a_multiMesh->getMesh(m);
+            cVector3d meshPos = mesh->getLocalPos();
+            cMatrix3d meshRot = mesh->getLocalRot();
+
+            std::vector<double> vertices, normals, texCoords;
+            for (int i=0; i<mesh->getNumVertices(); i++)
+            {
+                cVector3d pos = meshPos + meshRot * mesh->m_vertices->getLocalPos(i);
+                cVector3d normal = meshRot * mesh->m_vertices->getNormal(i);
+                cVector3d texCoord = mesh->m_vertices->getTexCoord(i);
+                for (int k=0; k<3; k++)
+                {
+                    vertices.push_back(pos(k));
+                    normals.push_back(normal(k));
+                    texCoords.push_back(texCoord(k));
+                }
+            }
+            std::vector<unsigned int> triangles;
+            for (int i=0; i<mesh->getNumTriangles(); i++)
+            {
+                triangles.push_back(mesh->m_triangles->getVertexIndex0(i));
+                triangles.push_back(mesh->m_triangles->getVertexIndex1(i));
+                triangles.push_back(mesh->m_triangles->getVertexIndex2(i));
+            }
+            addSection(cAssetCache::C_MESH_VERTICES, a_object, m, vertices);
+            addSection(cAssetCache::C_MESH_NORMALS, a_object, m, normals);
+            addSection(cAssetCache::C_MESH_TEXCOORDS, a_object, m, texCoords);
+            addSection(cAssetCache::C_MESH_TRIANGLES, a_object, m, triangles);
+        }
+    }
+
+    //! This method adds distance field __a_field__ of object __a_object__.
+    void addField(int a_object, const cSparseDistanceField& a_field)
+    {
+        std::vector<double> header;
+        header.push_back(a_field.getCellSize());
+        header.push_back(a_field.getBandWidth());
+        const cVector3d* corners[3] = { &a_field.getOrigin(), &a_field.getBoundaryMin(), &a_field.getBoundaryMax() };
+        for (int i=0; i<3; i++)
+        {
+            for (int k=0; k<3; k++) { header.push_back((*corners[i])(k)); }
+        }
+        std::vector<unsigned long long> keys;
+        a_field.getBrickKeys(keys);
+        std::vector<float> values(a_field.getValues(), a_field.getValues() + a_field.getNumValues());
+
+        addSection(cAssetCache::C_FIELD_HEADER, a_object, 0, header);
+        addSection(cAssetCache::C_FIELD_KEYS, a_object, 0, keys);
+        addSection(cAssetCache::C_FIELD_VALUES, a_object, 0, values);
+    }
+
+    //! This method adds points __a_points__ of object __a_object__.
+    void addPoints(int a_object, const std::vector<cVector3d>& a_points)
+    {
+        std::vector<double> points;
+        for (size_t i=0; i<a_points.size(); i++)
+        {
+            for (int k=0; k<3; k++) { points.push_back(a_points[i](k)); }
+        }
+        addSection(cAssetCache::C_POINTS, a_object, 0, points);
+    }
+
+    //! This method writes the cache with key __a_key__ to __a_filename__. The file is written under another name, then renamed, so that a reader never maps a partial file.
+    bool save(const std::string& a_filename, unsigned long long a_key) const
+    {
+        cAssetCacheHeader header;
+        memcpy(header.m_magic, "CHAIASST", 8);
+        header.m_version = cAssetCache::C_VERSION;
+        header.m_numSections = (unsigned int)m_sections.size();
+        header.m_key = a_key;
+
+        // sections after the table of contents, aligned to 8 bytes
+        std::vector<cAssetCacheSection> sections = m_sections;
+        unsigned long long offset = sizeof(cAssetCacheHeader) + sections.size() * sizeof(cAssetCacheSection);
+        for (size_t i=0; i<sections.size(); i++)
+        {
+            offset = (offset + 7) & ~7ULL;
+            sections[i].m_offset = offset;
+            offset += sections[i].m_size;
+        }
+
+        std::string temporary = a_filename + ".tmp";
+        FILE* file = fopen(temporary.c_str(), "wb");
+        if (file == NULL) { return (false); }
+        bool written = (fwrite(&header, sizeof(header), 1, file) == 1);
+        if (!sections.empty())
+        {
+            written = written && (fwrite(&sections[0], sizeof(cAssetCacheSection), sections.size(), file) == sections.size());
+        }
+        unsigned long long position = sizeof(cAssetCacheHeader) + sections.size() * sizeof(cAssetCacheSection);
+        static const char padding[8] = { 0 };
+        for (size_t i=0; written && (i<sections.size()); i++)
+        {
+            written = (fwrite(padding, 1, (size_t)(sections[i].m_offset - position), file) == (size_t)(sections[i].m_offset - position));
+            if (m_data[i].size() > 0)
+            {
+                written = written && (fwrite(&m_data[i][0], 1, m_data[i].size(), file) == m_data[i].size());
+            }
+            position = sections[i].m_offset + sections[i].m_size;
+        }
+        written = (fclose(file) == 0) && written;
+        if (!written)
+        {
+            remove(temporary.c_str());
+            return (false);
+        }
+
+        // rename() does not replace an existing file on Windows
+        #if defined(_WIN32)
+        remove(a_filename.c_str());
+        #endif
+        return (rename(temporary.c_str(), a_filename.c_str()) == 0);
+    }
+
+protected:
+
+    //! This method adds array __a_values__ as a section of type __a_type__ of mesh __a_mesh__ of object __a_object__.
+    template <class T> void addSection(unsigned int a_type, int a_object, int a_mesh, const std::vector<T>& a_values)
+    {
+        cAssetCacheSection section;
+        section.m_type = a_type;
+        section.m_object = (unsigned short)a_object;
+        section.m_mesh = (unsigned short)a_mesh;
+        section.m_offset = 0;
+        section.m_size = a_values.size() * sizeof(T);
+        m_sections.push_back(section);
+
+        const char* data = a_values.empty() ? NULL : (const char*)&a_values[0];
+        m_data.push_back(std::vector<char>(data, data + section.m_size));
+    }
+
+    //! Table of contents, without offsets.
+    std::vector<cAssetCacheSection> m_sections;
+
+    //! Contents of each section.
+    std::vector<std::vector<char> > m_data;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,419 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CDeviceRecordH
+#define CDeviceRecordH
+//------------------------------------------------------------------------------
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CDeviceRecord.h
+
+    \brief
+    Compact binary stream of haptic device ticks.
+
+    \details
+    A record file starts with a \ref cDeviceRecordHeader followed by one
+    fixed-size \ref cDeviceRecordSample per haptic tick. Each sample holds
+    the device state read during the tick and the force, torque and gripper
+    force sent at the end of the tick. The number of samples is deduced from
+    the file size, so a file truncated by a crash remains readable.
+
+    This header does not depend on CHAI3D so that offline tools can read the
+    records without linking the library.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+
+//! Magic number found at the beginning of every record file.
+#define C_DEVICE_RECORD_MAGIC       "CHDR"
+
+//! Current version of the record file format.
+#define C_DEVICE_RECORD_VERSION     1
+
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \struct     cDeviceRecordSpecs
+    \brief
+    Subset of the device specifications needed to replay a session.
+*/
+//==============================================================================
+struct cDeviceRecordSpecs
+{
+    //! Name of the recorded device model.
+    char m_modelName[64];
+
+    //! Maximum linear force [N].
+    double m_maxLinearForce;
+
+    //! Maximum angular torque [N*m].
+    double m_maxAngularTorque;
+
+    //! Maximum gripper force [N].
+    double m_maxGripperForce;
+
+    //! Maximum linear stiffness [N/m].
+    double m_maxLinearStiffness;
+
+    //! Maximum angular stiffness [N*m/rad].
+    double m_maxAngularStiffness;
+
+    //! Maximum gripper linear stiffness [N/m].
+    double m_maxGripperLinearStiffness;
+
+    //! Maximum linear damping [N/(m/s)].
+    double m_maxLinearDamping;
+
+    //! Maximum angular damping [N*m/(rad/s)].
+    double m_maxAngularDamping;
+
+    //! Maximum gripper angular damping [N*m/(rad/s)].
+    double m_maxGripperAngularDamping;
+
+    //! Radius of the physical workspace of the device [m].
+    double m_workspaceRadius;
+
+    //! Maximum opening angle of the gripper [rad].
+    double m_gripperMaxAngleRad;
+
+    //! Sensing and actuation capabilities, see \ref cDeviceRecordCapability.
+    uint32_t m_capabilities;
+
+    //! Unused, keeps the structure size a multiple of 8 bytes.
+    uint32_t m_reserved;
+};
+
+//------------------------------------------------------------------------------
+
+//! Bits of \ref cDeviceRecordSpecs::m_capabilities.
+enum cDeviceRecordCapability
+{
+    C_DEVICE_RECORD_SENSED_POSITION     = 0x0001,
+    C_DEVICE_RECORD_SENSED_ROTATION     = 0x0002,
+    C_DEVICE_RECORD_SENSED_GRIPPER      = 0x0004,
+    C_DEVICE_RECORD_ACTUATED_POSITION   = 0x0008,
+    C_DEVICE_RECORD_ACTUATED_ROTATION   = 0x0010,
+    C_DEVICE_RECORD_ACTUATED_GRIPPER    = 0x0020,
+    C_DEVICE_RECORD_LEFT_HAND           = 0x0040,
+    C_DEVICE_RECORD_RIGHT_HAND          = 0x0080
+};
+
+
+//==============================================================================
+/*!
+    \struct     cDeviceRecordHeader
+    \brief
+    Header found at the beginning of a record file.
+*/
+//==============================================================================
+struct cDeviceRecordHeader
+{
+    //! Magic number (\ref C_DEVICE_RECORD_MAGIC).
+    char m_magic[4];
+
+    //! File format version.
+    uint32_t m_version;
+
+    //! Size of one sample in bytes.
+    uint32_t m_sampleSize;
+
+    //! Unused, keeps the structure size a multiple of 8 bytes.
+    uint32_t m_reserved;
+
+    //! Nominal rate of the haptic loop that produced the record [Hz].
+    double m_tickRate;
+
+    //! Specifications of the recorded device.
+    cDeviceRecordSpecs m_specs;
+};
+
+
+//==============================================================================
+/*!
+    \struct     cDeviceRecordSample
+    \brief
+    State of the device and commands sent to it during one haptic tick.
+*/
+//==============================================================================
+struct cDeviceRecordSample
+{
+    //! Time elapsed since the first sample [s].
+    double m_time;
+
+    //! Position of the device [m].
+    double m_position[3];
+
+    //! Linear velocity of the device [m/s].
+    double m_linearVelocity[3];
+
+    //! Orientation of the device, row-major 3x3 rotation matrix.
+    double m_rotation[9];
+
+    //! Angular velocity of the device [rad/s].
+    double m_angularVelocity[3];
+
+    //! Gripper opening angle [rad].
+    double m_gripperAngle;
+
+    //! Gripper angular velocity [rad/s].
+    double m_gripperAngularVelocity;
+
+    //! Status of the user switches, one bit per switch.
+    uint32_t m_userSwitches;
+
+    //! Unused, keeps the structure size a multiple of 8 bytes.
+    uint32_t m_reserved;
+
+    //! Force sent to the device [N].
+    double m_force[3];
+
+    //! Torque sent to the device [N*m].
+    double m_torque[3];
+
+    //! Gripper force sent to the device [N].
+    double m_gripperForce;
+};
+
+
+//==============================================================================
+/*!
+    \class      cDeviceRecordWriter
+    \brief
+    Appends device samples to a record file.
+
+    \details
+    Samples are written through a large stdio buffer, so that a call to
+    \ref write() costs a memory copy on most ticks.
+*/
+//==============================================================================
+class cDeviceRecordWriter
+{
+public:
+
+    //! Constructor of cDeviceRecordWriter.
+    cDeviceRecordWriter() : m_file(NULL) {}
+
+    //! Destructor of cDeviceRecordWriter.
+    ~cDeviceRecordWriter() { close(); }
+
+    //! This method creates a record file and writes its header.
+    bool open(const std::string& a_filename, const cDeviceRecordSpecs& a_specs, double a_tickRate)
+    {
+        close();
+
+        m_file = fopen(a_filename.c_str(), "wb");
+        if (m_file == NULL) { return (false); }
+
+        m_buffer.resize(1 << 20);
+        setvbuf(m_file, &m_buffer[0], _IOFBF, m_buffer.size());
+
+        cDeviceRecordHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.m_magic, C_DEVICE_RECORD_MAGIC, 4);
+        header.m_version = C_DEVICE_RECORD_VERSION;
+        header.m_sampleSize = sizeof(cDeviceRecordSample);
+        header.m_tickRate = a_tickRate;
+        header.m_specs = a_specs;
+
+        return (fwrite(&header, sizeof(header), 1, m_file) == 1);
+    }
+
+    //! This method appends one sample to the record file.
+    bool write(const cDeviceRecordSample& a_sample)
+    {
+        if (m_file == NULL) { return (false); }
+        return (fwrite(&a_sample, sizeof(a_sample), 1, m_file) == 1);
+    }
+
+    //! This method flushes and closes the record file.
+    void close()
+    {
+        if (m_file == NULL) { return; }
+        fclose(m_file);
+        m_file = NULL;
+    }
+
+    //! This method returns __true__ if a record file is open.
+    bool isOpen() const { return (m_file != NULL); }
+
+private:
+
+    //! Record file.
+    FILE* m_file;
+
+    //! Write buffer of the record file.
+    std::vector<char> m_buffer;
+};
+
+
+//==============================================================================
+/*!
+    \class      cDeviceRecordReader
+    \brief
+    Loads a complete record file in memory.
+
+    \details
+    The whole file is read at once so that replaying a session never touches
+    the disk from the haptic thread.
+*/
+//==============================================================================
+class cDeviceRecordReader
+{
+public:
+
+    //! This method loads a record file. It returns __false__ if the file is missing or invalid.
+    bool load(const std::string& a_filename)
+    {
+        m_samples.clear();
+
+        FILE* file = fopen(a_filename.c_str(), "rb");
+        if (file == NULL) { return (false); }
+
+        bool valid = (fread(&m_header, sizeof(m_header), 1, file) == 1) &&
+                     (memcmp(m_header.m_magic, C_DEVICE_RECORD_MAGIC, 4) == 0) &&
+                     (m_header.m_version == C_DEVICE_RECORD_VERSION) &&
+                     (m_header.m_sampleSize == sizeof(cDeviceRecordSample));
+
+        if (valid)
+        {
+            cDeviceRecordSample sample;
+            while (fread(&sample, sizeof(sample), 1, file) == 1)
+            {
+                m_samples.push_back(sample);
+            }
+        }
+
+        fclose(file);
+        return (valid);
+    }
+
+    //! This method returns the header of the loaded file.
+    const cDeviceRecordHeader& getHeader() const { return (m_header); }
+
+    //! This method returns the number of samples of the loaded file.
+    size_t getNumSamples() const { return (m_samples.size()); }
+
+    //! This method returns sample __a_index__ of the loaded file.
+    const cDeviceRecordSample& getSample(size_t a_index) const { return (m_samples[a_index]); }
+
+private:
+
+    //! Header of the loaded file.
+    cDeviceRecordHeader m_header;
+
+    //! Samples of the loaded file.
+    std::vector<cDeviceRecordSample> m_samples;
+};
+
+
+//==============================================================================
+/*!
+    \struct     cDeviceRecordDiff
+    \brief
+    Differences between the commands of two records of the same input.
+*/
+//==============================================================================
+struct cDeviceRecordDiff
+{
+    //! Number of samples compared.
+    size_t m_numSamples;
+
+    //! Index of the first sample whose commands differ, or m_numSamples if none.
+    size_t m_firstDifference;
+
+    //! Largest norm of the force difference [N].
+    double m_maxForceError;
+
+    //! Largest norm of the torque difference [N*m].
+    double m_maxTorqueError;
+
+    //! Root mean square of the force difference [N].
+    double m_rmsForceError;
+
+    //! Number of samples whose inputs differ, in which case commands are not comparable.
+    size_t m_numInputMismatches;
+};
+
+//------------------------------------------------------------------------------
+
+//! This function compares the commands of two records sample by sample.
+inline cDeviceRecordDiff cCompareDeviceRecords(const cDeviceRecordReader& a_reference,
+                                               const cDeviceRecordReader& a_candidate,
+                                               double a_tolerance = 0.0)
+{
+    cDeviceRecordDiff diff;
+    diff.m_numSamples = (a_reference.getNumSamples() < a_candidate.getNumSamples()) ?
+                        a_reference.getNumSamples() : a_candidate.getNumSamples();
+    diff.m_firstDifference = diff.m_numSamples;
+    diff.m_maxForceError = 0.0;
+    diff.m_maxTorqueError = 0.0;
+    diff.m_rmsForceError = 0.0;
+    diff.m_numInputMismatches = 0;
+
+    for (size_t i=0; i<diff.m_numSamples; i++)
+    {
+        const cDeviceRecordSample& a = a_reference.getSample(i);
+        const cDeviceRecordSample& b = a_candidate.getSample(i);
+
+        // inputs are compared bitwise, replayed inputs must be identical
+        if ((memcmp(a.m_position, b.m_position, sizeof(a.m_position)) != 0) ||
+            (memcmp(a.m_rotation, b.m_rotation, sizeof(a.m_rotation)) != 0) ||
+            (a.m_userSwitches != b.m_userSwitches))
+        {
+            diff.m_numInputMismatches++;
+        }
+
+        double force = 0.0;
+        double torque = 0.0;
+        for (int j=0; j<3; j++)
+        {
+            force  += (a.m_force[j] - b.m_force[j]) * (a.m_force[j] - b.m_force[j]);
+            torque += (a.m_torque[j] - b.m_torque[j]) * (a.m_torque[j] - b.m_torque[j]);
+        }
+        force = sqrt(force);
+        torque = sqrt(torque);
+
+        if (((force > a_tolerance) || (torque > a_tolerance)) && (diff.m_firstDifference == diff.m_numSamples))
+        {
+            diff.m_firstDifference = i;
+        }
+
+        if (force > diff.m_maxForceError) { diff.m_maxForceError = force; }
+        if (torque > diff.m_maxTorqueError) { diff.m_maxTorqueError = torque; }
+        diff.m_rmsForceError += force * force;
+    }
+
+    if (diff.m_numSamples > 0)
+    {
+        diff.m_rmsForceError = sqrt(diff.m_rmsForceError / (double)diff.m_numSamples);
+    }
+
+    return (diff);
+}
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,520 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CDistanceFieldH
+#define CDistanceFieldH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CDistanceField.h
+
+    \brief
+    Sparse signed distance field of a triangle mesh, and points sampled on
+    the surface of a mesh.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cSparseDistanceField
+    \brief
+    Signed distance field of a triangle mesh, stored in a narrow band around
+    its surface.
+
+    \details
+    The distance is sampled at the nodes of a regular grid, but only in
+    bricks of C_BRICK_CELLS cells per side that lie within \ref m_bandWidth
+    of a triangle. A hash table maps the coordinates of a brick to its
+    nodes. Each brick stores its border nodes, shared with the next brick,
+    so that the eight nodes of any cell belong to one brick.
+
+    The distance is positive on the side the triangles face, and is
+    interpolated trilinearly in each cell; \ref getDistance() also returns
+    its gradient, the direction out of the surface. A point outside the
+    bricks is farther than the band from the surface, on either side, and
+    is reported as such, so the band must exceed the deepest penetration
+    to be resolved.
+
+    The distances are stored in the field after \ref build(), or in memory
+    owned by the caller after \ref assign(), such as a mapped cache file.
+
+    The sign of a node is given by the triangle nearest to it. Where two
+    triangles are at the same distance (the node is nearest to their
+    common edge or vertex), the one whose normal points most directly at
+    the node is chosen, which is correct along the convex edges of a
+    closed mesh.
+*/
+//==============================================================================
+class cSparseDistanceField
+{
+public:
+
+    //! Number of cells along each side of a brick.
+    static const int C_BRICK_CELLS = 8;
+
+    //! Number of nodes along each side of a brick.
+    static const int C_BRICK_NODES = C_BRICK_CELLS + 1;
+
+    //! Constructor of cSparseDistanceField.
+    cSparseDistanceField() : m_cellSize(0.0), m_bandWidth(0.0), m_data(NULL) {}
+
+    //! This method builds the field of triangles __a_triangles__ (three vertex indices each) over vertices __a_vertices__, with cells of size __a_cellSize__ and a band of __a_bandCells__ cells.
+    void build(const std::vector<cVector3d>& a_vertices, const std::vector<unsigned int>& a_triangles,
+               double a_cellSize, int a_bandCells)
+    {
+        m_brickIndex.clear();
+        m_values.clear();
+        m_data = NULL;
+        m_cellSize = a_cellSize;
+        m_bandWidth = a_cellSize * (double)std::max(1, a_bandCells);
+        if (a_vertices.empty() || a_triangles.empty() || (a_cellSize <= 0.0)) { return; }
+
+        // grid origin, one band and one cell below the lowest vertex, so that
+        // every node index is positive
+        cVector3d boundaryMin = a_vertices[0];
+        cVector3d boundaryMax = a_vertices[0];
+        for (size_t i=1; i<a_vertices.size(); i++)
+        {
+            for (int k=0; k<3; k++)
+            {
+                boundaryMin(k) = std::min(boundaryMin(k), a_vertices[i](k));
+                boundaryMax(k) = std::max(boundaryMax(k), a_vertices[i](k));
+            }
+        }
+        double margin = m_bandWidth + m_cellSize;
+        m_origin = boundaryMin - cVector3d(margin, margin, margin);
+        m_boundaryMin = boundaryMin - cVector3d(m_bandWidth, m_bandWidth, m_bandWidth);
+        m_boundaryMax = boundaryMax + cVector3d(m_bandWidth, m_bandWidth, m_bandWidth);
+
+        // nearest triangle of each node within the band
+        std::unordered_map<unsigned long long, cNode> nodes;
+        for (size_t t=0; t+2<a_triangles.size(); t+=3)
+        {
+            const cVector3d& a = a_vertices[a_triangles[t]];
+            const cVector3d& b = a_vertices[a_triangles[t+1]];
+            const cVector3d& c = a_vertices[a_triangles[t+2]];
+            cVector3d normal = (b - a).cross(c - a);
+            if (normal.length() < C_SMALL * C_SMALL) { continue; }
+            normal.normalize();
+
+            int first[3], last[3];
+            for (int k=0; k<3; k++)
+            {
+                double lo = std::min(a(k), std::min(b(k), c(k))) - m_bandWidth;
+                double hi = std::max(a(k), std::max(b(k), c(k))) + m_bandWidth;
+                first[k] = (int)ceil((lo - m_origin(k)) / m_cellSize);
+                last[k] = (int)floor((hi - m_origin(k)) / m_cellSize);
+            }
+
+            for (int z=first[2]; z<=last[2]; z++)
+            {
+                for (int y=first[1]; y<=last[1]; y++)
+                {
+                    for (int x=first[0]; x<=last[0]; x++)
+                    {
+                        cVector3d pos = m_origin + m_cellSize * cVector3d(x, y, z);
+                        cVector3d offset = pos - getClosestPoint(pos, a, b, c);
+                        double distance = offset.length();
+                        if (distance > m_bandWidth) { continue; }
+
+                        // alignment of the node with the normal, to choose
+                        // between triangles at the same distance
+                        double alignment = (distance > 0.0) ? offset.dot(normal) / distance : 1.0;
+
+                        cNode& node = nodes.insert(std::make_pair(getKey(x, y, z), cNode())).first->second;
+                        double tolerance = 1e-6 * m_cellSize;
+                        if ((distance < node.m_distance - tolerance) ||
+                            ((distance < node.m_distance + tolerance) && (fabs(alignment) > fabs(node.m_alignment))))
+                        {
+                            node.m_distance = distance;
+                            node.m_alignment = alignment;
+                        }
+                    }
+                }
+            }
+        }
+
+        // bricks holding the nodes, including the bricks of which a node is
+        // on the lower border
+        for (std::unordered_map<unsigned long long, cNode>::const_iterator it = nodes.begin(); it != nodes.end(); ++it)
+        {
+            int x, y, z;
+            getCoordinates(it->first, x, y, z);
+            for (int dz=0; dz<=((z % C_BRICK_CELLS == 0) && (z > 0) ? 1 : 0); dz++)
+            {
+                for (int dy=0; dy<=((y % C_BRICK_CELLS == 0) && (y > 0) ? 1 : 0); dy++)
+                {
+                    for (int dx=0; dx<=((x % C_BRICK_CELLS == 0) && (x > 0) ? 1 : 0); dx++)
+                    {
+                        unsigned long long key = getKey(x / C_BRICK_CELLS - dx, y / C_BRICK_CELLS - dy, z / C_BRICK_CELLS - dz);
+                        if (m_brickIndex.find(key) == m_brickIndex.end())
+                        {
+                            int index = (int)m_brickIndex.size();
+                            m_brickIndex[key] = index;
+                        }
+                    }
+                }
+            }
+        }
+
+        // nodes of each brick; the nodes beyond the band take the side of
+        // their neighbours in the brick
+        const int numNodes = C_BRICK_NODES * C_BRICK_NODES * C_BRICK_NODES;
+        m_values.assign(m_brickIndex.size() * numNodes, 0.0f);
+        std::vector<char> known(numNodes);
+        for (std::unordered_map<unsigned long long, int>::const_iterator it = m_brickIndex.begin(); it != m_brickIndex.end(); ++it)
+        {
+            int bx, by, bz;
+            getCoordinates(it->first, bx, by, bz);
+            float* values = &m_values[(size_t)it->second * numNodes];
+
+            int numUnknown = 0;
+            for (int n=0; n<numNodes; n++)
+            {
+                int x = bx * C_BRICK_CELLS + n % C_BRICK_NODES;
+                int y = by * C_BRICK_CELLS + (n / C_BRICK_NODES) % C_BRICK_NODES;
+                int z = bz * C_BRICK_CELLS + n / (C_BRICK_NODES * C_BRICK_NODES);
+                std::unordered_map<unsigned long long, cNode>::const_iterator node = nodes.find(getKey(x, y, z));
+                known[n] = (node != nodes.end());
+                if (known[n])
+                {
+                    values[n] = (float)((node->second.m_alignment < 0.0) ? -node->second.m_distance : node->second.m_distance);
+                }
+                else
+                {
+                    values[n] = (float)m_bandWidth;
+                    numUnknown++;
+                }
+            }
+            fillUnknownNodes(values, known, numUnknown);
+        }
+        m_data = m_values.empty() ? NULL : &m_values[0];
+    }
+
+    //! This method makes the field use __a_numBricks__ bricks of keys __a_keys__ and distances __a_values__, stored by the caller, as written by another field (\ref getBrickKeys(), \ref getValues()).
+    void assign(double a_cellSize, double a_bandWidth, const cVector3d& a_origin,
+                const cVector3d& a_boundaryMin, const cVector3d& a_boundaryMax,
+                const unsigned long long* a_keys, size_t a_numBricks, const float* a_values)
+    {
+        m_values.clear();
+        m_brickIndex.clear();
+        m_cellSize = a_cellSize;
+        m_bandWidth = a_bandWidth;
+        m_origin = a_origin;
+        m_boundaryMin = a_boundaryMin;
+        m_boundaryMax = a_boundaryMax;
+        for (size_t i=0; i<a_numBricks; i++)
+        {
+            m_brickIndex[a_keys[i]] = (int)i;
+        }
+        m_data = a_values;
+    }
+
+    //! This method computes the distance __a_distance__ and its gradient __a_gradient__ at __a_pos__. It returns __false__ if __a_pos__ is farther than the band from the surface.
+    bool getDistance(const cVector3d& a_pos, double& a_distance, cVector3d& a_gradient) const
+    {
+        double gx = (a_pos(0) - m_origin(0)) / m_cellSize;
+        double gy = (a_pos(1) - m_origin(1)) / m_cellSize;
+        double gz = (a_pos(2) - m_origin(2)) / m_cellSize;
+        if ((gx < 0.0) || (gy < 0.0) || (gz < 0.0)) { return (false); }
+
+        int x = (int)gx;
+        int y = (int)gy;
+        int z = (int)gz;
+        std::unordered_map<unsigned long long, int>::const_iterator brick =
+            m_brickIndex.find(getKey(x / C_BRICK_CELLS, y / C_BRICK_CELLS, z / C_BRICK_CELLS));
+        if (brick == m_brickIndex.end()) { return (false); }
+
+        // values at the corners of the cell
+        const int numNodes = C_BRICK_NODES * C_BRICK_NODES * C_BRICK_NODES;
+        const float* v = m_data + (size_t)brick->second * numNodes +
+                         ((z % C_BRICK_CELLS) * C_BRICK_NODES + (y % C_BRICK_CELLS)) * C_BRICK_NODES + (x % C_BRICK_CELLS);
+        const int dy = C_BRICK_NODES;
+        const int dz = C_BRICK_NODES * C_BRICK_NODES;
+        double v000 = v[0],       v100 = v[1];
+        double v010 = v[dy],      v110 = v[dy+1];
+        double v001 = v[dz],      v101 = v[dz+1];
+        double v011 = v[dz+dy],   v111 = v[dz+dy+1];
+
+        // trilinear interpolation and its derivatives
+        double fx = gx - (double)x;
+        double fy = gy - (double)y;
+        double fz = gz - (double)z;
+        double v00 = v000 + fx * (v100 - v000);
+        double v10 = v010 + fx * (v110 - v010);
+        double v01 = v001 + fx * (v101 - v001);
+        double v11 = v011 + fx * (v111 - v011);
+        double v0 = v00 + fy * (v10 - v00);
+        double v1 = v01 + fy * (v11 - v01);
+        a_distance = v0 + fz * (v1 - v0);
+
+        double dx0 = (1.0 - fy) * (v100 - v000) + fy * (v110 - v010);
+        double dx1 = (1.0 - fy) * (v101 - v001) + fy * (v111 - v011);
+        a_gradient.set(((1.0 - fz) * dx0 + fz * dx1) / m_cellSize,
+                       ((1.0 - fz) * (v10 - v00) + fz * (v11 - v01)) / m_cellSize,
+                       (v1 - v0) / m_cellSize);
+        return (true);
+    }
+
+    //! This method returns the size of the cells.
+    double getCellSize() const { return (m_cellSize); }
+
+    //! This method returns the width of the band around the surface.
+    double getBandWidth() const { return (m_bandWidth); }
+
+    //! This method returns the position of grid node (0,0,0).
+    const cVector3d& getOrigin() const { return (m_origin); }
+
+    //! This method returns the lower corner of the region covered by the field.
+    const cVector3d& getBoundaryMin() const { return (m_boundaryMin); }
+
+    //! This method returns the upper corner of the region covered by the field.
+    const cVector3d& getBoundaryMax() const { return (m_boundaryMax); }
+
+    //! This method returns the number of bricks.
+    size_t getNumBricks() const { return (m_brickIndex.size()); }
+
+    //! This method returns the memory used by the distances [bytes].
+    size_t getMemorySize() const { return (getNumValues() * sizeof(float)); }
+
+    //! This method returns the key of each brick, in the order of their distances.
+    void getBrickKeys(std::vector<unsigned long long>& a_keys) const
+    {
+        a_keys.assign(m_brickIndex.size(), 0);
+        for (std::unordered_map<unsigned long long, int>::const_iterator it = m_brickIndex.begin(); it != m_brickIndex.end(); ++it)
+        {
+            a_keys[it->second] = it->first;
+        }
+    }
+
+    //! This method returns the distances at the nodes, brick by brick.
+    const float* getValues() const { return (m_data); }
+
+    //! This method returns the number of distances.
+    size_t getNumValues() const { return (m_brickIndex.size() * C_BRICK_NODES * C_BRICK_NODES * C_BRICK_NODES); }
+
+    //! This method returns the point of triangle __a_a__, __a_b__, __a_c__ closest to __a_pos__.
+    static cVector3d getClosestPoint(const cVector3d& a_pos, const cVector3d& a_a, const cVector3d& a_b, const cVector3d& a_c)
+    {
+        // regions of the triangle (vertices, edges, face) by barycentric tests
+        cVector3d ab = a_b - a_a;
+        cVector3d ac = a_c - a_a;
+        cVector3d ap = a_pos - a_a;
+        double d1 = ab.dot(ap);
+        double d2 = ac.dot(ap);
+        if ((d1 <= 0.0) && (d2 <= 0.0)) { return (a_a); }
+
+        cVector3d bp = a_pos - a_b;
+        double d3 = ab.dot(bp);
+        double d4 = ac.dot(bp);
+        if ((d3 >= 0.0) && (d4 <= d3)) { return (a_b); }
+
+        double vc = d1 * d4 - d3 * d2;
+        if ((vc <= 0.0) && (d1 >= 0.0) && (d3 <= 0.0)) { return (a_a + (d1 / (d1 - d3)) * ab); }
+
+        cVector3d cp = a_pos - a_c;
+        double d5 = ab.dot(cp);
+        double d6 = ac.dot(cp);
+        if ((d6 >= 0.0) && (d5 <= d6)) { return (a_c); }
+
+        double vb = d5 * d2 - d1 * d6;
+        if ((vb <= 0.0) && (d2 >= 0.0) && (d6 <= 0.0)) { return (a_a + (d2 / (d2 - d6)) * ac); }
+
+        double va = d3 * d6 - d5 * d4;
+        if ((va <= 0.0) && ((d4 - d3) >= 0.0) && ((d5 - d6) >= 0.0))
+        {
+            return (a_b + ((d4 - d3) / ((d4 - d3) + (d5 - d6))) * (a_c - a_b));
+        }
+
+        double denom = 1.0 / (va + vb + vc);
+        return (a_a + (vb * denom) * ab + (vc * denom) * ac);
+    }
+
+protected:
+
+    //! Distance to the nearest triangle of a node, and alignment of the node with its normal.
+    struct cNode
+    {
+        double m_distance;
+        double m_alignment;
+        cNode() : m_distance(1e30), m_alignment(0.0) {}
+    };
+
+    //! This method returns the hash key of grid coordinates __a_x__, __a_y__, __a_z__ (21 bits each).
+    static unsigned long long getKey(int a_x, int a_y, int a_z)
+    {
+        return ((unsigned long long)(a_x & 0x1fffff) |
+                ((unsigned long long)(a_y & 0x1fffff) << 21) |
+                ((unsigned long long)(a_z & 0x1fffff) << 42));
+    }
+
+    //! This method returns the grid coordinates of hash key __a_key__.
+    static void getCoordinates(unsigned long long a_key, int& a_x, int& a_y, int& a_z)
+    {
+        a_x = (int)(a_key & 0x1fffff);
+        a_y = (int)((a_key >> 21) & 0x1fffff);
+        a_z = (int)((a_key >> 42) & 0x1fffff);
+    }
+
+    //! This method gives the __a_numUnknown__ nodes of a brick beyond the band the side of a neighbour.
+    static void fillUnknownNodes(float* a_values, std::vector<char>& a_known, int a_numUnknown)
+    {
+        const int steps[3] = { 1, C_BRICK_NODES, C_BRICK_NODES * C_BRICK_NODES };
+        while (a_numUnknown > 0)
+        {
+            int numFilled = 0;
+            for (int n=0; n<(int)a_known.size(); n++)
+            {
+                if (a_known[n]) { continue; }
+                int coordinates[3] = { n % C_BRICK_NODES, (n / C_BRICK_NODES) % C_BRICK_NODES, n / (C_BRICK_NODES * C_BRICK_NODES) };
+                for (int k=0; k<3; k++)
+                {
+                    int neighbour = -1;
+                    if ((coordinates[k] > 0) && (a_known[n - steps[k]] == 1)) { neighbour = n - steps[k]; }
+                    else if ((coordinates[k] < C_BRICK_NODES - 1) && (a_known[n + steps[k]] == 1)) { neighbour = n + steps[k]; }
+                    if (neighbour >= 0)
+                    {
+                        a_values[n] = (a_values[neighbour] < 0.0f) ? -fabs(a_values[n]) : fabs(a_values[n]);
+                        a_known[n] = 2;
+                        numFilled++;
+                        break;
+                    }
+                }
+            }
+            if (numFilled == 0) { break; }
+
+            // nodes filled in this pass become neighbours for the next one
+            for (size_t n=0; n<a_known.size(); n++)
+            {
+                if (a_known[n] == 2) { a_known[n] = 1; }
+            }
+            a_numUnknown -= numFilled;
+        }
+    }
+
+    //! Size of the cells.
+    double m_cellSize;
+
+    //! Width of the band around the surface.
+    double m_bandWidth;
+
+    //! Position of grid node (0,0,0).
+    cVector3d m_origin;
+
+    //! Region covered by the field.
+    cVector3d m_boundaryMin;
+    cVector3d m_boundaryMax;
+
+    //! Index of each brick, by its grid coordinates.
+    std::unordered_map<unsigned long long, int> m_brickIndex;
+
+    //! Distances at the nodes, brick by brick, x first, when built by the field.
+    std::vector<float> m_values;
+
+    //! Distances used by the lookups: \ref m_values, or memory of the caller.
+    const float* m_data;
+};
+
+
+//==============================================================================
+/*!
+    This function appends the vertices and the triangles (three vertex
+    indices each) of the meshes of __a_object__ to __a_vertices__ and
+    __a_triangles__, in the frame of __a_object__.
+*/
+//==============================================================================
+inline void cGetMeshTriangles(cMultiMesh* a_object, std::vector<cVector3d>& a_vertices, std::vector<unsigned int>& a_triangles)
+{
+    for (int i=0; i<a_object->getNumMeshes(); i++)
+    {
+        cMesh* mesh = a_object->getMesh(i);
+        cVector3d meshPos = mesh->getLocalPos();
+        cMatrix3d meshRot = mesh->getLocalRot();
+
+        unsigned int first = (unsigned int)a_vertices.size();
+        for (int j=0; j<mesh->getNumVertices(); j++)
+        {
+            a_vertices.push_back(meshPos + meshRot * mesh->m_vertices->getLocalPos(j));
+        }
+        for (int j=0; j<mesh->getNumTriangles(); j++)
+        {
+            a_triangles.push_back(first + mesh->m_triangles->getVertexIndex0(j));
+            a_triangles.push_back(first + mesh->m_triangles->getVertexIndex1(j));
+            a_triangles.push_back(first + mesh->m_triangles->getVertexIndex2(j));
+        }
+    }
+}
+
+
+//==============================================================================
+/*!
+    This function samples points about __a_spacing__ apart on the triangles
+    __a_triangles__ over vertices __a_vertices__ and stores them in
+    __a_points__. The spacing is widened until there are at most
+    __a_maxPoints__ points.
+*/
+//==============================================================================
+inline void cSampleSurface(const std::vector<cVector3d>& a_vertices, const std::vector<unsigned int>& a_triangles,
+                           double a_spacing, size_t a_maxPoints, std::vector<cVector3d>& a_points)
+{
+    a_points.clear();
+    if (a_vertices.empty() || (a_spacing <= 0.0) || (a_maxPoints == 0)) { return; }
+
+    std::unordered_map<unsigned long long, size_t> cells;
+    for (double spacing = a_spacing; ; spacing *= 1.25)
+    {
+        // points on a barycentric grid of each triangle, one per cell of
+        // size spacing, so that they spread evenly over the surface
+        a_points.clear();
+        cells.clear();
+        for (size_t t=0; t+2<a_triangles.size(); t+=3)
+        {
+            const cVector3d& a = a_vertices[a_triangles[t]];
+            const cVector3d& b = a_vertices[a_triangles[t+1]];
+            const cVector3d& c = a_vertices[a_triangles[t+2]];
+            double edge = std::max((b - a).length(), std::max((c - b).length(), (a - c).length()));
+            int n = std::max(1, (int)ceil(edge / spacing));
+
+            for (int i=0; i<=n; i++)
+            {
+                for (int j=0; i+j<=n; j++)
+                {
+                    cVector3d pos = a + ((double)i / (double)n) * (b - a) + ((double)j / (double)n) * (c - a);
+                    unsigned long long key = ((unsigned long long)((long long)floor(pos(0) / spacing) & 0x1fffff)) |
+                                             ((unsigned long long)((long long)floor(pos(1) / spacing) & 0x1fffff) << 21) |
+                                             ((unsigned long long)((long long)floor(pos(2) / spacing) & 0x1fffff) << 42);
+                    if (cells.insert(std::make_pair(key, a_points.size())).second)
+                    {
+                        a_points.push_back(pos);
+                    }
+                }
+            }
+        }
+        if (a_points.size() <= a_maxPoints) { return; }
+    }
+}
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
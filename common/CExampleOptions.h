@@ -0,0 +1,304 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CExampleOptionsH
+#define CExampleOptionsH
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CExampleOptions.h
+
+    \brief
+    Command line options shared by the examples.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \struct     cExampleOptions
+    \brief
+    Command line options shared by the examples.
+*/
+//==============================================================================
+struct cExampleOptions
+{
+    //! File in which every haptic tick is recorded (empty if disabled).
+    std::string m_recordFile;
+
+    //! File from which the haptic device is replayed (empty if disabled).
+    std::string m_replayFile;
+
+    //! If __true__, the haptic loop runs without window for a fixed number of ticks.
+    bool m_headless;
+
+    //! Number of ticks run in headless mode.
+    unsigned long m_ticks;
+
+    //! If __true__, the headless haptic loop is paced at the nominal device rate.
+    bool m_paced;
+
+    //! Variant of the example (empty for the default one).
+    std::string m_variant;
+
+    //! Number of haptic devices.
+    int m_numDevices;
+
+    //! Refresh rate of the telemetry overlay [Hz].
+    double m_hudRate;
+
+    //! Number of frames rendered before the application exits (0 to run until the window is closed).
+    unsigned long m_frames;
+
+    //! Maximum number of frames in flight on the GPU.
+    int m_framesInFlight;
+
+    //! If __true__, the frames are rendered into a frame buffer object of a hidden window, along a fixed camera orbit.
+    bool m_offscreen;
+
+    //! Number of vertices along the largest side of the height map (0 for the resolution of the image).
+    int m_mapSize;
+
+    //! Quality of the shadow maps (empty for the default one).
+    std::string m_shadowQuality;
+
+    //! Prefix of the reference images saved after an offscreen run (empty if disabled).
+    std::string m_referencePrefix;
+
+    //! If __true__, the cursor and the workspace box are drawn where they are predicted to be when the frame is displayed.
+    bool m_predict;
+
+    //! If __true__, the error of the predicted positions is measured and reported.
+    bool m_predictionError;
+
+    //! Rate of the physics thread [Hz] (0 to step the physics in the haptic loop).
+    double m_physicsRate;
+
+    //! Size of the ODE steps [s] (0 for the period of the loop that steps ODE).
+    double m_odeStep;
+
+    //! Time budget of the ODE steps of a tick [s] (0 for 60% of the period of the loop that steps ODE).
+    double m_odeBudget;
+
+    //! Collision model of the blade: trimesh or sdf.
+    std::string m_bladeCollider;
+
+    //! File of the preprocessed models, written if missing or out of date (empty if disabled).
+    std::string m_assetCache;
+
+    //! Computation of the rotational drift: quaternion or matrix.
+    std::string m_rotationalDrift;
+
+    //! Error bound of the decimated collision mesh of the blade [m] (0 to collide with the full mesh).
+    double m_collisionError;
+
+    //! If __true__, the distance field collider of the blade reuses the points near it from step to step.
+    bool m_contactCache;
+
+    //! Number of threads stepping the islands of the ODE world.
+    int m_odeThreads;
+
+    //! Number of parts added to the ODE world, resting on its floor.
+    int m_numBodies;
+
+    //! Constructor of cExampleOptions.
+    cExampleOptions() : m_headless(false), m_ticks(40000), m_paced(false), m_numDevices(1), m_hudRate(10.0), m_frames(0), m_framesInFlight(1),
+                        m_offscreen(false), m_mapSize(0), m_predict(false), m_predictionError(false), m_physicsRate(1000.0), m_odeStep(0.0), m_odeBudget(0.0), m_bladeCollider("trimesh"), m_rotationalDrift("quaternion"), m_collisionError(0.0), m_contactCache(true), m_odeThreads(1), m_numBodies(0) {}
+
+    //! This method prints the supported options.
+    static void printUsage(const char* a_program)
+    {
+        std::cout << "Usage: " << a_program << " [options]" << std::endl << std::endl;
+        std::cout << "  --record <file>      record every haptic tick to <file>" << std::endl;
+        std::cout << "  --replay <file>      replace the haptic device by the ticks recorded in <file>" << std::endl;
+        std::cout << "  --headless           run the haptic loop without window and report its timing" << std::endl;
+        std::cout << "  --ticks <n>          number of ticks run in headless mode (default 40000)" << std::endl;
+        std::cout << "  --paced              pace the headless haptic loop at 4 kHz instead of free running" << std::endl;
+        std::cout << "  --variant <name>     select the variant of the example (200-TransMap: drift, edge, bubble, expansion)" << std::endl;
+        std::cout << "  --devices <n>        number of haptic devices (200-TransMap); device i > 0 records and replays <file>.i" << std::endl;
+        std::cout << "  --hud-rate <Hz>      refresh rate of the telemetry overlay (default 10)" << std::endl;
+        std::cout << "  --frames <n>         exit after <n> frames and report the frame time and latency" << std::endl;
+        std::cout << "  --frames-in-flight <n>  maximum number of frames in flight on the GPU (1 to 4, default 1)" << std::endl;
+        std::cout << "  --offscreen          render one camera orbit into a hidden frame buffer and report the frame time" << std::endl;
+        std::cout << "  --map-size <n>       resample the height map to <n> vertices along its largest side (200-TransMap)" << std::endl;
+        std::cout << "  --shadow-quality <q> shadow map quality: verylow, low, medium, high or veryhigh (default low)" << std::endl;
+        std::cout << "  --reference <prefix> save the offscreen reference images to <prefix>_<i>.png" << std::endl;
+        std::cout << "  --predict            draw the cursor and workspace box at their predicted display position (200-TransMap)" << std::endl;
+        std::cout << "  --prediction-error   measure the error of the predicted positions and report it on exit (200-TransMap)" << std::endl;
+        std::cout << "  --physics-rate <Hz>  rate of the ODE thread (10-ODE-PolishingTask, default 1000; 0 steps ODE in the haptic loop)" << std::endl;
+        std::cout << "  --ode-step <us>      size of the ODE steps (10-ODE-PolishingTask, default the period of the loop that steps ODE)" << std::endl;
+        std::cout << "  --ode-budget <us>    time budget of the ODE steps of a tick (10-ODE-PolishingTask, default 60% of the period)" << std::endl;
+        std::cout << "  --blade-collider <c> collision model of the blade: trimesh or sdf (10-ODE-PolishingTask, default trimesh)" << std::endl;
+        std::cout << "  --asset-cache <file> map the preprocessed models from <file>, written if missing or out of date (10-ODE-PolishingTask)" << std::endl;
+        std::cout << "  --rotational-drift <r> computation of the rotational drift: quaternion or matrix (10-ODE-PolishingTask, default quaternion)" << std::endl;
+        std::cout << "  --collision-error <mm> collide with a copy of the blade decimated within <mm> (10-ODE-PolishingTask, default 0: full mesh)" << std::endl;
+        std::cout << "  --ode-threads <n>    number of threads stepping the independent islands of the ODE world (10-ODE-PolishingTask, default 1)" << std::endl;
+        std::cout << "  --bodies <n>         add <n> parts on the floor of the ODE world, in stacks of two (10-ODE-PolishingTask, default 0)" << std::endl;
+        std::cout << "  --no-contact-cache   test every tool point against the distance field of the blade at each step (10-ODE-PolishingTask)" << std::endl;
+        std::cout << "  --help               display this message" << std::endl << std::endl;
+    }
+
+    //! This method reports value __a_value__ of option __a_option__ as invalid and prints the supported options. It returns __false__.
+    static bool rejectValue(const char* a_program, const std::string& a_option, const std::string& a_value)
+    {
+        std::cout << "Error - invalid value of option " << a_option << ": " << a_value << std::endl << std::endl;
+        printUsage(a_program);
+        return (false);
+    }
+
+    //! This method parses the command line. It returns __false__ if the application should exit.
+    bool parse(int argc, char* argv[])
+    {
+        for (int i=1; i<argc; i++)
+        {
+            std::string arg = argv[i];
+            bool hasValue = (i+1 < argc);
+
+            if ((arg == "--record") && hasValue)
+            {
+                m_recordFile = argv[++i];
+            }
+            else if ((arg == "--replay") && hasValue)
+            {
+                m_replayFile = argv[++i];
+            }
+            else if (arg == "--headless")
+            {
+                m_headless = true;
+            }
+            else if ((arg == "--ticks") && hasValue)
+            {
+                m_ticks = strtoul(argv[++i], NULL, 10);
+            }
+            else if (arg == "--paced")
+            {
+                m_paced = true;
+            }
+            else if ((arg == "--variant") && hasValue)
+            {
+                m_variant = argv[++i];
+            }
+            else if ((arg == "--devices") && hasValue)
+            {
+                m_numDevices = std::max(1, atoi(argv[++i]));
+            }
+            else if ((arg == "--hud-rate") && hasValue)
+            {
+                m_hudRate = std::max(0.1, atof(argv[++i]));
+            }
+            else if ((arg == "--frames") && hasValue)
+            {
+                m_frames = strtoul(argv[++i], NULL, 10);
+            }
+            else if ((arg == "--frames-in-flight") && hasValue)
+            {
+                m_framesInFlight = atoi(argv[++i]);
+            }
+            else if (arg == "--offscreen")
+            {
+                m_offscreen = true;
+            }
+            else if ((arg == "--map-size") && hasValue)
+            {
+                m_mapSize = std::max(2, atoi(argv[++i]));
+            }
+            else if ((arg == "--shadow-quality") && hasValue)
+            {
+                m_shadowQuality = argv[++i];
+            }
+            else if ((arg == "--reference") && hasValue)
+            {
+                m_referencePrefix = argv[++i];
+            }
+            else if (arg == "--predict")
+            {
+                m_predict = true;
+            }
+            else if (arg == "--prediction-error")
+            {
+                m_predictionError = true;
+            }
+            else if ((arg == "--physics-rate") && hasValue)
+            {
+                m_physicsRate = std::max(0.0, atof(argv[++i]));
+            }
+            else if ((arg == "--ode-step") && hasValue)
+            {
+                m_odeStep = std::max(0.0, 1e-6 * atof(argv[++i]));
+            }
+            else if ((arg == "--ode-budget") && hasValue)
+            {
+                m_odeBudget = std::max(0.0, 1e-6 * atof(argv[++i]));
+            }
+            else if ((arg == "--blade-collider") && hasValue)
+            {
+                m_bladeCollider = argv[++i];
+                if ((m_bladeCollider != "trimesh") && (m_bladeCollider != "sdf"))
+                {
+                    return (rejectValue(argv[0], arg, m_bladeCollider));
+                }
+            }
+            else if ((arg == "--asset-cache") && hasValue)
+            {
+                m_assetCache = argv[++i];
+            }
+            else if ((arg == "--rotational-drift") && hasValue)
+            {
+                m_rotationalDrift = argv[++i];
+                if ((m_rotationalDrift != "quaternion") && (m_rotationalDrift != "matrix"))
+                {
+                    return (rejectValue(argv[0], arg, m_rotationalDrift));
+                }
+            }
+            else if ((arg == "--collision-error") && hasValue)
+            {
+                m_collisionError = std::max(0.0, 1e-3 * atof(argv[++i]));
+            }
+            else if ((arg == "--ode-threads") && hasValue)
+            {
+                m_odeThreads = std::max(1, atoi(argv[++i]));
+            }
+            else if ((arg == "--bodies") && hasValue)
+            {
+                m_numBodies = std::max(0, atoi(argv[++i]));
+            }
+            else if (arg == "--no-contact-cache")
+            {
+                m_contactCache = false;
+            }
+            else
+            {
+                if (arg != "--help")
+                {
+                    std::cout << "Error - unknown or incomplete option: " << arg << std::endl << std::endl;
+                }
+                printUsage(argv[0]);
+                return (false);
+            }
+        }
+        return (true);
+    }
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,293 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CFramePacerH
+#define CFramePacerH
+//------------------------------------------------------------------------------
+#include <GLFW/glfw3.h>
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CFramePacer.h
+
+    \brief
+    Limits the frames in flight on the GPU with fence sync objects and
+    measures the frame latency.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cFramePacer
+    \brief
+    Limits the frames in flight on the GPU with fence sync objects and
+    measures the frame latency.
+
+    \details
+    Calling glFinish() before swapping the buffers stalls the CPU until the
+    GPU has drawn the whole frame, which adds a frame of latency. Instead,
+    \ref endFrame() inserts a fence after each swap and waits only when more
+    than \ref m_maxFramesInFlight frames are still being drawn.
+
+    Fences need OpenGL 3.2 or GL_ARB_sync, whose entry points are loaded
+    with glfwGetProcAddress(). Without them, \ref endFrame() calls
+    glFinish() after the swap, which is the previous behaviour minus the
+    stall before the swap.
+
+    The latency of a frame is measured from \ref beginFrame(), called when
+    the frame starts reading the state of the scene, to the time its fence
+    is seen signaled. It is the input-to-photon latency without the scan-out
+    of the display. Frame times and latencies are stored in buffers
+    allocated by \ref reserve(); frames beyond the capacity are counted only.
+
+    glGetError() synchronizes with the driver on some implementations, so
+    \ref checkErrors() only reads the errors every
+    \ref C_ERROR_CHECK_INTERVAL frames, unless NDEBUG is undefined.
+*/
+//==============================================================================
+class cFramePacer
+{
+public:
+
+    //! Maximum number of frames in flight.
+    static const int C_MAX_FRAMES_IN_FLIGHT = 4;
+
+    //! Size of the ring of fences.
+    static const int C_NUM_FENCES = C_MAX_FRAMES_IN_FLIGHT + 1;
+
+    //! Number of frames between two error checks in release builds.
+    static const int C_ERROR_CHECK_INTERVAL = 120;
+
+    //! Constructor of cFramePacer.
+    cFramePacer() : m_maxFramesInFlight(1), m_useFences(false), m_numFrames(0), m_numFramesInFlight(0), m_firstFrame(0),
+                    m_meanLatency(0.0), m_glFenceSync(NULL), m_glClientWaitSync(NULL), m_glDeleteSync(NULL) {}
+
+    //! This method selects fences or glFinish() for the current context and allows __a_maxFramesInFlight__ frames in flight.
+    bool initialize(int a_maxFramesInFlight)
+    {
+        m_maxFramesInFlight = std::max(1, std::min(a_maxFramesInFlight, (int)C_MAX_FRAMES_IN_FLIGHT));
+
+        // fences are core since OpenGL 3.2
+        const char* version = (const char*)glGetString(GL_VERSION);
+        int major = 0, minor = 0;
+        bool core = (version != NULL) && (sscanf(version, "%d.%d", &major, &minor) == 2) && ((major > 3) || ((major == 3) && (minor >= 2)));
+
+        if (core || glfwExtensionSupported("GL_ARB_sync"))
+        {
+            m_glFenceSync = (PFenceSync)glfwGetProcAddress("glFenceSync");
+            m_glClientWaitSync = (PClientWaitSync)glfwGetProcAddress("glClientWaitSync");
+            m_glDeleteSync = (PDeleteSync)glfwGetProcAddress("glDeleteSync");
+        }
+        m_useFences = (m_glFenceSync != NULL) && (m_glClientWaitSync != NULL) && (m_glDeleteSync != NULL);
+        return (m_useFences);
+    }
+
+    //! This method returns __true__ if fences are used, __false__ if glFinish() is.
+    bool getUseFences() const { return (m_useFences); }
+
+    //! This method returns the maximum number of frames in flight.
+    int getMaxFramesInFlight() const { return (m_maxFramesInFlight); }
+
+    //! This method allocates storage for the timing of __a_numFrames__ frames and resets the counters.
+    void reserve(size_t a_numFrames)
+    {
+        m_frameTimes.assign(a_numFrames, 0.0);
+        m_latencies.assign(a_numFrames, 0.0);
+        m_numFrames = 0;
+    }
+
+    //! This method marks the beginning of a frame, when it starts reading the state of the scene.
+    void beginFrame()
+    {
+        clock::time_point now = clock::now();
+        if ((m_numFrames > 0) && (m_numFrames - 1 < m_frameTimes.size()))
+        {
+            m_frameTimes[m_numFrames - 1] = std::chrono::duration<double>(now - m_frameStart).count();
+        }
+        m_frameStart = now;
+    }
+
+    //! This method marks the end of a frame. It must be called right after the buffers are swapped.
+    void endFrame()
+    {
+        size_t frame = m_numFrames++;
+
+        if (!m_useFences)
+        {
+            glFinish();
+            storeLatency(frame, clock::now());
+            return;
+        }
+
+        // insert the fence of the frame
+        int slot = (m_firstFrame + m_numFramesInFlight) % C_NUM_FENCES;
+        m_fences[slot] = m_glFenceSync(C_GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_frameIndices[slot] = frame;
+        m_inputTimes[slot] = m_frameStart;
+        m_numFramesInFlight++;
+
+        // wait for the oldest frames until few enough are in flight, then
+        // collect the frames already drawn without waiting
+        while (m_numFramesInFlight > 0)
+        {
+            bool wait = (m_numFramesInFlight > m_maxFramesInFlight);
+            unsigned int result = m_glClientWaitSync(m_fences[m_firstFrame], C_GL_SYNC_FLUSH_COMMANDS_BIT,
+                                                     wait ? C_WAIT_TIMEOUT_NS : 0);
+            if ((result == C_GL_TIMEOUT_EXPIRED) && !wait) { break; }
+
+            storeLatency(m_frameIndices[m_firstFrame], clock::now(), m_inputTimes[m_firstFrame]);
+            m_glDeleteSync(m_fences[m_firstFrame]);
+            m_firstFrame = (m_firstFrame + 1) % C_NUM_FENCES;
+            m_numFramesInFlight--;
+        }
+    }
+
+    //! This method returns the first OpenGL error raised since the last check, or GL_NO_ERROR if none or if no check is due.
+    GLenum checkErrors()
+    {
+#ifdef NDEBUG
+        if ((m_numFrames % C_ERROR_CHECK_INTERVAL) != 0) { return (GL_NO_ERROR); }
+#endif
+        GLenum first = glGetError();
+        if (first != GL_NO_ERROR)
+        {
+            // drain the remaining error flags
+            for (int i=0; (i<8) && (glGetError() != GL_NO_ERROR); i++) {}
+        }
+        return (first);
+    }
+
+    //! This method returns the number of frames ended.
+    size_t getNumFrames() const { return (m_numFrames); }
+
+    //! This method returns the latency of the recent frames [s], to predict when the next frame is displayed.
+    double getMeanLatency() const { return (m_meanLatency); }
+
+    //! This method prints the frame time and latency distributions.
+    void printReport(const std::string& a_title) const
+    {
+        // the latency of the frames still in flight is not known yet
+        size_t numTimes = std::min((m_numFrames > 0) ? m_numFrames - 1 : 0, m_frameTimes.size());
+        size_t numLatencies = std::min(m_numFrames - m_numFramesInFlight, m_latencies.size());
+
+        double times[4], latencies[4];
+        getPercentiles(m_frameTimes, numTimes, times);
+        getPercentiles(m_latencies, numLatencies, latencies);
+
+        printf("%s: %lu frames, %s, %d frame(s) in flight\n", a_title.c_str(), (unsigned long)m_numFrames,
+               m_useFences ? "fences" : "glFinish", m_maxFramesInFlight);
+        printf("frame time [ms]: p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n",
+               1e3 * times[0], 1e3 * times[1], 1e3 * times[2], 1e3 * times[3]);
+        printf("frame latency [ms]: p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n",
+               1e3 * latencies[0], 1e3 * latencies[1], 1e3 * latencies[2], 1e3 * latencies[3]);
+    }
+
+protected:
+
+    //! Monotonic clock used for all measurements.
+    typedef std::chrono::steady_clock clock;
+
+    //! Fence sync object and entry points of GL_ARB_sync.
+    typedef struct __cGLsync* GLsyncObject;
+    typedef GLsyncObject (APIENTRY *PFenceSync)(GLenum, GLbitfield);
+    typedef GLenum (APIENTRY *PClientWaitSync)(GLsyncObject, GLbitfield, unsigned long long);
+    typedef void (APIENTRY *PDeleteSync)(GLsyncObject);
+
+    //! Constants of GL_ARB_sync.
+    static const GLenum C_GL_SYNC_GPU_COMMANDS_COMPLETE = 0x9117;
+    static const GLbitfield C_GL_SYNC_FLUSH_COMMANDS_BIT = 0x00000001;
+    static const GLenum C_GL_TIMEOUT_EXPIRED = 0x911B;
+
+    //! Timeout of a blocking wait [ns].
+    static const unsigned long long C_WAIT_TIMEOUT_NS = 1000000000ULL;
+    //! This method stores the latency of frame __a_frame__, drawn at __a_drawnTime__.
+    void storeLatency(size_t a_frame, clock::time_point a_drawnTime)
+    {
+        storeLatency(a_frame, a_drawnTime, m_frameStart);
+    }
+
+    //! This method stores the latency of frame __a_frame__, started at __a_inputTime__ and drawn at __a_drawnTime__.
+    void storeLatency(size_t a_frame, clock::time_point a_drawnTime, clock::time_point a_inputTime)
+    {
+        double latency = std::chrono::duration<double>(a_drawnTime - a_inputTime).count();
+        // the mean follows about the last 10 frames
+        m_meanLatency = (a_frame == 0) ? latency : m_meanLatency + 0.1 * (latency - m_meanLatency);
+        if (a_frame < m_latencies.size())
+        {
+            m_latencies[a_frame] = latency;
+        }
+    }
+
+    //! This method computes the median, 90th, 99th percentiles and maximum of the first __a_count__ values.
+    static void getPercentiles(const std::vector<double>& a_values, size_t a_count, double* a_result)
+    {
+        static const double percentiles[] = { 50.0, 90.0, 99.0, 100.0 };
+        std::vector<double> sorted(a_values.begin(), a_values.begin() + a_count);
+        std::sort(sorted.begin(), sorted.end());
+        for (int i=0; i<4; i++)
+        {
+            a_result[i] = sorted.empty() ? 0.0 : sorted[(size_t)(percentiles[i] / 100.0 * (double)(sorted.size() - 1) + 0.5)];
+        }
+    }
+
+    //! Maximum number of frames in flight.
+    int m_maxFramesInFlight;
+
+    //! __true__ if fences are used, __false__ if glFinish() is.
+    bool m_useFences;
+
+    //! Number of frames ended.
+    size_t m_numFrames;
+
+    //! Number of frames whose fence has not been seen signaled.
+    int m_numFramesInFlight;
+
+    //! Slot of the oldest frame in flight.
+    int m_firstFrame;
+
+    //! Fence, index and input time of the frames in flight.
+    GLsyncObject m_fences[C_NUM_FENCES];
+    size_t m_frameIndices[C_NUM_FENCES];
+    clock::time_point m_inputTimes[C_NUM_FENCES];
+
+    //! Beginning of the current frame.
+    clock::time_point m_frameStart;
+
+    //! Exponential moving average of the frame latency [s].
+    double m_meanLatency;
+
+    //! Time between the beginnings of consecutive frames [s].
+    std::vector<double> m_frameTimes;
+
+    //! Latency of each stored frame [s].
+    std::vector<double> m_latencies;
+
+    //! Entry points of GL_ARB_sync.
+    PFenceSync m_glFenceSync;
+    PClientWaitSync m_glClientWaitSync;
+    PDeleteSync m_glDeleteSync;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,169 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CGlobalFrameUpdaterH
+#define CGlobalFrameUpdaterH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CGlobalFrameUpdater.h
+
+    \brief
+    Incremental update of the global frames of a scene graph.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cGlobalFrameUpdater
+    \brief
+    Incremental update of the global frames of a scene graph.
+
+    \details
+    world->computeGlobalPositions() walks the whole scene graph, although
+    a haptic tick usually moves a handful of objects. Instead, the objects
+    moved during the tick are marked with \ref markDirty() and
+    \ref update() recomputes the global frames of their subtrees only,
+    from the global frame of their parent. The cost of a tick then depends
+    on what moved, not on the size of the scene.
+
+    The objects of the scene graph that are never marked keep the global
+    frame computed by a full update, so the whole world must be updated
+    once before the haptic loop starts. An object moved by the graphics
+    thread (a camera for instance) must be marked by the haptic thread
+    before its frame is read by a haptic tick.
+
+    The number of nodes updated is accumulated for each tick, so that the
+    cost of the incremental update can be compared with the size of the
+    scene (\ref countNodes()).
+*/
+//==============================================================================
+class cGlobalFrameUpdater
+{
+public:
+
+    //! Constructor of cGlobalFrameUpdater.
+    cGlobalFrameUpdater() : m_numTicks(0), m_numNodes(0), m_numNodesTick(0), m_numNodesLastTick(0)
+    {
+        m_dirty.reserve(C_NUM_DIRTY_RESERVED);
+    }
+
+    //! This method marks the subtree of __a_object__ for update.
+    void markDirty(cGenericObject* a_object)
+    {
+        for (size_t i=0; i<m_dirty.size(); i++)
+        {
+            if (m_dirty[i] == a_object) { return; }
+        }
+        m_dirty.push_back(a_object);
+    }
+
+    //! This method recomputes the global frames of the marked subtrees and returns the number of nodes updated.
+    int update()
+    {
+        int numNodes = 0;
+        for (size_t i=0; i<m_dirty.size(); i++)
+        {
+            cGenericObject* object = m_dirty[i];
+
+            // the subtree of a marked ancestor is updated anyway
+            if (hasDirtyAncestor(object)) { continue; }
+
+            cGenericObject* parent = object->getParent();
+            if (parent != NULL)
+            {
+                object->computeGlobalPositions(true, parent->getGlobalPos(), parent->getGlobalRot());
+            }
+            else
+            {
+                object->computeGlobalPositions(true);
+            }
+            numNodes += countNodes(object);
+        }
+        m_dirty.clear();
+        m_numNodesTick += numNodes;
+        return (numNodes);
+    }
+
+    //! This method marks the end of a tick for the statistics.
+    void endTick()
+    {
+        m_numNodesLastTick = m_numNodesTick;
+        m_numNodes += m_numNodesTick;
+        m_numNodesTick = 0;
+        m_numTicks++;
+    }
+
+    //! This method returns the number of nodes updated during the last tick.
+    int getNumNodesLastTick() const { return (m_numNodesLastTick); }
+
+    //! This method returns the average number of nodes updated per tick.
+    double getMeanNodesPerTick() const { return ((m_numTicks > 0) ? (double)m_numNodes / (double)m_numTicks : 0.0); }
+
+    //! This method returns the number of nodes of the subtree of __a_object__, __a_object__ included.
+    static int countNodes(cGenericObject* a_object)
+    {
+        int numNodes = 1;
+        unsigned int numChildren = a_object->getNumChildren();
+        for (unsigned int i=0; i<numChildren; i++)
+        {
+            numNodes += countNodes(a_object->getChild(i));
+        }
+        return (numNodes);
+    }
+
+protected:
+
+    //! This method returns __true__ if an ancestor of __a_object__ is marked.
+    bool hasDirtyAncestor(cGenericObject* a_object) const
+    {
+        for (cGenericObject* parent = a_object->getParent(); parent != NULL; parent = parent->getParent())
+        {
+            for (size_t i=0; i<m_dirty.size(); i++)
+            {
+                if (m_dirty[i] == parent) { return (true); }
+            }
+        }
+        return (false);
+    }
+
+    //! Number of marked objects for which storage is reserved, so that marking does not allocate.
+    static const size_t C_NUM_DIRTY_RESERVED = 16;
+
+    //! Objects whose subtree is updated by the next call to \ref update().
+    std::vector<cGenericObject*> m_dirty;
+
+    //! Number of ticks ended.
+    unsigned long m_numTicks;
+
+    //! Number of nodes updated during the ended ticks.
+    unsigned long m_numNodes;
+
+    //! Number of nodes updated during the current tick.
+    int m_numNodesTick;
+
+    //! Number of nodes updated during the last ended tick.
+    int m_numNodesLastTick;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
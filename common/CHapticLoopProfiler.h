@@ -0,0 +1,218 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CHapticLoopProfilerH
+#define CHapticLoopProfilerH
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CHapticLoopProfiler.h
+
+    \brief
+    Measures the rate and the per-tick latency of a haptic loop.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cHapticLoopProfiler
+    \brief
+    Measures the rate and the per-tick latency of a haptic loop.
+
+    \details
+    The haptic loop calls \ref beginTick() at the top of each tick and
+    \ref endTick() once the forces have been sent. Latencies are stored in a
+    buffer allocated by \ref reserve() so that measuring never allocates
+    memory from the haptic thread; ticks beyond the capacity are counted but
+    their latency is not stored.
+
+    Every latency is also counted in a fixed histogram of
+    \ref C_NUM_LATENCY_BINS bins, which another thread can copy while the
+    loop runs (\ref getLatencyHistogram()) to display live percentiles
+    without allocating.
+
+    When a pacing rate is set, \ref beginTick() waits for the time slot of
+    the tick, which emulates a device running at a fixed rate.
+*/
+//==============================================================================
+class cHapticLoopProfiler
+{
+public:
+
+    //! Number of bins of the latency histogram; the last one counts the latencies beyond the others.
+    static const int C_NUM_LATENCY_BINS = 512;
+
+    //! This method returns the width of the bins of the latency histogram [s].
+    static double getLatencyBinWidth() { return (0.5e-6); }
+
+    //! Constructor of cHapticLoopProfiler.
+    cHapticLoopProfiler() : m_pacingRate(0.0), m_numTicks(0)
+    {
+        for (int i=0; i<C_NUM_LATENCY_BINS; i++) { m_latencyHistogram[i].store(0, std::memory_order_relaxed); }
+    }
+
+    //! This method allocates storage for the latency of __a_numTicks__ ticks and resets the counters.
+    void reserve(size_t a_numTicks)
+    {
+        m_latencies.assign(a_numTicks, 0.0);
+        m_numTicks = 0;
+    }
+
+    //! This method paces the loop at __a_rate__ [Hz]. A rate of zero runs the loop as fast as possible.
+    void setPacingRate(double a_rate) { m_pacingRate = a_rate; }
+
+    //! This method returns the pacing rate [Hz], zero if the loop is not paced.
+    double getPacingRate() const { return (m_pacingRate); }
+
+    //! This method marks the beginning of a tick.
+    void beginTick()
+    {
+        if (m_numTicks == 0)
+        {
+            m_startTime = clock::now();
+        }
+        else if (m_pacingRate > 0.0)
+        {
+            clock::time_point slot = m_startTime + std::chrono::duration_cast<clock::duration>(
+                std::chrono::duration<double>((double)m_numTicks / m_pacingRate));
+            while (clock::now() < slot) {}
+        }
+        m_tickTime = clock::now();
+    }
+
+    //! This method marks the end of a tick.
+    void endTick()
+    {
+        m_endTime = clock::now();
+        double latency = std::chrono::duration<double>(m_endTime - m_tickTime).count();
+        if (m_numTicks < m_latencies.size())
+        {
+            m_latencies[m_numTicks] = latency;
+        }
+        m_numTicks++;
+
+        // the haptic thread is the only writer of the histogram
+        int bin = std::min((int)(latency / getLatencyBinWidth()), C_NUM_LATENCY_BINS - 1);
+        m_latencyHistogram[bin].store(m_latencyHistogram[bin].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    //! This method returns the number of ticks measured since the last reset.
+    size_t getNumTicks() const { return (m_numTicks); }
+
+    //! This method returns the time elapsed between the first and the last tick [s].
+    double getElapsedTime() const
+    {
+        if (m_numTicks == 0) { return (0.0); }
+        return (std::chrono::duration<double>(m_endTime - m_startTime).count());
+    }
+
+    //! This method returns the average tick rate [Hz].
+    double getTickRate() const
+    {
+        double elapsed = getElapsedTime();
+        return ((elapsed > 0.0) ? (double)m_numTicks / elapsed : 0.0);
+    }
+
+    //! This method returns the latency percentiles __a_percentiles__ [s] of the stored ticks.
+    std::vector<double> getLatencyPercentiles(const std::vector<double>& a_percentiles) const
+    {
+        std::vector<double> sorted(m_latencies.begin(), m_latencies.begin() + std::min(m_numTicks, m_latencies.size()));
+        std::sort(sorted.begin(), sorted.end());
+
+        std::vector<double> result;
+        for (size_t i=0; i<a_percentiles.size(); i++)
+        {
+            if (sorted.empty()) { result.push_back(0.0); continue; }
+            double rank = a_percentiles[i] / 100.0 * (double)(sorted.size() - 1);
+            result.push_back(sorted[(size_t)(rank + 0.5)]);
+        }
+        return (result);
+    }
+
+    //! This method copies the latency histogram (\ref C_NUM_LATENCY_BINS counts) to __a_counts__. It can be called from any thread.
+    void getLatencyHistogram(unsigned int* a_counts) const
+    {
+        for (int i=0; i<C_NUM_LATENCY_BINS; i++) { a_counts[i] = m_latencyHistogram[i].load(std::memory_order_relaxed); }
+    }
+
+    //! This method returns the latency percentile __a_percentile__ [s] of the histogram __a_counts__ (upper edge of the bin).
+    static double getHistogramPercentile(const unsigned int* a_counts, double a_percentile)
+    {
+        unsigned long total = 0;
+        for (int i=0; i<C_NUM_LATENCY_BINS; i++) { total += a_counts[i]; }
+        if (total == 0) { return (0.0); }
+
+        unsigned long rank = (unsigned long)(a_percentile / 100.0 * (double)(total - 1));
+        unsigned long count = 0;
+        for (int i=0; i<C_NUM_LATENCY_BINS; i++)
+        {
+            count += a_counts[i];
+            if (count > rank) { return ((i + 1) * getLatencyBinWidth()); }
+        }
+        return (C_NUM_LATENCY_BINS * getLatencyBinWidth());
+    }
+
+    //! This method prints the tick rate and the latency distribution.
+    void printReport(const std::string& a_title) const
+    {
+        static const double percentiles[] = { 50.0, 90.0, 99.0, 99.9, 100.0 };
+        std::vector<double> values = getLatencyPercentiles(std::vector<double>(percentiles, percentiles + 5));
+
+        printf("%s: %lu ticks in %.3f s (%.0f ticks/s%s)\n", a_title.c_str(),
+               (unsigned long)m_numTicks, getElapsedTime(), getTickRate(),
+               (m_pacingRate > 0.0) ? ", paced" : "");
+        printf("tick latency [us]: p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f  max %.2f\n",
+               1e6 * values[0], 1e6 * values[1], 1e6 * values[2], 1e6 * values[3], 1e6 * values[4]);
+    }
+
+private:
+
+    //! Monotonic clock used for all measurements.
+    typedef std::chrono::steady_clock clock;
+
+    //! Pacing rate [Hz], zero if the loop is not paced.
+    double m_pacingRate;
+
+    //! Number of ticks measured since the last reset.
+    size_t m_numTicks;
+
+    //! Latency of each stored tick [s].
+    std::vector<double> m_latencies;
+
+    //! Number of ticks per latency bin of \ref getLatencyBinWidth().
+    std::atomic<unsigned int> m_latencyHistogram[C_NUM_LATENCY_BINS];
+
+    //! Beginning of the first tick.
+    clock::time_point m_startTime;
+
+    //! Beginning of the current tick.
+    clock::time_point m_tickTime;
+
+    //! End of the last tick.
+    clock::time_point m_endTime;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,488 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CMeshDecimatorH
+#define CMeshDecimatorH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CMeshDecimator.h
+
+    \brief
+    Simplification of a triangle mesh within a bound on the geometric
+    error, by quadric error edge collapses.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cQuadricDecimator
+    \brief
+    Simplification of a triangle mesh within a bound on the geometric
+    error, by quadric error edge collapses.
+
+    \details
+    Vertices at the same position are first welded, so that the seams of
+    the texture coordinates and of the normals do not split the surface.
+    Each vertex then holds the quadric of the planes of its triangles (and
+    of planes normal to the border edges), which gives the sum of the
+    squared distances of a point to these planes. Edges are collapsed,
+    cheapest first, into the point that minimizes the sum of the quadrics
+    of their two vertices, and the quadrics are added. A collapse is
+    skipped when it would flip a triangle or make the surface non-manifold.
+
+    The decimation stops when the cheapest collapse costs more than the
+    square of the error bound: every vertex of the result is then within
+    the bound of the planes of all the triangles of the input that
+    collapsed into it.
+
+    \ref getVertexMap() gives the vertex of the result that each vertex of
+    the input collapsed into, so that values computed on the result can be
+    shown on the input mesh.
+*/
+//==============================================================================
+class cQuadricDecimator
+{
+public:
+
+    //! Constructor of cQuadricDecimator.
+    cQuadricDecimator() : m_maxError(0.0) {}
+
+    //! This method simplifies triangles __a_triangles__ over vertices __a_vertices__ within error __a_maxError__, and returns the number of triangles of the result.
+    size_t decimate(const std::vector<cVector3d>& a_vertices, const std::vector<unsigned int>& a_triangles, double a_maxError)
+    {
+        m_maxError = 0.0;
+        weld(a_vertices, a_triangles);
+        initQuadrics();
+
+        // collapse the edges, cheapest first, until the error bound
+        std::priority_queue<cCollapse> collapses;
+        for (size_t t=0; t<m_faces.size(); t++)
+        {
+            for (int k=0; k<3; k++)
+            {
+                pushCollapse(collapses, m_faces[t].m_v[k], m_faces[t].m_v[(k+1)%3]);
+            }
+        }
+        double maxCost = a_maxError * a_maxError;
+        while (!collapses.empty())
+        {
+            cCollapse collapse = collapses.top();
+            collapses.pop();
+            if (collapse.m_cost > maxCost) { break; }
+            if (!m_alive[collapse.m_v0] || !m_alive[collapse.m_v1] ||
+                (m_stamps[collapse.m_v0] != collapse.m_stamp0) || (m_stamps[collapse.m_v1] != collapse.m_stamp1)) { continue; }
+            if (!isCollapseValid(collapse.m_v0, collapse.m_v1, collapse.m_pos)) { continue; }
+
+            applyCollapse(collapse.m_v0, collapse.m_v1, collapse.m_pos);
+            m_maxError = cMax(m_maxError, sqrt(cMax(collapse.m_cost, 0.0)));
+
+            std::vector<unsigned int> neighbors;
+            getNeighbors(collapse.m_v0, neighbors);
+            for (size_t i=0; i<neighbors.size(); i++) { pushCollapse(collapses, collapse.m_v0, neighbors[i]); }
+        }
+
+        compact(a_vertices.size());
+        return (m_triangles.size() / 3);
+    }
+
+    //! This method returns the vertices of the result.
+    const std::vector<cVector3d>& getVertices() const { return (m_vertices); }
+
+    //! This method returns the triangles of the result, three vertex indices each.
+    const std::vector<unsigned int>& getTriangles() const { return (m_triangles); }
+
+    //! This method returns, for each vertex of the input, the vertex of the result it collapsed into.
+    const std::vector<unsigned int>& getVertexMap() const { return (m_vertexMap); }
+
+    //! This method returns the largest error of the collapses done, as the square root of their cost.
+    double getMaxError() const { return (m_maxError); }
+
+    //! This method adds the result to __a_multiMesh__ as a single mesh.
+    void createMesh(cMultiMesh* a_multiMesh) const
+    {
+        cMesh* mesh = a_multiMesh->newMesh();
+        for (size_t i=0; i<m_vertices.size(); i++)
+        {
+            mesh->newVertex(m_vertices[i]);
+        }
+        for (size_t i=0; i+2<m_triangles.size(); i+=3)
+        {
+            mesh->newTriangle(m_triangles[i], m_triangles[i+1], m_triangles[i+2]);
+        }
+        mesh->computeAllNormals();
+        a_multiMesh->computeBoundaryBox(true);
+    }
+
+protected:
+
+    //! Symmetric 4x4 matrix of a quadric: xx xy xz xw yy yz yw zz zw ww.
+    struct cQuadric
+    {
+        double m_q[10];
+
+        cQuadric() { for (int i=0; i<10; i++) { m_q[i] = 0.0; } }
+
+        //! This method adds the squared distance to plane __a_n__.x + __a_d__ = 0.
+        void addPlane(const cVector3d& a_n, double a_d)
+        {
+            double a = a_n(0), b = a_n(1), c = a_n(2);
+            m_q[0] += a*a; m_q[1] += a*b; m_q[2] += a*c; m_q[3] += a*a_d;
+            m_q[4] += b*b; m_q[5] += b*c; m_q[6] += b*a_d;
+            m_q[7] += c*c; m_q[8] += c*a_d;
+            m_q[9] += a_d*a_d;
+        }
+
+        //! This method adds quadric __a_other__.
+        void add(const cQuadric& a_other) { for (int i=0; i<10; i++) { m_q[i] += a_other.m_q[i]; } }
+
+        //! This method returns the sum of the squared distances of __a_p__ to the planes.
+        double evaluate(const cVector3d& a_p) const
+        {
+            double x = a_p(0), y = a_p(1), z = a_p(2);
+            return (m_q[0]*x*x + 2.0*m_q[1]*x*y + 2.0*m_q[2]*x*z + 2.0*m_q[3]*x +
+                    m_q[4]*y*y + 2.0*m_q[5]*y*z + 2.0*m_q[6]*y +
+                    m_q[7]*z*z + 2.0*m_q[8]*z + m_q[9]);
+        }
+
+        //! This method computes the point __a_p__ of least error. It returns __false__ if the quadric is singular.
+        bool getMinimum(cVector3d& a_p) const
+        {
+            cMatrix3d a;
+            a.set(m_q[0], m_q[1], m_q[2],
+                  m_q[1], m_q[4], m_q[5],
+                  m_q[2], m_q[5], m_q[7]);
+            double det = a.det();
+            double scale = m_q[0] + m_q[4] + m_q[7];
+            if (fabs(det) < 1e-9 * scale * scale * scale) { return (false); }
+            cMatrix3d inverse;
+            a.invertr(inverse);
+            a_p = inverse * cVector3d(-m_q[3], -m_q[6], -m_q[8]);
+            return (true);
+        }
+    };
+
+    //! Triangle of the mesh being simplified.
+    struct cFace
+    {
+        unsigned int m_v[3];
+        bool m_removed;
+    };
+
+    //! Candidate collapse of vertex __m_v1__ into vertex __m_v0__, at position __m_pos__.
+    struct cCollapse
+    {
+        double m_cost;
+        unsigned int m_v0, m_v1;
+        unsigned int m_stamp0, m_stamp1;
+        cVector3d m_pos;
+        bool operator<(const cCollapse& a_other) const { return (m_cost > a_other.m_cost); }
+    };
+
+    //! Position of a vertex, compared exactly for welding.
+    struct cPositionKey
+    {
+        double m_x, m_y, m_z;
+        bool operator<(const cPositionKey& a_other) const
+        {
+            if (m_x != a_other.m_x) { return (m_x < a_other.m_x); }
+            if (m_y != a_other.m_y) { return (m_y < a_other.m_y); }
+            return (m_z < a_other.m_z);
+        }
+    };
+
+    //! This method welds the vertices at the same position and drops the degenerate triangles.
+    void weld(const std::vector<cVector3d>& a_vertices, const std::vector<unsigned int>& a_triangles)
+    {
+        std::map<cPositionKey, unsigned int> welded;
+        m_welded.resize(a_vertices.size());
+        m_positions.clear();
+        for (size_t i=0; i<a_vertices.size(); i++)
+        {
+            cPositionKey key = { a_vertices[i](0), a_vertices[i](1), a_vertices[i](2) };
+            std::map<cPositionKey, unsigned int>::iterator it = welded.find(key);
+            if (it == welded.end())
+            {
+                it = welded.insert(std::make_pair(key, (unsigned int)m_positions.size())).first;
+                m_positions.push_back(a_vertices[i]);
+            }
+            m_welded[i] = it->second;
+        }
+
+        size_t numVertices = m_positions.size();
+        m_alive.assign(numVertices, true);
+        m_stamps.assign(numVertices, 0);
+        m_parents.resize(numVertices);
+        for (size_t i=0; i<numVertices; i++) { m_parents[i] = (unsigned int)i; }
+        m_vertexFaces.assign(numVertices, std::vector<unsigned int>());
+
+        m_faces.clear();
+        for (size_t i=0; i+2<a_triangles.size(); i+=3)
+        {
+            cFace face;
+            for (int k=0; k<3; k++) { face.m_v[k] = m_welded[a_triangles[i+k]]; }
+            face.m_removed = false;
+            if ((face.m_v[0] == face.m_v[1]) || (face.m_v[1] == face.m_v[2]) || (face.m_v[2] == face.m_v[0])) { continue; }
+            for (int k=0; k<3; k++) { m_vertexFaces[face.m_v[k]].push_back((unsigned int)m_faces.size()); }
+            m_faces.push_back(face);
+        }
+    }
+
+    //! This method sets the quadric of each vertex from the planes of its triangles and of its border edges.
+    void initQuadrics()
+    {
+        m_quadrics.assign(m_positions.size(), cQuadric());
+        std::map<std::pair<unsigned int, unsigned int>, int> edgeFaces;
+        for (size_t t=0; t<m_faces.size(); t++)
+        {
+            cVector3d normal;
+            if (!getNormal(m_faces[t], normal)) { continue; }
+            double d = -normal.dot(m_positions[m_faces[t].m_v[0]]);
+            for (int k=0; k<3; k++)
+            {
+                m_quadrics[m_faces[t].m_v[k]].addPlane(normal, d);
+                unsigned int a = m_faces[t].m_v[k], b = m_faces[t].m_v[(k+1)%3];
+                edgeFaces[std::make_pair(cMin(a, b), cMax(a, b))]++;
+            }
+        }
+
+        // planes through the border edges, normal to their triangle, keep the border in place
+        for (size_t t=0; t<m_faces.size(); t++)
+        {
+            cVector3d normal;
+            if (!getNormal(m_faces[t], normal)) { continue; }
+            for (int k=0; k<3; k++)
+            {
+                unsigned int a = m_faces[t].m_v[k], b = m_faces[t].m_v[(k+1)%3];
+                if (edgeFaces[std::make_pair(cMin(a, b), cMax(a, b))] != 1) { continue; }
+                cVector3d edge = m_positions[b] - m_positions[a];
+                cVector3d side = edge.cross(normal);
+                if (side.length() < C_SMALL) { continue; }
+                side.normalize();
+                double d = -side.dot(m_positions[a]);
+                m_quadrics[a].addPlane(side, d);
+                m_quadrics[b].addPlane(side, d);
+            }
+        }
+    }
+
+    //! This method computes the unit normal of triangle __a_face__. It returns __false__ if the triangle has no area.
+    bool getNormal(const cFace& a_face, cVector3d& a_normal) const
+    {
+        const cVector3d& a = m_positions[a_face.m_v[0]];
+        a_normal = (m_positions[a_face.m_v[1]] - a).cross(m_positions[a_face.m_v[2]] - a);
+        double length = a_normal.length();
+        if (length < C_SMALL * C_SMALL) { return (false); }
+        a_normal.mul(1.0 / length);
+        return (true);
+    }
+
+    //! This method adds the collapse of the edge between __a_v0__ and __a_v1__ to __a_collapses__.
+    void pushCollapse(std::priority_queue<cCollapse>& a_collapses, unsigned int a_v0, unsigned int a_v1) const
+    {
+        cQuadric quadric = m_quadrics[a_v0];
+        quadric.add(m_quadrics[a_v1]);
+
+        cCollapse collapse;
+        collapse.m_v0 = a_v0;
+        collapse.m_v1 = a_v1;
+        collapse.m_stamp0 = m_stamps[a_v0];
+        collapse.m_stamp1 = m_stamps[a_v1];
+        if (quadric.getMinimum(collapse.m_pos))
+        {
+            collapse.m_cost = quadric.evaluate(collapse.m_pos);
+        }
+        else
+        {
+            // singular quadric: the best of the two ends and the middle
+            const cVector3d candidates[3] = { m_positions[a_v0], m_positions[a_v1], 0.5 * (m_positions[a_v0] + m_positions[a_v1]) };
+            collapse.m_cost = 1e30;
+            for (int i=0; i<3; i++)
+            {
+                double cost = quadric.evaluate(candidates[i]);
+                if (cost < collapse.m_cost) { collapse.m_cost = cost; collapse.m_pos = candidates[i]; }
+            }
+        }
+        a_collapses.push(collapse);
+    }
+
+    //! This method appends the vertices sharing a triangle with vertex __a_v__ to __a_neighbors__, once each.
+    void getNeighbors(unsigned int a_v, std::vector<unsigned int>& a_neighbors) const
+    {
+        const std::vector<unsigned int>& faces = m_vertexFaces[a_v];
+        for (size_t i=0; i<faces.size(); i++)
+        {
+            for (int k=0; k<3; k++)
+            {
+                unsigned int w = m_faces[faces[i]].m_v[k];
+                if ((w != a_v) && (std::find(a_neighbors.begin(), a_neighbors.end(), w) == a_neighbors.end()))
+                {
+                    a_neighbors.push_back(w);
+                }
+            }
+        }
+    }
+
+    //! This method returns __true__ if vertex __a_v1__ can collapse into vertex __a_v0__ at __a_pos__.
+    bool isCollapseValid(unsigned int a_v0, unsigned int a_v1, const cVector3d& a_pos) const
+    {
+        // the vertices adjacent to both must be those of the triangles of the edge
+        std::vector<unsigned int> neighbors0, neighbors1;
+        getNeighbors(a_v0, neighbors0);
+        getNeighbors(a_v1, neighbors1);
+        int numShared = 0;
+        for (size_t i=0; i<neighbors0.size(); i++)
+        {
+            if (std::find(neighbors1.begin(), neighbors1.end(), neighbors0[i]) != neighbors1.end()) { numShared++; }
+        }
+        int numEdgeFaces = 0;
+        const std::vector<unsigned int>& faces1 = m_vertexFaces[a_v1];
+        for (size_t i=0; i<faces1.size(); i++)
+        {
+            const cFace& face = m_faces[faces1[i]];
+            if ((face.m_v[0] == a_v0) || (face.m_v[1] == a_v0) || (face.m_v[2] == a_v0)) { numEdgeFaces++; }
+        }
+        if ((numEdgeFaces == 0) || (numShared != numEdgeFaces)) { return (false); }
+
+        // the other triangles of both vertices must not flip or degenerate
+        for (int e=0; e<2; e++)
+        {
+            unsigned int moved = (e == 0) ? a_v0 : a_v1;
+            unsigned int other = (e == 0) ? a_v1 : a_v0;
+            const std::vector<unsigned int>& faces = m_vertexFaces[moved];
+            for (size_t i=0; i<faces.size(); i++)
+            {
+                const cFace& face = m_faces[faces[i]];
+                if ((face.m_v[0] == other) || (face.m_v[1] == other) || (face.m_v[2] == other)) { continue; }
+
+                cVector3d before, after;
+                if (!getNormal(face, before)) { continue; }
+                cVector3d p[3];
+                for (int k=0; k<3; k++) { p[k] = (face.m_v[k] == moved) ? a_pos : m_positions[face.m_v[k]]; }
+                after = (p[1] - p[0]).cross(p[2] - p[0]);
+                double length = after.length();
+                if (length < C_SMALL * C_SMALL) { return (false); }
+                if (before.dot(after) < 0.2 * length) { return (false); }
+            }
+        }
+        return (true);
+    }
+
+    //! This method collapses vertex __a_v1__ into vertex __a_v0__, moved to __a_pos__.
+    void applyCollapse(unsigned int a_v0, unsigned int a_v1, const cVector3d& a_pos)
+    {
+        m_positions[a_v0] = a_pos;
+        m_quadrics[a_v0].add(m_quadrics[a_v1]);
+        m_alive[a_v1] = false;
+        m_parents[a_v1] = a_v0;
+        m_stamps[a_v0]++;
+        m_stamps[a_v1]++;
+
+        const std::vector<unsigned int> faces1 = m_vertexFaces[a_v1];
+        m_vertexFaces[a_v1].clear();
+        for (size_t i=0; i<faces1.size(); i++)
+        {
+            unsigned int f = faces1[i];
+            cFace& face = m_faces[f];
+            bool onEdge = (face.m_v[0] == a_v0) || (face.m_v[1] == a_v0) || (face.m_v[2] == a_v0);
+            if (onEdge)
+            {
+                // the triangles of the edge disappear
+                face.m_removed = true;
+                for (int k=0; k<3; k++)
+                {
+                    if (face.m_v[k] == a_v1) { continue; }
+                    std::vector<unsigned int>& list = m_vertexFaces[face.m_v[k]];
+                    list.erase(std::remove(list.begin(), list.end(), f), list.end());
+                }
+            }
+            else
+            {
+                for (int k=0; k<3; k++) { if (face.m_v[k] == a_v1) { face.m_v[k] = a_v0; } }
+                m_vertexFaces[a_v0].push_back(f);
+            }
+        }
+    }
+
+    //! This method builds the result from the remaining vertices and triangles, and maps the __a_numInput__ input vertices onto it.
+    void compact(size_t a_numInput)
+    {
+        std::vector<unsigned int> index(m_positions.size(), 0);
+        m_vertices.clear();
+        for (size_t i=0; i<m_positions.size(); i++)
+        {
+            if (!m_alive[i]) { continue; }
+            index[i] = (unsigned int)m_vertices.size();
+            m_vertices.push_back(m_positions[i]);
+        }
+        m_triangles.clear();
+        for (size_t t=0; t<m_faces.size(); t++)
+        {
+            if (m_faces[t].m_removed) { continue; }
+            for (int k=0; k<3; k++) { m_triangles.push_back(index[m_faces[t].m_v[k]]); }
+        }
+        m_vertexMap.resize(a_numInput);
+        for (size_t i=0; i<a_numInput; i++)
+        {
+            unsigned int v = m_welded[i];
+            while (!m_alive[v]) { v = m_parents[v]; }
+            m_vertexMap[i] = index[v];
+        }
+
+        // the work data is not needed anymore
+        std::vector<cFace>().swap(m_faces);
+        std::vector<std::vector<unsigned int> >().swap(m_vertexFaces);
+        std::vector<cQuadric>().swap(m_quadrics);
+    }
+
+    //! Vertices of the result.
+    std::vector<cVector3d> m_vertices;
+
+    //! Triangles of the result.
+    std::vector<unsigned int> m_triangles;
+
+    //! Vertex of the result of each input vertex.
+    std::vector<unsigned int> m_vertexMap;
+
+    //! Largest error of the collapses done.
+    double m_maxError;
+
+    //! Welded vertex of each input vertex.
+    std::vector<unsigned int> m_welded;
+
+    //! Position, quadric, state and triangles of each welded vertex.
+    std::vector<cVector3d> m_positions;
+    std::vector<cQuadric> m_quadrics;
+    std::vector<bool> m_alive;
+    std::vector<unsigned int> m_stamps;
+    std::vector<unsigned int> m_parents;
+    std::vector<std::vector<unsigned int> > m_vertexFaces;
+
+    //! Triangles of the mesh being simplified.
+    std::vector<cFace> m_faces;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,368 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CODEDistanceFieldGeomH
+#define CODEDistanceFieldGeomH
+//------------------------------------------------------------------------------
+#include "CODE.h"
+#include "CDistanceField.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CODEDistanceFieldGeom.h
+
+    \brief
+    ODE geometry of a static body represented by a signed distance field,
+    colliding with points sampled on the surface of other bodies.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cODEDistanceFieldGeom
+    \brief
+    ODE geometry of a static body represented by a signed distance field,
+    colliding with points sampled on the surface of other bodies.
+
+    \details
+    ODE collides two triangle meshes triangle against triangle, so the cost
+    of a contact grows with the triangles of both meshes near it. This
+    geometry replaces the triangle mesh of a static body by a
+    \ref cSparseDistanceField. The geometries that collide with it are
+    registered with \ref addSampledGeom() and represented by points sampled
+    on their surface; each point of such a geometry, moved into the frame of
+    the field, is a contact when its distance is negative. The cost is one
+    field lookup per point, whatever the number of triangles.
+
+    The geometry is an ODE user class: \ref create() adds it to a space,
+    where the collision callback of the world handles its contacts as those
+    of the mesh it replaces. When there are more contacts than ODE asks for,
+    the deepest are kept. Geometries that are not registered do not collide
+    with the field.
+
+    In steady contact the points of a geometry move little from one step to
+    the next, so most of them are tested for nothing. With a coherence
+    margin (\ref setCoherenceMargin()), a full test records the points
+    closer to the surface than the margin: the contacts and their
+    neighbours. The next collisions test only these points, as long as the
+    geometry has moved by less than the margin relative to the field since
+    the full test; then no other point can have reached the surface, and
+    the contacts are the same as those of a full test. A larger move falls
+    back to a full test, which records the points again. The distance
+    interpolated in the field changes at most sqrt(3) times as fast as the
+    point moves, which the move is scaled by.
+
+    The contacts written to ODE by the collisions are kept until
+    \ref clearLastContacts(), in the frame of the field, so that the example
+    can use them after the step (to wear the surface, for instance).
+*/
+//==============================================================================
+class cODEDistanceFieldGeom
+{
+public:
+
+    //! Constructor of cODEDistanceFieldGeom, colliding with field __a_field__.
+    cODEDistanceFieldGeom(const cSparseDistanceField* a_field) : m_field(a_field), m_geom(0), m_margin(0.0), m_numCollisions(0), m_numPointTests(0),
+                                                                 m_numCacheHits(0), m_fullTime(0.0), m_cachedTime(0.0) {}
+
+    //! Destructor of cODEDistanceFieldGeom.
+    ~cODEDistanceFieldGeom()
+    {
+        if (m_geom != 0) { dGeomDestroy(m_geom); }
+    }
+
+    //! This method creates the geometry in space __a_space__, with user data __a_data__ (the \ref cODEGenericBody it stands for).
+    dGeomID create(dSpaceID a_space, void* a_data)
+    {
+        m_geom = dCreateGeom(getClass());
+        *(cODEDistanceFieldGeom**)dGeomGetClassData(m_geom) = this;
+        dGeomSetData(m_geom, a_data);
+        if (a_space != 0) { dSpaceAdd(a_space, m_geom); }
+        return (m_geom);
+    }
+
+    //! This method returns the ODE geometry.
+    dGeomID getGeom() const { return (m_geom); }
+
+    //! This method places the field at position __a_pos__ and rotation __a_rot__, in the frame of the ODE world.
+    void setPose(const cVector3d& a_pos, const cMatrix3d& a_rot)
+    {
+        dMatrix3 rot;
+        for (int r=0; r<3; r++)
+        {
+            for (int c=0; c<3; c++) { rot[4*r + c] = a_rot(r,c); }
+            rot[4*r + 3] = 0.0;
+        }
+        dGeomSetPosition(m_geom, a_pos(0), a_pos(1), a_pos(2));
+        dGeomSetRotation(m_geom, rot);
+    }
+
+    //! This method makes geometry __a_geom__ collide with the field, at points __a_points__ in its frame.
+    void addSampledGeom(dGeomID a_geom, const std::vector<cVector3d>& a_points)
+    {
+        cSampledGeom sampled;
+        sampled.m_geom = a_geom;
+        sampled.m_points = a_points;
+        sampled.m_radius = 0.0;
+        for (size_t i=0; i<a_points.size(); i++) { sampled.m_radius = cMax(sampled.m_radius, a_points[i].length()); }
+        sampled.m_cached = false;
+        m_sampledGeoms.push_back(sampled);
+    }
+
+    //! This method makes the collisions test only the points found within __a_margin__ of the surface by the last full test, until the geometry moves by __a_margin__ (0 disables). The margin is limited to the band of the field.
+    void setCoherenceMargin(double a_margin)
+    {
+        m_margin = cClamp(a_margin, 0.0, m_field->getBandWidth());
+        for (size_t i=0; i<m_sampledGeoms.size(); i++) { m_sampledGeoms[i].m_cached = false; }
+    }
+
+    //! This method returns the coherence margin.
+    double getCoherenceMargin() const { return (m_margin); }
+
+    //! This method returns the number of collisions that tested only the points recorded by a full test.
+    unsigned long getNumCacheHits() const { return (m_numCacheHits); }
+
+    //! This method returns the time spent in full tests and in tests of the recorded points [s].
+    double getFullTestTime() const { return (m_fullTime); }
+    double getCachedTestTime() const { return (m_cachedTime); }
+
+    //! This method returns the number of collisions tested.
+    unsigned long getNumCollisions() const { return (m_numCollisions); }
+
+    //! This method returns the number of points tested against the field.
+    unsigned long getNumPointTests() const { return (m_numPointTests); }
+
+    //! A contact found in the frame of the field.
+    struct cContact
+    {
+        double m_depth;
+        cVector3d m_pos;
+        cVector3d m_normal;
+        bool operator<(const cContact& a_other) const { return (m_depth > a_other.m_depth); }
+    };
+
+    //! This method returns the number of contacts written to ODE since the last \ref clearLastContacts().
+    size_t getNumLastContacts() const { return (m_lastContacts.size()); }
+
+    //! This method returns contact __a_index__ written to ODE since the last \ref clearLastContacts(), in the frame of the field.
+    const cContact& getLastContact(size_t a_index) const { return (m_lastContacts[a_index]); }
+
+    //! This method forgets the contacts written to ODE.
+    void clearLastContacts() { m_lastContacts.clear(); }
+
+protected:
+
+    //! A geometry, the points sampled on its surface, and the points recorded by its last full test.
+    struct cSampledGeom
+    {
+        dGeomID m_geom;
+        std::vector<cVector3d> m_points;
+        double m_radius;
+        bool m_cached;
+        std::vector<unsigned int> m_nearPoints;
+        cVector3d m_cachePos;
+        cMatrix3d m_cacheRot;
+    };
+
+    //! This method returns the ODE class of the geometry, registered on first use.
+    static int getClass()
+    {
+        static int geomClass = -1;
+        if (geomClass < 0)
+        {
+            dGeomClass description;
+            description.bytes = sizeof(cODEDistanceFieldGeom*);
+            description.collider = &getCollider;
+            description.aabb = &getAABB;
+            description.aabb_test = 0;
+            description.dtor = 0;
+            geomClass = dCreateGeomClass(&description);
+        }
+        return (geomClass);
+    }
+
+    //! This method returns the collider of the field with geometries of class __a_class__.
+    static dColliderFn* getCollider(int a_class)
+    {
+        return (&collide);
+    }
+
+    //! This method computes the bounding box __a_aabb__ of field geometry __a_geom__ in the world.
+    static void getAABB(dGeomID a_geom, dReal a_aabb[6])
+    {
+        const cODEDistanceFieldGeom* self = *(cODEDistanceFieldGeom**)dGeomGetClassData(a_geom);
+        const dReal* pos = dGeomGetPosition(a_geom);
+        const dReal* rot = dGeomGetRotation(a_geom);
+        cVector3d center = 0.5 * (self->m_field->getBoundaryMin() + self->m_field->getBoundaryMax());
+        cVector3d half = 0.5 * (self->m_field->getBoundaryMax() - self->m_field->getBoundaryMin());
+        for (int r=0; r<3; r++)
+        {
+            double c = pos[r] + rot[4*r] * center(0) + rot[4*r+1] * center(1) + rot[4*r+2] * center(2);
+            double h = fabs(rot[4*r]) * half(0) + fabs(rot[4*r+1]) * half(1) + fabs(rot[4*r+2]) * half(2);
+            a_aabb[2*r] = c - h;
+            a_aabb[2*r+1] = c + h;
+        }
+    }
+
+    //! This method collides field geometry __a_field__ with geometry __a_other__, and writes up to (__a_flags__ & 0xffff) contacts every __a_skip__ bytes from __a_contacts__.
+    static int collide(dGeomID a_field, dGeomID a_other, int a_flags, dContactGeom* a_contacts, int a_skip)
+    {
+        cODEDistanceFieldGeom* self = *(cODEDistanceFieldGeom**)dGeomGetClassData(a_field);
+        cSampledGeom* sampled = NULL;
+        for (size_t i=0; i<self->m_sampledGeoms.size(); i++)
+        {
+            if (self->m_sampledGeoms[i].m_geom == a_other) { sampled = &self->m_sampledGeoms[i]; break; }
+        }
+        int maxContacts = a_flags & 0xffff;
+        if ((sampled == NULL) || (maxContacts < 1)) { return (0); }
+        self->m_numCollisions++;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        // transform from the frame of the other geometry to that of the field
+        cVector3d fieldPos, otherPos;
+        cMatrix3d fieldRot, otherRot;
+        getPose(a_field, fieldPos, fieldRot);
+        getPose(a_other, otherPos, otherRot);
+        cMatrix3d fieldRotT = cTranspose(fieldRot);
+        cMatrix3d rot = cMul(fieldRotT, otherRot);
+        cVector3d pos = fieldRotT * (otherPos - fieldPos);
+
+        // the points recorded by the last full test are enough if the
+        // geometry moved by less than the margin since: the largest move of
+        // its points is that of its origin plus that of the farthest point
+        // by the rotation, 2 sin(angle / 2) = sqrt(3 - trace) times its radius
+        bool cached = false;
+        if ((self->m_margin > 0.0) && sampled->m_cached)
+        {
+            cMatrix3d delta = cMul(cTranspose(sampled->m_cacheRot), rot);
+            double trace = delta(0,0) + delta(1,1) + delta(2,2);
+            double move = (pos - sampled->m_cachePos).length() + sqrt(cMax(0.0, 3.0 - trace)) * sampled->m_radius;
+            cached = (sqrt(3.0) * move < self->m_margin);
+        }
+        if (!cached && (self->m_margin > 0.0))
+        {
+            sampled->m_cached = true;
+            sampled->m_nearPoints.clear();
+            sampled->m_cachePos = pos;
+            sampled->m_cacheRot = rot;
+        }
+        size_t numTests = cached ? sampled->m_nearPoints.size() : sampled->m_points.size();
+        self->m_numPointTests += (unsigned long)numTests;
+
+        std::vector<cContact>& contacts = self->m_contacts;
+        contacts.clear();
+        for (size_t n=0; n<numTests; n++)
+        {
+            size_t i = cached ? (size_t)sampled->m_nearPoints[n] : n;
+            cContact contact;
+            contact.m_pos = pos + rot * sampled->m_points[i];
+            double distance;
+            cVector3d gradient;
+            if (!self->m_field->getDistance(contact.m_pos, distance, gradient)) { continue; }
+            if (!cached && (self->m_margin > 0.0) && (distance < self->m_margin))
+            {
+                sampled->m_nearPoints.push_back((unsigned int)i);
+            }
+            if (distance >= 0.0) { continue; }
+            if (gradient.lengthsq() < C_SMALL * C_SMALL) { continue; }
+            gradient.normalize();
+            contact.m_depth = -distance;
+            contact.m_normal = gradient;
+            contacts.push_back(contact);
+        }
+
+        int numContacts = std::min((int)contacts.size(), maxContacts);
+        std::partial_sort(contacts.begin(), contacts.begin() + numContacts, contacts.end());
+
+        // moving the field along the normal (into itself, away from the
+        // point) separates the bodies
+        for (int i=0; i<numContacts; i++)
+        {
+            dContactGeom* contact = (dContactGeom*)((char*)a_contacts + i * a_skip);
+            cVector3d position = fieldPos + fieldRot * contacts[i].m_pos;
+            cVector3d normal = fieldRot * (-contacts[i].m_normal);
+            for (int k=0; k<3; k++)
+            {
+                contact->pos[k] = position(k);
+                contact->normal[k] = normal(k);
+            }
+            contact->depth = contacts[i].m_depth;
+            contact->g1 = a_field;
+            contact->g2 = a_other;
+        }
+        self->m_lastContacts.insert(self->m_lastContacts.end(), contacts.begin(), contacts.begin() + numContacts);
+
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (cached)
+        {
+            self->m_numCacheHits++;
+            self->m_cachedTime += elapsed;
+        }
+        else
+        {
+            self->m_fullTime += elapsed;
+        }
+        return (numContacts);
+    }
+
+    //! This method reads the position __a_pos__ and the rotation __a_rot__ of geometry __a_geom__.
+    static void getPose(dGeomID a_geom, cVector3d& a_pos, cMatrix3d& a_rot)
+    {
+        const dReal* pos = dGeomGetPosition(a_geom);
+        const dReal* rot = dGeomGetRotation(a_geom);
+        a_pos.set(pos[0], pos[1], pos[2]);
+        for (int r=0; r<3; r++)
+        {
+            for (int c=0; c<3; c++) { a_rot(r,c) = rot[4*r + c]; }
+        }
+    }
+
+    //! Distance field of the body.
+    const cSparseDistanceField* m_field;
+
+    //! ODE geometry.
+    dGeomID m_geom;
+
+    //! Geometries colliding with the field.
+    std::vector<cSampledGeom> m_sampledGeoms;
+
+    //! Contacts found by the last collision.
+    std::vector<cContact> m_contacts;
+
+    //! Contacts written to ODE since the last \ref clearLastContacts().
+    std::vector<cContact> m_lastContacts;
+
+    //! Coherence margin (0 if disabled).
+    double m_margin;
+
+    //! Number of collisions and of points tested.
+    unsigned long m_numCollisions;
+    unsigned long m_numPointTests;
+
+    //! Number of collisions that tested only the recorded points, and time of the full and of the other tests [s].
+    unsigned long m_numCacheHits;
+    double m_fullTime;
+    double m_cachedTime;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,129 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CODEIslandThreadsH
+#define CODEIslandThreadsH
+//------------------------------------------------------------------------------
+#include "CODE.h"
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CODEIslandThreads.h
+
+    \brief
+    Persistent pool of threads that step the independent islands of an ODE
+    world in parallel.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cODEIslandThreads
+    \brief
+    Persistent pool of threads that step the independent islands of an ODE
+    world in parallel.
+
+    \details
+    At each step, ODE splits the bodies of a world into islands: groups of
+    bodies linked by joints or contacts, which static geometries do not
+    link. Each island is solved on its own. By default the islands are
+    solved one after the other by the thread that steps the world, so the
+    cost of a step grows with every fixture, part or piece of debris added
+    to the scene.
+
+    \ref start() gives the world a threading implementation of ODE, served
+    by a pool of threads created once. Each step then hands the islands to
+    the threads of the pool, up to the number of threads. An island is
+    always solved whole by one thread, from its own bodies and joints, so
+    the result of a step does not depend on the number of threads nor on
+    their timing. The collision detection, done by the world before the
+    step, is not affected.
+
+    ODE must be built with its threading interface and built-in threading
+    implementation (--enable-builtin-threading-impl); otherwise \ref start()
+    fails and the world keeps stepping on one thread.
+*/
+//==============================================================================
+class cODEIslandThreads
+{
+public:
+
+    //! Constructor of cODEIslandThreads.
+    cODEIslandThreads() : m_world(0), m_threading(0), m_pool(0), m_numThreads(1) {}
+
+    //! Destructor of cODEIslandThreads.
+    ~cODEIslandThreads() { stop(); }
+
+    //! This method makes __a_numThreads__ threads step the islands of world __a_world__. It returns __false__ if ODE has no threading implementation, in which case the world is stepped on one thread.
+    bool start(dWorldID a_world, int a_numThreads)
+    {
+        stop();
+        if (a_numThreads < 2) { return (true); }
+
+        m_threading = dThreadingAllocateMultiThreadedImplementation();
+        if (m_threading == 0) { return (false); }
+        m_pool = dThreadingAllocateThreadPool((unsigned)a_numThreads, 0, dAllocateFlagBasicData, NULL);
+        if (m_pool == 0)
+        {
+            dThreadingFreeImplementation(m_threading);
+            m_threading = 0;
+            return (false);
+        }
+        dThreadingThreadPoolServeMultiThreadedImplementation(m_pool, m_threading);
+
+        m_world = a_world;
+        dWorldSetStepThreadingImplementation(m_world, dThreadingImplementationGetFunctions(m_threading), m_threading);
+        dWorldSetStepIslandsProcessingMaxThreadCount(m_world, (unsigned)a_numThreads);
+        m_numThreads = a_numThreads;
+        return (true);
+    }
+
+    //! This method stops the threads; the world is stepped on one thread again.
+    void stop()
+    {
+        if (m_threading == 0) { return; }
+        dThreadingImplementationShutdownProcessing(m_threading);
+        dThreadingFreeThreadPool(m_pool);
+        dWorldSetStepThreadingImplementation(m_world, NULL, NULL);
+        dThreadingFreeImplementation(m_threading);
+        m_world = 0;
+        m_threading = 0;
+        m_pool = 0;
+        m_numThreads = 1;
+    }
+
+    //! This method returns the number of threads stepping the islands.
+    int getNumThreads() const { return (m_numThreads); }
+
+protected:
+
+    //! World whose islands are stepped.
+    dWorldID m_world;
+
+    //! Threading implementation of ODE given to the world.
+    dThreadingImplementationID m_threading;
+
+    //! Threads serving the threading implementation.
+    dThreadingThreadPoolID m_pool;
+
+    //! Number of threads.
+    int m_numThreads;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,164 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef COffscreenRendererH
+#define COffscreenRendererH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <cstdio>
+#include <string>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       COffscreenRenderer.h
+
+    \brief
+    Renders the view of a camera into a frame buffer object, along an
+    orbit, to benchmark the rendering without a visible window.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cOffscreenRenderer
+    \brief
+    Renders the view of a camera into a frame buffer object, along an
+    orbit, to benchmark the rendering without a visible window.
+
+    \details
+    The default frame buffer of a hidden window may not be drawn at all,
+    so the camera renders into a \ref cFrameBuffer of a fixed size instead,
+    which the examples create from the OpenGL context of a hidden GLFW
+    window.
+
+    \ref moveCamera() places the camera on an orbit around a point, one
+    turn over \ref m_numFrames frames, so that every run renders the same
+    views. The camera must be a child of the world: its global frame is
+    updated by \ref moveCamera(). \ref saveReferenceImage() reads back the
+    last frame and saves it, for the comparison of the images of two
+    builds; it is called after the timed frames, since the read back
+    waits for the GPU.
+*/
+//==============================================================================
+class cOffscreenRenderer
+{
+public:
+
+    //! Size of the frame buffer.
+    static const int C_WIDTH = 1024;
+    static const int C_HEIGHT = 640;
+
+    //! Number of reference images, evenly spaced along the orbit.
+    static const int C_NUM_REFERENCE_IMAGES = 4;
+
+    //! Constructor of cOffscreenRenderer.
+    cOffscreenRenderer() : m_camera(NULL), m_radius(1.0), m_polarDeg(90.0), m_azimuthDeg(0.0), m_numFrames(360) {}
+
+    //! This method creates the frame buffer of camera __a_camera__. It must be called with the OpenGL context current.
+    void initialize(cCamera* a_camera)
+    {
+        m_camera = a_camera;
+        m_frameBuffer = cFrameBuffer::create();
+        m_frameBuffer->setup(a_camera, C_WIDTH, C_HEIGHT, true, true);
+        m_image = cImage::create();
+    }
+
+    //! This method returns __true__ if the frame buffer has been created.
+    bool isInitialized() const { return (m_camera != NULL); }
+
+    //! This method sets an orbit of radius __a_radius__ around __a_origin__, starting at __a_polarDeg__ and __a_azimuthDeg__, one turn in __a_numFrames__ frames.
+    void setOrbit(const cVector3d& a_origin, double a_radius, double a_polarDeg, double a_azimuthDeg, unsigned long a_numFrames)
+    {
+        m_camera->setSphericalReferences(a_origin, cVector3d(0,0,1), cVector3d(1,0,0));
+        m_radius = a_radius;
+        m_polarDeg = a_polarDeg;
+        m_azimuthDeg = a_azimuthDeg;
+        m_numFrames = (a_numFrames > 0) ? a_numFrames : 1;
+    }
+
+    //! This method places the camera at frame __a_frame__ of the orbit.
+    void moveCamera(unsigned long a_frame)
+    {
+        double azimuthDeg = m_azimuthDeg + 360.0 * (double)(a_frame % m_numFrames) / (double)m_numFrames;
+        m_camera->setSphericalDeg(m_radius, m_polarDeg, azimuthDeg);
+        m_camera->computeGlobalPositions(true);
+    }
+
+    //! This method returns the frame of the orbit at which reference image __a_index__ is taken.
+    unsigned long getReferenceFrame(int a_index) const
+    {
+        return ((unsigned long)a_index * m_numFrames / C_NUM_REFERENCE_IMAGES);
+    }
+
+    //! This method renders the view of the camera into the frame buffer.
+    void renderView()
+    {
+        m_frameBuffer->renderView();
+    }
+
+    //! This method saves the last frame as reference image __a_index__, to <__a_prefix__>_<__a_index__>.png.
+    bool saveReferenceImage(const std::string& a_prefix, int a_index)
+    {
+        char fileName[16];
+        snprintf(fileName, sizeof(fileName), "_%d.png", a_index);
+        m_frameBuffer->copyImageBuffer(m_image);
+        return (m_image->saveToFile(a_prefix + fileName));
+    }
+
+protected:
+
+    //! Camera moved along the orbit.
+    cCamera* m_camera;
+
+    //! Frame buffer rendered by the camera.
+    cFrameBufferPtr m_frameBuffer;
+
+    //! Image read back from the frame buffer.
+    cImagePtr m_image;
+
+    //! Orbit of the camera: radius [m], polar and initial azimuth angles [deg].
+    double m_radius;
+    double m_polarDeg;
+    double m_azimuthDeg;
+
+    //! Number of frames of one turn.
+    unsigned long m_numFrames;
+};
+
+
+//==============================================================================
+/*!
+    This function sets the shadow map quality of light __a_light__ from its
+    name: verylow, low, medium, high or veryhigh. It returns __false__ if
+    the name is unknown.
+*/
+//==============================================================================
+inline bool cSetShadowMapQuality(cSpotLight* a_light, const std::string& a_quality)
+{
+    if (a_quality == "verylow")       { a_light->m_shadowMap->setQualityVeryLow(); }
+    else if (a_quality == "low")      { a_light->m_shadowMap->setQualityLow(); }
+    else if (a_quality == "medium")   { a_light->m_shadowMap->setQualityMedium(); }
+    else if (a_quality == "high")     { a_light->m_shadowMap->setQualityHigh(); }
+    else if (a_quality == "veryhigh") { a_light->m_shadowMap->setQualityVeryHigh(); }
+    else { return (false); }
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,138 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CPerfCountersH
+#define CPerfCountersH
+//------------------------------------------------------------------------------
+#include <stdint.h>
+#include <string.h>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CPerfCounters.h
+
+    \brief
+    Hardware performance counters of the calling thread, for benchmarks.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cPerfCounters
+    \brief
+    Counts retired instructions, branch misses and cycles of the calling thread.
+
+    \details
+    The counters are read with perf_event_open on Linux. They are unavailable
+    on other systems, or when the kernel forbids unprivileged access
+    (/proc/sys/kernel/perf_event_paranoid), in which case \ref isAvailable()
+    returns __false__ and every count reads zero.
+*/
+//==============================================================================
+class cPerfCounters
+{
+public:
+
+    //! Counted events.
+    enum Event { INSTRUCTIONS = 0, BRANCH_MISSES = 1, CYCLES = 2, NUM_EVENTS = 3 };
+
+    //! Constructor of cPerfCounters. Opens the counters for the calling thread.
+    cPerfCounters()
+    {
+        for (int i=0; i<NUM_EVENTS; i++) { m_fd[i] = -1; m_count[i] = 0; }
+
+#if defined(__linux__)
+        static const uint64_t configs[NUM_EVENTS] = { PERF_COUNT_HW_INSTRUCTIONS,
+                                                      PERF_COUNT_HW_BRANCH_MISSES,
+                                                      PERF_COUNT_HW_CPU_CYCLES };
+        for (int i=0; i<NUM_EVENTS; i++)
+        {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = configs[i];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            m_fd[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+#endif
+    }
+
+    //! Destructor of cPerfCounters.
+    ~cPerfCounters()
+    {
+#if defined(__linux__)
+        for (int i=0; i<NUM_EVENTS; i++)
+        {
+            if (m_fd[i] >= 0) { ::close(m_fd[i]); }
+        }
+#endif
+    }
+
+    //! This method returns __true__ if event __a_event__ can be counted.
+    bool isAvailable(Event a_event = INSTRUCTIONS) const { return (m_fd[a_event] >= 0); }
+
+    //! This method resets and starts the counters.
+    void start()
+    {
+#if defined(__linux__)
+        for (int i=0; i<NUM_EVENTS; i++)
+        {
+            if (m_fd[i] < 0) { continue; }
+            ioctl(m_fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(m_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    //! This method stops the counters and latches their values.
+    void stop()
+    {
+#if defined(__linux__)
+        for (int i=0; i<NUM_EVENTS; i++)
+        {
+            m_count[i] = 0;
+            if (m_fd[i] < 0) { continue; }
+            ioctl(m_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(m_fd[i], &m_count[i], sizeof(m_count[i])) != sizeof(m_count[i])) { m_count[i] = 0; }
+        }
+#endif
+    }
+
+    //! This method returns the count of event __a_event__ between the last start() and stop().
+    uint64_t getCount(Event a_event) const { return (m_count[a_event]); }
+
+private:
+
+    //! File descriptors of the counters, -1 if unavailable.
+    int m_fd[NUM_EVENTS];
+
+    //! Counts latched by the last stop().
+    uint64_t m_count[NUM_EVENTS];
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
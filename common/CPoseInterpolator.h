@@ -0,0 +1,161 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CPoseInterpolatorH
+#define CPoseInterpolatorH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CPoseInterpolator.h
+
+    \brief
+    Poses exchanged between loops running at different rates.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \struct     cTimedPose
+    \brief
+    A position and an orientation at a time, as plain numbers so that it
+    can be passed through a \ref cSeqLock.
+*/
+//==============================================================================
+struct cTimedPose
+{
+    //! Time of the pose [s].
+    double m_time;
+
+    //! Position.
+    double m_pos[3];
+
+    //! Rotation matrix, row by row.
+    double m_rot[9];
+
+    //! This method sets the pose to position __a_pos__ and rotation __a_rot__ at time __a_time__.
+    void set(double a_time, const cVector3d& a_pos, const cMatrix3d& a_rot)
+    {
+        m_time = a_time;
+        for (int r=0; r<3; r++)
+        {
+            m_pos[r] = a_pos(r);
+            for (int c=0; c<3; c++) { m_rot[3*r + c] = a_rot(r,c); }
+        }
+    }
+
+    //! This method returns the position.
+    cVector3d getPos() const { return (cVector3d(m_pos[0], m_pos[1], m_pos[2])); }
+
+    //! This method returns the rotation matrix.
+    cMatrix3d getRot() const
+    {
+        cMatrix3d rot;
+        for (int r=0; r<3; r++)
+        {
+            for (int c=0; c<3; c++) { rot(r,c) = m_rot[3*r + c]; }
+        }
+        return (rot);
+    }
+};
+
+
+//==============================================================================
+/*!
+    \class      cPoseInterpolator
+    \brief
+    Interpolates the poses of a slower loop for a faster one.
+
+    \details
+    The faster loop passes each new pose of the slower loop to
+    \ref update(), and reads the pose at a time with \ref interpolate().
+    Asking for the pose one period of the slower loop in the past keeps the
+    time between the last two poses, so that the pose moves smoothly
+    instead of jumping at each step of the slower loop. The position is
+    interpolated linearly and the rotation about the axis of the relative
+    rotation.
+*/
+//==============================================================================
+class cPoseInterpolator
+{
+public:
+
+    //! Constructor of cPoseInterpolator.
+    cPoseInterpolator() : m_numPoses(0) {}
+
+    //! This method returns the current time [s] on the clock of the poses.
+    static double now()
+    {
+        return (std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    //! This method adds pose __a_pose__ if it is newer than the last one.
+    void update(const cTimedPose& a_pose)
+    {
+        if ((m_numPoses > 0) && (a_pose.m_time <= m_last.m_time)) { return; }
+        m_previous = m_last;
+        m_last = a_pose;
+        m_numPoses++;
+    }
+
+    //! This method computes the pose at time __a_time__, between the last two poses. It returns __false__ if there is no pose yet.
+    bool interpolate(double a_time, cVector3d& a_pos, cMatrix3d& a_rot) const
+    {
+        if (m_numPoses == 0) { return (false); }
+
+        cVector3d pos = m_last.getPos();
+        cMatrix3d rot = m_last.getRot();
+        if (m_numPoses == 1)
+        {
+            a_pos = pos;
+            a_rot = rot;
+            return (true);
+        }
+
+        double w = (a_time - m_previous.m_time) / (m_last.m_time - m_previous.m_time);
+        w = std::max(0.0, std::min(w, 1.0));
+
+        cVector3d previousPos = m_previous.getPos();
+        cMatrix3d previousRot = m_previous.getRot();
+        a_pos = previousPos + w * (pos - previousPos);
+
+        cVector3d axis(1.0, 0.0, 0.0);
+        double angle = 0.0;
+        cMatrix3d deltaRot = cMul(cTranspose(previousRot), rot);
+        deltaRot.toAxisAngle(axis, angle);
+        deltaRot.setAxisAngleRotationRad(axis, w * angle);
+        a_rot = cMul(previousRot, deltaRot);
+        return (true);
+    }
+
+protected:
+
+    //! Last two poses.
+    cTimedPose m_previous;
+    cTimedPose m_last;
+
+    //! Number of poses added.
+    unsigned long m_numPoses;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,256 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CPosePredictorH
+#define CPosePredictorH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CSeqLock.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CPosePredictor.h
+
+    \brief
+    Position published by the haptic thread and extrapolated by the graphics
+    thread to the time the frame is displayed.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cPosePredictor
+    \brief
+    Position published by the haptic thread and extrapolated by the graphics
+    thread to the time the frame is displayed.
+
+    \details
+    The graphics thread draws the last position written by the haptic
+    thread, which is a frame latency old when the frame is displayed. The
+    haptic thread instead publishes the position, the velocity and the time
+    of each tick with \ref publish(), and the graphics thread extrapolates
+    them to the expected display time with \ref predict(). The extrapolation
+    is limited to \ref m_maxHorizon.
+
+    The sample is exchanged through a \ref cSeqLock: the haptic thread never
+    waits, and the graphics thread reads again in the rare case the sample
+    changed while it was read.
+
+    When the error is measured (\ref reserve()), each prediction is kept
+    until the haptic thread has published the samples around its display
+    time, then compared with the position interpolated between them, as is
+    the position held without prediction. The positions are interpolated
+    between the samples read at each frame, so the error includes the
+    interpolation error over a frame.
+*/
+//==============================================================================
+class cPosePredictor
+{
+public:
+
+    //! Constructor of cPosePredictor. __a_maxHorizon__ is the longest extrapolation [s], about six frames at 60 Hz by default.
+    cPosePredictor(double a_maxHorizon = 0.1) : m_maxHorizon(a_maxHorizon), m_numHistory(0),
+                                                m_firstPending(0), m_numPending(0), m_numErrors(0) {}
+
+    //! This method returns the current time [s] on the clock of the samples and of the frame pacer.
+    static double now()
+    {
+        return (std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    //! This method publishes position __a_pos__ and velocity __a_vel__ at the current time. Haptic thread only.
+    void publish(const cVector3d& a_pos, const cVector3d& a_vel)
+    {
+        cSample sample;
+        sample.m_time = now();
+        for (int i=0; i<3; i++)
+        {
+            sample.m_pos[i] = a_pos(i);
+            sample.m_vel[i] = a_vel(i);
+        }
+        m_sample.write(sample);
+    }
+
+    //! This method extrapolates the last sample to display time __a_displayTime__. It returns __false__ if nothing has been published yet.
+    bool predict(double a_displayTime, cVector3d& a_pos)
+    {
+        cSample sample;
+        if (!m_sample.read(sample)) { return (false); }
+        double time = sample.m_time;
+        cVector3d pos(sample.m_pos[0], sample.m_pos[1], sample.m_pos[2]);
+        cVector3d vel(sample.m_vel[0], sample.m_vel[1], sample.m_vel[2]);
+
+        double horizon = std::max(0.0, std::min(a_displayTime - time, m_maxHorizon));
+        a_pos = pos + horizon * vel;
+
+        if (!m_errors.empty())
+        {
+            addSample(time, pos);
+            addPending(a_displayTime, a_pos, pos);
+            resolvePending();
+        }
+        return (true);
+    }
+
+    //! This method allocates storage for the error of __a_numFrames__ predictions and enables the measurement.
+    void reserve(size_t a_numFrames)
+    {
+        m_errors.assign(a_numFrames, 0.0);
+        m_heldErrors.assign(a_numFrames, 0.0);
+        m_numErrors = 0;
+    }
+
+    //! This method prints the distributions of the error with and without prediction.
+    void printReport(const std::string& a_title) const
+    {
+        size_t count = std::min(m_numErrors, m_errors.size());
+        double errors[3], heldErrors[3];
+        getPercentiles(m_errors, count, errors);
+        getPercentiles(m_heldErrors, count, heldErrors);
+
+        printf("%s: %lu predictions\n", a_title.c_str(), (unsigned long)m_numErrors);
+        printf("predicted position error [mm]: p50 %.2f  p99 %.2f  max %.2f\n", 1e3 * errors[0], 1e3 * errors[1], 1e3 * errors[2]);
+        printf("held position error [mm]: p50 %.2f  p99 %.2f  max %.2f\n", 1e3 * heldErrors[0], 1e3 * heldErrors[1], 1e3 * heldErrors[2]);
+    }
+
+protected:
+
+    //! Number of samples kept to interpolate the displayed positions.
+    static const int C_NUM_HISTORY = 8;
+
+    //! Number of predictions waiting for the samples around their display time.
+    static const int C_NUM_PENDING = 8;
+
+    //! Time, position and velocity published by the haptic thread.
+    struct cSample
+    {
+        double m_time;
+        double m_pos[3];
+        double m_vel[3];
+    };
+
+    //! A position at a time.
+    struct cTimedPos
+    {
+        double m_time;
+        cVector3d m_pos;
+        cVector3d m_heldPos;
+    };
+
+    //! This method keeps sample __a_pos__ at __a_time__ for the interpolation.
+    void addSample(double a_time, const cVector3d& a_pos)
+    {
+        if ((m_numHistory > 0) && (m_history[(m_numHistory - 1) % C_NUM_HISTORY].m_time >= a_time)) { return; }
+        cTimedPos& sample = m_history[m_numHistory % C_NUM_HISTORY];
+        sample.m_time = a_time;
+        sample.m_pos = a_pos;
+        m_numHistory++;
+    }
+
+    //! This method keeps prediction __a_pos__ and held position __a_heldPos__ for display time __a_displayTime__.
+    void addPending(double a_displayTime, const cVector3d& a_pos, const cVector3d& a_heldPos)
+    {
+        // the oldest prediction is dropped when too many wait
+        if (m_numPending == C_NUM_PENDING)
+        {
+            m_firstPending = (m_firstPending + 1) % C_NUM_PENDING;
+            m_numPending--;
+        }
+        cTimedPos& pending = m_pending[(m_firstPending + m_numPending) % C_NUM_PENDING];
+        pending.m_time = a_displayTime;
+        pending.m_pos = a_pos;
+        pending.m_heldPos = a_heldPos;
+        m_numPending++;
+    }
+
+    //! This method measures the error of the predictions whose display time is past the last sample.
+    void resolvePending()
+    {
+        unsigned long first = (m_numHistory > C_NUM_HISTORY) ? m_numHistory - C_NUM_HISTORY : 0;
+        while (m_numPending > 0)
+        {
+            const cTimedPos& pending = m_pending[m_firstPending];
+            if (pending.m_time > m_history[(m_numHistory - 1) % C_NUM_HISTORY].m_time) { break; }
+
+            // interpolate the position at the display time between the samples around it
+            for (unsigned long i = first + 1; i < m_numHistory; i++)
+            {
+                const cTimedPos& a = m_history[(i - 1) % C_NUM_HISTORY];
+                const cTimedPos& b = m_history[i % C_NUM_HISTORY];
+                if ((a.m_time <= pending.m_time) && (pending.m_time <= b.m_time))
+                {
+                    double w = (pending.m_time - a.m_time) / (b.m_time - a.m_time);
+                    cVector3d pos = a.m_pos + w * (b.m_pos - a.m_pos);
+                    if (m_numErrors < m_errors.size())
+                    {
+                        m_errors[m_numErrors] = (pending.m_pos - pos).length();
+                        m_heldErrors[m_numErrors] = (pending.m_heldPos - pos).length();
+                    }
+                    m_numErrors++;
+                    break;
+                }
+            }
+
+            m_firstPending = (m_firstPending + 1) % C_NUM_PENDING;
+            m_numPending--;
+        }
+    }
+
+    //! This method computes the median, 99th percentile and maximum of the first __a_count__ values.
+    static void getPercentiles(const std::vector<double>& a_values, size_t a_count, double* a_result)
+    {
+        static const double percentiles[] = { 50.0, 99.0, 100.0 };
+        std::vector<double> sorted(a_values.begin(), a_values.begin() + a_count);
+        std::sort(sorted.begin(), sorted.end());
+        for (int i=0; i<3; i++)
+        {
+            a_result[i] = sorted.empty() ? 0.0 : sorted[(size_t)(percentiles[i] / 100.0 * (double)(sorted.size() - 1) + 0.5)];
+        }
+    }
+
+    //! Longest extrapolation [s].
+    double m_maxHorizon;
+
+    //! Last sample published.
+    cSeqLock<cSample> m_sample;
+
+    //! Samples read by the graphics thread, and their number.
+    cTimedPos m_history[C_NUM_HISTORY];
+    unsigned long m_numHistory;
+
+    //! Predictions waiting for the samples around their display time.
+    cTimedPos m_pending[C_NUM_PENDING];
+    int m_firstPending;
+    int m_numPending;
+
+    //! Error of the predictions and of the held positions [m].
+    std::vector<double> m_errors;
+    std::vector<double> m_heldErrors;
+
+    //! Number of predictions measured.
+    size_t m_numErrors;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
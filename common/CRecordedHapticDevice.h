@@ -0,0 +1,580 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CRecordedHapticDeviceH
+#define CRecordedHapticDeviceH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CDeviceRecord.h"
+#include <chrono>
+#include <iostream>
+#include <thread>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CRecordedHapticDevice.h
+
+    \brief
+    Haptic devices that record a session to, or replay it from, a
+    \ref cDeviceRecordSample stream.
+
+    \details
+    Both devices treat a haptic tick as everything that happens between two
+    force commands. The device state is sampled once, at the first read of a
+    tick, and every read of the same tick returns that sample. The tick ends
+    when \ref setForceAndTorqueAndGripperForce() is called, at which point
+    the sample and the command are written to the record.
+
+    A replay device wrapped by a recording device therefore produces a record
+    with the same inputs as the original session and the forces computed by
+    the current code, which can be compared with \ref cCompareDeviceRecords().
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+
+//! Nominal rate of the haptic loops of the examples [Hz].
+const double C_DEVICE_RECORD_TICK_RATE = 4000.0;
+
+//------------------------------------------------------------------------------
+
+//! This function converts CHAI3D device specifications to their recorded form.
+inline cDeviceRecordSpecs cDeviceRecordSpecsFromInfo(const cHapticDeviceInfo& a_info)
+{
+    cDeviceRecordSpecs specs;
+    memset(&specs, 0, sizeof(specs));
+    strncpy(specs.m_modelName, a_info.m_modelName.c_str(), sizeof(specs.m_modelName) - 1);
+    specs.m_maxLinearForce = a_info.m_maxLinearForce;
+    specs.m_maxAngularTorque = a_info.m_maxAngularTorque;
+    specs.m_maxGripperForce = a_info.m_maxGripperForce;
+    specs.m_maxLinearStiffness = a_info.m_maxLinearStiffness;
+    specs.m_maxAngularStiffness = a_info.m_maxAngularStiffness;
+    specs.m_maxGripperLinearStiffness = a_info.m_maxGripperLinearStiffness;
+    specs.m_maxLinearDamping = a_info.m_maxLinearDamping;
+    specs.m_maxAngularDamping = a_info.m_maxAngularDamping;
+    specs.m_maxGripperAngularDamping = a_info.m_maxGripperAngularDamping;
+    specs.m_workspaceRadius = a_info.m_workspaceRadius;
+    specs.m_gripperMaxAngleRad = a_info.m_gripperMaxAngleRad;
+    if (a_info.m_sensedPosition)    { specs.m_capabilities |= C_DEVICE_RECORD_SENSED_POSITION; }
+    if (a_info.m_sensedRotation)    { specs.m_capabilities |= C_DEVICE_RECORD_SENSED_ROTATION; }
+    if (a_info.m_sensedGripper)     { specs.m_capabilities |= C_DEVICE_RECORD_SENSED_GRIPPER; }
+    if (a_info.m_actuatedPosition)  { specs.m_capabilities |= C_DEVICE_RECORD_ACTUATED_POSITION; }
+    if (a_info.m_actuatedRotation)  { specs.m_capabilities |= C_DEVICE_RECORD_ACTUATED_ROTATION; }
+    if (a_info.m_actuatedGripper)   { specs.m_capabilities |= C_DEVICE_RECORD_ACTUATED_GRIPPER; }
+    if (a_info.m_leftHand)          { specs.m_capabilities |= C_DEVICE_RECORD_LEFT_HAND; }
+    if (a_info.m_rightHand)         { specs.m_capabilities |= C_DEVICE_RECORD_RIGHT_HAND; }
+    return (specs);
+}
+
+//------------------------------------------------------------------------------
+
+//! This function converts recorded device specifications back to CHAI3D specifications.
+inline cHapticDeviceInfo cDeviceRecordSpecsToInfo(const cDeviceRecordSpecs& a_specs)
+{
+    cHapticDeviceInfo info;
+    info.m_modelName = std::string(a_specs.m_modelName) + " (replay)";
+    info.m_manufacturerName = "CHAI3D";
+    info.m_maxLinearForce = a_specs.m_maxLinearForce;
+    info.m_maxAngularTorque = a_specs.m_maxAngularTorque;
+    info.m_maxGripperForce = a_specs.m_maxGripperForce;
+    info.m_maxLinearStiffness = a_specs.m_maxLinearStiffness;
+    info.m_maxAngularStiffness = a_specs.m_maxAngularStiffness;
+    info.m_maxGripperLinearStiffness = a_specs.m_maxGripperLinearStiffness;
+    info.m_maxLinearDamping = a_specs.m_maxLinearDamping;
+    info.m_maxAngularDamping = a_specs.m_maxAngularDamping;
+    info.m_maxGripperAngularDamping = a_specs.m_maxGripperAngularDamping;
+    info.m_workspaceRadius = a_specs.m_workspaceRadius;
+    info.m_gripperMaxAngleRad = a_specs.m_gripperMaxAngleRad;
+    info.m_sensedPosition = (a_specs.m_capabilities & C_DEVICE_RECORD_SENSED_POSITION) != 0;
+    info.m_sensedRotation = (a_specs.m_capabilities & C_DEVICE_RECORD_SENSED_ROTATION) != 0;
+    info.m_sensedGripper = (a_specs.m_capabilities & C_DEVICE_RECORD_SENSED_GRIPPER) != 0;
+    info.m_actuatedPosition = (a_specs.m_capabilities & C_DEVICE_RECORD_ACTUATED_POSITION) != 0;
+    info.m_actuatedRotation = (a_specs.m_capabilities & C_DEVICE_RECORD_ACTUATED_ROTATION) != 0;
+    info.m_actuatedGripper = (a_specs.m_capabilities & C_DEVICE_RECORD_ACTUATED_GRIPPER) != 0;
+    info.m_leftHand = (a_specs.m_capabilities & C_DEVICE_RECORD_LEFT_HAND) != 0;
+    info.m_rightHand = (a_specs.m_capabilities & C_DEVICE_RECORD_RIGHT_HAND) != 0;
+    return (info);
+}
+
+
+//==============================================================================
+/*!
+    \class      cSampledHapticDevice
+    \brief
+    Base class of devices that return one latched sample per haptic tick.
+
+    \details
+    Subclasses implement \ref acquireSample() to fill the sample of a new
+    tick and \ref commitSample() to handle the sample once the commands of
+    the tick are known.
+*/
+//==============================================================================
+class cSampledHapticDevice : public cGenericHapticDevice
+{
+public:
+
+    //! Constructor of cSampledHapticDevice.
+    cSampledHapticDevice() : m_latched(false) { memset(&m_sample, 0, sizeof(m_sample)); m_sample.m_rotation[0] = m_sample.m_rotation[4] = m_sample.m_rotation[8] = 1.0; }
+
+    //! Destructor of cSampledHapticDevice.
+    virtual ~cSampledHapticDevice() {}
+
+    //! This method returns the position of the device for the current tick.
+    virtual bool getPosition(cVector3d& a_position)
+    {
+        latch();
+        a_position.set(m_sample.m_position[0], m_sample.m_position[1], m_sample.m_position[2]);
+        return (C_SUCCESS);
+    }
+
+    //! This method returns the linear velocity of the device for the current tick.
+    virtual bool getLinearVelocity(cVector3d& a_linearVelocity)
+    {
+        latch();
+        a_linearVelocity.set(m_sample.m_linearVelocity[0], m_sample.m_linearVelocity[1], m_sample.m_linearVelocity[2]);
+        return (C_SUCCESS);
+    }
+
+    //! This method returns the orientation of the device for the current tick.
+    virtual bool getRotation(cMatrix3d& a_rotation)
+    {
+        latch();
+        for (int i=0; i<3; i++)
+        {
+            for (int j=0; j<3; j++)
+            {
+                a_rotation(i,j) = m_sample.m_rotation[3*i+j];
+            }
+        }
+        return (C_SUCCESS);
+    }
+
+    //! This method returns the angular velocity of the device for the current tick.
+    virtual bool getAngularVelocity(cVector3d& a_angularVelocity)
+    {
+        latch();
+        a_angularVelocity.set(m_sample.m_angularVelocity[0], m_sample.m_angularVelocity[1], m_sample.m_angularVelocity[2]);
+        return (C_SUCCESS);
+    }
+
+    //! This method returns the gripper angle of the device for the current tick.
+    virtual bool getGripperAngleRad(double& a_angle)
+    {
+        latch();
+        a_angle = m_sample.m_gripperAngle;
+        return (C_SUCCESS);
+    }
+
+    //! This method returns the gripper angular velocity of the device for the current tick.
+    virtual bool getGripperAngularVelocity(double& a_gripperAngularVelocity)
+    {
+        latch();
+        a_gripperAngularVelocity = m_sample.m_gripperAngularVelocity;
+        return (C_SUCCESS);
+    }
+
+    //! This method returns the user switches of the device for the current tick.
+    virtual bool getUserSwitches(unsigned int& a_userSwitches)
+    {
+        latch();
+        a_userSwitches = m_sample.m_userSwitches;
+        return (C_SUCCESS);
+    }
+
+    //! This method stores the commands of the current tick and ends the tick.
+    virtual bool setForceAndTorqueAndGripperForce(const cVector3d& a_force, const cVector3d& a_torque, double a_gripperForce)
+    {
+        latch();
+        for (int i=0; i<3; i++)
+        {
+            m_sample.m_force[i] = a_force(i);
+            m_sample.m_torque[i] = a_torque(i);
+        }
+        m_sample.m_gripperForce = a_gripperForce;
+
+        bool result = commitSample(a_force, a_torque, a_gripperForce);
+        m_latched = false;
+        return (result);
+    }
+
+protected:
+
+    //! This method fills \ref m_sample with the device state of a new tick.
+    virtual void acquireSample() = 0;
+
+    //! This method is called at the end of a tick, once \ref m_sample holds the commands.
+    virtual bool commitSample(const cVector3d& a_force, const cVector3d& a_torque, double a_gripperForce) = 0;
+
+    //! This method acquires the sample of the current tick if not yet done.
+    void latch()
+    {
+        if (!m_latched)
+        {
+            acquireSample();
+            m_latched = true;
+        }
+    }
+
+protected:
+
+    //! Sample of the current tick.
+    cDeviceRecordSample m_sample;
+
+    //! __true__ once the sample of the current tick has been acquired.
+    bool m_latched;
+};
+
+
+//------------------------------------------------------------------------------
+class cRecordingHapticDevice;
+typedef std::shared_ptr<cRecordingHapticDevice> cRecordingHapticDevicePtr;
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \class      cRecordingHapticDevice
+    \brief
+    Forwards a haptic device and records every tick to a file.
+*/
+//==============================================================================
+class cRecordingHapticDevice : public cSampledHapticDevice
+{
+public:
+
+    //! Constructor of cRecordingHapticDevice.
+    cRecordingHapticDevice(cGenericHapticDevicePtr a_device) : m_device(a_device), m_startTime(-1.0)
+    {
+        m_specifications = m_device->getSpecifications();
+        m_deviceAvailable = true;
+    }
+
+    //! Destructor of cRecordingHapticDevice.
+    virtual ~cRecordingHapticDevice() { m_writer.close(); }
+
+    //! Shared cRecordingHapticDevice allocator.
+    static cRecordingHapticDevicePtr create(cGenericHapticDevicePtr a_device) { return (std::make_shared<cRecordingHapticDevice>(a_device)); }
+
+    //! This method creates the record file. It must be called before the haptic loop starts.
+    bool record(const std::string& a_filename, double a_tickRate = C_DEVICE_RECORD_TICK_RATE)
+    {
+        return (m_writer.open(a_filename, cDeviceRecordSpecsFromInfo(m_specifications), a_tickRate));
+    }
+
+    //! This method opens the recorded device.
+    virtual bool open() { m_deviceReady = m_device->open(); return (m_deviceReady); }
+
+    //! This method closes the recorded device and the record file.
+    virtual bool close() { m_writer.close(); m_deviceReady = false; return (m_device->close()); }
+
+    //! This method calibrates the recorded device.
+    virtual bool calibrate(bool a_forceCalibration = false) { return (m_device->calibrate(a_forceCalibration)); }
+
+    //! This method returns the specifications of the recorded device.
+    virtual cHapticDeviceInfo getSpecifications() { return (m_specifications); }
+
+    //! This method returns the recorded device.
+    cGenericHapticDevicePtr getDevice() const { return (m_device); }
+
+protected:
+
+    //! This method reads the state of the recorded device.
+    virtual void acquireSample()
+    {
+        cVector3d position, linearVelocity, angularVelocity;
+        cMatrix3d rotation;
+        unsigned int userSwitches = 0;
+
+        m_device->getPosition(position);
+        m_device->getLinearVelocity(linearVelocity);
+        m_device->getRotation(rotation);
+        m_device->getAngularVelocity(angularVelocity);
+        m_device->getGripperAngleRad(m_sample.m_gripperAngle);
+        m_device->getGripperAngularVelocity(m_sample.m_gripperAngularVelocity);
+        m_device->getUserSwitches(userSwitches);
+
+        double time = m_clock.getCPUTimeSeconds();
+        if (m_startTime < 0.0) { m_startTime = time; }
+        m_sample.m_time = time - m_startTime;
+
+        for (int i=0; i<3; i++)
+        {
+            m_sample.m_position[i] = position(i);
+            m_sample.m_linearVelocity[i] = linearVelocity(i);
+            m_sample.m_angularVelocity[i] = angularVelocity(i);
+            for (int j=0; j<3; j++)
+            {
+                m_sample.m_rotation[3*i+j] = rotation(i,j);
+            }
+        }
+        m_sample.m_userSwitches = userSwitches;
+    }
+
+    //! This method writes the tick to the record and forwards the commands to the device.
+    virtual bool commitSample(const cVector3d& a_force, const cVector3d& a_torque, double a_gripperForce)
+    {
+        m_writer.write(m_sample);
+        return (m_device->setForceAndTorqueAndGripperForce(a_force, a_torque, a_gripperForce));
+    }
+
+protected:
+
+    //! Recorded device.
+    cGenericHapticDevicePtr m_device;
+
+    //! Record file writer.
+    cDeviceRecordWriter m_writer;
+
+    //! Clock used to timestamp samples.
+    cPrecisionClock m_clock;
+
+    //! Time of the first sample [s].
+    double m_startTime;
+};
+
+
+//------------------------------------------------------------------------------
+class cReplayHapticDevice;
+typedef std::shared_ptr<cReplayHapticDevice> cReplayHapticDevicePtr;
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \class      cReplayHapticDevice
+    \brief
+    Haptic device that plays back a record file, one sample per tick.
+
+    \details
+    Forces sent to the device are ignored. When the record is exhausted, the
+    device holds the last recorded pose at rest and \ref isFinished() returns
+    __true__. By default the playback is paced at the recorded tick rate,
+    from the first sample played; pacing can be disabled to replay as fast
+    as the haptic loop runs.
+*/
+//==============================================================================
+class cReplayHapticDevice : public cSampledHapticDevice
+{
+public:
+
+    //! Constructor of cReplayHapticDevice.
+    cReplayHapticDevice() : m_index(0), m_finished(false), m_paced(true), m_nextTickTime(0.0) { m_deviceAvailable = true; }
+
+    //! Destructor of cReplayHapticDevice.
+    virtual ~cReplayHapticDevice() {}
+
+    //! Shared cReplayHapticDevice allocator.
+    static cReplayHapticDevicePtr create() { return (std::make_shared<cReplayHapticDevice>()); }
+
+    //! This method loads a record file. It must be called before the haptic loop starts.
+    bool load(const std::string& a_filename)
+    {
+        if (!m_reader.load(a_filename)) { return (false); }
+        m_specifications = cDeviceRecordSpecsToInfo(m_reader.getHeader().m_specs);
+        rewind();
+        return (m_reader.getNumSamples() > 0);
+    }
+
+    //! This method restarts the playback from the first sample, and its pacing from now.
+    void rewind() { m_index = 0; m_finished = false; m_latched = false; m_nextTickTime = 0.0; m_clock.start(true); }
+
+    //! This method enables or disables pacing the playback at the recorded tick rate.
+    void setPaced(bool a_paced) { m_paced = a_paced; }
+
+    //! This method returns __true__ once every recorded sample has been played.
+    bool isFinished() const { return (m_finished); }
+
+    //! This method returns the number of recorded samples.
+    size_t getNumSamples() const { return (m_reader.getNumSamples()); }
+
+    //! This method returns the index of the sample played by the current tick.
+    size_t getSampleIndex() const { return (m_index); }
+
+    //! This method returns the tick rate of the record [Hz].
+    double getTickRate() const { return (m_reader.getHeader().m_tickRate); }
+
+    //! This method opens the device.
+    virtual bool open() { m_deviceReady = true; m_clock.start(true); return (C_SUCCESS); }
+
+    //! This method closes the device.
+    virtual bool close() { m_deviceReady = false; return (C_SUCCESS); }
+
+    //! This method calibrates the device.
+    virtual bool calibrate(bool a_forceCalibration = false) { return (C_SUCCESS); }
+
+    //! This method returns the specifications of the recorded device.
+    virtual cHapticDeviceInfo getSpecifications() { return (m_specifications); }
+
+protected:
+
+    //! This method copies the next recorded sample.
+    virtual void acquireSample()
+    {
+        if (m_index < m_reader.getNumSamples())
+        {
+            m_sample = m_reader.getSample(m_index);
+            return;
+        }
+
+        // hold the last pose at rest once the record is exhausted
+        m_finished = true;
+        m_sample = m_reader.getSample(m_reader.getNumSamples() - 1);
+        for (int i=0; i<3; i++)
+        {
+            m_sample.m_linearVelocity[i] = 0.0;
+            m_sample.m_angularVelocity[i] = 0.0;
+        }
+        m_sample.m_gripperAngularVelocity = 0.0;
+    }
+
+    //! This method moves on to the next sample, waiting for its time slot if paced.
+    virtual bool commitSample(const cVector3d& a_force, const cVector3d& a_torque, double a_gripperForce)
+    {
+        // the pacing starts with the first sample played, however long
+        // the device was open before (while the scene loaded, for instance)
+        if (m_index == 0)
+        {
+            m_clock.start(true);
+            m_nextTickTime = 0.0;
+        }
+        if (m_index < m_reader.getNumSamples()) { m_index++; }
+
+        if (m_paced)
+        {
+            m_nextTickTime += 1.0 / m_reader.getHeader().m_tickRate;
+
+            // sleep through long waits, up to the last few hundred
+            // microseconds, which the thread yields through
+            double wait = m_nextTickTime - m_clock.getCurrentTimeSeconds();
+            while (wait > 0.0)
+            {
+                if (wait > C_SPIN_TIME)
+                {
+                    std::this_thread::sleep_for(std::chrono::duration<double>(wait - C_SPIN_TIME));
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+                wait = m_nextTickTime - m_clock.getCurrentTimeSeconds();
+            }
+        }
+
+        return (C_SUCCESS);
+    }
+
+protected:
+
+    //! Wait below which the pacing yields instead of sleeping [s].
+    static constexpr double C_SPIN_TIME = 0.0003;
+
+    //! Loaded record.
+    cDeviceRecordReader m_reader;
+
+    //! Index of the sample played by the current tick.
+    size_t m_index;
+
+    //! __true__ once every recorded sample has been played.
+    bool m_finished;
+
+    //! If __true__, playback is paced at the recorded tick rate.
+    bool m_paced;
+
+    //! Clock used to pace the playback.
+    cPrecisionClock m_clock;
+
+    //! Time at which the next tick may start [s].
+    double m_nextTickTime;
+};
+
+
+//------------------------------------------------------------------------------
+
+/*!
+    This function replaces __a_device__ by a device replaying __a_replayFile__
+    and wraps the result in a device recording to __a_recordFile__. Empty file
+    names disable the corresponding stage. The replay is paced at the recorded
+    rate if __a_pacedReplay__ is __true__. It returns __false__ on error.
+*/
+inline bool cSetupRecordedDevice(cGenericHapticDevicePtr& a_device,
+                                 const std::string& a_replayFile,
+                                 const std::string& a_recordFile,
+                                 bool a_pacedReplay = true)
+{
+    if (!a_replayFile.empty())
+    {
+        cReplayHapticDevicePtr replayDevice = cReplayHapticDevice::create();
+        if (!replayDevice->load(a_replayFile))
+        {
+            std::cout << "Error - failed to load device record: " << a_replayFile << std::endl;
+            return (false);
+        }
+        replayDevice->setPaced(a_pacedReplay);
+        a_device = replayDevice;
+    }
+
+    if (!a_recordFile.empty())
+    {
+        cRecordingHapticDevicePtr recordingDevice = cRecordingHapticDevice::create(a_device);
+        if (!recordingDevice->record(a_recordFile))
+        {
+            std::cout << "Error - failed to create device record: " << a_recordFile << std::endl;
+            return (false);
+        }
+        a_device = recordingDevice;
+    }
+
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+//! This function returns the device replaying a record behind __a_device__ (itself, or the device it records), or NULL if none.
+inline cReplayHapticDevicePtr cGetReplayDevice(cGenericHapticDevicePtr a_device)
+{
+    cRecordingHapticDevicePtr recordingDevice = std::dynamic_pointer_cast<cRecordingHapticDevice>(a_device);
+    if (recordingDevice != NULL)
+    {
+        a_device = recordingDevice->getDevice();
+    }
+    return (std::dynamic_pointer_cast<cReplayHapticDevice>(a_device));
+}
+
+//------------------------------------------------------------------------------
+
+//! This function returns the physical device behind __a_device__ (itself, or the device it records), or NULL if it is replayed or simulated. Driving it does not record nor consume a tick of the session.
+inline cGenericHapticDevicePtr cGetPhysicalDevice(cGenericHapticDevicePtr a_device)
+{
+    cRecordingHapticDevicePtr recordingDevice = std::dynamic_pointer_cast<cRecordingHapticDevice>(a_device);
+    if (recordingDevice != NULL)
+    {
+        a_device = recordingDevice->getDevice();
+    }
+    if (std::dynamic_pointer_cast<cSampledHapticDevice>(a_device) != NULL) { return (NULL); }
+    return (a_device);
+}
+
+//------------------------------------------------------------------------------
+
+//! This function returns the record file of device __a_index__: __a_filename__ for the first device, __a_filename__.index for the others.
+inline std::string cGetDeviceRecordFileName(const std::string& a_filename, int a_index)
+{
+    if (a_filename.empty() || (a_index == 0)) { return (a_filename); }
+    return (a_filename + "." + std::to_string(a_index));
+}
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,477 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CRotationalDriftH
+#define CRotationalDriftH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <cmath>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CRotationalDrift.h
+
+    \brief
+    Rotational workspace drift of the ODE polishing task.
+
+    \details
+    The drift maps the orientation theta_d and the angular velocity wd of
+    the device to the avatar orientation and angular velocity. The device
+    axis theta_d is pulled back towards its initial direction theta_d0 by a
+    drift velocity proportional to its tilt speed, while the avatar
+    workspace (theta_w) turns by the same amount, so that the avatar keeps
+    its orientation. The rotational scale factor grows with the tilt so
+    that the device range ThetaMax reaches the range ThetaE of the virtual
+    environment. Beyond these ranges, stiff torques push the device back.
+
+    Two implementations compute the same outputs:
+
+    - \ref cMatrixRotationalDrift: the original computation with rotation
+      matrices, two axis-angle rotations and an axis-angle extraction per
+      tick.
+    - \ref cQuaternionRotationalDrift: the same computation with unit
+      quaternions, the constants precomputed, and a single conversion to a
+      matrix for the avatar orientation.
+
+    The controllers only compute; setting the tool is left to the haptic
+    loop.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \struct     cUnitQuaternion
+    \brief
+    Unit quaternion (w, x, y, z) of the rotational drift.
+*/
+//==============================================================================
+struct cUnitQuaternion
+{
+    //! Scalar part.
+    double m_w;
+
+    //! Vector part.
+    double m_x, m_y, m_z;
+
+    //! Constructor of cUnitQuaternion, the identity by default.
+    cUnitQuaternion(double a_w = 1.0, double a_x = 0.0, double a_y = 0.0, double a_z = 0.0) :
+        m_w(a_w), m_x(a_x), m_y(a_y), m_z(a_z) {}
+
+    //! This method sets the rotation of __a_angle__ [rad] about unit axis __a_axis__.
+    inline void setAxisAngle(const cVector3d& a_axis, double a_angle)
+    {
+        double s = sin(0.5 * a_angle);
+        m_w = cos(0.5 * a_angle);
+        m_x = s * a_axis(0);
+        m_y = s * a_axis(1);
+        m_z = s * a_axis(2);
+    }
+
+    //! This method returns the product of this quaternion by __a_q__.
+    inline cUnitQuaternion operator*(const cUnitQuaternion& a_q) const
+    {
+        return (cUnitQuaternion(m_w*a_q.m_w - m_x*a_q.m_x - m_y*a_q.m_y - m_z*a_q.m_z,
+                                m_w*a_q.m_x + m_x*a_q.m_w + m_y*a_q.m_z - m_z*a_q.m_y,
+                                m_w*a_q.m_y - m_x*a_q.m_z + m_y*a_q.m_w + m_z*a_q.m_x,
+                                m_w*a_q.m_z + m_x*a_q.m_y - m_y*a_q.m_x + m_z*a_q.m_w));
+    }
+
+    //! This method returns vector __a_v__ rotated by this quaternion.
+    inline cVector3d rotate(const cVector3d& a_v) const
+    {
+        // v + 2w (u x v) + 2 u x (u x v), with u the vector part
+        double tx = 2.0 * (m_y*a_v(2) - m_z*a_v(1));
+        double ty = 2.0 * (m_z*a_v(0) - m_x*a_v(2));
+        double tz = 2.0 * (m_x*a_v(1) - m_y*a_v(0));
+        return (cVector3d(a_v(0) + m_w*tx + m_y*tz - m_z*ty,
+                          a_v(1) + m_w*ty + m_z*tx - m_x*tz,
+                          a_v(2) + m_w*tz + m_x*ty - m_y*tx));
+    }
+
+    //! This method brings the quaternion back to unit length, when it is already close to it.
+    inline void renormalize()
+    {
+        // first order of 1/sqrt(n) about n = 1, without a square root
+        double k = 0.5 * (3.0 - (m_w*m_w + m_x*m_x + m_y*m_y + m_z*m_z));
+        m_w *= k; m_x *= k; m_y *= k; m_z *= k;
+    }
+
+    //! This method returns the angle of the rotation [rad], in [0, pi].
+    inline double getAngle() const
+    {
+        return (2.0 * atan2(sqrt(m_x*m_x + m_y*m_y + m_z*m_z), fabs(m_w)));
+    }
+
+    //! This method converts the quaternion to rotation matrix __a_rot__.
+    inline void toRotMat(cMatrix3d& a_rot) const
+    {
+        double xx = m_x*m_x, yy = m_y*m_y, zz = m_z*m_z;
+        double xy = m_x*m_y, xz = m_x*m_z, yz = m_y*m_z;
+        double wx = m_w*m_x, wy = m_w*m_y, wz = m_w*m_z;
+        a_rot.set(1.0 - 2.0*(yy + zz), 2.0*(xy - wz),       2.0*(xz + wy),
+                  2.0*(xy + wz),       1.0 - 2.0*(xx + zz), 2.0*(yz - wx),
+                  2.0*(xz - wy),       2.0*(yz + wx),       1.0 - 2.0*(xx + yy));
+    }
+};
+
+
+//==============================================================================
+/*!
+    \struct     cRotationalDriftParams
+    \brief
+    Parameters of the rotational drift.
+*/
+//==============================================================================
+struct cRotationalDriftParams
+{
+    //! Rotational drift factor.
+    double m_Kd;
+
+    //! Rotational drift controller gain.
+    double m_Kv;
+
+    //! Device max angular motion range [deg].
+    double m_thetaMax;
+
+    //! Virtual environment max angular motion range [deg].
+    double m_thetaE;
+
+    //! Virtual workspace stiffness factor.
+    double m_KVirtual;
+
+    //! Maximum torque of the device [Nm].
+    double m_maxRotTorque;
+
+    //! Maximum angular stiffness of the device, in the avatar workspace [Nm/rad].
+    double m_maxRotStiffness;
+
+    //! Rate of the haptic loop [Hz].
+    double m_tickRate;
+
+    //! Constructor of cRotationalDriftParams, with the values of the example.
+    cRotationalDriftParams(double a_Kd = 0.1, double a_Kv = 0.1, double a_thetaMax = 20.0, double a_thetaE = 85.0,
+                           double a_KVirtual = 1.0, double a_maxRotTorque = 0.0, double a_maxRotStiffness = 0.0,
+                           double a_tickRate = 4000.0) :
+        m_Kd(a_Kd), m_Kv(a_Kv), m_thetaMax(a_thetaMax), m_thetaE(a_thetaE), m_KVirtual(a_KVirtual),
+        m_maxRotTorque(a_maxRotTorque), m_maxRotStiffness(a_maxRotStiffness), m_tickRate(a_tickRate) {}
+};
+
+
+//==============================================================================
+/*!
+    \struct     cRotationalDriftState
+    \brief
+    State and outputs of a rotational drift controller, in device coordinates.
+*/
+//==============================================================================
+struct cRotationalDriftState
+{
+    //! Initial orientation of the haptic device (theta_d0).
+    cVector3d m_deviceRotIni;
+
+    //! Orientation of the avatar workspace (theta_w).
+    cVector3d m_centerRot;
+
+    //! Rotation of the avatar workspace, as a matrix (\ref cMatrixRotationalDrift).
+    cMatrix3d m_virtualWSRot;
+
+    //! Rotation of the avatar workspace, as a unit quaternion (\ref cQuaternionRotationalDrift).
+    cUnitQuaternion m_virtualWSQuat;
+
+    //! Rotation axis of the last tick, used when the device is at theta_d0.
+    cVector3d m_axisThetaPast;
+
+    //! Orientation of the haptic device (theta_d).
+    cVector3d m_deviceRot;
+
+    //! Tilt velocity of the device.
+    cVector3d m_tiltVel;
+
+    //! Cross rotational vector (theta_d x theta_d0).
+    cVector3d m_crossVector;
+
+    //! Drift velocity.
+    cVector3d m_driftVel;
+
+    //! Rotational scale factor.
+    double m_scaleFactor;
+
+    //! Avatar angular velocity.
+    cVector3d m_avatarVel;
+
+    //! Avatar orientation axis.
+    cVector3d m_avatarRotVect;
+
+    //! Avatar rotation.
+    cMatrix3d m_avatarRot;
+
+    //! Angle between theta_d and theta_d0 [rad].
+    double m_angleTheta;
+
+    //! Angle of the avatar rotation [rad].
+    double m_angleAvatar;
+
+    //! Drift torque to add to the device.
+    cVector3d m_driftTorque;
+
+    //! Torque of the device workspace limit, kept once the limit has been reached.
+    cVector3d m_wsTorque;
+
+    //! Torque of the avatar workspace limit, kept once the limit has been reached.
+    cVector3d m_avatarWSTorque;
+
+    //! Constructor of cRotationalDriftState.
+    cRotationalDriftState() : m_scaleFactor(1.0), m_angleTheta(0.0), m_angleAvatar(0.0)
+    {
+        m_deviceRotIni.set(0.0, 0.0, 1.0);
+        m_centerRot.set(0.0, 0.0, 1.0);
+        m_virtualWSRot.identity();
+        m_axisThetaPast.set(1.0, 0.0, 0.0);
+        m_deviceRot.set(0.0, 0.0, 1.0);
+        m_tiltVel.zero();
+        m_crossVector.zero();
+        m_driftVel.zero();
+        m_avatarVel.zero();
+        m_avatarRotVect.set(0.0, 0.0, 1.0);
+        m_avatarRot.identity();
+        m_driftTorque.zero();
+        m_wsTorque.zero();
+        m_avatarWSTorque.zero();
+    }
+};
+
+
+//==============================================================================
+/*!
+    \class      cMatrixRotationalDrift
+    \brief
+    Rotational drift computed with rotation matrices.
+*/
+//==============================================================================
+class cMatrixRotationalDrift
+{
+public:
+
+    //! Constructor of cMatrixRotationalDrift.
+    cMatrixRotationalDrift(const cRotationalDriftParams& a_params = cRotationalDriftParams()) : m_params(a_params) {}
+
+    //! This method sets the parameters of the drift.
+    void setParams(const cRotationalDriftParams& a_params) { m_params = a_params; }
+
+    //! This method returns the parameters of the drift.
+    const cRotationalDriftParams& getParams() const { return (m_params); }
+
+    //! This method updates the drift from the device rotation __a_deviceRot__ and angular velocity __a_deviceAngVel__.
+    inline void update(cRotationalDriftState& a_state, const cMatrix3d& a_deviceRot, const cVector3d& a_deviceAngVel) const
+    {
+        const cRotationalDriftParams& p = m_params;
+
+        // orientation of the device theta_d
+        a_state.m_deviceRot = a_deviceRot * a_state.m_deviceRotIni;
+
+        // tilt velocity of the device
+        a_state.m_tiltVel = a_deviceAngVel - a_state.m_deviceRot.dot(a_deviceAngVel)*a_state.m_deviceRot;
+
+        // cross rotational vector (Theta_d x Theta_d0)
+        a_state.m_deviceRot.crossr(a_state.m_deviceRotIni, a_state.m_crossVector);
+        // dot product (Theta_d . Theta_d0)
+        double rotDot = a_state.m_deviceRot.dot(a_state.m_deviceRotIni);
+
+        // calculation of the rotational drift velocity
+        a_state.m_driftVel = p.m_Kd*a_state.m_tiltVel.length()*a_state.m_crossVector/(sin(p.m_thetaMax*3.14/180));
+
+        // modification of the rotational scaling factor according to the orientation
+        a_state.m_scaleFactor = (1 + a_state.m_crossVector.length()*(p.m_thetaE/p.m_thetaMax-1)/(sin(p.m_thetaMax*3.14/180)));
+
+        // avatar rotational velocity in device coordinates
+        a_state.m_avatarVel = a_state.m_scaleFactor * (a_deviceAngVel-a_state.m_driftVel);
+
+        // virtual workspace orientation
+        double angleCenter = a_state.m_scaleFactor*a_state.m_driftVel.length()/p.m_tickRate;
+
+        // rotation axis in the virtual workspace local coordinates
+        cVector3d axisTheta = a_state.m_virtualWSRot*a_state.m_crossVector;
+        if (axisTheta.length()!=0.0)
+        {
+            axisTheta.normalize();
+        }
+        else
+        {
+            axisTheta = a_state.m_axisThetaPast;
+        }
+        a_state.m_axisThetaPast = axisTheta;
+
+        cMatrix3d rot;
+        rot.setAxisAngleRotationRad(-axisTheta, angleCenter);
+        // update new virtual workspace rotation matrix and z_axis
+        a_state.m_virtualWSRot = a_state.m_virtualWSRot*rot;
+        a_state.m_centerRot = rot * a_state.m_centerRot;
+
+        // avatar orientation in device coordinates
+        a_state.m_angleTheta = atan2(a_state.m_crossVector.length(), rotDot);
+
+        rot.setAxisAngleRotationRad(-axisTheta, a_state.m_scaleFactor*a_state.m_angleTheta);
+        // update new avatar orientation axis and rotation matrix
+        a_state.m_avatarRotVect = rot * a_state.m_centerRot;
+        a_state.m_avatarRot = a_state.m_virtualWSRot*rot;
+
+        // drift of the device
+        a_state.m_driftTorque = p.m_Kv*p.m_maxRotTorque*(a_state.m_driftVel-a_state.m_tiltVel);
+
+        // device workspace limit
+        if (a_state.m_angleTheta>=(p.m_thetaMax*3.14/180))
+        {
+            a_state.m_wsTorque = p.m_KVirtual*(a_state.m_angleTheta-(p.m_thetaMax*3.14/180))*p.m_maxRotStiffness*a_state.m_crossVector;
+        }
+
+        // avatar workspace limit
+        cVector3d axis;
+        a_state.m_avatarRot.toAxisAngle(axis, a_state.m_angleAvatar);
+        if (a_state.m_angleAvatar>=(p.m_thetaE*3.14/180))
+        {
+            a_state.m_avatarWSTorque = p.m_KVirtual*(a_state.m_angleAvatar-(p.m_thetaE*3.14/180))*p.m_maxRotStiffness*a_state.m_crossVector;
+        }
+    }
+
+protected:
+
+    //! Parameters of the drift.
+    cRotationalDriftParams m_params;
+};
+
+
+//==============================================================================
+/*!
+    \class      cQuaternionRotationalDrift
+    \brief
+    Rotational drift computed with unit quaternions.
+
+    \details
+    The rotation of the avatar workspace is a unit quaternion, brought back
+    to unit length after each tick so that rounding errors do not
+    accumulate over a session. The sines and ratios of the parameters are
+    computed once in \ref setParams(), and the avatar rotation is converted
+    to a matrix once per tick; its angle is read from the quaternion.
+    Angles are converted with 3.14/180 as in the matrix version, so that
+    both produce the same outputs.
+*/
+//==============================================================================
+class cQuaternionRotationalDrift
+{
+public:
+
+    //! Constructor of cQuaternionRotationalDrift.
+    cQuaternionRotationalDrift(const cRotationalDriftParams& a_params = cRotationalDriftParams()) { setParams(a_params); }
+
+    //! This method sets the parameters of the drift.
+    void setParams(const cRotationalDriftParams& a_params)
+    {
+        m_params = a_params;
+        m_thetaMaxRad = m_params.m_thetaMax*3.14/180;
+        m_thetaERad = m_params.m_thetaE*3.14/180;
+        m_invSinThetaMax = 1.0/sin(m_thetaMaxRad);
+        m_scaleSlope = (m_params.m_thetaE/m_params.m_thetaMax-1)*m_invSinThetaMax;
+        m_invTickRate = 1.0/m_params.m_tickRate;
+    }
+
+    //! This method returns the parameters of the drift.
+    const cRotationalDriftParams& getParams() const { return (m_params); }
+
+    //! This method updates the drift from the device rotation __a_deviceRot__ and angular velocity __a_deviceAngVel__.
+    inline void update(cRotationalDriftState& a_state, const cMatrix3d& a_deviceRot, const cVector3d& a_deviceAngVel) const
+    {
+        const cRotationalDriftParams& p = m_params;
+
+        // orientation of the device theta_d, its tilt velocity, and its
+        // position relative to theta_d0
+        a_state.m_deviceRot = a_deviceRot * a_state.m_deviceRotIni;
+        a_state.m_tiltVel = a_deviceAngVel - a_state.m_deviceRot.dot(a_deviceAngVel)*a_state.m_deviceRot;
+        a_state.m_deviceRot.crossr(a_state.m_deviceRotIni, a_state.m_crossVector);
+        double rotDot = a_state.m_deviceRot.dot(a_state.m_deviceRotIni);
+        double crossLength = a_state.m_crossVector.length();
+
+        // drift velocity, scale factor and avatar angular velocity
+        a_state.m_driftVel = (p.m_Kd*a_state.m_tiltVel.length()*m_invSinThetaMax)*a_state.m_crossVector;
+        a_state.m_scaleFactor = 1.0 + crossLength*m_scaleSlope;
+        a_state.m_avatarVel = a_state.m_scaleFactor * (a_deviceAngVel-a_state.m_driftVel);
+
+        // rotation axis in the virtual workspace local coordinates
+        cVector3d axisTheta = a_state.m_virtualWSQuat.rotate(a_state.m_crossVector);
+        double axisLength = axisTheta.length();
+        if (axisLength!=0.0)
+        {
+            axisTheta *= 1.0/axisLength;
+        }
+        else
+        {
+            axisTheta = a_state.m_axisThetaPast;
+        }
+        a_state.m_axisThetaPast = axisTheta;
+        cVector3d axis = -axisTheta;
+
+        // turn the virtual workspace by the drift of this tick
+        cUnitQuaternion rot;
+        rot.setAxisAngle(axis, a_state.m_scaleFactor*a_state.m_driftVel.length()*m_invTickRate);
+        a_state.m_virtualWSQuat = a_state.m_virtualWSQuat*rot;
+        a_state.m_virtualWSQuat.renormalize();
+        a_state.m_centerRot = rot.rotate(a_state.m_centerRot);
+
+        // avatar orientation in device coordinates
+        a_state.m_angleTheta = atan2(crossLength, rotDot);
+        rot.setAxisAngle(axis, a_state.m_scaleFactor*a_state.m_angleTheta);
+        a_state.m_avatarRotVect = rot.rotate(a_state.m_centerRot);
+        cUnitQuaternion avatarRot = a_state.m_virtualWSQuat*rot;
+        avatarRot.toRotMat(a_state.m_avatarRot);
+        a_state.m_angleAvatar = avatarRot.getAngle();
+
+        // drift of the device
+        a_state.m_driftTorque = p.m_Kv*p.m_maxRotTorque*(a_state.m_driftVel-a_state.m_tiltVel);
+
+        // device and avatar workspace limits
+        if (a_state.m_angleTheta>=m_thetaMaxRad)
+        {
+            a_state.m_wsTorque = (p.m_KVirtual*(a_state.m_angleTheta-m_thetaMaxRad)*p.m_maxRotStiffness)*a_state.m_crossVector;
+        }
+        if (a_state.m_angleAvatar>=m_thetaERad)
+        {
+            a_state.m_avatarWSTorque = (p.m_KVirtual*(a_state.m_angleAvatar-m_thetaERad)*p.m_maxRotStiffness)*a_state.m_crossVector;
+        }
+    }
+
+protected:
+
+    //! Parameters of the drift.
+    cRotationalDriftParams m_params;
+
+    //! Ranges of the device and of the virtual environment [rad].
+    double m_thetaMaxRad;
+    double m_thetaERad;
+
+    //! 1/sin(ThetaMax).
+    double m_invSinThetaMax;
+
+    //! Growth of the scale factor with |theta_d x theta_d0|.
+    double m_scaleSlope;
+
+    //! Period of the haptic loop [s].
+    double m_invTickRate;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,307 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CSceneCommandQueueH
+#define CSceneCommandQueueH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <atomic>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CSceneCommandQueue.h
+
+    \brief
+    Visual-only scene graph changes deferred from the haptic thread to the
+    graphics thread.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \struct     cSceneCommand
+    \brief
+    A visual-only change of a scene graph object.
+*/
+//==============================================================================
+struct cSceneCommand
+{
+    //! Types of commands.
+    enum Type { SET_LOCAL_POS = 0, SET_BOX_SIZE = 1, SET_SHOW_ENABLED = 2 };
+
+    //! Type of the command.
+    Type m_type;
+
+    //! Object changed by the command.
+    cGenericObject* m_object;
+
+    //! Position or size set by the command.
+    cVector3d m_value;
+
+    //! Visibility set by the command.
+    bool m_flag;
+};
+
+
+//==============================================================================
+/*!
+    \class      cSceneCommandQueue
+    \brief
+    Lock-free queue of visual-only scene graph changes.
+
+    \details
+    The haptic thread must not change objects that are only displayed
+    (positions of markers, size of the workspace box, visibility), because
+    the graphics thread renders them at the same time and because some of
+    these changes rebuild geometry, which is wasted at 4 kHz when only the
+    last change before a frame is seen.
+
+    The haptic thread records the changes with \ref setLocalPos(),
+    \ref setBoxSize() and \ref setShowEnabled(), and the graphics thread
+    applies them once per frame with \ref apply(). Only the last command of
+    each type for each object is applied. The queue is a fixed-size ring
+    with one producer and one consumer: neither thread locks nor allocates.
+
+    When the ring is full (the graphics thread stalls, or is not running in
+    headless mode), the haptic thread defers the new commands, keeping the
+    last one of each type for each object, and writes them to the ring
+    before its next command once there is room. The final state of every
+    object is thus kept; the commands replaced while deferred, or lost when
+    too many objects are deferred, are counted as dropped.
+
+    Changes that affect the haptic rendering (haptic enable, magnetic line
+    end points) must stay on the haptic thread.
+*/
+//==============================================================================
+class cSceneCommandQueue
+{
+public:
+
+    //! Constructor of cSceneCommandQueue.
+    cSceneCommandQueue() : m_head(0), m_tail(0), m_numDropped(0), m_numApplied(0), m_numCoalesced(0), m_numPending(0), m_firstPending(0) {}
+
+    //! This method records a change of the local position of __a_object__.
+    bool setLocalPos(cGenericObject* a_object, const cVector3d& a_pos)
+    {
+        return (push(cSceneCommand::SET_LOCAL_POS, a_object, a_pos, false));
+    }
+
+    //! This method records a change of the size of box __a_box__.
+    bool setBoxSize(cShapeBox* a_box, double a_sizeX, double a_sizeY, double a_sizeZ)
+    {
+        return (push(cSceneCommand::SET_BOX_SIZE, a_box, cVector3d(a_sizeX, a_sizeY, a_sizeZ), false));
+    }
+
+    //! This method records a change of the visibility of __a_object__.
+    bool setShowEnabled(cGenericObject* a_object, bool a_showEnabled)
+    {
+        return (push(cSceneCommand::SET_SHOW_ENABLED, a_object, cVector3d(0.0, 0.0, 0.0), a_showEnabled));
+    }
+
+    //! This method applies the recorded commands, the last one of each type for each object only. Graphics thread only.
+    void apply()
+    {
+        // take the commands recorded so far
+        unsigned int head = m_head.load(std::memory_order_relaxed);
+        unsigned int tail = m_tail.load(std::memory_order_acquire);
+
+        // find the last command of each type for each object, walking the
+        // commands from the most recent one
+        int numLast = 0;
+        bool coalesce = true;
+        for (unsigned int i = tail; i != head; i--)
+        {
+            const cSceneCommand& command = m_commands[(i - 1) & C_MASK];
+
+            bool found = false;
+            for (int j=0; j<numLast; j++)
+            {
+                const cSceneCommand& last = m_commands[m_last[j] & C_MASK];
+                if ((last.m_object == command.m_object) && (last.m_type == command.m_type))
+                {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found)
+            {
+                // too many distinct objects: apply every command in order instead
+                if (numLast == C_NUM_LAST)
+                {
+                    coalesce = false;
+                    break;
+                }
+                m_last[numLast++] = i - 1;
+            }
+        }
+
+        if (coalesce)
+        {
+            for (int j=0; j<numLast; j++)
+            {
+                execute(m_commands[m_last[j] & C_MASK]);
+            }
+            m_numApplied += numLast;
+            m_numCoalesced += (tail - head) - numLast;
+        }
+        else
+        {
+            for (unsigned int i = head; i != tail; i++)
+            {
+                execute(m_commands[i & C_MASK]);
+            }
+            m_numApplied += tail - head;
+        }
+
+        // release the slots to the haptic thread
+        m_head.store(tail, std::memory_order_release);
+    }
+
+    //! This method returns the number of commands dropped because the queue was full: replaced by a later deferred command, or lost.
+    unsigned long getNumDropped() const { return (m_numDropped.load(std::memory_order_relaxed)); }
+
+    //! This method returns the number of commands applied.
+    unsigned long getNumApplied() const { return (m_numApplied); }
+
+    //! This method returns the number of commands skipped because a later one replaced them.
+    unsigned long getNumCoalesced() const { return (m_numCoalesced); }
+
+protected:
+
+    //! Number of commands of the ring (power of two), about 0.3 s of three commands per haptic tick.
+    static const unsigned int C_SIZE = 4096;
+    static const unsigned int C_MASK = C_SIZE - 1;
+
+    //! Number of distinct (object, type) pairs coalesced per frame.
+    static const int C_NUM_LAST = 64;
+
+    //! This method records a command, after the deferred ones; it returns __false__ if the command is deferred. Haptic thread only.
+    bool push(cSceneCommand::Type a_type, cGenericObject* a_object, const cVector3d& a_value, bool a_flag)
+    {
+        cSceneCommand command;
+        command.m_type = a_type;
+        command.m_object = a_object;
+        command.m_value = a_value;
+        command.m_flag = a_flag;
+
+        // the commands deferred while the ring was full go first, in order
+        while ((m_firstPending < m_numPending) && write(m_pending[m_firstPending]))
+        {
+            m_firstPending++;
+        }
+        if (m_firstPending == m_numPending)
+        {
+            m_firstPending = 0;
+            m_numPending = 0;
+            if (write(command)) { return (true); }
+        }
+
+        defer(command);
+        return (false);
+    }
+
+    //! This method writes __a_command__ to the ring; it returns __false__ if the ring is full. Haptic thread only.
+    bool write(const cSceneCommand& a_command)
+    {
+        unsigned int tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) >= C_SIZE)
+        {
+            return (false);
+        }
+        m_commands[tail & C_MASK] = a_command;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return (true);
+    }
+
+    //! This method defers __a_command__ until the ring has room, in place of the deferred command of the same type for the same object. Haptic thread only.
+    void defer(const cSceneCommand& a_command)
+    {
+        for (int i=m_firstPending; i<m_numPending; i++)
+        {
+            if ((m_pending[i].m_object == a_command.m_object) && (m_pending[i].m_type == a_command.m_type))
+            {
+                m_pending[i] = a_command;
+                m_numDropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        // make room at the end, or lose the command if too many objects are deferred
+        if ((m_numPending == C_NUM_LAST) && (m_firstPending > 0))
+        {
+            for (int i=m_firstPending; i<m_numPending; i++) { m_pending[i - m_firstPending] = m_pending[i]; }
+            m_numPending -= m_firstPending;
+            m_firstPending = 0;
+        }
+        if (m_numPending == C_NUM_LAST)
+        {
+            m_numDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        m_pending[m_numPending++] = a_command;
+    }
+
+    //! This method executes command __a_command__.
+    static void execute(const cSceneCommand& a_command)
+    {
+        switch (a_command.m_type)
+        {
+        case cSceneCommand::SET_LOCAL_POS :
+            a_command.m_object->setLocalPos(a_command.m_value);
+            break;
+        case cSceneCommand::SET_BOX_SIZE :
+            ((cShapeBox*)a_command.m_object)->setSize(a_command.m_value(0), a_command.m_value(1), a_command.m_value(2));
+            break;
+        default :
+            a_command.m_object->setShowEnabled(a_command.m_flag);
+            break;
+        }
+    }
+
+    //! Ring of commands.
+    cSceneCommand m_commands[C_SIZE];
+
+    //! Index of the last command of each (object, type) pair during the current call to \ref apply().
+    unsigned int m_last[C_NUM_LAST];
+
+    //! Index of the oldest command not yet applied (written by the graphics thread).
+    std::atomic<unsigned int> m_head;
+
+    //! Index of the next command recorded (written by the haptic thread).
+    std::atomic<unsigned int> m_tail;
+
+    //! Number of commands dropped because the queue was full.
+    std::atomic<unsigned long> m_numDropped;
+
+    //! Number of commands applied.
+    unsigned long m_numApplied;
+
+    //! Number of commands skipped because a later one replaced them.
+    unsigned long m_numCoalesced;
+
+    //! Commands deferred while the ring was full, the last one of each type for each object (haptic thread only).
+    cSceneCommand m_pending[C_NUM_LAST];
+
+    //! Number of deferred commands, and index of the first one not yet written to the ring.
+    int m_numPending;
+    int m_firstPending;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,108 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CSeqLockH
+#define CSeqLockH
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <cstring>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CSeqLock.h
+
+    \brief
+    Sequence lock that passes a value from one writer thread to reader
+    threads without blocking the writer.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cSeqLock
+    \brief
+    Sequence lock that passes a value from one writer thread to reader
+    threads without blocking the writer.
+
+    \details
+    The writer makes the sequence odd, stores the value and makes the
+    sequence even again. A reader copies the value and reads again if the
+    sequence was odd or has changed meanwhile, which is rare when the value
+    is small. The value is stored as relaxed atomic words, so that a torn
+    copy is discarded rather than being a data race.
+
+    T must be trivially copyable (plain numbers and arrays of them).
+*/
+//==============================================================================
+template <class T> class cSeqLock
+{
+public:
+
+    //! Constructor of cSeqLock.
+    cSeqLock() : m_sequence(0)
+    {
+        for (int i=0; i<C_NUM_WORDS; i++) { m_words[i].store(0, std::memory_order_relaxed); }
+    }
+
+    //! This method stores value __a_value__. Writer thread only.
+    void write(const T& a_value)
+    {
+        unsigned long long words[C_NUM_WORDS] = { 0 };
+        memcpy(words, &a_value, sizeof(T));
+
+        unsigned int sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (int i=0; i<C_NUM_WORDS; i++) { m_words[i].store(words[i], std::memory_order_relaxed); }
+
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    //! This method copies the last value stored into __a_value__. It returns __false__ if no value has been stored yet.
+    bool read(T& a_value) const
+    {
+        unsigned long long words[C_NUM_WORDS];
+        unsigned int before, after;
+        do
+        {
+            before = m_sequence.load(std::memory_order_acquire);
+            for (int i=0; i<C_NUM_WORDS; i++) { words[i] = m_words[i].load(std::memory_order_relaxed); }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = m_sequence.load(std::memory_order_relaxed);
+        }
+        while ((before != after) || ((before & 1) != 0));
+
+        memcpy(&a_value, words, sizeof(T));
+        return (before != 0);
+    }
+
+protected:
+
+    //! Number of words of the value.
+    static const int C_NUM_WORDS = (sizeof(T) + sizeof(unsigned long long) - 1) / sizeof(unsigned long long);
+
+    //! Sequence of the value, odd while it is written.
+    std::atomic<unsigned int> m_sequence;
+
+    //! Value.
+    std::atomic<unsigned long long> m_words[C_NUM_WORDS];
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
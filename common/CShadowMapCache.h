@@ -0,0 +1,187 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CShadowMapCacheH
+#define CShadowMapCacheH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <cmath>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CShadowMapCache.h
+
+    \brief
+    Re-renders the shadow maps of a world only when they are out of date.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cShadowMapCache
+    \brief
+    Re-renders the shadow maps of a world only when they are out of date.
+
+    \details
+    world->updateShadowMaps() renders the scene once more from each light
+    that casts shadows, every frame, although the lights and most of the
+    scene are static. The cache keeps the shadow maps of the previous
+    frame unless:
+
+    - an object registered with \ref track() (a light, or an object that
+      moves: workspace box, ODE body) has moved or turned by more than a
+      tolerance in its parent frame, has changed size or has been shown or
+      hidden,
+    - a tool registered with \ref trackTool() has moved or turned by more
+      than the tolerance,
+    - \ref invalidate() has been called, when the geometry of an untracked
+      object has changed (a sculpted terrain for instance),
+    - the mirroring of the display has changed.
+
+    The tolerance lets a tool held still, whose position jitters with the
+    device noise, keep the cached shadows.
+*/
+//==============================================================================
+class cShadowMapCache
+{
+public:
+
+    //! Constructor of cShadowMapCache. __a_tolerance__ is the smallest move [m] or rotation [rad] that updates the shadows.
+    cShadowMapCache(double a_tolerance = 0.001) : m_tolerance(a_tolerance), m_valid(false), m_mirrored(false),
+                                                   m_numFrames(0), m_numUpdates(0) {}
+
+    //! This method registers object __a_object__, whose moves, size and visibility update the shadows.
+    void track(cGenericObject* a_object)
+    {
+        m_tracked.push_back(cTrackedObject(a_object, NULL));
+        m_valid = false;
+    }
+
+    //! This method registers tool __a_tool__, whose moves update the shadows.
+    void trackTool(cGenericTool* a_tool)
+    {
+        m_tracked.push_back(cTrackedObject(a_tool, a_tool));
+        m_valid = false;
+    }
+
+    //! This method marks the shadow maps out of date.
+    void invalidate() { m_valid = false; }
+
+    //! This method renders the shadow maps of __a_world__ if they are out of date. It returns __true__ if it did.
+    bool update(cWorld* a_world, bool a_mirrored)
+    {
+        m_numFrames++;
+
+        // compare each tracked object with its state when it last changed;
+        // every object is visited so that all changed states are stored
+        bool changed = (!m_valid) || (a_mirrored != m_mirrored);
+        for (size_t i=0; i<m_tracked.size(); i++)
+        {
+            changed = m_tracked[i].update(m_tolerance) || changed;
+        }
+        if (!changed) { return (false); }
+
+        a_world->updateShadowMaps(false, a_mirrored);
+        m_valid = true;
+        m_mirrored = a_mirrored;
+        m_numUpdates++;
+        return (true);
+    }
+
+    //! This method returns the fraction of the frames that rendered the shadow maps.
+    double getUpdateRatio() const { return ((m_numFrames > 0) ? (double)m_numUpdates / (double)m_numFrames : 0.0); }
+
+protected:
+
+    //! State of a tracked object when it last changed.
+    struct cTrackedObject
+    {
+        cGenericObject* m_object;
+        cGenericTool* m_tool;
+        cVector3d m_pos;
+        cMatrix3d m_rot;
+        cVector3d m_boundaryMin;
+        cVector3d m_boundaryMax;
+        bool m_visible;
+
+        //! Constructor of cTrackedObject, which stores the current state of __a_object__ (drawn by tool __a_tool__, or NULL).
+        cTrackedObject(cGenericObject* a_object, cGenericTool* a_tool) : m_object(a_object), m_tool(a_tool), m_visible(false)
+        {
+            m_pos.zero();
+            m_rot.identity();
+            m_boundaryMin.zero();
+            m_boundaryMax.zero();
+            update(-1.0);
+        }
+
+        //! This method stores the current state and returns __true__ if it differs from the last one by more than __a_tolerance__.
+        bool update(double a_tolerance)
+        {
+            // a tool is drawn at the position of its device; other objects
+            // are drawn in their parent frame
+            cVector3d pos = (m_tool != NULL) ? m_tool->getDeviceGlobalPos() : m_object->getLocalPos();
+            cMatrix3d rot = (m_tool != NULL) ? m_tool->getDeviceGlobalRot() : m_object->getLocalRot();
+            cVector3d boundaryMin = m_object->getBoundaryMin();
+            cVector3d boundaryMax = m_object->getBoundaryMax();
+            bool visible = m_object->getEnabled() && m_object->getShowEnabled();
+
+            bool changed = (visible != m_visible) ||
+                           ((pos - m_pos).length() > a_tolerance) ||
+                           ((boundaryMin - m_boundaryMin).length() > a_tolerance) ||
+                           ((boundaryMax - m_boundaryMax).length() > a_tolerance);
+            for (int r=0; (r<3) && !changed; r++)
+            {
+                for (int c=0; c<3; c++)
+                {
+                    if (fabs(rot(r,c) - m_rot(r,c)) > a_tolerance) { changed = true; break; }
+                }
+            }
+            if (!changed) { return (false); }
+
+            m_pos = pos;
+            m_rot = rot;
+            m_boundaryMin = boundaryMin;
+            m_boundaryMax = boundaryMax;
+            m_visible = visible;
+            return (true);
+        }
+    };
+
+    //! Smallest move [m] or rotation [rad] that updates the shadows.
+    double m_tolerance;
+
+    //! Tracked objects.
+    std::vector<cTrackedObject> m_tracked;
+
+    //! __false__ if the shadow maps must be rendered at the next update.
+    bool m_valid;
+
+    //! Mirroring of the display at the last update.
+    bool m_mirrored;
+
+    //! Number of calls to \ref update().
+    unsigned long m_numFrames;
+
+    //! Number of updates that rendered the shadow maps.
+    unsigned long m_numUpdates;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
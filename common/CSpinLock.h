@@ -0,0 +1,116 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CSpinLockH
+#define CSpinLockH
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <thread>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CSpinLock.h
+
+    \brief
+    Spin lock for data shared between haptic threads.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cSpinLock
+    \brief
+    Spin lock for data shared between haptic threads.
+
+    \details
+    Haptic threads hold shared data for a few microseconds per tick, which
+    is shorter than putting a thread to sleep and waking it up again, so a
+    waiting thread spins instead of blocking. After a number of failed
+    attempts it yields its core, so that a lock held for longer (for
+    instance while a collision tree is rebuilt) does not starve the thread
+    that holds it.
+*/
+//==============================================================================
+class cSpinLock
+{
+public:
+
+    //! Constructor of cSpinLock.
+    cSpinLock() : m_locked(false) {}
+
+    //! This method acquires the lock.
+    void acquire()
+    {
+        int spins = 0;
+        while (true)
+        {
+            if (!m_locked.exchange(true, std::memory_order_acquire)) { return; }
+
+            // wait until the lock looks free before trying again
+            while (m_locked.load(std::memory_order_relaxed))
+            {
+                if (++spins >= C_SPIN_COUNT) { std::this_thread::yield(); spins = 0; }
+            }
+        }
+    }
+
+    //! This method acquires the lock if it is free and returns __true__ if it did.
+    bool tryAcquire() { return (!m_locked.load(std::memory_order_relaxed) && !m_locked.exchange(true, std::memory_order_acquire)); }
+
+    //! This method releases the lock.
+    void release() { m_locked.store(false, std::memory_order_release); }
+
+private:
+
+    //! Number of failed attempts after which a waiting thread yields its core.
+    static const int C_SPIN_COUNT = 4096;
+
+    //! __true__ while the lock is held.
+    std::atomic<bool> m_locked;
+};
+
+
+//==============================================================================
+/*!
+    \class      cSpinLockGuard
+    \brief
+    Holds a \ref cSpinLock for the lifetime of the guard.
+*/
+//==============================================================================
+class cSpinLockGuard
+{
+public:
+
+    //! Constructor of cSpinLockGuard. Acquires __a_lock__.
+    cSpinLockGuard(cSpinLock& a_lock) : m_lock(a_lock) { m_lock.acquire(); }
+
+    //! Destructor of cSpinLockGuard. Releases the lock.
+    ~cSpinLockGuard() { m_lock.release(); }
+
+private:
+
+    //! Lock held by the guard.
+    cSpinLock& m_lock;
+
+    //! Copying a guard is not allowed.
+    cSpinLockGuard(const cSpinLockGuard&);
+    cSpinLockGuard& operator=(const cSpinLockGuard&);
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,326 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CStartupTasksH
+#define CStartupTasksH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CStartupTasks.h
+
+    \brief
+    Startup of an example in timed phases, with its loading and
+    preprocessing run as background tasks while the window shows their
+    progress and the haptic device is held in a safe idle mode.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cStartupTasks
+    \brief
+    Timed phases of the startup of an example, some of them run as
+    background tasks.
+
+    \details
+    Each phase is timed from its \ref beginPhase() to its \ref endPhase(),
+    on the thread that runs it, relative to the construction of the object.
+    \ref run() starts a task on a thread of its own; the phases it begins
+    are reported on that thread. The graphics thread polls
+    \ref isDone(), \ref getProgress() and \ref getStatus() to show the
+    progress, and \ref wait() joins the tasks. \ref printReport() lists the
+    phases with their thread, start and duration, and the time at which the
+    example became interactive (\ref setInteractive()).
+
+    The tasks must not touch objects used by other threads meanwhile (the
+    world rendered, the device of the haptic loop); objects they share
+    with each other must be locked by the example.
+*/
+//==============================================================================
+class cStartupTasks
+{
+public:
+
+    //! Constructor of cStartupTasks. The phases are timed from now.
+    cStartupTasks() : m_origin(clock::now()), m_numExpected(0), m_numRunning(0), m_interactiveTime(-1.0) {}
+
+    //! Destructor of cStartupTasks.
+    ~cStartupTasks() { wait(); }
+
+    //! This method sets the number of phases expected in all, for \ref getProgress().
+    void expectPhases(int a_numPhases) { m_numExpected = a_numPhases; }
+
+    //! This method returns the number of phases begun.
+    int getNumPhases() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return ((int)m_phases.size());
+    }
+
+    //! This method begins phase __a_name__ on the calling thread, and returns its index for \ref endPhase().
+    int beginPhase(const std::string& a_name)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        cPhase phase;
+        phase.m_name = a_name;
+        phase.m_thread = getThreadIndex();
+        phase.m_start = getTime();
+        phase.m_end = -1.0;
+        m_phases.push_back(phase);
+        return ((int)m_phases.size() - 1);
+    }
+
+    //! This method ends phase __a_phase__.
+    void endPhase(int a_phase)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_phases[a_phase].m_end = getTime();
+    }
+
+    //! This method runs __a_task__ on a thread of its own.
+    void run(const std::function<void()>& a_task)
+    {
+        m_numRunning++;
+        m_threads.push_back(std::thread([this, a_task]()
+        {
+            a_task();
+            m_numRunning--;
+        }));
+    }
+
+    //! This method returns __true__ if all the tasks are done.
+    bool isDone() const { return (m_numRunning == 0); }
+
+    //! This method waits for the tasks to finish.
+    void wait()
+    {
+        for (size_t i=0; i<m_threads.size(); i++)
+        {
+            if (m_threads[i].joinable()) { m_threads[i].join(); }
+        }
+        m_threads.clear();
+    }
+
+    //! This method returns the fraction of the phases expected that are done.
+    double getProgress() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        int numDone = 0;
+        for (size_t i=0; i<m_phases.size(); i++) { if (m_phases[i].m_end >= 0.0) { numDone++; } }
+        int numPhases = cMax(m_numExpected, (int)m_phases.size());
+        return ((numPhases > 0) ? cMin(1.0, (double)numDone / (double)numPhases) : 0.0);
+    }
+
+    //! This method returns the names of the phases in progress.
+    std::string getStatus() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::string status;
+        for (size_t i=0; i<m_phases.size(); i++)
+        {
+            if (m_phases[i].m_end >= 0.0) { continue; }
+            if (!status.empty()) { status += ", "; }
+            status += m_phases[i].m_name;
+        }
+        return (status);
+    }
+
+    //! This method returns the time since the construction [s].
+    double getTime() const { return (std::chrono::duration<double>(clock::now() - m_origin).count()); }
+
+    //! This method marks the time at which the example became interactive.
+    void setInteractive() { m_interactiveTime = getTime(); }
+
+    //! This method prints the phases under title __a_title__.
+    void printReport(const std::string& a_title) const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        printf("%s:\n", a_title.c_str());
+        for (size_t i=0; i<m_phases.size(); i++)
+        {
+            const cPhase& phase = m_phases[i];
+            double end = (phase.m_end >= 0.0) ? phase.m_end : getTime();
+            printf("  %-28s %-8s %8.1f ms + %8.1f ms\n", phase.m_name.c_str(),
+                   (phase.m_thread == 0) ? "main" : ("task " + std::to_string(phase.m_thread)).c_str(),
+                   1e3 * phase.m_start, 1e3 * (end - phase.m_start));
+        }
+        if (m_interactiveTime >= 0.0)
+        {
+            printf("  interactive after %.1f ms\n", 1e3 * m_interactiveTime);
+        }
+    }
+
+protected:
+
+    typedef std::chrono::steady_clock clock;
+
+    //! A phase of the startup.
+    struct cPhase
+    {
+        std::string m_name;
+        int m_thread;
+        double m_start;
+        double m_end;
+    };
+
+    //! This method returns the index of the calling thread, 0 for the thread that created the object.
+    int getThreadIndex()
+    {
+        std::thread::id id = std::this_thread::get_id();
+        for (size_t i=0; i<m_threadIds.size(); i++)
+        {
+            if (m_threadIds[i] == id) { return ((int)i + 1); }
+        }
+        if (id == m_mainThread) { return (0); }
+        m_threadIds.push_back(id);
+        return ((int)m_threadIds.size());
+    }
+
+    //! Origin of the times.
+    clock::time_point m_origin;
+
+    //! Thread that created the object, and the other threads that began phases.
+    std::thread::id m_mainThread = std::this_thread::get_id();
+    std::vector<std::thread::id> m_threadIds;
+
+    //! Phases, and the lock of the phases.
+    std::vector<cPhase> m_phases;
+    mutable std::mutex m_mutex;
+
+    //! Number of phases expected.
+    int m_numExpected;
+
+    //! Threads of the tasks, and number of tasks running.
+    std::vector<std::thread> m_threads;
+    std::atomic<int> m_numRunning;
+
+    //! Time at which the example became interactive (negative until then) [s].
+    double m_interactiveTime;
+};
+
+
+//==============================================================================
+/*!
+    \class      cStartupScreen
+    \brief
+    Screen showing the progress of a \ref cStartupTasks.
+
+    \details
+    The screen is a world of its own, with a camera, a label and a bar, so
+    that the graphics thread can render it while the tasks build the world
+    of the example.
+*/
+//==============================================================================
+class cStartupScreen
+{
+public:
+
+    //! Constructor of cStartupScreen.
+    cStartupScreen() : m_world(NULL), m_camera(NULL), m_label(NULL), m_bar(NULL), m_frame(NULL) {}
+
+    //! Destructor of cStartupScreen.
+    ~cStartupScreen() { delete m_world; }
+
+    //! This method creates the screen, with text in font __a_font__.
+    void initialize(cFontPtr a_font)
+    {
+        m_world = new cWorld();
+        m_world->m_backgroundColor.setWhite();
+        m_camera = new cCamera(m_world);
+        m_world->addChild(m_camera);
+
+        m_label = new cLabel(a_font);
+        m_label->m_fontColor.setBlack();
+        m_camera->m_frontLayer->addChild(m_label);
+
+        m_frame = new cPanel();
+        m_frame->setColor(cColorf(0.85f, 0.85f, 0.85f));
+        m_camera->m_frontLayer->addChild(m_frame);
+        m_bar = new cPanel();
+        m_bar->setColor(cColorf(0.39f, 0.58f, 0.93f));
+        m_camera->m_frontLayer->addChild(m_bar);
+    }
+
+    //! This method returns __true__ if the screen was created.
+    bool isInitialized() const { return (m_world != NULL); }
+
+    //! This method renders the progress of __a_tasks__ in a window of size __a_width__ x __a_height__.
+    void render(const cStartupTasks& a_tasks, int a_width, int a_height)
+    {
+        double progress = a_tasks.getProgress();
+        std::string status = a_tasks.getStatus();
+        m_label->setText("loading " + std::to_string((int)(100.0 * progress)) + "%" + (status.empty() ? "" : ": " + status));
+        m_label->setLocalPos((int)(0.5 * (a_width - m_label->getWidth())), (int)(0.5 * a_height) + 20);
+
+        double barWidth = 0.6 * a_width;
+        m_frame->setSize(barWidth, 12);
+        m_frame->setLocalPos((int)(0.2 * a_width), (int)(0.5 * a_height));
+        m_bar->setSize(cMax(1.0, progress * barWidth), 12);
+        m_bar->setLocalPos((int)(0.2 * a_width), (int)(0.5 * a_height));
+
+        m_camera->renderView(a_width, a_height);
+    }
+
+protected:
+
+    //! World, camera and widgets of the screen.
+    cWorld* m_world;
+    cCamera* m_camera;
+    cLabel* m_label;
+    cPanel* m_bar;
+    cPanel* m_frame;
+};
+
+
+//==============================================================================
+/*!
+    This function holds haptic device __a_device__ in a safe idle mode while
+    the scene is not ready: a viscous force of __a_damping__ [N s/m] against
+    its velocity, limited to __a_maxForce__ [N], and no torque nor gripper
+    force. It reads nothing but the device, so that the haptic loop can run
+    it while the world is being built. Give it the physical device
+    (\ref cGetPhysicalDevice()), so that the idle ticks are neither recorded
+    nor taken from a replayed or synthetic session.
+*/
+//==============================================================================
+inline void cHoldDeviceIdle(cGenericHapticDevicePtr a_device, double a_damping, double a_maxForce)
+{
+    cVector3d velocity;
+    a_device->getLinearVelocity(velocity);
+    cVector3d force = -a_damping * velocity;
+    double length = force.length();
+    if (length > a_maxForce)
+    {
+        force.mul(a_maxForce / length);
+    }
+    a_device->setForceAndTorqueAndGripperForce(force, cVector3d(0.0, 0.0, 0.0), 0.0);
+}
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
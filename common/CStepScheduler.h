@@ -0,0 +1,231 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CStepSchedulerH
+#define CStepSchedulerH
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CStepScheduler.h
+
+    \brief
+    Fixed simulation steps for the real time elapsed, within a time budget
+    per tick of the loop that takes them.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cStepScheduler
+    \brief
+    Fixed simulation steps for the real time elapsed, within a time budget
+    per tick of the loop that takes them.
+
+    \details
+    \ref beginTick() adds the real time elapsed since the previous tick to
+    the simulated time owed. The loop then takes steps of
+    \ref getStepSize() while \ref nextStep() returns __true__, calling
+    \ref endStep() after each one:
+
+    \code
+    scheduler.beginTick();
+    while (scheduler.nextStep())
+    {
+        // apply the forces, step the simulation by scheduler.getStepSize()
+        scheduler.endStep();
+    }
+    scheduler.endTick();
+    \endcode
+
+    A tick takes no step when less than a step is owed, and several to
+    catch up after a slow tick. Steps stop when the next one, at the
+    average cost of the last steps, would exceed the time budget of the
+    tick; the first step owed is always taken. The time still owed is then
+    carried to the next ticks, which slows the simulation down, up to
+    \ref m_maxLagSteps steps; beyond that it is dropped. The ticks whose
+    steps exceeded the budget are counted as overruns.
+
+    A loop that replays a record calls \ref beginTick(double) with the
+    period of the record instead: the budget is then ignored, so that the
+    steps depend on the ticks only and the replay is reproducible.
+*/
+//==============================================================================
+class cStepScheduler
+{
+public:
+
+    //! Constructor of cStepScheduler, with steps of __a_stepSize__ [s], a budget of __a_budget__ [s] per tick and at most __a_maxLagSteps__ steps owed.
+    cStepScheduler(double a_stepSize = 0.00025, double a_budget = 0.00015, int a_maxLagSteps = 4) :
+        m_stepSize(a_stepSize), m_budget(a_budget), m_maxLagSteps(a_maxLagSteps), m_owed(0.0), m_meanStepCost(0.0),
+        m_tickCost(0.0), m_numStepsInTick(0), m_numTicks(0), m_numSteps(0), m_maxStepsPerTick(0),
+        m_limited(true), m_numLimitedTicks(0), m_numOverruns(0), m_droppedTime(0.0) {}
+
+    //! This method sets the size of the steps [s].
+    void setStepSize(double a_stepSize) { m_stepSize = a_stepSize; }
+
+    //! This method returns the size of the steps [s].
+    double getStepSize() const { return (m_stepSize); }
+
+    //! This method sets the time budget of the steps of a tick [s].
+    void setBudget(double a_budget) { m_budget = a_budget; }
+
+    //! This method returns the time budget of the steps of a tick [s].
+    double getBudget() const { return (m_budget); }
+
+    //! This method marks the beginning of a tick and adds the real time elapsed since the previous one.
+    void beginTick()
+    {
+        clock::time_point now = clock::now();
+        double elapsed = (m_numTicks > 0) ? std::chrono::duration<double>(now - m_lastTick).count() : m_stepSize;
+        m_lastTick = now;
+        m_limited = true;
+        addTick(elapsed);
+    }
+
+    //! This method marks the beginning of a tick and adds __a_elapsed__ [s] of simulated time, such as the period of a replayed record. The steps then depend on the ticks only: the budget does not stop them.
+    void beginTick(double a_elapsed)
+    {
+        m_limited = false;
+        addTick((m_numTicks > 0) ? a_elapsed : m_stepSize);
+    }
+
+    //! This method returns __true__ if the loop should take another step in this tick.
+    bool nextStep()
+    {
+        if (m_owed < m_stepSize) { return (false); }
+        if (m_limited && (m_numStepsInTick > 0) && (m_tickCost + m_meanStepCost > m_budget))
+        {
+            m_numLimitedTicks++;
+            return (false);
+        }
+        m_stepStart = clock::now();
+        return (true);
+    }
+
+    //! This method marks the end of a step.
+    void endStep()
+    {
+        double cost = std::chrono::duration<double>(clock::now() - m_stepStart).count();
+        m_meanStepCost = (m_numSteps > 0) ? m_meanStepCost + 0.1 * (cost - m_meanStepCost) : cost;
+        m_tickCost += cost;
+        m_owed -= m_stepSize;
+        m_numStepsInTick++;
+        m_numSteps++;
+    }
+
+    //! This method marks the end of a tick.
+    void endTick()
+    {
+        m_maxStepsPerTick = std::max(m_maxStepsPerTick, m_numStepsInTick);
+        if (m_tickCost > m_budget) { m_numOverruns++; }
+    }
+
+    //! This method returns the number of steps taken in the current tick.
+    int getNumStepsInTick() const { return (m_numStepsInTick); }
+
+    //! This method returns the number of ticks whose steps exceeded the budget.
+    unsigned long getNumOverruns() const { return (m_numOverruns); }
+
+    //! This method returns the simulated time dropped [s].
+    double getDroppedTime() const { return (m_droppedTime); }
+
+    //! This method prints the steps per tick, the overruns and the time dropped.
+    void printReport(const std::string& a_title) const
+    {
+        double ticks = (double)std::max(m_numTicks, 1UL);
+        printf("%s: %lu ticks, %.2f steps of %.0f us per tick (max %d), step cost %.1f us\n", a_title.c_str(), m_numTicks,
+               (double)m_numSteps / ticks, 1e6 * m_stepSize, m_maxStepsPerTick, 1e6 * m_meanStepCost);
+        printf("budget %.0f us: %lu overruns (%.2f%%), %.2f%% of the ticks limited, %.1f ms of simulated time dropped\n",
+               1e6 * m_budget, m_numOverruns, 100.0 * (double)m_numOverruns / ticks,
+               100.0 * (double)m_numLimitedTicks / ticks, 1e3 * m_droppedTime);
+    }
+
+protected:
+
+    //! Monotonic clock used for all measurements.
+    typedef std::chrono::steady_clock clock;
+
+    //! This method begins a tick of __a_elapsed__ [s].
+    void addTick(double a_elapsed)
+    {
+        m_owed += a_elapsed;
+        m_numTicks++;
+        m_numStepsInTick = 0;
+        m_tickCost = 0.0;
+
+        // time that cannot be caught up is dropped
+        double maxLag = (double)m_maxLagSteps * m_stepSize;
+        if (m_owed > maxLag)
+        {
+            m_droppedTime += m_owed - maxLag;
+            m_owed = maxLag;
+        }
+    }
+
+    //! Size of the steps [s].
+    double m_stepSize;
+
+    //! Time budget of the steps of a tick [s].
+    double m_budget;
+
+    //! Largest number of steps owed; more is dropped.
+    int m_maxLagSteps;
+
+    //! Simulated time owed [s].
+    double m_owed;
+
+    //! Average cost of the last steps [s].
+    double m_meanStepCost;
+
+    //! Cost of the steps of the current tick [s].
+    double m_tickCost;
+
+    //! Number of steps of the current tick.
+    int m_numStepsInTick;
+
+    //! Beginning of the previous tick, and of the current step.
+    clock::time_point m_lastTick;
+    clock::time_point m_stepStart;
+
+    //! Number of ticks and of steps.
+    unsigned long m_numTicks;
+    unsigned long m_numSteps;
+
+    //! Largest number of steps in a tick.
+    int m_maxStepsPerTick;
+
+    //! __true__ if the budget stops the steps of the current tick.
+    bool m_limited;
+
+    //! Number of ticks whose steps were stopped by the budget.
+    unsigned long m_numLimitedTicks;
+
+    //! Number of ticks whose steps exceeded the budget.
+    unsigned long m_numOverruns;
+
+    //! Simulated time dropped [s].
+    double m_droppedTime;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,241 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CSyntheticHapticDeviceH
+#define CSyntheticHapticDeviceH
+//------------------------------------------------------------------------------
+#include "CRecordedHapticDevice.h"
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CSyntheticHapticDevice.h
+
+    \brief
+    Simulated haptic device driven by a scripted hand motion.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+class cSyntheticHapticDevice;
+typedef std::shared_ptr<cSyntheticHapticDevice> cSyntheticHapticDevicePtr;
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \class      cSyntheticHapticDevice
+    \brief
+    Simulated haptic device driven by a scripted hand motion.
+
+    \details
+    The handle is a point mass that receives the commanded force and is
+    pulled by a spring-damper model of the hand. The hand follows a
+    Lissajous curve around a rest point that slowly tracks the handle, so it
+    gives way to sustained forces such as the homing controller of the
+    examples while still producing continuous motion. The wrist follows a
+    scripted oscillation and ignores torques; the user switch is pressed
+    periodically.
+
+    The device advances by exactly one tick period per force command, so a
+    given sequence of commands always produces the same trajectory.
+    Specifications are close to those of a Force Dimension sigma.7.
+*/
+//==============================================================================
+class cSyntheticHapticDevice : public cSampledHapticDevice
+{
+public:
+
+    //! Constructor of cSyntheticHapticDevice.
+    cSyntheticHapticDevice(double a_tickRate = C_DEVICE_RECORD_TICK_RATE) :
+        m_timeStep(1.0 / a_tickRate),
+        m_mass(0.2),
+        m_handStiffness(150.0),
+        m_handDamping(4.0),
+        m_restTimeConstant(0.5),
+        m_amplitude(0.02),
+        m_wristAmplitude(0.25),
+        m_switchPeriod(8.0),
+        m_switchDuration(3.0),
+        m_time(0.0)
+    {
+        m_specifications.m_modelName = "synthetic";
+        m_specifications.m_manufacturerName = "CHAI3D";
+        m_specifications.m_maxLinearForce = 20.0;
+        m_specifications.m_maxAngularTorque = 0.4;
+        m_specifications.m_maxGripperForce = 8.0;
+        m_specifications.m_maxLinearStiffness = 5000.0;
+        m_specifications.m_maxAngularStiffness = 10.0;
+        m_specifications.m_maxGripperLinearStiffness = 1000.0;
+        m_specifications.m_maxLinearDamping = 20.0;
+        m_specifications.m_maxAngularDamping = 0.02;
+        m_specifications.m_maxGripperAngularDamping = 0.02;
+        m_specifications.m_workspaceRadius = 0.075;
+        m_specifications.m_gripperMaxAngleRad = cDegToRad(30.0);
+        m_specifications.m_sensedPosition = true;
+        m_specifications.m_sensedRotation = true;
+        m_specifications.m_sensedGripper = true;
+        m_specifications.m_actuatedPosition = true;
+        m_specifications.m_actuatedRotation = true;
+        m_specifications.m_actuatedGripper = true;
+        m_specifications.m_rightHand = true;
+        m_position.zero();
+        m_velocity.zero();
+        m_rest.zero();
+        m_deviceAvailable = true;
+    }
+
+    //! Destructor of cSyntheticHapticDevice.
+    virtual ~cSyntheticHapticDevice() {}
+
+    //! Shared cSyntheticHapticDevice allocator.
+    static cSyntheticHapticDevicePtr create(double a_tickRate = C_DEVICE_RECORD_TICK_RATE) { return (std::make_shared<cSyntheticHapticDevice>(a_tickRate)); }
+
+    //! This method sets the period and the pressed duration of the user switch [s]. A zero period disables it.
+    void setUserSwitchSchedule(double a_period, double a_duration) { m_switchPeriod = a_period; m_switchDuration = a_duration; }
+
+    //! This method sets the amplitude of the hand motion [m].
+    void setAmplitude(double a_amplitude) { m_amplitude = a_amplitude; }
+
+    //! This method opens the device.
+    virtual bool open() { m_deviceReady = true; return (C_SUCCESS); }
+
+    //! This method closes the device.
+    virtual bool close() { m_deviceReady = false; return (C_SUCCESS); }
+
+    //! This method calibrates the device.
+    virtual bool calibrate(bool a_forceCalibration = false) { return (C_SUCCESS); }
+
+    //! This method returns the specifications of the device.
+    virtual cHapticDeviceInfo getSpecifications() { return (m_specifications); }
+
+protected:
+
+    //! This method computes the scripted hand target at time __a_time__.
+    void getHandTarget(double a_time, cVector3d& a_position, cVector3d& a_velocity) const
+    {
+        const double w0 = 2.0 * C_PI * 0.50;
+        const double w1 = 2.0 * C_PI * 0.35;
+        const double w2 = 2.0 * C_PI * 0.20;
+        a_position.set(m_amplitude * sin(w0 * a_time),
+                       m_amplitude * sin(w1 * a_time + 0.5),
+                       m_amplitude * sin(w2 * a_time + 1.0));
+        a_velocity.set(m_amplitude * w0 * cos(w0 * a_time),
+                       m_amplitude * w1 * cos(w1 * a_time + 0.5),
+                       m_amplitude * w2 * cos(w2 * a_time + 1.0));
+        a_position += m_rest;
+    }
+
+    //! This method computes the scripted wrist orientation at time __a_time__.
+    cMatrix3d getWristRotation(double a_time) const
+    {
+        cMatrix3d rotX, rotY;
+        rotX.setAxisAngleRotationRad(cVector3d(1,0,0), m_wristAmplitude * sin(2.0 * C_PI * 0.30 * a_time));
+        rotY.setAxisAngleRotationRad(cVector3d(0,1,0), m_wristAmplitude * sin(2.0 * C_PI * 0.45 * a_time + 0.7));
+        return (rotX * rotY);
+    }
+
+    //! This method fills the sample of the current tick from the simulated state.
+    virtual void acquireSample()
+    {
+        // the angular velocity is obtained by differentiating the scripted orientation
+        cMatrix3d rot = getWristRotation(m_time);
+        cMatrix3d rotNext = getWristRotation(m_time + m_timeStep);
+        cVector3d axis;
+        double angle;
+        cMul(rotNext, cTranspose(rot)).toAxisAngle(axis, angle);
+        cVector3d angularVelocity = (angle / m_timeStep) * axis;
+
+        m_sample.m_time = m_time;
+        for (int i=0; i<3; i++)
+        {
+            m_sample.m_position[i] = m_position(i);
+            m_sample.m_linearVelocity[i] = m_velocity(i);
+            m_sample.m_angularVelocity[i] = angularVelocity(i);
+            for (int j=0; j<3; j++)
+            {
+                m_sample.m_rotation[3*i+j] = rot(i,j);
+            }
+        }
+        m_sample.m_gripperAngle = 0.0;
+        m_sample.m_gripperAngularVelocity = 0.0;
+
+        bool pressed = (m_switchPeriod > 0.0) && (fmod(m_time, m_switchPeriod) >= (m_switchPeriod - m_switchDuration));
+        m_sample.m_userSwitches = pressed ? 1 : 0;
+    }
+
+    //! This method integrates the handle dynamics over one tick.
+    virtual bool commitSample(const cVector3d& a_force, const cVector3d& a_torque, double a_gripperForce)
+    {
+        cVector3d targetPos, targetVel;
+        getHandTarget(m_time, targetPos, targetVel);
+
+        // semi-implicit Euler integration of the handle
+        cVector3d handForce = m_handStiffness * (targetPos - m_position) + m_handDamping * (targetVel - m_velocity);
+        m_velocity += (m_timeStep / m_mass) * (a_force + handForce);
+        m_position += m_timeStep * m_velocity;
+
+        // the rest point of the hand slowly follows the handle
+        m_rest += (m_timeStep / m_restTimeConstant) * (m_position - m_rest);
+
+        m_time += m_timeStep;
+        return (C_SUCCESS);
+    }
+
+protected:
+
+    //! Duration of a tick [s].
+    double m_timeStep;
+
+    //! Mass of the handle [kg].
+    double m_mass;
+
+    //! Stiffness of the hand [N/m].
+    double m_handStiffness;
+
+    //! Damping of the hand [N/(m/s)].
+    double m_handDamping;
+
+    //! Time constant with which the rest point of the hand tracks the handle [s].
+    double m_restTimeConstant;
+
+    //! Amplitude of the hand motion [m].
+    double m_amplitude;
+
+    //! Amplitude of the wrist motion [rad].
+    double m_wristAmplitude;
+
+    //! Period of the user switch [s].
+    double m_switchPeriod;
+
+    //! Duration for which the user switch is pressed in each period [s].
+    double m_switchDuration;
+
+    //! Simulated time [s].
+    double m_time;
+
+    //! Position of the handle [m].
+    cVector3d m_position;
+
+    //! Velocity of the handle [m/s].
+    cVector3d m_velocity;
+
+    //! Rest point of the hand [m].
+    cVector3d m_rest;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
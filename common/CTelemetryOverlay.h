@@ -0,0 +1,190 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CTelemetryOverlayH
+#define CTelemetryOverlayH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CHapticLoopProfiler.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CTelemetryOverlay.h
+
+    \brief
+    Text overlay of the haptic loop telemetry, formatted without allocating.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cHapticLoopMonitor
+    \brief
+    Live latency percentiles of a haptic loop.
+
+    \details
+    \ref update() copies the latency histogram of a \ref cHapticLoopProfiler
+    and computes the percentiles of the ticks run since the previous update,
+    in fixed arrays.
+*/
+//==============================================================================
+class cHapticLoopMonitor
+{
+public:
+
+    //! Constructor of cHapticLoopMonitor.
+    cHapticLoopMonitor() : m_p50(0.0), m_p99(0.0), m_max(0.0)
+    {
+        for (int i=0; i<cHapticLoopProfiler::C_NUM_LATENCY_BINS; i++) { m_previous[i] = 0; }
+    }
+
+    //! This method computes the latency percentiles of the ticks run by __a_profiler__ since the last update.
+    void update(const cHapticLoopProfiler& a_profiler)
+    {
+        a_profiler.getLatencyHistogram(m_interval);
+        for (int i=0; i<cHapticLoopProfiler::C_NUM_LATENCY_BINS; i++)
+        {
+            unsigned int count = m_interval[i];
+            m_interval[i] = count - m_previous[i];
+            m_previous[i] = count;
+        }
+        m_p50 = cHapticLoopProfiler::getHistogramPercentile(m_interval, 50.0);
+        m_p99 = cHapticLoopProfiler::getHistogramPercentile(m_interval, 99.0);
+        m_max = cHapticLoopProfiler::getHistogramPercentile(m_interval, 100.0);
+    }
+
+    //! Median, 99th percentile and maximum latency of the last interval [s].
+    double m_p50;
+    double m_p99;
+    double m_max;
+
+protected:
+
+    //! Histogram at the previous update.
+    unsigned int m_previous[cHapticLoopProfiler::C_NUM_LATENCY_BINS];
+
+    //! Histogram of the last interval.
+    unsigned int m_interval[cHapticLoopProfiler::C_NUM_LATENCY_BINS];
+};
+
+
+//==============================================================================
+/*!
+    \class      cTelemetryOverlay
+    \brief
+    Text overlay refreshed at a fixed rate.
+
+    \details
+    Building a label with cVector3d::str() and std::to_string() every frame
+    allocates several strings per frame. The overlay formats its text into
+    a fixed buffer with \ref append(), at most \ref m_refreshRate times per
+    second (\ref isRefreshDue()), and \ref applyTo() passes it to the label
+    only when it has changed, through a string whose capacity is reserved
+    once.
+*/
+//==============================================================================
+class cTelemetryOverlay
+{
+public:
+
+    //! Size of the text buffer, terminating null included.
+    static const int C_TEXT_SIZE = 512;
+
+    //! Constructor of cTelemetryOverlay.
+    cTelemetryOverlay(double a_refreshRate = 10.0) : m_length(0), m_refreshRate(a_refreshRate), m_nextRefresh(clock::now())
+    {
+        m_buffer[0] = '\0';
+        m_text.reserve(C_TEXT_SIZE);
+    }
+
+    //! This method sets the refresh rate [Hz].
+    void setRefreshRate(double a_refreshRate) { m_refreshRate = a_refreshRate; }
+
+    //! This method returns __true__ if the text should be refreshed now.
+    bool isRefreshDue()
+    {
+        clock::time_point now = clock::now();
+        if (now < m_nextRefresh) { return (false); }
+        m_nextRefresh = now + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / m_refreshRate));
+        return (true);
+    }
+
+    //! This method clears the text.
+    void clear()
+    {
+        m_length = 0;
+        m_buffer[0] = '\0';
+    }
+
+    //! This method appends text formatted as printf() does; the text is truncated to the buffer.
+    void append(const char* a_format, ...)
+    {
+        if (m_length >= C_TEXT_SIZE - 1) { return; }
+        va_list args;
+        va_start(args, a_format);
+        int length = vsnprintf(m_buffer + m_length, C_TEXT_SIZE - m_length, a_format, args);
+        va_end(args);
+        if (length > 0) { m_length = std::min(m_length + length, C_TEXT_SIZE - 1); }
+    }
+
+    //! This method appends vector __a_vector__ with __a_precision__ decimals, as cVector3d::str() does.
+    void appendVector(const cVector3d& a_vector, int a_precision)
+    {
+        append("%.*f, %.*f, %.*f", a_precision, a_vector(0), a_precision, a_vector(1), a_precision, a_vector(2));
+    }
+
+    //! This method returns the text.
+    const char* getText() const { return (m_buffer); }
+
+    //! This method sets the text of label __a_label__ if it has changed.
+    void applyTo(cLabel* a_label)
+    {
+        if (m_text.compare(m_buffer) == 0) { return; }
+        m_text.assign(m_buffer, m_length);
+        a_label->setText(m_text);
+    }
+
+protected:
+
+    //! Monotonic clock used for the refresh rate.
+    typedef std::chrono::steady_clock clock;
+
+    //! Text being formatted.
+    char m_buffer[C_TEXT_SIZE];
+
+    //! Length of the text.
+    int m_length;
+
+    //! Text last passed to the label.
+    std::string m_text;
+
+    //! Refresh rate [Hz].
+    double m_refreshRate;
+
+    //! Time of the next refresh.
+    clock::time_point m_nextRefresh;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,65 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CThreadAffinityH
+#define CThreadAffinityH
+//------------------------------------------------------------------------------
+#include <thread>
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CThreadAffinity.h
+
+    \brief
+    Pins the calling thread to a core.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+
+//! This function returns the number of cores of the machine (at least 1).
+inline int cGetNumCores()
+{
+    unsigned int numCores = std::thread::hardware_concurrency();
+    return ((numCores > 0) ? (int)numCores : 1);
+}
+
+//! This function pins the calling thread to core __a_core__. It returns __false__ if the system does not support it.
+inline bool cSetCurrentThreadAffinity(int a_core)
+{
+#if defined(_WIN32)
+    return (SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << a_core) != 0);
+#elif defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(a_core, &cpuSet);
+    return (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0);
+#else
+    // macOS only supports affinity hints between threads
+    return (false);
+#endif
+}
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
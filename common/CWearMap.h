@@ -0,0 +1,424 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CWearMapH
+#define CWearMapH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+#include "CDistanceField.h"
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CWearMap.h
+
+    \brief
+    Per-triangle wear of a mesh, accumulated by the haptic loop and shown as
+    vertex colors.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cWearMap
+    \brief
+    Per-triangle wear of a mesh, accumulated by the haptic loop and shown as
+    vertex colors.
+
+    \details
+    The wear of a triangle is the pressure applied to it integrated over
+    time [Pa s]: the force of each contact on the triangle, divided by the
+    area of the triangle, times the duration of the tick. The haptic loop
+    adds the contacts of a haptic point with \ref addContacts(). Each contact
+    costs a search among the meshes and one atomic add to a 64-bit
+    fixed-point counter, so that the accumulation stays within a few
+    hundred nanoseconds per tick and never waits for the graphics thread.
+
+    Contacts found by another solver, such as those of a physics engine,
+    have a position but no triangle. After \ref initContactSearch(), which
+    sorts the triangles into cells of a grid, \ref addContactAt() adds such
+    a contact to the triangle nearest to it among those of its cell.
+
+    The graphics thread calls \ref updateColors() at a lower rate. It maps
+    the wear of each vertex (the largest wear of its triangles) to one of
+    \ref C_WEAR_LEVELS colors, from unworn to saturated, and only recolors
+    the vertices whose level changed. It also computes the area of the
+    mesh that has been touched (the coverage).
+
+    The wear may be shown on another mesh than the one touched, such as
+    the full mesh of an object that collides through a simplified copy:
+    \ref init() then takes the display mesh and the vertex of the touched
+    mesh that each of its vertices maps to.
+*/
+//==============================================================================
+class cWearMap
+{
+public:
+
+    //! Number of color levels of the wear map.
+    static const int C_WEAR_LEVELS = 32;
+
+    //! Constructor of cWearMap.
+    cWearMap() : m_multiMesh(NULL), m_displayMesh(NULL), m_vertexMap(NULL), m_numTriangles(0), m_numVertices(0), m_saturation(1e6), m_totalArea(0.0), m_coveredArea(0.0), m_cellSize(0.0)
+    {
+        m_unwornColor.set(0.8f, 0.8f, 0.8f);
+        m_wornColor.set(1.0f, 0.3f, 0.0f);
+    }
+
+    //! This method sets up the wear map of the triangles of __a_multiMesh__, shown on __a_displayMesh__ (by default __a_multiMesh__), and colors the vertices shown as unworn.
+    /*!
+        \param  a_multiMesh    Mesh whose triangles are touched.
+        \param  a_displayMesh  Mesh showing the wear, or __NULL__.
+        \param  a_vertexMap    For each vertex of __a_displayMesh__, mesh after mesh, the vertex of __a_multiMesh__ it shows, mesh after mesh. Must outlive the wear map.
+    */
+    void init(cMultiMesh* a_multiMesh, cMultiMesh* a_displayMesh = NULL, const std::vector<unsigned int>* a_vertexMap = NULL)
+    {
+        m_multiMesh = a_multiMesh;
+        m_displayMesh = (a_displayMesh != NULL) ? a_displayMesh : a_multiMesh;
+        m_vertexMap = (a_displayMesh != NULL) ? a_vertexMap : NULL;
+        m_meshes.clear();
+        m_invAreas.clear();
+        m_totalArea = 0.0;
+        m_coveredArea = 0.0;
+
+        size_t offset = 0;
+        size_t vertexOffset = 0;
+        for (int m=0; m<a_multiMesh->getNumMeshes(); m++)
+        {
+            cMesh* mesh = a_multiMesh->getMesh(m);
+            cWearMesh wearMesh;
+            wearMesh.m_mesh = mesh;
+            wearMesh.m_triangles = mesh->m_triangles.get();
+            wearMesh.m_offset = offset;
+            wearMesh.m_numTriangles = (size_t)mesh->getNumTriangles();
+            wearMesh.m_vertexOffset = vertexOffset;
+            m_meshes.push_back(wearMesh);
+
+            for (size_t i=0; i<wearMesh.m_numTriangles; i++)
+            {
+                cVector3d v0 = mesh->m_vertices->getLocalPos(mesh->m_triangles->getVertexIndex0((unsigned int)i));
+                cVector3d v1 = mesh->m_vertices->getLocalPos(mesh->m_triangles->getVertexIndex1((unsigned int)i));
+                cVector3d v2 = mesh->m_vertices->getLocalPos(mesh->m_triangles->getVertexIndex2((unsigned int)i));
+                double area = 0.5 * cCross(v1 - v0, v2 - v0).length();
+                m_invAreas.push_back((area > 0.0) ? 1.0 / area : 0.0);
+                m_totalArea += area;
+            }
+            offset += wearMesh.m_numTriangles;
+            vertexOffset += (size_t)mesh->getNumVertices();
+        }
+
+        m_numTriangles = offset;
+        m_numVertices = vertexOffset;
+        m_wear.reset(new std::atomic<uint64_t>[m_numTriangles]);
+        for (size_t i=0; i<m_numTriangles; i++) { m_wear[i].store(0, std::memory_order_relaxed); }
+        m_shownWear.assign(m_numTriangles, 0);
+
+        size_t numShown = 0;
+        for (int m=0; m<m_displayMesh->getNumMeshes(); m++)
+        {
+            cMesh* mesh = m_displayMesh->getMesh(m);
+            for (int i=0; i<mesh->getNumVertices(); i++)
+            {
+                mesh->m_vertices->setColor(i, m_unwornColor);
+            }
+            numShown += (size_t)mesh->getNumVertices();
+        }
+        m_shownLevels.assign(numShown, 0);
+
+        m_displayMesh->setUseVertexColors(true);
+        m_displayMesh->markForUpdate(false);
+    }
+
+    //! This method adds a force of __a_force__ [N] during __a_duration__ [s] to triangle __a_index__ of triangle array __a_triangles__. Contacts on other meshes are ignored.
+    inline void addContact(const cTriangleArray* a_triangles, int a_index, double a_force, double a_duration)
+    {
+        for (size_t m=0; m<m_meshes.size(); m++)
+        {
+            const cWearMesh& mesh = m_meshes[m];
+            if (mesh.m_triangles != a_triangles) { continue; }
+            if ((a_index < 0) || ((size_t)a_index >= mesh.m_numTriangles)) { return; }
+
+            size_t triangle = mesh.m_offset + (size_t)a_index;
+            double wear = a_force * a_duration * m_invAreas[triangle];
+            m_wear[triangle].fetch_add((uint64_t)(C_WEAR_UNITS * wear + 0.5), std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    //! This method adds the contacts of haptic point __a_point__ during __a_duration__ [s]; its force is shared among them.
+    inline void addContacts(cHapticPoint* a_point, double a_duration)
+    {
+        int numEvents = a_point->getNumCollisionEvents();
+        if (numEvents < 1) { return; }
+
+        double force = a_point->getLastComputedForce().length() / (double)numEvents;
+        for (int i=0; i<numEvents; i++)
+        {
+            const cCollisionEvent* event = a_point->getCollisionEvent(i);
+            addContact(event->m_triangles.get(), event->m_index, force, a_duration);
+        }
+    }
+
+    //! This method sorts the triangles into cells of size __a_cellSize__ for \ref addContactAt(), which matches a contact with a triangle within that distance.
+    void initContactSearch(double a_cellSize)
+    {
+        m_cellSize = a_cellSize;
+        m_cells.clear();
+        m_vertices.clear();
+        m_triangleVertices.clear();
+        if ((m_multiMesh == NULL) || (a_cellSize <= 0.0)) { return; }
+
+        // triangles in the frame of the multi mesh, numbered mesh after mesh
+        // as their wear
+        cGetMeshTriangles(m_multiMesh, m_vertices, m_triangleVertices);
+        for (size_t t=0; t+2<m_triangleVertices.size(); t+=3)
+        {
+            const cVector3d& a = m_vertices[m_triangleVertices[t]];
+            const cVector3d& b = m_vertices[m_triangleVertices[t+1]];
+            const cVector3d& c = m_vertices[m_triangleVertices[t+2]];
+            int first[3], last[3];
+            for (int k=0; k<3; k++)
+            {
+                first[k] = getCell(cMin(a(k), cMin(b(k), c(k))) - m_cellSize);
+                last[k] = getCell(cMax(a(k), cMax(b(k), c(k))) + m_cellSize);
+            }
+            for (int z=first[2]; z<=last[2]; z++)
+            {
+                for (int y=first[1]; y<=last[1]; y++)
+                {
+                    for (int x=first[0]; x<=last[0]; x++)
+                    {
+                        m_cells[getKey(x, y, z)].push_back((unsigned int)(t / 3));
+                    }
+                }
+            }
+        }
+    }
+
+    //! This method adds a force of __a_force__ [N] during __a_duration__ [s] at __a_pos__, in the frame of the mesh touched, to the triangle nearest to it. It returns __false__ if no triangle is within the cell size of \ref initContactSearch().
+    inline bool addContactAt(const cVector3d& a_pos, double a_force, double a_duration)
+    {
+        if (m_cells.empty()) { return (false); }
+        std::unordered_map<unsigned long long, std::vector<unsigned int> >::const_iterator cell =
+            m_cells.find(getKey(getCell(a_pos(0)), getCell(a_pos(1)), getCell(a_pos(2))));
+        if (cell == m_cells.end()) { return (false); }
+
+        size_t nearest = m_numTriangles;
+        double nearestDistance = m_cellSize * m_cellSize;
+        for (size_t i=0; i<cell->second.size(); i++)
+        {
+            size_t t = 3 * (size_t)cell->second[i];
+            cVector3d closest = cSparseDistanceField::getClosestPoint(a_pos, m_vertices[m_triangleVertices[t]],
+                                                                      m_vertices[m_triangleVertices[t+1]], m_vertices[m_triangleVertices[t+2]]);
+            double distance = (closest - a_pos).lengthsq();
+            if (distance <= nearestDistance)
+            {
+                nearestDistance = distance;
+                nearest = (size_t)cell->second[i];
+            }
+        }
+        if (nearest == m_numTriangles) { return (false); }
+
+        double wear = a_force * a_duration * m_invAreas[nearest];
+        m_wear[nearest].fetch_add((uint64_t)(C_WEAR_UNITS * wear + 0.5), std::memory_order_relaxed);
+        return (true);
+    }
+
+    //! This method returns the number of triangles of the wear map.
+    size_t getNumTriangles() const { return (m_numTriangles); }
+
+    //! This method returns the wear of triangle __a_triangle__ [Pa s], triangles numbered mesh after mesh.
+    double getWear(size_t a_triangle) const
+    {
+        return ((double)m_wear[a_triangle].load(std::memory_order_relaxed) / C_WEAR_UNITS);
+    }
+
+    //! This method sets the wear [Pa s] shown with the color of the most worn areas.
+    void setSaturation(double a_saturation) { m_saturation = a_saturation; }
+
+    //! This method returns the wear [Pa s] shown with the color of the most worn areas.
+    double getSaturation() const { return (m_saturation); }
+
+    //! This method updates the colors of the vertices from the wear. It returns __true__ if a color changed, in which case the mesh must be updated.
+    bool updateColors()
+    {
+        bool changed = false;
+        m_coveredArea = 0.0;
+        double levelScale = (double)(C_WEAR_LEVELS - 1) / m_saturation;
+
+        // level of each vertex: the largest of its triangles
+        m_vertexLevels.assign(m_numVertices, 0);
+        for (size_t m=0; m<m_meshes.size(); m++)
+        {
+            const cWearMesh& wearMesh = m_meshes[m];
+            cMesh* mesh = wearMesh.m_mesh;
+            unsigned char* levels = m_vertexLevels.data() + wearMesh.m_vertexOffset;
+            for (size_t i=0; i<wearMesh.m_numTriangles; i++)
+            {
+                size_t triangle = wearMesh.m_offset + i;
+                uint64_t value = m_wear[triangle].load(std::memory_order_relaxed);
+                m_shownWear[triangle] = value;
+                if (value == 0) { continue; }
+                m_coveredArea += 1.0 / m_invAreas[triangle];
+
+                double level = 1.0 + levelScale * (double)value / C_WEAR_UNITS;
+                unsigned char l = (unsigned char)cMin(level, (double)(C_WEAR_LEVELS - 1));
+                unsigned int v0 = mesh->m_triangles->getVertexIndex0((unsigned int)i);
+                unsigned int v1 = mesh->m_triangles->getVertexIndex1((unsigned int)i);
+                unsigned int v2 = mesh->m_triangles->getVertexIndex2((unsigned int)i);
+                levels[v0] = cMax(levels[v0], l);
+                levels[v1] = cMax(levels[v1], l);
+                levels[v2] = cMax(levels[v2], l);
+            }
+        }
+
+        // recolor the vertices shown whose level changed
+        size_t shown = 0;
+        for (int m=0; (m_displayMesh != NULL) && (m<m_displayMesh->getNumMeshes()); m++)
+        {
+            cMesh* mesh = m_displayMesh->getMesh(m);
+            for (int i=0; i<mesh->getNumVertices(); i++, shown++)
+            {
+                size_t vertex = (m_vertexMap != NULL) ? (size_t)(*m_vertexMap)[shown] : shown;
+                unsigned char level = (vertex < m_numVertices) ? m_vertexLevels[vertex] : 0;
+                if (level == m_shownLevels[shown]) { continue; }
+                m_shownLevels[shown] = level;
+                mesh->m_vertices->setColor(i, getLevelColor(level));
+                changed = true;
+            }
+        }
+
+        if (changed)
+        {
+            m_displayMesh->markForUpdate(false);
+        }
+        return (changed);
+    }
+
+    //! This method returns the fraction of the area of the mesh touched, as of the last \ref updateColors().
+    double getCoverage() const { return ((m_totalArea > 0.0) ? m_coveredArea / m_totalArea : 0.0); }
+
+    //! This method returns the largest wear [Pa s], as of the last \ref updateColors().
+    double getMaxWear() const
+    {
+        uint64_t value = 0;
+        for (size_t i=0; i<m_shownWear.size(); i++) { value = cMax(value, m_shownWear[i]); }
+        return ((double)value / C_WEAR_UNITS);
+    }
+
+    //! This method clears the wear. Contacts added meanwhile may be lost.
+    void reset()
+    {
+        for (size_t i=0; i<m_numTriangles; i++) { m_wear[i].store(0, std::memory_order_relaxed); }
+    }
+
+protected:
+
+    //! Fixed-point units of the wear counters, per Pa s.
+    static constexpr double C_WEAR_UNITS = 1000.0;
+
+    //! Triangles of one mesh in the wear map.
+    struct cWearMesh
+    {
+        cMesh* m_mesh;
+        const cTriangleArray* m_triangles;
+        size_t m_offset;
+        size_t m_numTriangles;
+        size_t m_vertexOffset;
+    };
+
+    //! This method returns the cell of coordinate __a_coordinate__ along an axis.
+    int getCell(double a_coordinate) const { return ((int)floor(a_coordinate / m_cellSize)); }
+
+    //! This method returns the hash key of cell __a_x__, __a_y__, __a_z__ (21 bits each, wrapping around).
+    static unsigned long long getKey(int a_x, int a_y, int a_z)
+    {
+        return ((unsigned long long)(a_x & 0x1fffff) |
+                ((unsigned long long)(a_y & 0x1fffff) << 21) |
+                ((unsigned long long)(a_z & 0x1fffff) << 42));
+    }
+
+    //! This method returns the color of wear level __a_level__.
+    cColorf getLevelColor(unsigned char a_level) const
+    {
+        if (a_level == 0) { return (m_unwornColor); }
+        float t = (float)a_level / (float)(C_WEAR_LEVELS - 1);
+        return (cColorf(m_unwornColor.getR() + t * (m_wornColor.getR() - m_unwornColor.getR()),
+                        m_unwornColor.getG() + t * (m_wornColor.getG() - m_unwornColor.getG()),
+                        m_unwornColor.getB() + t * (m_wornColor.getB() - m_unwornColor.getB())));
+    }
+
+    //! Mesh whose triangles are touched, and mesh showing the wear.
+    cMultiMesh* m_multiMesh;
+    cMultiMesh* m_displayMesh;
+
+    //! Vertex of the wear map shown by each vertex of the display mesh, or __NULL__ if the same mesh.
+    const std::vector<unsigned int>* m_vertexMap;
+
+    //! Meshes of the wear map.
+    std::vector<cWearMesh> m_meshes;
+
+    //! Number of triangles and of vertices.
+    size_t m_numTriangles;
+    size_t m_numVertices;
+
+    //! Wear of each triangle, in fixed-point units.
+    std::unique_ptr<std::atomic<uint64_t>[]> m_wear;
+
+    //! Inverse of the area of each triangle [1/m^2].
+    std::vector<double> m_invAreas;
+
+    //! Wear of each triangle as of the last update of the colors.
+    std::vector<uint64_t> m_shownWear;
+
+    //! Level of each vertex, mesh after mesh.
+    std::vector<unsigned char> m_vertexLevels;
+
+    //! Level shown by each vertex of the display mesh.
+    std::vector<unsigned char> m_shownLevels;
+
+    //! Wear shown with the worn color [Pa s].
+    double m_saturation;
+
+    //! Colors of the unworn and of the most worn areas.
+    cColorf m_unwornColor;
+    cColorf m_wornColor;
+
+    //! Area of the mesh, and area touched [m^2].
+    double m_totalArea;
+    double m_coveredArea;
+
+    //! Size of the cells of the contact search.
+    double m_cellSize;
+
+    //! Triangles of each cell of the contact search, by hash key.
+    std::unordered_map<unsigned long long, std::vector<unsigned int> > m_cells;
+
+    //! Vertices of the triangles, and vertices of each triangle (three each), in the frame of the mesh touched.
+    std::vector<cVector3d> m_vertices;
+    std::vector<unsigned int> m_triangleVertices;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,185 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CWorkspaceConstraintH
+#define CWorkspaceConstraintH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define C_WORKSPACE_CONSTRAINT_SSE2
+#endif
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CWorkspaceConstraint.h
+
+    \brief
+    Penalty force that keeps the haptic device inside a virtual workspace.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cWorkspaceConstraint
+    \brief
+    Penalty force that keeps the haptic device inside a virtual workspace.
+
+    \details
+    The virtual workspace is a box, a sphere or an ellipsoid centered on the
+    initial device position rd0. When the device leaves it, a spring of
+    stiffness \ref m_stiffness pulls it back towards the closest point of
+    the box, towards the sphere, or radially towards the ellipsoid surface.
+
+    The force is computed with clamp arithmetic (min/max) instead of
+    per-axis tests, using SSE2 when it is available, so its cost does not
+    depend on where the device is.
+*/
+//==============================================================================
+class cWorkspaceConstraint
+{
+public:
+
+    //! Shapes of the virtual workspace.
+    enum Shape { BOX = 0, SPHERE = 1, ELLIPSOID = 2 };
+
+    //! Constructor of cWorkspaceConstraint. The default workspace is a cube of half-size __a_R__.
+    cWorkspaceConstraint(double a_R = 0.025, double a_stiffness = 0.0)
+    {
+        setBox(cVector3d(a_R, a_R, a_R), a_stiffness);
+    }
+
+    //! This method sets a box workspace of half-extents __a_halfExtents__.
+    void setBox(const cVector3d& a_halfExtents, double a_stiffness)
+    {
+        set(BOX, a_halfExtents, a_stiffness);
+    }
+
+    //! This method sets a sphere workspace of radius __a_radius__.
+    void setSphere(double a_radius, double a_stiffness)
+    {
+        set(SPHERE, cVector3d(a_radius, a_radius, a_radius), a_stiffness);
+    }
+
+    //! This method sets an ellipsoid workspace of semi-axes __a_semiAxes__.
+    void setEllipsoid(const cVector3d& a_semiAxes, double a_stiffness)
+    {
+        set(ELLIPSOID, a_semiAxes, a_stiffness);
+    }
+
+    //! This method sets the shape __a_shape__ and extents __a_extents__ of the workspace.
+    void set(Shape a_shape, const cVector3d& a_extents, double a_stiffness)
+    {
+        m_shape = a_shape;
+        m_stiffness = a_stiffness;
+        for (int i=0; i<3; i++)
+        {
+            m_extents[i] = a_extents(i);
+            m_invExtents[i] = 1.0 / a_extents(i);
+        }
+    }
+
+    //! This method returns the shape of the workspace.
+    Shape getShape() const { return (m_shape); }
+
+    //! This method returns the extents of the workspace (half-extents or semi-axes).
+    cVector3d getExtents() const { return (cVector3d(m_extents[0], m_extents[1], m_extents[2])); }
+
+    //! This method returns the stiffness of the constraint [N/m].
+    double getStiffness() const { return (m_stiffness); }
+
+    //! This method computes the force __a_force__ for the device position __a_devicePosRel__ relative to rd0.
+    inline void computeForce(const cVector3d& a_devicePosRel, cVector3d& a_force) const
+    {
+        switch (m_shape)
+        {
+        case SPHERE :    computeSphereForce(a_devicePosRel, a_force); break;
+        case ELLIPSOID : computeEllipsoidForce(a_devicePosRel, a_force); break;
+        default :        computeBoxForce(a_devicePosRel, a_force); break;
+        }
+    }
+
+    //! This method computes the force of a box workspace.
+    inline void computeBoxForce(const cVector3d& a_devicePosRel, cVector3d& a_force) const
+    {
+#if defined(C_WORKSPACE_CONSTRAINT_SSE2)
+        // penetration = p - clamp(p, -h, h), two axes per register
+        const __m128d k = _mm_set1_pd(-m_stiffness);
+        __m128d p01 = _mm_set_pd(a_devicePosRel(1), a_devicePosRel(0));
+        __m128d p2  = _mm_set_sd(a_devicePosRel(2));
+        __m128d h01 = _mm_loadu_pd(m_extents);
+        __m128d h2  = _mm_load_sd(m_extents + 2);
+        __m128d c01 = _mm_min_pd(_mm_max_pd(p01, _mm_sub_pd(_mm_setzero_pd(), h01)), h01);
+        __m128d c2  = _mm_min_sd(_mm_max_sd(p2, _mm_sub_sd(_mm_setzero_pd(), h2)), h2);
+        double f[3];
+        _mm_storeu_pd(f, _mm_mul_pd(k, _mm_sub_pd(p01, c01)));
+        _mm_store_sd(f + 2, _mm_mul_sd(k, _mm_sub_sd(p2, c2)));
+        a_force.set(f[0], f[1], f[2]);
+#else
+        double f[3];
+        for (int i=0; i<3; i++)
+        {
+            double p = a_devicePosRel(i);
+            f[i] = -m_stiffness * (p - std::min(std::max(p, -m_extents[i]), m_extents[i]));
+        }
+        a_force.set(f[0], f[1], f[2]);
+#endif
+    }
+
+    //! This method computes the force of a sphere workspace.
+    inline void computeSphereForce(const cVector3d& a_devicePosRel, cVector3d& a_force) const
+    {
+        // the device is pulled back radially by its distance to the sphere
+        double r = a_devicePosRel.length();
+        double scale = -m_stiffness * std::max(r - m_extents[0], 0.0) / std::max(r, C_SMALL);
+        a_force.set(scale * a_devicePosRel(0), scale * a_devicePosRel(1), scale * a_devicePosRel(2));
+    }
+
+    //! This method computes the force of an ellipsoid workspace.
+    inline void computeEllipsoidForce(const cVector3d& a_devicePosRel, cVector3d& a_force) const
+    {
+        // s is the ellipsoidal radius of the device, 1 on the surface; the
+        // device is pulled back radially to the point p/s of the surface
+        double q0 = a_devicePosRel(0) * m_invExtents[0];
+        double q1 = a_devicePosRel(1) * m_invExtents[1];
+        double q2 = a_devicePosRel(2) * m_invExtents[2];
+        double s = sqrt(q0*q0 + q1*q1 + q2*q2);
+        double scale = -m_stiffness * std::max(1.0 - 1.0 / std::max(s, C_SMALL), 0.0);
+        a_force.set(scale * a_devicePosRel(0), scale * a_devicePosRel(1), scale * a_devicePosRel(2));
+    }
+
+protected:
+
+    //! Shape of the workspace.
+    Shape m_shape;
+
+    //! Stiffness of the constraint [N/m].
+    double m_stiffness;
+
+    //! Half-extents of the box, radius of the sphere or semi-axes of the ellipsoid [m].
+    double m_extents[3];
+
+    //! Inverse of the extents [1/m].
+    double m_invExtents[3];
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
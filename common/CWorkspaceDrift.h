@@ -0,0 +1,401 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CWorkspaceDriftH
+#define CWorkspaceDriftH
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CWorkspaceDrift.h
+
+    \brief
+    Translational workspace drift controllers of the TransMap example.
+
+    \details
+    A controller maps the position rd and velocity vd of the device to the
+    avatar position and velocity, moves the center rw of the avatar
+    workspace and computes the drift force that pulls the hand back towards
+    the initial device position rd0.
+
+    \ref cDriftController is composed at compile time from three policies:
+    the drift factor (\ref cConstantDriftGain, \ref cEdgeDriftGain), the
+    rate control on the workspace boundaries (\ref cNoRateControl,
+    \ref cBubbleRateControl) and the scale factor (\ref cFixedScale,
+    \ref cExpansionScale). The policies are plain classes, so every
+    combination is fully inlined in the haptic loop. The variants of the
+    example are:
+
+    - \ref cTranslationalDrift: drift velocity proportional to the device
+      speed and to the distance from rd0.
+    - \ref cEdgeGainDrift: same drift with a larger drift factor on the edges
+      of the device workspace.
+    - \ref cBubbleDrift: drift inside the device workspace, rate control on
+      its boundaries.
+    - \ref cExpansionDrift: drift with a scale factor that grows with the
+      distance from rd0.
+
+    The controllers only compute; setting the tool and the scene is left to
+    the haptic loop.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \struct     cWorkspaceDriftState
+    \brief
+    State and outputs of a workspace drift controller, in device coordinates.
+*/
+//==============================================================================
+struct cWorkspaceDriftState
+{
+    //! Initial position of the haptic device (rd0).
+    cVector3d m_devicePosIni;
+
+    //! Position of the avatar workspace (rw).
+    cVector3d m_wsCenter;
+
+    //! Velocity of the avatar workspace.
+    cVector3d m_wsCenterVel;
+
+    //! Scale factor between the device and the avatar workspaces.
+    double m_workspaceScaleFactor;
+
+    //! Relative position of the haptic device (rd-rd0).
+    cVector3d m_devicePosRel;
+
+    //! Drift velocity.
+    cVector3d m_driftVel;
+
+    //! Avatar velocity.
+    cVector3d m_avatarVel;
+
+    //! Avatar position.
+    cVector3d m_avatarPos;
+
+    //! Drift force to add to the device.
+    cVector3d m_driftForce;
+
+    //! __true__ if the last update used rate control instead of drift.
+    bool m_rateControl;
+
+    //! Constructor of cWorkspaceDriftState.
+    cWorkspaceDriftState() : m_workspaceScaleFactor(1.0), m_rateControl(false)
+    {
+        m_devicePosIni.zero();
+        m_wsCenter.zero();
+        m_wsCenterVel.zero();
+        m_devicePosRel.zero();
+        m_driftVel.zero();
+        m_avatarVel.zero();
+        m_avatarPos.zero();
+        m_driftForce.zero();
+    }
+};
+
+
+//------------------------------------------------------------------------------
+
+//! This function returns __true__ if __a_devicePosRel__ lies on or outside the cube of half-size __a_R__.
+inline bool cIsOnWorkspaceEdge(const cVector3d& a_devicePosRel, double a_R)
+{
+    return ((a_devicePosRel(0) >= a_R) || (a_devicePosRel(0) <= -a_R) ||
+            (a_devicePosRel(1) >= a_R) || (a_devicePosRel(1) <= -a_R) ||
+            (a_devicePosRel(2) >= a_R) || (a_devicePosRel(2) <= -a_R));
+}
+
+
+//==============================================================================
+/*!
+    \class      cConstantDriftGain
+    \brief
+    Drift factor policy: the same drift factor everywhere.
+*/
+//==============================================================================
+class cConstantDriftGain
+{
+public:
+
+    //! Constructor of cConstantDriftGain.
+    cConstantDriftGain(double a_Kd = 0.2) : m_Kd(a_Kd) {}
+
+    //! This method returns the drift factor at relative device position __a_devicePosRel__.
+    inline double getDriftFactor(const cVector3d& a_devicePosRel, double a_R) const { return (m_Kd); }
+
+public:
+
+    //! Drift factor.
+    double m_Kd;
+};
+
+
+//==============================================================================
+/*!
+    \class      cEdgeDriftGain
+    \brief
+    Drift factor policy: a larger drift factor on the workspace edge.
+*/
+//==============================================================================
+class cEdgeDriftGain
+{
+public:
+
+    //! Constructor of cEdgeDriftGain.
+    cEdgeDriftGain(double a_Kd = 0.2, double a_KdEdge = 0.8) : m_Kd(a_Kd), m_KdEdge(a_KdEdge) {}
+
+    //! This method returns the drift factor at relative device position __a_devicePosRel__.
+    inline double getDriftFactor(const cVector3d& a_devicePosRel, double a_R) const
+    {
+        return (cIsOnWorkspaceEdge(a_devicePosRel, a_R) ? m_KdEdge : m_Kd);
+    }
+
+public:
+
+    //! Drift factor inside the workspace.
+    double m_Kd;
+
+    //! Drift factor on the workspace edge.
+    double m_KdEdge;
+};
+
+
+//==============================================================================
+/*!
+    \class      cNoRateControl
+    \brief
+    Rate control policy: drift everywhere.
+*/
+//==============================================================================
+class cNoRateControl
+{
+public:
+
+    //! This method returns __true__ if rate control applies at relative device position __a_devicePosRel__.
+    inline bool isActive(const cVector3d& a_devicePosRel, double a_R) const { return (false); }
+
+    //! This method returns the rate-control factor.
+    inline double getRateFactor() const { return (0.0); }
+};
+
+
+//==============================================================================
+/*!
+    \class      cBubbleRateControl
+    \brief
+    Rate control policy: the avatar workspace moves towards the device when
+    the device reaches the workspace boundaries (bubble technique).
+*/
+//==============================================================================
+class cBubbleRateControl
+{
+public:
+
+    //! Constructor of cBubbleRateControl.
+    cBubbleRateControl(double a_Kb = 0.05) : m_Kb(a_Kb) {}
+
+    //! This method returns __true__ if rate control applies at relative device position __a_devicePosRel__.
+    inline bool isActive(const cVector3d& a_devicePosRel, double a_R) const { return (cIsOnWorkspaceEdge(a_devicePosRel, a_R)); }
+
+    //! This method returns the rate-control factor.
+    inline double getRateFactor() const { return (m_Kb); }
+
+public:
+
+    //! Rate-control factor.
+    double m_Kb;
+};
+
+
+//==============================================================================
+/*!
+    \class      cFixedScale
+    \brief
+    Scale factor policy: the scale factor set at initialization is kept.
+*/
+//==============================================================================
+class cFixedScale
+{
+public:
+
+    //! This method updates the scale factor of __a_state__.
+    inline void updateScale(cWorkspaceDriftState& a_state, double a_R) const {}
+
+    //! This method returns __true__ if the scale factor changes at run time.
+    static bool isVariable() { return (false); }
+};
+
+
+//==============================================================================
+/*!
+    \class      cExpansionScale
+    \brief
+    Scale factor policy: the scale factor grows with the distance from rd0
+    so that the device workspace edge reaches the virtual environment radius.
+*/
+//==============================================================================
+class cExpansionScale
+{
+public:
+
+    //! Constructor of cExpansionScale.
+    cExpansionScale(double a_workspaceScaleFactorIni = 1.0, double a_Re = 1.0) :
+        m_workspaceScaleFactorIni(a_workspaceScaleFactorIni), m_Re(a_Re) {}
+
+    //! This method updates the scale factor of __a_state__.
+    inline void updateScale(cWorkspaceDriftState& a_state, double a_R) const
+    {
+        // modification of the scaling factor according to the relative position
+        a_state.m_workspaceScaleFactor = (m_workspaceScaleFactorIni + (a_state.m_devicePosRel.length()/a_R)*(1.1*m_Re/a_R-m_workspaceScaleFactorIni));
+    }
+
+    //! This method returns __true__ if the scale factor changes at run time.
+    static bool isVariable() { return (true); }
+
+public:
+
+    //! Scale factor at the initial device position.
+    double m_workspaceScaleFactorIni;
+
+    //! Virtual environment radius.
+    double m_Re;
+};
+
+
+//==============================================================================
+/*!
+    \class      cDriftController
+    \brief
+    Workspace drift controller composed of a drift factor, a rate control
+    and a scale factor policy.
+*/
+//==============================================================================
+template <class TGain, class TRate, class TScale>
+class cDriftController
+{
+public:
+
+    //! Constructor of cDriftController.
+    cDriftController(double a_Kv, double a_R, double a_maxLinearForce,
+                     const TGain& a_gain = TGain(), const TRate& a_rate = TRate(), const TScale& a_scale = TScale(),
+                     double a_tickRate = 4000.0) :
+        m_gain(a_gain), m_rate(a_rate), m_scale(a_scale),
+        m_Kv(a_Kv), m_R(a_R), m_maxLinearForce(a_maxLinearForce), m_tickRate(a_tickRate) {}
+
+    //! This method returns __true__ if the scale factor changes at run time.
+    static bool hasVariableScale() { return (TScale::isVariable()); }
+
+    //! This method updates the controller from the device position and velocity.
+    inline void update(cWorkspaceDriftState& a_state, const cVector3d& a_devicePos, const cVector3d& a_deviceVel) const
+    {
+        // calculation of the device relative position
+        a_state.m_devicePosRel = a_devicePos-a_state.m_devicePosIni;
+
+        m_scale.updateScale(a_state, m_R);
+
+        if (m_rate.isActive(a_state.m_devicePosRel, m_R))
+        {
+            rateControl(a_state);
+        }
+        else
+        {
+            drift(a_state, a_deviceVel, m_gain.getDriftFactor(a_state.m_devicePosRel, m_R));
+        }
+    }
+
+protected:
+
+    //! This method moves the avatar workspace by drift with drift factor __a_Kd__.
+    inline void drift(cWorkspaceDriftState& a_state, const cVector3d& a_deviceVel, double a_Kd) const
+    {
+        const double scale = a_state.m_workspaceScaleFactor;
+
+        // calculation of the drift velocity
+        a_state.m_driftVel = -a_Kd*a_deviceVel.length()*a_state.m_devicePosRel/m_R;
+
+        // avatar velocity in device coordinates
+        a_state.m_avatarVel = scale * (a_deviceVel-a_state.m_driftVel);
+
+        // virtual workspace velocity and position
+        a_state.m_wsCenterVel = -scale*a_state.m_driftVel;
+        a_state.m_wsCenter = a_state.m_wsCenter + a_state.m_wsCenterVel/m_tickRate;
+
+        // avatar position in device coordinates
+        a_state.m_avatarPos = scale * a_state.m_devicePosRel + a_state.m_wsCenter;
+
+        // drift of the device
+        a_state.m_driftForce = m_Kv*m_maxLinearForce*(a_state.m_driftVel-a_deviceVel);
+        a_state.m_rateControl = false;
+    }
+
+    //! This method moves the avatar workspace towards the device by rate control.
+    inline void rateControl(cWorkspaceDriftState& a_state) const
+    {
+        const double scale = a_state.m_workspaceScaleFactor;
+
+        // the avatar workspace moves towards the device, no drift force
+        a_state.m_avatarVel = scale * m_rate.getRateFactor()*a_state.m_devicePosRel/m_R;
+        a_state.m_wsCenterVel = a_state.m_avatarVel;
+        a_state.m_wsCenter = a_state.m_wsCenter + a_state.m_wsCenterVel/m_tickRate;
+        a_state.m_avatarPos = scale * a_state.m_devicePosRel + a_state.m_wsCenter;
+        a_state.m_driftVel.zero();
+        a_state.m_driftForce.zero();
+        a_state.m_rateControl = true;
+    }
+
+public:
+
+    //! Drift factor policy.
+    TGain m_gain;
+
+    //! Rate control policy.
+    TRate m_rate;
+
+    //! Scale factor policy.
+    TScale m_scale;
+
+    //! Drift controller gain.
+    double m_Kv;
+
+    //! Device workspace radius [m].
+    double m_R;
+
+    //! Maximum linear force of the device [N].
+    double m_maxLinearForce;
+
+    //! Rate of the haptic loop [Hz].
+    double m_tickRate;
+};
+
+
+//------------------------------------------------------------------------------
+
+//! Drift velocity proportional to the device speed and to the distance from rd0.
+typedef cDriftController<cConstantDriftGain, cNoRateControl, cFixedScale> cTranslationalDrift;
+
+//! Drift with a larger drift factor on the workspace edge.
+typedef cDriftController<cEdgeDriftGain, cNoRateControl, cFixedScale> cEdgeGainDrift;
+
+//! Drift inside the workspace, rate control on its boundaries.
+typedef cDriftController<cConstantDriftGain, cBubbleRateControl, cFixedScale> cBubbleDrift;
+
+//! Drift with a scale factor that grows with the distance from rd0.
+typedef cDriftController<cConstantDriftGain, cNoRateControl, cExpansionScale> cExpansionDrift;
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
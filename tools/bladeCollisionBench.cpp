@@ -0,0 +1,347 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include "CODE.h"
+//------------------------------------------------------------------------------
+#include "CDistanceField.h"
+#include "CODEDistanceFieldGeom.h"
+#include "CPerfCounters.h"
+//------------------------------------------------------------------------------
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*
+    TOOL:    bladeCollisionBench.cpp
+
+    Benchmark of the collision of the polishing tool with the blade of the
+    10-ODE-PolishingTask example, with the two collision models of the
+    blade: the ODE triangle mesh (--blade-collider trimesh) and the
+    distance field with points sampled on the tool (--blade-collider sdf,
+    common/CDistanceField.h, common/CODEDistanceFieldGeom.h).
+
+    The tool is placed in polishing contact configurations: at random
+    points of the blade surface, its axis along the surface normal and
+    tilted by 0, 15 or 30 degrees, with its lowest point 0.5, 1 or 2 mm
+    into the blade. Both models collide the same configurations; the tool
+    reports the time per collision, the number of contacts and the deepest
+    contact compared with the penetration set.
+
+    The distance field is then collided along polishing strokes: from each
+    configuration, the tool slides 0.05 mm per step (0.2 m/s at 4 kHz) for
+    40 steps, without and with the contact cache of the geometry
+    (cODEDistanceFieldGeom::setCoherenceMargin()). The tool reports both
+    times, the cache hit rate and the collisions whose contacts differ
+    (none expected).
+
+        bladeCollisionBench <models/Polishing folder> [configurations] [passes]
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// DECLARED TYPES
+//------------------------------------------------------------------------------
+
+// pose of the tool in a contact configuration, and its penetration
+struct cToolPose
+{
+    dVector3 m_pos;
+    dMatrix3 m_rot;
+    double m_penetration;
+};
+
+
+//------------------------------------------------------------------------------
+// DECLARED VARIABLES
+//------------------------------------------------------------------------------
+
+// maximum number of contacts per collision
+const int C_MAX_CONTACTS = 32;
+
+// prevents the compiler from discarding the collisions
+volatile double sink = 0.0;
+
+
+//------------------------------------------------------------------------------
+
+// creates the ODE body of a mesh loaded from a file, as the example does
+cODEGenericBody* createBody(cODEWorld* a_world, const string& a_filename, double a_scale, bool a_static)
+{
+    cMultiMesh* mesh = new cMultiMesh();
+    if (!mesh->loadFromFile(a_filename))
+    {
+        printf("Error - failed to load model: %s\n", a_filename.c_str());
+        exit(1);
+    }
+    mesh->scale(a_scale);
+    mesh->computeBoundaryBox(true);
+
+    cODEGenericBody* body = new cODEGenericBody(a_world);
+    body->setImageModel(mesh);
+    body->createDynamicMesh(a_static);
+    return (body);
+}
+
+//------------------------------------------------------------------------------
+
+// places the tool in random contact configurations on the blade
+vector<cToolPose> createConfigurations(const vector<cVector3d>& a_bladeVertices, const vector<unsigned int>& a_bladeTriangles,
+                                       const cVector3d& a_bladePos, const cMatrix3d& a_bladeRot,
+                                       const vector<cVector3d>& a_toolPoints, size_t a_numConfigurations)
+{
+    static const double tilts[] = { 0.0, 15.0, 30.0 };
+    static const double penetrations[] = { 0.0005, 0.001, 0.002 };
+
+    // blade triangles weighted by their area
+    vector<double> areas;
+    for (size_t t=0; t+2<a_bladeTriangles.size(); t+=3)
+    {
+        const cVector3d& a = a_bladeVertices[a_bladeTriangles[t]];
+        const cVector3d& b = a_bladeVertices[a_bladeTriangles[t+1]];
+        const cVector3d& c = a_bladeVertices[a_bladeTriangles[t+2]];
+        areas.push_back(0.5 * (b - a).cross(c - a).length());
+    }
+    mt19937 random(1);
+    discrete_distribution<size_t> pickTriangle(areas.begin(), areas.end());
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    vector<cToolPose> poses(a_numConfigurations);
+    for (size_t i=0; i<a_numConfigurations; i++)
+    {
+        // point and normal of the blade surface
+        size_t t = 3 * pickTriangle(random);
+        const cVector3d& a = a_bladeVertices[a_bladeTriangles[t]];
+        const cVector3d& b = a_bladeVertices[a_bladeTriangles[t+1]];
+        const cVector3d& c = a_bladeVertices[a_bladeTriangles[t+2]];
+        double u = uniform(random);
+        double v = uniform(random);
+        if (u + v > 1.0) { u = 1.0 - u; v = 1.0 - v; }
+        cVector3d surfacePos = a_bladePos + a_bladeRot * (a + u * (b - a) + v * (c - a));
+        cVector3d normal = a_bladeRot * (b - a).cross(c - a);
+        normal.normalize();
+
+        // tool axis along the normal, tilted about a random direction of the surface
+        cVector3d axisX = (fabs(normal(0)) < 0.9) ? cVector3d(1,0,0).cross(normal) : cVector3d(0,1,0).cross(normal);
+        axisX.normalize();
+        cVector3d axisY = normal.cross(axisX);
+        cMatrix3d frame;
+        frame.setCol(axisX, axisY, normal);
+        cMatrix3d spin, tilt;
+        spin.setAxisAngleRotationRad(normal, 2.0 * C_PI * uniform(random));
+        tilt.setAxisAngleRotationRad(axisX, cDegToRad(tilts[i % 3]));
+        cMatrix3d rot = cMul(tilt, cMul(spin, frame));
+
+        // lowest point of the tool along the normal at the surface point,
+        // moved into the blade by the penetration
+        size_t lowest = 0;
+        for (size_t j=1; j<a_toolPoints.size(); j++)
+        {
+            if ((rot * a_toolPoints[j]).dot(normal) < (rot * a_toolPoints[lowest]).dot(normal)) { lowest = j; }
+        }
+        double penetration = penetrations[(i / 3) % 3];
+        cVector3d pos = surfacePos - rot * a_toolPoints[lowest] - penetration * normal;
+
+        cToolPose& pose = poses[i];
+        pose.m_penetration = penetration;
+        for (int r=0; r<3; r++)
+        {
+            pose.m_pos[r] = pos(r);
+            for (int k=0; k<3; k++) { pose.m_rot[4*r + k] = rot(r,k); }
+            pose.m_rot[4*r + 3] = 0.0;
+        }
+    }
+    return (poses);
+}
+
+//------------------------------------------------------------------------------
+
+// collides the tool with the blade in every configuration and prints the cost and the contacts
+void benchmark(const char* a_name, dGeomID a_blade, dGeomID a_tool, const vector<cToolPose>& a_poses, int a_passes)
+{
+    vector<dContact> contacts(C_MAX_CONTACTS);
+
+    // contacts, and warm up of the caches
+    double numContacts = 0.0;
+    double numColliding = 0.0;
+    double depthError = 0.0;
+    for (size_t i=0; i<a_poses.size(); i++)
+    {
+        dGeomSetPosition(a_tool, a_poses[i].m_pos[0], a_poses[i].m_pos[1], a_poses[i].m_pos[2]);
+        dGeomSetRotation(a_tool, a_poses[i].m_rot);
+        int n = dCollide(a_blade, a_tool, C_MAX_CONTACTS, &contacts[0].geom, sizeof(dContact));
+        double depth = 0.0;
+        for (int j=0; j<n; j++) { depth = cMax(depth, (double)contacts[j].geom.depth); }
+        numContacts += (double)n;
+        numColliding += (n > 0) ? 1.0 : 0.0;
+        depthError += fabs(depth - a_poses[i].m_penetration);
+    }
+
+    cPerfCounters counters;
+    double acc = 0.0;
+
+    counters.start();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int pass=0; pass<a_passes; pass++)
+    {
+        for (size_t i=0; i<a_poses.size(); i++)
+        {
+            dGeomSetPosition(a_tool, a_poses[i].m_pos[0], a_poses[i].m_pos[1], a_poses[i].m_pos[2]);
+            dGeomSetRotation(a_tool, a_poses[i].m_rot);
+            int n = dCollide(a_blade, a_tool, C_MAX_CONTACTS, &contacts[0].geom, sizeof(dContact));
+            acc += (n > 0) ? contacts[0].geom.depth : 0.0;
+        }
+    }
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    counters.stop();
+    sink = sink + acc;
+
+    double collisions = (double)a_poses.size() * (double)a_passes;
+    double numPoses = (double)a_poses.size();
+    printf("  %-8s %9.2f us/collision", a_name, 1e6 * chrono::duration<double>(stop - start).count() / collisions);
+    if (counters.isAvailable(cPerfCounters::INSTRUCTIONS))
+    {
+        printf("  %10.0f instr/collision", (double)counters.getCount(cPerfCounters::INSTRUCTIONS) / collisions);
+    }
+    printf("  %5.1f contacts  %5.1f%% colliding  depth error %.3f mm\n",
+           numContacts / numPoses, 100.0 * numColliding / numPoses, 1e3 * depthError / numPoses);
+}
+
+//------------------------------------------------------------------------------
+
+// collides the tool with the distance field along strokes from every
+// configuration, with a coherence margin of a_margin (0 for none); returns
+// the time per collision and writes the contacts of each collision
+double benchmarkStrokes(cODEDistanceFieldGeom& a_field, dGeomID a_tool, const vector<cToolPose>& a_poses, double a_margin,
+                        vector<int>& a_numContacts, vector<double>& a_depths)
+{
+    const int numSteps = 40;
+    const double step = 0.00005;
+    vector<dContact> contacts(C_MAX_CONTACTS);
+    a_field.setCoherenceMargin(a_margin);
+    a_numContacts.clear();
+    a_depths.clear();
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (size_t i=0; i<a_poses.size(); i++)
+    {
+        dGeomSetRotation(a_tool, a_poses[i].m_rot);
+        for (int s=0; s<numSteps; s++)
+        {
+            // along the first axis of the tool, across the surface
+            const dReal* rot = a_poses[i].m_rot;
+            dGeomSetPosition(a_tool, a_poses[i].m_pos[0] + s * step * rot[0],
+                                     a_poses[i].m_pos[1] + s * step * rot[4],
+                                     a_poses[i].m_pos[2] + s * step * rot[8]);
+            int n = dCollide(a_field.getGeom(), a_tool, C_MAX_CONTACTS, &contacts[0].geom, sizeof(dContact));
+            double depth = 0.0;
+            for (int j=0; j<n; j++) { depth += contacts[j].geom.depth; }
+            a_numContacts.push_back(n);
+            a_depths.push_back(depth);
+        }
+    }
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return (elapsed / (double)a_numContacts.size());
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <models/Polishing folder> [configurations] [passes]\n", argv[0]);
+        return 1;
+    }
+    string folder = argv[1];
+    size_t numConfigurations = (argc > 2) ? strtoul(argv[2], NULL, 10) : 900;
+    int passes = (argc > 3) ? atoi(argv[3]) : 10;
+    if (numConfigurations < 1) { numConfigurations = 1; }
+    if (passes < 1) { passes = 1; }
+
+    // blade and tool of the example, with their triangle mesh models
+    cWorld* world = new cWorld();
+    cODEWorld* ODEWorld = new cODEWorld(world);
+    world->addChild(ODEWorld);
+
+    cODEGenericBody* ODEBlade = createBody(ODEWorld, folder + "/blade.3ds", 0.012, true);
+    ODEBlade->setLocalPos(0.0, 0.0, -0.5);
+    ODEBlade->rotateAboutGlobalAxisDeg(cVector3d(1,0,0), 90);
+    cODEGenericBody* ODETool = createBody(ODEWorld, folder + "/ToolPoli2.3ds", 0.065, false);
+
+    // distance field of the blade and points of the tool, as the example builds them
+    cMultiMesh* blade = (cMultiMesh*)ODEBlade->m_imageModel;
+    cMultiMesh* tool = (cMultiMesh*)ODETool->m_imageModel;
+    vector<cVector3d> bladeVertices, toolVertices, toolPoints;
+    vector<unsigned int> bladeTriangles, toolTriangles;
+    cGetMeshTriangles(blade, bladeVertices, bladeTriangles);
+    cGetMeshTriangles(tool, toolVertices, toolTriangles);
+
+    cVector3d size = blade->getBoundaryMax() - blade->getBoundaryMin();
+    double cellSize = cMax(size(0), cMax(size(1), size(2))) / 256.0;
+    cSparseDistanceField field;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    field.build(bladeVertices, bladeTriangles, cellSize, 4);
+    double buildTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cSampleSurface(toolVertices, toolTriangles, 2.0 * cellSize, 512, toolPoints);
+
+    cODEDistanceFieldGeom fieldGeom(&field);
+    fieldGeom.create(0, ODEBlade);
+    fieldGeom.setPose(ODEBlade->getLocalPos(), ODEBlade->getLocalRot());
+    fieldGeom.addSampledGeom(ODETool->m_ode_geom, toolPoints);
+
+    printf("blade: %lu triangles; tool: %lu triangles, %lu points\n", (unsigned long)bladeTriangles.size() / 3,
+           (unsigned long)toolTriangles.size() / 3, (unsigned long)toolPoints.size());
+    printf("distance field: cell %.2f mm, %lu bricks, %.1f MB, built in %.2f s\n", 1e3 * cellSize,
+           (unsigned long)field.getNumBricks(), 1e-6 * (double)field.getMemorySize(), buildTime);
+
+    cPerfCounters probe;
+    if (!probe.isAvailable())
+    {
+        printf("hardware counters unavailable, reporting time only\n");
+    }
+
+    vector<cToolPose> poses = createConfigurations(bladeVertices, bladeTriangles, ODEBlade->getLocalPos(),
+                                                   ODEBlade->getLocalRot(), toolPoints, numConfigurations);
+    printf("%lu contact configurations x %d passes\n", (unsigned long)poses.size(), passes);
+
+    benchmark("trimesh", ODEBlade->m_ode_geom, ODETool->m_ode_geom, poses, passes);
+    benchmark("sdf", fieldGeom.getGeom(), ODETool->m_ode_geom, poses, passes);
+
+    // strokes, without and with the contact cache
+    vector<int> numContacts, numContactsCached;
+    vector<double> depths, depthsCached;
+    double margin = 0.5 * field.getBandWidth();
+    benchmarkStrokes(fieldGeom, ODETool->m_ode_geom, poses, 0.0, numContacts, depths);
+    double time = benchmarkStrokes(fieldGeom, ODETool->m_ode_geom, poses, 0.0, numContacts, depths);
+    unsigned long hits = fieldGeom.getNumCacheHits();
+    unsigned long tests = fieldGeom.getNumPointTests();
+    double timeCached = benchmarkStrokes(fieldGeom, ODETool->m_ode_geom, poses, margin, numContactsCached, depthsCached);
+    hits = fieldGeom.getNumCacheHits() - hits;
+    tests = fieldGeom.getNumPointTests() - tests;
+    size_t differences = 0;
+    for (size_t i=0; i<numContacts.size(); i++)
+    {
+        if ((numContacts[i] != numContactsCached[i]) || (depths[i] != depthsCached[i])) { differences++; }
+    }
+    double collisions = (double)numContacts.size();
+    printf("strokes: %lu collisions, sdf %.2f us/collision, cached (margin %.2f mm) %.2f us/collision, %.1f%% hits, %.1f point tests/collision, %lu differ\n",
+           (unsigned long)numContacts.size(), 1e6 * time, 1e3 * margin, 1e6 * timeCached, 100.0 * (double)hits / collisions,
+           (double)tests / collisions, (unsigned long)differences);
+
+    return 0;
+}
@@ -0,0 +1,426 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include "CODE.h"
+//------------------------------------------------------------------------------
+#include "CDistanceField.h"
+#include "CMeshDecimator.h"
+//------------------------------------------------------------------------------
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*
+    TOOL:    bladeDecimationBench.cpp
+
+    Benchmark of the decimated collision mesh of the blade of the
+    10-ODE-PolishingTask example (--collision-error, common/CMeshDecimator.h)
+    against its error bound.
+
+    For each error bound [mm] (0 for the full mesh), the blade is decimated
+    and the tool reports:
+    - the number of triangles and the time of the decimation,
+    - the distance between the surfaces, measured both ways at points
+      sampled every 0.25 mm on each (largest and mean),
+    - the cost of the collision queries of a haptic tick: the segment of
+      the haptic point against the AABB tree of CHAI3D, 1 mm across the
+      surface, and the tool against the ODE triangle mesh of the blade in
+      polishing contact configurations (as bladeCollisionBench places
+      them).
+
+        bladeDecimationBench <models/Polishing folder> [errors=0,0.02,0.05,0.1,0.2,0.5] [configurations=900] [passes=10]
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// DECLARED TYPES
+//------------------------------------------------------------------------------
+
+// pose of the tool in a contact configuration
+struct cToolPose
+{
+    dVector3 m_pos;
+    dMatrix3 m_rot;
+};
+
+// uniform grid of the triangles of a mesh, for the distance of points to its surface
+class cTriangleGrid
+{
+public:
+
+    cTriangleGrid(const vector<cVector3d>& a_vertices, const vector<unsigned int>& a_triangles, double a_cellSize) :
+        m_vertices(a_vertices), m_triangles(a_triangles), m_cellSize(a_cellSize)
+    {
+        m_min = a_vertices[0];
+        cVector3d max = a_vertices[0];
+        for (size_t i=1; i<a_vertices.size(); i++)
+        {
+            for (int k=0; k<3; k++)
+            {
+                m_min(k) = cMin(m_min(k), a_vertices[i](k));
+                max(k) = cMax(max(k), a_vertices[i](k));
+            }
+        }
+        for (int k=0; k<3; k++)
+        {
+            m_min(k) -= a_cellSize;
+            m_size[k] = (int)((max(k) - m_min(k)) / a_cellSize) + 2;
+        }
+        m_cells.resize((size_t)m_size[0] * m_size[1] * m_size[2]);
+
+        // each triangle in the cells of its bounding box
+        for (size_t t=0; t+2<a_triangles.size(); t+=3)
+        {
+            int lo[3], hi[3];
+            for (int k=0; k<3; k++)
+            {
+                double a = a_vertices[a_triangles[t]](k), b = a_vertices[a_triangles[t+1]](k), c = a_vertices[a_triangles[t+2]](k);
+                lo[k] = getCell(cMin(a, cMin(b, c)), k);
+                hi[k] = getCell(cMax(a, cMax(b, c)), k);
+            }
+            for (int z=lo[2]; z<=hi[2]; z++)
+                for (int y=lo[1]; y<=hi[1]; y++)
+                    for (int x=lo[0]; x<=hi[0]; x++)
+                        m_cells[getIndex(x, y, z)].push_back((unsigned int)t);
+        }
+    }
+
+    // distance of a_pos to the closest triangle, searching shells of cells around it
+    double getDistance(const cVector3d& a_pos) const
+    {
+        int c[3];
+        for (int k=0; k<3; k++) { c[k] = getCell(a_pos(k), k); }
+        int maxRadius = cMax(m_size[0], cMax(m_size[1], m_size[2]));
+
+        double best = 1e30;
+        for (int r=0; r<=maxRadius; r++)
+        {
+            for (int z=c[2]-r; z<=c[2]+r; z++)
+                for (int y=c[1]-r; y<=c[1]+r; y++)
+                    for (int x=c[0]-r; x<=c[0]+r; x++)
+                    {
+                        if (cMax(abs(x - c[0]), cMax(abs(y - c[1]), abs(z - c[2]))) != r) { continue; }
+                        if ((x < 0) || (y < 0) || (z < 0) || (x >= m_size[0]) || (y >= m_size[1]) || (z >= m_size[2])) { continue; }
+                        const vector<unsigned int>& cell = m_cells[getIndex(x, y, z)];
+                        for (size_t i=0; i<cell.size(); i++)
+                        {
+                            unsigned int t = cell[i];
+                            cVector3d p = cSparseDistanceField::getClosestPoint(a_pos, m_vertices[m_triangles[t]],
+                                                                               m_vertices[m_triangles[t+1]], m_vertices[m_triangles[t+2]]);
+                            best = cMin(best, (p - a_pos).length());
+                        }
+                    }
+
+            // triangles of the next shells are at least r cells away
+            if (best <= (double)r * m_cellSize) { break; }
+        }
+        return (best);
+    }
+
+protected:
+
+    int getCell(double a_value, int a_axis) const
+    {
+        return (cClamp((int)((a_value - m_min(a_axis)) / m_cellSize), 0, m_size[a_axis] - 1));
+    }
+
+    size_t getIndex(int a_x, int a_y, int a_z) const
+    {
+        return ((size_t)a_x + (size_t)m_size[0] * ((size_t)a_y + (size_t)m_size[1] * (size_t)a_z));
+    }
+
+    const vector<cVector3d>& m_vertices;
+    const vector<unsigned int>& m_triangles;
+    double m_cellSize;
+    cVector3d m_min;
+    int m_size[3];
+    vector<vector<unsigned int> > m_cells;
+};
+
+
+//------------------------------------------------------------------------------
+// DECLARED VARIABLES
+//------------------------------------------------------------------------------
+
+// maximum number of contacts per collision
+const int C_MAX_CONTACTS = 32;
+
+// spacing of the points sampled to measure the distance between the surfaces [m], and their maximum number
+const double C_SAMPLE_SPACING = 0.00025;
+const size_t C_MAX_SAMPLES = 200000;
+
+// prevents the compiler from discarding the collisions
+volatile double sink = 0.0;
+
+
+//------------------------------------------------------------------------------
+
+// largest and mean distance of points a_points to the surface of a_grid
+void measureDistance(const cTriangleGrid& a_grid, const vector<cVector3d>& a_points, double& a_max, double& a_mean)
+{
+    a_max = 0.0;
+    a_mean = 0.0;
+    for (size_t i=0; i<a_points.size(); i++)
+    {
+        double distance = a_grid.getDistance(a_points[i]);
+        a_max = cMax(a_max, distance);
+        a_mean += distance;
+    }
+    a_mean /= (double)cMax((size_t)1, a_points.size());
+}
+
+//------------------------------------------------------------------------------
+
+// places the tool at random points of the blade, its axis along the normal
+// tilted by 0, 15 or 30 degrees, its lowest point 0.5, 1 or 2 mm into the
+// blade; also returns the segments of the haptic point across the surface
+void createConfigurations(const vector<cVector3d>& a_bladeVertices, const vector<unsigned int>& a_bladeTriangles,
+                          const cVector3d& a_bladePos, const cMatrix3d& a_bladeRot, const vector<cVector3d>& a_toolVertices,
+                          size_t a_numConfigurations, vector<cToolPose>& a_poses, vector<cVector3d>& a_segments)
+{
+    static const double tilts[] = { 0.0, 15.0, 30.0 };
+    static const double penetrations[] = { 0.0005, 0.001, 0.002 };
+
+    vector<double> areas;
+    for (size_t t=0; t+2<a_bladeTriangles.size(); t+=3)
+    {
+        const cVector3d& a = a_bladeVertices[a_bladeTriangles[t]];
+        areas.push_back(0.5 * (a_bladeVertices[a_bladeTriangles[t+1]] - a).cross(a_bladeVertices[a_bladeTriangles[t+2]] - a).length());
+    }
+    mt19937 random(1);
+    discrete_distribution<size_t> pickTriangle(areas.begin(), areas.end());
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    a_poses.resize(a_numConfigurations);
+    a_segments.clear();
+    for (size_t i=0; i<a_numConfigurations; i++)
+    {
+        size_t t = 3 * pickTriangle(random);
+        const cVector3d& a = a_bladeVertices[a_bladeTriangles[t]];
+        const cVector3d& b = a_bladeVertices[a_bladeTriangles[t+1]];
+        const cVector3d& c = a_bladeVertices[a_bladeTriangles[t+2]];
+        double u = uniform(random);
+        double v = uniform(random);
+        if (u + v > 1.0) { u = 1.0 - u; v = 1.0 - v; }
+        cVector3d localPos = a + u * (b - a) + v * (c - a);
+        cVector3d localNormal = (b - a).cross(c - a);
+        localNormal.normalize();
+
+        // segment of the haptic point, in the frame of the blade
+        a_segments.push_back(localPos + 0.0005 * localNormal);
+        a_segments.push_back(localPos - 0.0005 * localNormal);
+
+        cVector3d surfacePos = a_bladePos + a_bladeRot * localPos;
+        cVector3d normal = a_bladeRot * localNormal;
+        cVector3d axisX = (fabs(normal(0)) < 0.9) ? cVector3d(1,0,0).cross(normal) : cVector3d(0,1,0).cross(normal);
+        axisX.normalize();
+        cVector3d axisY = normal.cross(axisX);
+        cMatrix3d frame;
+        frame.setCol(axisX, axisY, normal);
+        cMatrix3d spin, tilt;
+        spin.setAxisAngleRotationRad(normal, 2.0 * C_PI * uniform(random));
+        tilt.setAxisAngleRotationRad(axisX, cDegToRad(tilts[i % 3]));
+        cMatrix3d rot = cMul(tilt, cMul(spin, frame));
+
+        size_t lowest = 0;
+        for (size_t j=1; j<a_toolVertices.size(); j++)
+        {
+            if ((rot * a_toolVertices[j]).dot(normal) < (rot * a_toolVertices[lowest]).dot(normal)) { lowest = j; }
+        }
+        cVector3d pos = surfacePos - rot * a_toolVertices[lowest] - penetrations[(i / 3) % 3] * normal;
+
+        cToolPose& pose = a_poses[i];
+        for (int r=0; r<3; r++)
+        {
+            pose.m_pos[r] = pos(r);
+            for (int k=0; k<3; k++) { pose.m_rot[4*r + k] = rot(r,k); }
+            pose.m_rot[4*r + 3] = 0.0;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// time per segment query of the haptic point against a_mesh [s], and fraction of the segments that hit it
+double benchmarkHaptic(cMultiMesh* a_mesh, const vector<cVector3d>& a_segments, int a_passes, double& a_hits)
+{
+    cCollisionRecorder recorder;
+    cCollisionSettings settings;
+    settings.m_checkForNearestCollisionOnly = true;
+    settings.m_returnMinimalCollisionData = false;
+    settings.m_checkVisibleObjects = false;
+    settings.m_checkHapticObjects = true;
+
+    double hits = 0.0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int pass=0; pass<a_passes; pass++)
+    {
+        for (size_t i=0; i+1<a_segments.size(); i+=2)
+        {
+            recorder.clear();
+            if (a_mesh->computeCollisionDetection(a_segments[i], a_segments[i+1], recorder, settings)) { hits += 1.0; }
+        }
+    }
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    double queries = (double)(a_segments.size() / 2) * (double)a_passes;
+    a_hits = hits / queries;
+    sink = sink + hits;
+    return (elapsed / queries);
+}
+
+//------------------------------------------------------------------------------
+
+// time per collision of the tool with the ODE mesh of the blade [s], and mean number of contacts
+double benchmarkODE(dGeomID a_blade, dGeomID a_tool, const vector<cToolPose>& a_poses, int a_passes, double& a_contacts)
+{
+    vector<dContact> contacts(C_MAX_CONTACTS);
+    double acc = 0.0;
+    double numContacts = 0.0;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int pass=0; pass<a_passes; pass++)
+    {
+        for (size_t i=0; i<a_poses.size(); i++)
+        {
+            dGeomSetPosition(a_tool, a_poses[i].m_pos[0], a_poses[i].m_pos[1], a_poses[i].m_pos[2]);
+            dGeomSetRotation(a_tool, a_poses[i].m_rot);
+            int n = dCollide(a_blade, a_tool, C_MAX_CONTACTS, &contacts[0].geom, sizeof(dContact));
+            acc += (n > 0) ? contacts[0].geom.depth : 0.0;
+            numContacts += (double)n;
+        }
+    }
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    double collisions = (double)a_poses.size() * (double)a_passes;
+    a_contacts = numContacts / collisions;
+    sink = sink + acc;
+    return (elapsed / collisions);
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <models/Polishing folder> [errors=0,0.02,0.05,0.1,0.2,0.5] [configurations=900] [passes=10]\n", argv[0]);
+        return 1;
+    }
+    string folder = argv[1];
+    vector<double> errors;
+    stringstream errorList((argc > 2) ? argv[2] : "0,0.02,0.05,0.1,0.2,0.5");
+    string item;
+    while (getline(errorList, item, ','))
+    {
+        errors.push_back(cMax(0.0, 1e-3 * atof(item.c_str())));
+    }
+    size_t numConfigurations = (argc > 3) ? strtoul(argv[3], NULL, 10) : 900;
+    int passes = (argc > 4) ? atoi(argv[4]) : 10;
+    if (numConfigurations < 1) { numConfigurations = 1; }
+    if (passes < 1) { passes = 1; }
+
+    // blade and tool of the example
+    cMultiMesh* blade = new cMultiMesh();
+    cMultiMesh* tool = new cMultiMesh();
+    if (!blade->loadFromFile(folder + "/blade.3ds") || !tool->loadFromFile(folder + "/ToolPoli2.3ds"))
+    {
+        printf("Error - failed to load the models from: %s\n", folder.c_str());
+        return 1;
+    }
+    blade->scale(0.012);
+    tool->scale(0.065);
+
+    cWorld* world = new cWorld();
+    cODEWorld* ODEWorld = new cODEWorld(world);
+    world->addChild(ODEWorld);
+    cODEGenericBody* ODETool = new cODEGenericBody(ODEWorld);
+    ODETool->setImageModel(tool);
+    ODETool->createDynamicMesh(false);
+
+    vector<cVector3d> bladeVertices, toolVertices;
+    vector<unsigned int> bladeTriangles, toolTriangles;
+    cGetMeshTriangles(blade, bladeVertices, bladeTriangles);
+    cGetMeshTriangles(tool, toolVertices, toolTriangles);
+
+    // pose of the blade in the example
+    cMatrix3d bladeRot;
+    bladeRot.setAxisAngleRotationDeg(cVector3d(1,0,0), 90);
+    cVector3d bladePos(0.0, 0.0, -0.5);
+
+    vector<cToolPose> poses;
+    vector<cVector3d> segments;
+    createConfigurations(bladeVertices, bladeTriangles, bladePos, bladeRot, toolVertices, numConfigurations, poses, segments);
+
+    // points of the blade surface, and grid of its triangles
+    vector<cVector3d> bladePoints;
+    cSampleSurface(bladeVertices, bladeTriangles, C_SAMPLE_SPACING, C_MAX_SAMPLES, bladePoints);
+    cTriangleGrid bladeGrid(bladeVertices, bladeTriangles, 0.002);
+
+    printf("blade: %lu triangles, %lu surface points; %lu configurations x %d passes\n",
+           (unsigned long)(bladeTriangles.size() / 3), (unsigned long)bladePoints.size(), (unsigned long)poses.size(), passes);
+    printf("  bound mm  triangles  decimation ms  max/mean deviation mm  haptic us/query  hits  ODE us/collision  contacts\n");
+
+    for (size_t e=0; e<errors.size(); e++)
+    {
+        // collision mesh within the error bound, or the blade itself
+        cMultiMesh* mesh = blade;
+        vector<cVector3d> vertices = bladeVertices;
+        vector<unsigned int> triangles = bladeTriangles;
+        double decimationTime = 0.0;
+        if (errors[e] > 0.0)
+        {
+            cQuadricDecimator decimator;
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            decimator.decimate(bladeVertices, bladeTriangles, errors[e]);
+            decimationTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            vertices = decimator.getVertices();
+            triangles = decimator.getTriangles();
+            mesh = new cMultiMesh();
+            decimator.createMesh(mesh);
+        }
+        mesh->createAABBCollisionDetector(0.0);
+
+        // distance between the surfaces, both ways
+        vector<cVector3d> points;
+        cSampleSurface(vertices, triangles, C_SAMPLE_SPACING, C_MAX_SAMPLES, points);
+        cTriangleGrid grid(vertices, triangles, 0.002);
+        double maxTo, meanTo, maxFrom, meanFrom;
+        measureDistance(grid, bladePoints, maxTo, meanTo);
+        measureDistance(bladeGrid, points, maxFrom, meanFrom);
+
+        // collision queries of a tick
+        double hits, contacts;
+        double hapticTime = benchmarkHaptic(mesh, segments, passes, hits);
+
+        cODEGenericBody* ODEBlade = new cODEGenericBody(ODEWorld);
+        ODEBlade->setImageModel(mesh);
+        ODEBlade->createDynamicMesh(true);
+        ODEBlade->setLocalPos(bladePos);
+        ODEBlade->rotateAboutGlobalAxisDeg(cVector3d(1,0,0), 90);
+        double odeTime = benchmarkODE(ODEBlade->m_ode_geom, ODETool->m_ode_geom, poses, passes, contacts);
+
+        printf("  %8.3f  %9lu  %13.1f  %9.4f / %-9.4f  %15.3f  %3.0f%%  %16.2f  %8.1f\n",
+               1e3 * errors[e], (unsigned long)(triangles.size() / 3), 1e3 * decimationTime,
+               1e3 * cMax(maxTo, maxFrom), 1e3 * 0.5 * (meanTo + meanFrom),
+               1e6 * hapticTime, 100.0 * hits, 1e6 * odeTime, contacts);
+    }
+
+    return 0;
+}
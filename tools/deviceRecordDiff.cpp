@@ -0,0 +1,93 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "CDeviceRecord.h"
+//------------------------------------------------------------------------------
+#include <cstdlib>
+#include <iostream>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*
+    TOOL:    deviceRecordDiff.cpp
+
+    Compares the forces and torques of two device records produced from the
+    same input, typically a session recorded with --record and its replay
+    recorded with --replay <session> --record <replay>. The tool only depends
+    on the record format and builds without CHAI3D:
+
+        c++ -O2 -I../common deviceRecordDiff.cpp -o deviceRecordDiff
+
+    The exit code is 0 if every command matches within the tolerance. The
+    commands are only comparable if both records read the same inputs, so
+    differing inputs or lengths also fail.
+*/
+//==============================================================================
+
+int main(int argc, char* argv[])
+{
+    if ((argc != 3) && (argc != 4))
+    {
+        cout << "Usage: " << argv[0] << " <reference.rec> <candidate.rec> [tolerance]" << endl;
+        return 2;
+    }
+
+    double tolerance = (argc == 4) ? atof(argv[3]) : 0.0;
+
+    // load both records
+    cDeviceRecordReader reference, candidate;
+    if (!reference.load(argv[1]))
+    {
+        cout << "Error - failed to load device record: " << argv[1] << endl;
+        return 2;
+    }
+    if (!candidate.load(argv[2]))
+    {
+        cout << "Error - failed to load device record: " << argv[2] << endl;
+        return 2;
+    }
+
+    // compare commands tick by tick
+    cDeviceRecordDiff diff = cCompareDeviceRecords(reference, candidate, tolerance);
+
+    cout << "samples compared:   " << diff.m_numSamples;
+    if (reference.getNumSamples() != candidate.getNumSamples())
+    {
+        cout << " (lengths differ: " << reference.getNumSamples() << " / " << candidate.getNumSamples() << ")";
+    }
+    cout << endl;
+    cout << "input mismatches:   " << diff.m_numInputMismatches << endl;
+    cout << "max force error:    " << diff.m_maxForceError << " N" << endl;
+    cout << "rms force error:    " << diff.m_rmsForceError << " N" << endl;
+    cout << "max torque error:   " << diff.m_maxTorqueError << " Nm" << endl;
+
+    // the commands of a replay that read other inputs prove nothing
+    if (diff.m_numInputMismatches > 0)
+    {
+        cout << "inputs differ: the records do not replay the same session" << endl;
+        return 1;
+    }
+
+    if (diff.m_firstDifference < diff.m_numSamples)
+    {
+        const cDeviceRecordSample& sample = reference.getSample(diff.m_firstDifference);
+        cout << "first difference:   tick " << diff.m_firstDifference << " (t = " << sample.m_time << " s)" << endl;
+        return 1;
+    }
+    if (reference.getNumSamples() != candidate.getNumSamples())
+    {
+        cout << "lengths differ: the commands match over the shorter record only" << endl;
+        return 1;
+    }
+
+    cout << "commands match" << endl;
+    return 0;
+}
@@ -0,0 +1,207 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include "CODE.h"
+//------------------------------------------------------------------------------
+#include "CODEIslandThreads.h"
+//------------------------------------------------------------------------------
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*
+    TOOL:    odeIslandBench.cpp
+
+    Benchmark of the parallel stepping of the islands of an ODE world
+    (common/CODEIslandThreads.h, --ode-threads of 10-ODE-PolishingTask).
+
+    The world holds the parts that --bodies adds to the polishing cell:
+    boxes in stacks of two on a static floor, each stack an island. They
+    are dropped slightly tilted, so that they tumble before they settle.
+    For each number of bodies, the same scene is built again and stepped
+    1 ms at a time by 1, 2, 4, ... threads. The tool reports the time per
+    step (collision detection, which stays on one thread, included), the
+    speedup over one thread, and whether the final poses of the bodies are
+    bit for bit those of one thread.
+
+        odeIslandBench [bodies=16,64,256,1024] [threads=hw] [steps=2000]
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// DECLARED TYPES
+//------------------------------------------------------------------------------
+
+// world of the benchmark and its bodies
+struct cIslandScene
+{
+    cWorld* m_world;
+    cODEWorld* m_ODEWorld;
+    vector<cODEGenericBody*> m_bodies;
+};
+
+
+//------------------------------------------------------------------------------
+// DECLARED VARIABLES
+//------------------------------------------------------------------------------
+
+// size of the steps [s]
+const double C_STEP_SIZE = 0.001;
+
+// side of the parts [m]
+const double C_PART_SIZE = 0.04;
+
+
+//------------------------------------------------------------------------------
+
+// creates the floor and a_numBodies parts in stacks of two, as --bodies does
+cIslandScene createScene(int a_numBodies)
+{
+    cIslandScene scene;
+    scene.m_world = new cWorld();
+    scene.m_ODEWorld = new cODEWorld(scene.m_world);
+    scene.m_world->addChild(scene.m_ODEWorld);
+    scene.m_ODEWorld->setGravity(cVector3d(0.0, 0.0, -9.81));
+    scene.m_ODEWorld->setAngularDamping(0.00002);
+    scene.m_ODEWorld->setLinearDamping(0.00002);
+
+    cODEGenericBody* floor = new cODEGenericBody(scene.m_ODEWorld);
+    floor->createStaticPlane(cVector3d(0.0, 0.0, -1.0), cVector3d(0.0, 0.0, 1.0));
+
+    mt19937 random(1);
+    uniform_real_distribution<double> angle(-0.3, 0.3);
+    int numStacks = (a_numBodies + 1) / 2;
+    int side = (int)ceil(sqrt((double)numStacks));
+    for (int i=0; i<a_numBodies; i++)
+    {
+        int stack = i / 2;
+        cMesh* mesh = new cMesh();
+        cCreateBox(mesh, C_PART_SIZE, C_PART_SIZE, C_PART_SIZE);
+
+        cODEGenericBody* part = new cODEGenericBody(scene.m_ODEWorld);
+        part->setImageModel(mesh);
+        part->createDynamicBox(C_PART_SIZE, C_PART_SIZE, C_PART_SIZE);
+        part->setMass(0.05);
+        part->setLocalPos(3.0 * C_PART_SIZE * ((double)(stack % side) - 0.5 * (double)(side - 1)),
+                          3.0 * C_PART_SIZE * ((double)(stack / side) - 0.5 * (double)(side - 1)),
+                          -1.0 + (0.6 + 1.2 * (double)(i % 2)) * C_PART_SIZE);
+        cMatrix3d rot;
+        rot.setAxisAngleRotationRad(cVector3d(1,0,0), angle(random));
+        part->setLocalRot(rot);
+        scene.m_bodies.push_back(part);
+    }
+    return (scene);
+}
+
+//------------------------------------------------------------------------------
+
+// steps the scene a_numSteps times with a_numThreads threads; returns the time per step [s]
+double runScene(cIslandScene& a_scene, int a_numThreads, int a_numSteps, bool& a_threaded)
+{
+    cODEIslandThreads threads;
+    a_threaded = threads.start(a_scene.m_ODEWorld->m_ode_world, a_numThreads);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i=0; i<a_numSteps; i++)
+    {
+        a_scene.m_ODEWorld->updateDynamics(C_STEP_SIZE);
+    }
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    threads.stop();
+    return (elapsed / (double)a_numSteps);
+}
+
+//------------------------------------------------------------------------------
+
+// positions and orientations of the bodies of the scene
+vector<dReal> getPoses(const cIslandScene& a_scene)
+{
+    vector<dReal> poses;
+    for (size_t i=0; i<a_scene.m_bodies.size(); i++)
+    {
+        const dReal* pos = dBodyGetPosition(a_scene.m_bodies[i]->m_ode_body);
+        const dReal* quat = dBodyGetQuaternion(a_scene.m_bodies[i]->m_ode_body);
+        poses.insert(poses.end(), pos, pos + 3);
+        poses.insert(poses.end(), quat, quat + 4);
+    }
+    return (poses);
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    vector<int> numBodies;
+    stringstream bodyList((argc > 1) ? argv[1] : "16,64,256,1024");
+    string item;
+    while (getline(bodyList, item, ','))
+    {
+        numBodies.push_back(max(1, atoi(item.c_str())));
+    }
+    int maxThreads = (argc > 2) ? atoi(argv[2]) : (int)thread::hardware_concurrency();
+    int numSteps = (argc > 3) ? atoi(argv[3]) : 2000;
+    if (maxThreads < 1) { maxThreads = 1; }
+    if (numSteps < 1) { numSteps = 1; }
+
+    dInitODE2(0);
+    printf("steps of %.1f ms x %d, up to %d threads\n", 1e3 * C_STEP_SIZE, numSteps, maxThreads);
+
+    for (size_t b=0; b<numBodies.size(); b++)
+    {
+        printf("%d bodies (%d islands):\n", numBodies[b], (numBodies[b] + 1) / 2);
+        double baseTime = 0.0;
+        vector<dReal> basePoses;
+        for (int numThreads=1; ; numThreads*=2)
+        {
+            numThreads = min(numThreads, maxThreads);
+
+            cIslandScene scene = createScene(numBodies[b]);
+            bool threaded;
+            double time = runScene(scene, numThreads, numSteps, threaded);
+            vector<dReal> poses = getPoses(scene);
+            delete scene.m_world;
+
+            if (!threaded)
+            {
+                printf("  ODE has no threading implementation (built without --enable-builtin-threading-impl)\n");
+                break;
+            }
+
+            size_t differences = 0;
+            if (numThreads == 1)
+            {
+                baseTime = time;
+                basePoses = poses;
+            }
+            else
+            {
+                for (size_t i=0; i<poses.size(); i++) { if (poses[i] != basePoses[i]) { differences++; } }
+            }
+            printf("  %3d threads: %9.1f us/step, speedup %5.2f, final poses %s\n", numThreads, 1e6 * time,
+                   baseTime / time, (differences == 0) ? "identical" : "differ");
+
+            if (numThreads >= maxThreads) { break; }
+        }
+    }
+
+    dCloseODE();
+    return 0;
+}
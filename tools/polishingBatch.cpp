@@ -0,0 +1,397 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include "CODE.h"
+//------------------------------------------------------------------------------
+#include "CDeviceRecord.h"
+#include "CDistanceField.h"
+#include "CODEDistanceFieldGeom.h"
+#include "CRecordedHapticDevice.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*
+    TOOL:    polishingBatch.cpp
+
+    Batch runner of the polishing scene of the 10-ODE-PolishingTask
+    example, to evaluate its settings offline on many cores. It creates
+    K independent ODE worlds, each with the blade and the tool of the
+    example, and couples each tool to an avatar that follows a device
+    trajectory: the device positions and orientations of a recorded
+    session if one is given, or else a scripted trajectory that presses
+    the tool on the blade and sweeps it across. Each world starts at a
+    different point of the trajectory.
+
+    The worlds are stepped in parallel by a pool of worker threads, each
+    owning a fixed subset of them, with 1, 2, 4, ... up to the requested
+    number of threads. The tool reports the throughput in simulated
+    seconds per wall second, the speedup and the parallel efficiency, and a
+    checksum of the final tool poses to compare the runs: each world is
+    only stepped by one thread, so the checksum does not depend on their
+    number.
+
+    The trimesh collider uses collision data that ODE only keeps per
+    thread when built with --enable-ou; without it, the worlds are
+    stepped by a single thread. The sdf collider has no such restriction.
+
+        polishingBatch <models/Polishing folder> [worlds] [threads] [seconds] [trimesh|sdf] [session.rec]
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// DECLARED TYPES
+//------------------------------------------------------------------------------
+
+// pose of the avatar at one tick of the trajectory
+struct cAvatarPose
+{
+    cVector3d m_pos;
+    cMatrix3d m_rot;
+};
+
+// one independent polishing scene
+struct cPolishingWorld
+{
+    cWorld* m_world;
+    cODEWorld* m_ODEWorld;
+    cODEGenericBody* m_blade;
+    cODEGenericBody* m_tool;
+    cODEDistanceFieldGeom* m_fieldGeom;
+    size_t m_firstPose;
+};
+
+
+//------------------------------------------------------------------------------
+// DECLARED VARIABLES
+//------------------------------------------------------------------------------
+
+// scale of the models, as in the example
+const double C_BLADE_SCALE = 0.012;
+const double C_TOOL_SCALE = 0.065;
+
+// coupling spring of the tool to the avatar, as in the example
+const double linStiffness = 800;
+const double angStiffness = 30;
+
+// size of the ODE steps, as the ODE thread of the example at 1000 Hz [s]
+const double C_STEP_SIZE = 0.001;
+
+
+//------------------------------------------------------------------------------
+
+// loads a model of the example, scaled
+cMultiMesh* loadModel(const string& a_filename, double a_scale)
+{
+    cMultiMesh* mesh = new cMultiMesh();
+    if (!mesh->loadFromFile(a_filename))
+    {
+        printf("Error - failed to load model: %s\n", a_filename.c_str());
+        exit(1);
+    }
+    mesh->scale(a_scale);
+    mesh->computeBoundaryBox(true);
+    return (mesh);
+}
+
+//------------------------------------------------------------------------------
+
+// creates a polishing scene with copies of the blade and of the tool models
+cPolishingWorld createWorld(cMultiMesh* a_blade, cMultiMesh* a_tool, const cSparseDistanceField* a_field,
+                            const vector<cVector3d>& a_toolPoints, const cAvatarPose& a_start, size_t a_firstPose)
+{
+    cPolishingWorld scene;
+    scene.m_firstPose = a_firstPose;
+    scene.m_fieldGeom = NULL;
+    scene.m_world = new cWorld();
+    scene.m_ODEWorld = new cODEWorld(scene.m_world);
+    scene.m_world->addChild(scene.m_ODEWorld);
+    scene.m_ODEWorld->setGravity(cVector3d(0.0, 0.0, -9.81));
+    scene.m_ODEWorld->setAngularDamping(0.00002);
+    scene.m_ODEWorld->setLinearDamping(0.00002);
+
+    // blade: triangle mesh, or distance field against the tool points
+    scene.m_blade = new cODEGenericBody(scene.m_ODEWorld);
+    scene.m_blade->setImageModel(a_blade->copy(false, false, true, false));
+    if (a_field != NULL)
+    {
+        scene.m_fieldGeom = new cODEDistanceFieldGeom(a_field);
+        scene.m_fieldGeom->create(scene.m_ODEWorld->m_ode_space, scene.m_blade);
+    }
+    else
+    {
+        scene.m_blade->createDynamicMesh(true);
+    }
+    scene.m_blade->setLocalPos(0.0, 0.0, -0.5);
+    scene.m_blade->rotateAboutGlobalAxisDeg(cVector3d(1,0,0), 90);
+    if (scene.m_fieldGeom != NULL)
+    {
+        scene.m_fieldGeom->setPose(scene.m_blade->getLocalPos(), scene.m_blade->getLocalRot());
+    }
+
+    // tool, at the first pose of its avatar
+    scene.m_tool = new cODEGenericBody(scene.m_ODEWorld);
+    scene.m_tool->setImageModel(a_tool->copy(false, false, true, false));
+    scene.m_tool->createDynamicMesh(false);
+    scene.m_tool->setMass(0.01);
+    dBodySetAngularDamping(scene.m_tool->m_ode_body, 0.06);
+    dBodySetLinearDamping(scene.m_tool->m_ode_body, 0.06);
+    scene.m_tool->setLocalPos(a_start.m_pos);
+    scene.m_tool->setLocalRot(a_start.m_rot);
+    if (scene.m_fieldGeom != NULL)
+    {
+        scene.m_fieldGeom->addSampledGeom(scene.m_tool->m_ode_geom, a_toolPoints);
+    }
+    return (scene);
+}
+
+//------------------------------------------------------------------------------
+
+// deletes a polishing scene
+void deleteWorld(cPolishingWorld& a_scene)
+{
+    delete a_scene.m_fieldGeom;
+    delete a_scene.m_world;
+}
+
+//------------------------------------------------------------------------------
+
+// steps a polishing scene for __a_numSteps__ steps, its tool coupled to the avatar, whose poses follow at __a_tickRate__ [Hz]
+void runWorld(cPolishingWorld& a_scene, const vector<cAvatarPose>& a_poses, double a_tickRate, size_t a_numSteps)
+{
+    double posesPerStep = C_STEP_SIZE * a_tickRate;
+    for (size_t step=0; step<a_numSteps; step++)
+    {
+        const cAvatarPose& avatar = a_poses[(a_scene.m_firstPose + (size_t)((double)step * posesPerStep)) % a_poses.size()];
+
+        // compute position and angular error between tool and avatar, as
+        // computeToolCoupling() of the example
+        cVector3d posTool = a_scene.m_tool->getLocalPos();
+        cMatrix3d rotTool = a_scene.m_tool->getLocalRot();
+        cVector3d axis(1.0, 0.0, 0.0);
+        double angle = 0.0;
+        cMatrix3d deltaRot = cMul(cTranspose(rotTool), avatar.m_rot);
+        deltaRot.toAxisAngle(axis, angle);
+
+        cVector3d force = linStiffness * (avatar.m_pos - posTool);
+        cVector3d torque = cMul((angStiffness * angle), axis);
+        rotTool.mul(torque);
+
+        a_scene.m_tool->addExternalForce(force);
+        a_scene.m_tool->addExternalTorque(torque);
+        a_scene.m_ODEWorld->updateDynamics(C_STEP_SIZE);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// builds a trajectory that presses the tool on the blade and sweeps it across
+vector<cAvatarPose> createScriptedTrajectory(const vector<cVector3d>& a_bladeVertices, const cVector3d& a_bladePos,
+                                             const cMatrix3d& a_bladeRot, const vector<cVector3d>& a_toolVertices)
+{
+    // extent of the blade in the world, and lowest point of the tool
+    cVector3d bladeMin(1e9, 1e9, 1e9), bladeMax(-1e9, -1e9, -1e9);
+    for (size_t i=0; i<a_bladeVertices.size(); i++)
+    {
+        cVector3d v = a_bladePos + a_bladeRot * a_bladeVertices[i];
+        for (int k=0; k<3; k++)
+        {
+            bladeMin(k) = cMin(bladeMin(k), v(k));
+            bladeMax(k) = cMax(bladeMax(k), v(k));
+        }
+    }
+    double toolBottom = 1e9;
+    for (size_t i=0; i<a_toolVertices.size(); i++) { toolBottom = cMin(toolBottom, a_toolVertices[i](2)); }
+
+    // 20 s of sweeps over the middle of the blade, 2 mm below its top, tilting the tool
+    const size_t numPoses = (size_t)(20.0 * C_DEVICE_RECORD_TICK_RATE);
+    cVector3d center = 0.5 * (bladeMin + bladeMax);
+    cVector3d half = 0.35 * (bladeMax - bladeMin);
+    double height = bladeMax(2) - toolBottom - 0.002;
+
+    vector<cAvatarPose> poses(numPoses);
+    for (size_t i=0; i<numPoses; i++)
+    {
+        double t = (double)i / C_DEVICE_RECORD_TICK_RATE;
+        poses[i].m_pos.set(center(0) + half(0) * sin(2.0 * C_PI * 0.25 * t),
+                           center(1) + half(1) * sin(2.0 * C_PI * 0.10 * t),
+                           height);
+        poses[i].m_rot.setAxisAngleRotationRad(cVector3d(1.0, 0.0, 0.0), cDegToRad(10.0) * sin(2.0 * C_PI * 0.5 * t));
+    }
+    return (poses);
+}
+
+//------------------------------------------------------------------------------
+
+// loads the device poses of a recorded session, scaled to the virtual workspace of the example, and the tick rate of the record
+bool loadRecordedTrajectory(const string& a_filename, vector<cAvatarPose>& a_poses, double& a_tickRate)
+{
+    cDeviceRecordReader reader;
+    if (!reader.load(a_filename) || (reader.getNumSamples() == 0)) { return (false); }
+
+    // the example maps the device workspace to a radius of 1.3
+    const cDeviceRecordSpecs& specs = reader.getHeader().m_specs;
+    double workspaceScaleFactor = (specs.m_workspaceRadius > 0.0) ? 1.3 / specs.m_workspaceRadius : 1.0;
+
+    a_tickRate = reader.getHeader().m_tickRate;
+    a_poses.resize(reader.getNumSamples());
+    for (size_t i=0; i<reader.getNumSamples(); i++)
+    {
+        const cDeviceRecordSample& sample = reader.getSample(i);
+        a_poses[i].m_pos.set(workspaceScaleFactor * sample.m_position[0], workspaceScaleFactor * sample.m_position[1],
+                             workspaceScaleFactor * sample.m_position[2]);
+        for (int r=0; r<3; r++)
+        {
+            for (int c=0; c<3; c++) { a_poses[i].m_rot(r,c) = sample.m_rotation[3*r+c]; }
+        }
+    }
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+// steps the worlds for __a_numSteps__ steps with __a_numThreads__ threads; returns the wall time [s]
+double runBatch(vector<cPolishingWorld>& a_worlds, const vector<cAvatarPose>& a_poses, double a_tickRate, size_t a_numSteps, int a_numThreads)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    // worker i steps worlds i, i + N, i + 2N, ...; a world is only touched by its worker
+    vector<thread> workers;
+    for (int i=0; i<a_numThreads; i++)
+    {
+        workers.push_back(thread([&a_worlds, &a_poses, a_tickRate, a_numSteps, a_numThreads, i]()
+        {
+            dAllocateODEDataForThread(dAllocateMaskAll);
+            for (size_t k=(size_t)i; k<a_worlds.size(); k+=(size_t)a_numThreads)
+            {
+                runWorld(a_worlds[k], a_poses, a_tickRate, a_numSteps);
+            }
+            dCleanupODEAllDataForThread();
+        }));
+    }
+    for (size_t i=0; i<workers.size(); i++) { workers[i].join(); }
+
+    return (chrono::duration<double>(chrono::steady_clock::now() - start).count());
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <models/Polishing folder> [worlds] [threads] [seconds] [trimesh|sdf] [session.rec]\n", argv[0]);
+        return 1;
+    }
+    string folder = argv[1];
+    int numWorlds = (argc > 2) ? atoi(argv[2]) : 16;
+    int maxThreads = (argc > 3) ? atoi(argv[3]) : (int)thread::hardware_concurrency();
+    double seconds = (argc > 4) ? atof(argv[4]) : 5.0;
+    string collider = (argc > 5) ? argv[5] : "trimesh";
+    string recordFile = (argc > 6) ? argv[6] : "";
+    if (numWorlds < 1) { numWorlds = 1; }
+    if (maxThreads < 1) { maxThreads = 1; }
+    if (seconds <= 0.0) { seconds = 5.0; }
+
+    dInitODE2(0);
+    if ((collider == "trimesh") && !dCheckConfiguration("ODE_EXT_mt_collisions") && (maxThreads > 1))
+    {
+        printf("ODE keeps no collision data per thread (built without --enable-ou): trimesh worlds are stepped by 1 thread\n");
+        maxThreads = 1;
+    }
+
+    // models of the example, and the blade as the example places it
+    cMultiMesh* blade = loadModel(folder + "/blade.3ds", C_BLADE_SCALE);
+    cMultiMesh* tool = loadModel(folder + "/ToolPoli2.3ds", C_TOOL_SCALE);
+    vector<cVector3d> bladeVertices, toolVertices, toolPoints;
+    vector<unsigned int> bladeTriangles, toolTriangles;
+    cGetMeshTriangles(blade, bladeVertices, bladeTriangles);
+    cGetMeshTriangles(tool, toolVertices, toolTriangles);
+    cMatrix3d bladeRot;
+    bladeRot.setAxisAngleRotationDeg(cVector3d(1,0,0), 90);
+    cVector3d bladePos(0.0, 0.0, -0.5);
+
+    // distance field of the blade, shared by all worlds
+    cSparseDistanceField field;
+    if (collider == "sdf")
+    {
+        cVector3d size = blade->getBoundaryMax() - blade->getBoundaryMin();
+        double cellSize = cMax(size(0), cMax(size(1), size(2))) / 256.0;
+        field.build(bladeVertices, bladeTriangles, cellSize, 4);
+        cSampleSurface(toolVertices, toolTriangles, 2.0 * cellSize, 512, toolPoints);
+    }
+
+    // avatar trajectory, and the rate of its poses
+    vector<cAvatarPose> poses;
+    double tickRate = C_DEVICE_RECORD_TICK_RATE;
+    if (!recordFile.empty())
+    {
+        if (!loadRecordedTrajectory(recordFile, poses, tickRate) || (tickRate <= 0.0))
+        {
+            printf("Error - failed to load device record: %s\n", recordFile.c_str());
+            return 1;
+        }
+    }
+    else
+    {
+        poses = createScriptedTrajectory(bladeVertices, bladePos, bladeRot, toolVertices);
+    }
+
+    size_t numSteps = (size_t)(seconds / C_STEP_SIZE + 0.5);
+    printf("%d worlds (%s blade), %.1f s of %s trajectory at %.0f Hz each in steps of %.1f ms, up to %d threads\n", numWorlds,
+           collider.c_str(), seconds, recordFile.empty() ? "scripted" : recordFile.c_str(), tickRate, 1e3 * C_STEP_SIZE, maxThreads);
+
+    double baseThroughput = 0.0;
+    for (int numThreads=1; ; numThreads=cMin(2 * numThreads, maxThreads))
+    {
+        // fresh worlds, each starting at its own point of the trajectory
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        vector<cPolishingWorld> worlds;
+        for (int k=0; k<numWorlds; k++)
+        {
+            size_t firstPose = (size_t)k * poses.size() / (size_t)numWorlds;
+            worlds.push_back(createWorld(blade, tool, (collider == "sdf") ? &field : NULL, toolPoints, poses[firstPose], firstPose));
+        }
+        double setupTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        double wallTime = runBatch(worlds, poses, tickRate, numSteps, numThreads);
+
+        // the final poses do not depend on the number of threads
+        double checksum = 0.0;
+        for (size_t k=0; k<worlds.size(); k++)
+        {
+            cVector3d pos = worlds[k].m_tool->getLocalPos();
+            checksum += pos(0) + pos(1) + pos(2);
+            deleteWorld(worlds[k]);
+        }
+
+        double throughput = (double)numWorlds * seconds / wallTime;
+        if (numThreads == 1) { baseThroughput = throughput; }
+        double speedup = throughput / baseThroughput;
+        printf("  %3d threads: %8.2f simulated s / wall s (%.2f per thread), speedup %5.2f, efficiency %5.1f%%, setup %.2f s, checksum %.9f\n",
+               numThreads, throughput, throughput / (double)numThreads, speedup, 100.0 * speedup / (double)numThreads,
+               setupTime, checksum);
+
+        if (numThreads >= maxThreads) { break; }
+    }
+
+    dCloseODE();
+    return 0;
+}
@@ -0,0 +1,315 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include "CDeviceRecord.h"
+#include "CPerfCounters.h"
+#include "CRotationalDrift.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*
+    TOOL:    rotationalDriftBench.cpp
+
+    Validation and microbenchmark of the rotational drift of the ODE
+    polishing task (common/CRotationalDrift.h). The matrix and the
+    quaternion implementations are run side by side over a synthetic
+    trajectory that tilts the device beyond its angular range and, if a
+    record file is given, over the device orientations of a recorded
+    session. The tool reports the largest difference between their outputs
+    and their time, retired instructions and cycles per tick; it exits with
+    an error when the outputs differ by more than the tolerance. Hardware
+    counters require perf_event_open access
+    (/proc/sys/kernel/perf_event_paranoid <= 2).
+
+        rotationalDriftBench [session.rec] [passes] [tolerance]
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// DECLARED TYPES
+//------------------------------------------------------------------------------
+
+// device orientation and angular velocity of one tick
+struct cRotationSample
+{
+    cMatrix3d m_rot;
+    cVector3d m_angVel;
+};
+
+// trajectory fed to the controllers
+struct cRotationTrajectory
+{
+    string m_name;
+    cRotationalDriftParams m_params;
+    vector<cRotationSample> m_samples;
+};
+
+// largest differences between the outputs of two controllers
+struct cDriftDifference
+{
+    double m_rotation;
+    double m_velocity;
+    double m_torque;
+    double m_angle;
+    double getMax() const { return (max(max(m_rotation, m_velocity), max(m_torque, m_angle))); }
+};
+
+
+//------------------------------------------------------------------------------
+// DECLARED VARIABLES
+//------------------------------------------------------------------------------
+
+// rate of the haptic loop of the example
+const double tickRate = 4000.0;
+
+// prevents the compiler from discarding the controller outputs
+volatile double sink = 0.0;
+
+
+//------------------------------------------------------------------------------
+
+// returns the parameters of the example for a device of the given specifications
+cRotationalDriftParams createParams(double a_maxAngularTorque, double a_maxAngularStiffness, double a_workspaceScaleFactor)
+{
+    return (cRotationalDriftParams(0.1, 0.1, 20.0, 85.0, 1.0, a_maxAngularTorque,
+                                   a_maxAngularStiffness / a_workspaceScaleFactor, tickRate));
+}
+
+//------------------------------------------------------------------------------
+
+// sets the angular velocities from the finite differences of the orientations
+void computeAngularVelocities(vector<cRotationSample>& a_samples)
+{
+    for (size_t i=0; i+1<a_samples.size(); i++)
+    {
+        cMatrix3d delta = cMul(a_samples[i+1].m_rot, cTranspose(a_samples[i].m_rot));
+        cVector3d axis;
+        double angle;
+        delta.toAxisAngle(axis, angle);
+        a_samples[i].m_angVel = (angle * tickRate) * axis;
+    }
+    if (a_samples.size() > 1) { a_samples.back().m_angVel = a_samples[a_samples.size()-2].m_angVel; }
+}
+
+//------------------------------------------------------------------------------
+
+// builds a trajectory that tilts the device up to 30 deg in all directions,
+// beyond its 20 deg range, while it spins about its axis
+cRotationTrajectory createSyntheticTrajectory(size_t a_numTicks)
+{
+    cRotationTrajectory trajectory;
+    trajectory.m_name = "synthetic";
+    trajectory.m_params = createParams(0.15, 1.0, 1.0 / 0.075);
+
+    const double dt = 1.0 / tickRate;
+    const double tiltMax = 30.0 * C_PI / 180.0;
+    const double w0 = 2.0 * C_PI * 0.40;
+    const double w1 = 2.0 * C_PI * 0.13;
+    const double w2 = 2.0 * C_PI * 0.25;
+
+    trajectory.m_samples.resize(a_numTicks);
+    for (size_t i=0; i<a_numTicks; i++)
+    {
+        double t = (double)i * dt;
+        cMatrix3d tilt, spin;
+        cVector3d axis(cos(w1 * t), sin(w1 * t), 0.0);
+        tilt.setAxisAngleRotationRad(axis, tiltMax * sin(w0 * t));
+        spin.setAxisAngleRotationRad(cVector3d(0.0, 0.0, 1.0), 0.5 * sin(w2 * t));
+        trajectory.m_samples[i].m_rot = cMul(tilt, spin);
+    }
+    computeAngularVelocities(trajectory.m_samples);
+    return (trajectory);
+}
+
+//------------------------------------------------------------------------------
+
+// loads the device orientations and angular velocities of a recorded session
+bool loadRecordedTrajectory(const string& a_filename, cRotationTrajectory& a_trajectory)
+{
+    cDeviceRecordReader reader;
+    if (!reader.load(a_filename) || (reader.getNumSamples() == 0)) { return (false); }
+
+    const cDeviceRecordSpecs& specs = reader.getHeader().m_specs;
+    a_trajectory.m_name = a_filename;
+    a_trajectory.m_params = createParams(specs.m_maxAngularTorque, specs.m_maxAngularStiffness,
+                                         (specs.m_workspaceRadius > 0.0) ? 1.0 / specs.m_workspaceRadius : 1.0);
+
+    a_trajectory.m_samples.resize(reader.getNumSamples());
+    for (size_t i=0; i<reader.getNumSamples(); i++)
+    {
+        const cDeviceRecordSample& record = reader.getSample(i);
+        cRotationSample& sample = a_trajectory.m_samples[i];
+        for (int r=0; r<3; r++)
+        {
+            for (int c=0; c<3; c++) { sample.m_rot(r,c) = record.m_rotation[3*r+c]; }
+        }
+        sample.m_angVel.set(record.m_angularVelocity[0], record.m_angularVelocity[1], record.m_angularVelocity[2]);
+    }
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+// returns the largest component of |a - b|
+double getDifference(const cVector3d& a_a, const cVector3d& a_b)
+{
+    cVector3d d = a_a - a_b;
+    return (max(max(fabs(d(0)), fabs(d(1))), fabs(d(2))));
+}
+
+//------------------------------------------------------------------------------
+
+// runs both controllers side by side and returns the largest differences of their outputs
+cDriftDifference compare(const cRotationTrajectory& a_trajectory, size_t& a_limitTicks)
+{
+    cMatrixRotationalDrift matrixDrift(a_trajectory.m_params);
+    cQuaternionRotationalDrift quaternionDrift(a_trajectory.m_params);
+    cRotationalDriftState a, b;
+
+    cDriftDifference diff = { 0.0, 0.0, 0.0, 0.0 };
+    a_limitTicks = 0;
+    for (size_t i=0; i<a_trajectory.m_samples.size(); i++)
+    {
+        const cRotationSample& sample = a_trajectory.m_samples[i];
+        matrixDrift.update(a, sample.m_rot, sample.m_angVel);
+        quaternionDrift.update(b, sample.m_rot, sample.m_angVel);
+
+        for (int r=0; r<3; r++)
+        {
+            for (int c=0; c<3; c++) { diff.m_rotation = max(diff.m_rotation, fabs(a.m_avatarRot(r,c) - b.m_avatarRot(r,c))); }
+        }
+        diff.m_rotation = max(diff.m_rotation, getDifference(a.m_centerRot, b.m_centerRot));
+        diff.m_rotation = max(diff.m_rotation, getDifference(a.m_avatarRotVect, b.m_avatarRotVect));
+        diff.m_velocity = max(diff.m_velocity, getDifference(a.m_avatarVel, b.m_avatarVel));
+        diff.m_velocity = max(diff.m_velocity, getDifference(a.m_driftVel, b.m_driftVel));
+        diff.m_torque = max(diff.m_torque, getDifference(a.m_driftTorque, b.m_driftTorque));
+        diff.m_torque = max(diff.m_torque, getDifference(a.m_wsTorque, b.m_wsTorque));
+        diff.m_torque = max(diff.m_torque, getDifference(a.m_avatarWSTorque, b.m_avatarWSTorque));
+        diff.m_angle = max(diff.m_angle, fabs(a.m_angleTheta - b.m_angleTheta));
+        diff.m_angle = max(diff.m_angle, fabs(a.m_angleAvatar - b.m_angleAvatar));
+        diff.m_angle = max(diff.m_angle, fabs(a.m_scaleFactor - b.m_scaleFactor));
+        a_limitTicks += (a.m_angleTheta >= a_trajectory.m_params.m_thetaMax * 3.14 / 180) ? 1 : 0;
+    }
+    return (diff);
+}
+
+//------------------------------------------------------------------------------
+
+// runs a controller over a trajectory and prints its cost per tick
+template <class T>
+double benchmark(const char* a_name, const T& a_controller, const cRotationTrajectory& a_trajectory, int a_passes)
+{
+    const vector<cRotationSample>& samples = a_trajectory.m_samples;
+    const size_t numSamples = samples.size();
+
+    // warm up caches and branch predictors
+    cRotationalDriftState state;
+    for (size_t i=0; i<numSamples; i++)
+    {
+        a_controller.update(state, samples[i].m_rot, samples[i].m_angVel);
+    }
+
+    cPerfCounters counters;
+    double acc = 0.0;
+
+    counters.start();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int pass=0; pass<a_passes; pass++)
+    {
+        for (size_t i=0; i<numSamples; i++)
+        {
+            a_controller.update(state, samples[i].m_rot, samples[i].m_angVel);
+            acc += state.m_avatarRot(0,1) + state.m_driftTorque(2);
+        }
+    }
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    counters.stop();
+    sink = sink + acc;
+
+    double ticks = (double)numSamples * (double)a_passes;
+    double seconds = chrono::duration<double>(stop - start).count();
+    printf("  %-12s %8.2f ns/tick", a_name, 1e9 * seconds / ticks);
+    if (counters.isAvailable(cPerfCounters::INSTRUCTIONS))
+    {
+        printf("  %8.1f instr/tick", (double)counters.getCount(cPerfCounters::INSTRUCTIONS) / ticks);
+    }
+    if (counters.isAvailable(cPerfCounters::CYCLES))
+    {
+        printf("  %8.1f cycles/tick", (double)counters.getCount(cPerfCounters::CYCLES) / ticks);
+    }
+    printf("\n");
+    return (seconds / ticks);
+}
+
+//------------------------------------------------------------------------------
+
+// compares and benchmarks both controllers over a trajectory; returns
+// false if their outputs differ by more than the tolerance
+bool benchmarkTrajectory(const cRotationTrajectory& a_trajectory, int a_passes, double a_tolerance)
+{
+    printf("%s trajectory: %lu ticks x %d passes\n", a_trajectory.m_name.c_str(),
+           (unsigned long)a_trajectory.m_samples.size(), a_passes);
+
+    size_t limitTicks;
+    cDriftDifference diff = compare(a_trajectory, limitTicks);
+    bool match = (diff.getMax() <= a_tolerance);
+    printf("  max difference: rotation %.3g, velocity %.3g rad/s, torque %.3g Nm, angle %.3g  (%.1f%% beyond ThetaMax)  %s\n",
+           diff.m_rotation, diff.m_velocity, diff.m_torque, diff.m_angle,
+           100.0 * (double)limitTicks / (double)max(a_trajectory.m_samples.size(), (size_t)1),
+           match ? "OK" : "MISMATCH");
+
+    cMatrixRotationalDrift matrixDrift(a_trajectory.m_params);
+    cQuaternionRotationalDrift quaternionDrift(a_trajectory.m_params);
+    double matrixCost = benchmark("matrix", matrixDrift, a_trajectory, a_passes);
+    double quaternionCost = benchmark("quaternion", quaternionDrift, a_trajectory, a_passes);
+    printf("  speedup %.2fx\n", matrixCost / quaternionCost);
+    return (match);
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    string recordFile = (argc > 1) ? argv[1] : "";
+    int passes = (argc > 2) ? atoi(argv[2]) : 20;
+    if (passes < 1) { passes = 1; }
+    double tolerance = (argc > 3) ? atof(argv[3]) : 1e-6;
+
+    cPerfCounters probe;
+    if (!probe.isAvailable())
+    {
+        printf("hardware counters unavailable, reporting time only\n");
+    }
+
+    bool match = benchmarkTrajectory(createSyntheticTrajectory(40000), passes, tolerance);
+
+    if (!recordFile.empty())
+    {
+        cRotationTrajectory recorded;
+        if (!loadRecordedTrajectory(recordFile, recorded))
+        {
+            printf("Error - failed to load device record: %s\n", recordFile.c_str());
+            return 1;
+        }
+        match = benchmarkTrajectory(recorded, passes, tolerance) && match;
+    }
+
+    return (match ? 0 : 1);
+}
@@ -0,0 +1,303 @@
+//==============================================================================
+/*
+
+    \author
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "chai3d.h"
+//------------------------------------------------------------------------------
+#include "CDeviceRecord.h"
+#include "CPerfCounters.h"
+#include "CWorkspaceDrift.h"
+#include "CWorkspaceConstraint.h"
+//------------------------------------------------------------------------------
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+using namespace chai3d;
+using namespace std;
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*
+    TOOL:    workspaceDriftBench.cpp
+
+    Microbenchmark of the workspace drift variants and of the workspace
+    constraints of the TransMap example (common/CWorkspaceDrift.h,
+    common/CWorkspaceConstraint.h). Each of them is run over a
+    synthetic trajectory that crosses the workspace edges and, if a record
+    file is given, over the device positions of a recorded session. The
+    tool reports the time, the retired instructions and the branch misses
+    per tick; hardware counters require perf_event_open access
+    (/proc/sys/kernel/perf_event_paranoid <= 2).
+
+        workspaceDriftBench [session.rec] [passes]
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// DECLARED TYPES
+//------------------------------------------------------------------------------
+
+// device position and velocity of one tick
+struct cDriftSample
+{
+    cVector3d m_pos;
+    cVector3d m_vel;
+};
+
+// trajectory fed to the controllers
+struct cDriftTrajectory
+{
+    string m_name;
+    cVector3d m_devicePosIni;
+    double m_workspaceScaleFactor;
+    double m_maxLinearForce;
+    vector<cDriftSample> m_samples;
+};
+
+
+//------------------------------------------------------------------------------
+// DECLARED VARIABLES
+//------------------------------------------------------------------------------
+
+// workspace drift parameters of the example
+const double R   = 0.025;   // device workspace radius
+const double Kb  = 0.05;    // rate-control factor (bubble)
+const double Re  = 1.0;     // virtual environment radius (expansion)
+
+// prevents the compiler from discarding the controller outputs
+volatile double sink = 0.0;
+
+
+//------------------------------------------------------------------------------
+
+// builds a Lissajous trajectory that crosses the workspace edges
+cDriftTrajectory createSyntheticTrajectory(size_t a_numTicks)
+{
+    cDriftTrajectory trajectory;
+    trajectory.m_name = "synthetic";
+    trajectory.m_devicePosIni.zero();
+    trajectory.m_workspaceScaleFactor = 1.0 / 0.075;
+    trajectory.m_maxLinearForce = 20.0;
+
+    const double dt = 1.0 / 4000.0;
+    const double a = 1.2 * R;
+    const double w0 = 2.0 * C_PI * 0.50;
+    const double w1 = 2.0 * C_PI * 0.35;
+    const double w2 = 2.0 * C_PI * 0.20;
+
+    trajectory.m_samples.resize(a_numTicks);
+    for (size_t i=0; i<a_numTicks; i++)
+    {
+        double t = (double)i * dt;
+        cDriftSample& sample = trajectory.m_samples[i];
+        sample.m_pos.set(a * sin(w0 * t), a * sin(w1 * t + 0.5), a * sin(w2 * t + 1.0));
+        sample.m_vel.set(a * w0 * cos(w0 * t), a * w1 * cos(w1 * t + 0.5), a * w2 * cos(w2 * t + 1.0));
+    }
+    return (trajectory);
+}
+
+//------------------------------------------------------------------------------
+
+// loads the device positions and velocities of a recorded session
+bool loadRecordedTrajectory(const string& a_filename, cDriftTrajectory& a_trajectory)
+{
+    cDeviceRecordReader reader;
+    if (!reader.load(a_filename) || (reader.getNumSamples() == 0)) { return (false); }
+
+    const cDeviceRecordSpecs& specs = reader.getHeader().m_specs;
+    a_trajectory.m_name = a_filename;
+    a_trajectory.m_workspaceScaleFactor = (specs.m_workspaceRadius > 0.0) ? 1.0 / specs.m_workspaceRadius : 1.0;
+    a_trajectory.m_maxLinearForce = specs.m_maxLinearForce;
+
+    a_trajectory.m_samples.resize(reader.getNumSamples());
+    for (size_t i=0; i<reader.getNumSamples(); i++)
+    {
+        const cDeviceRecordSample& record = reader.getSample(i);
+        cDriftSample& sample = a_trajectory.m_samples[i];
+        sample.m_pos.set(record.m_position[0], record.m_position[1], record.m_position[2]);
+        sample.m_vel.set(record.m_linearVelocity[0], record.m_linearVelocity[1], record.m_linearVelocity[2]);
+    }
+    a_trajectory.m_devicePosIni = a_trajectory.m_samples[0].m_pos;
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+// prints the time and the hardware counts per tick of a benchmark
+void printCost(const char* a_name, double a_seconds, const cPerfCounters& a_counters, double a_ticks)
+{
+    printf("  %-12s %8.2f ns/tick", a_name, 1e9 * a_seconds / a_ticks);
+    if (a_counters.isAvailable(cPerfCounters::INSTRUCTIONS))
+    {
+        printf("  %8.1f instr/tick", (double)a_counters.getCount(cPerfCounters::INSTRUCTIONS) / a_ticks);
+    }
+    if (a_counters.isAvailable(cPerfCounters::BRANCH_MISSES))
+    {
+        printf("  %8.4f br-miss/tick", (double)a_counters.getCount(cPerfCounters::BRANCH_MISSES) / a_ticks);
+    }
+    if (a_counters.isAvailable(cPerfCounters::CYCLES))
+    {
+        printf("  %8.1f cycles/tick", (double)a_counters.getCount(cPerfCounters::CYCLES) / a_ticks);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// runs a controller over a trajectory and prints its cost per tick
+template <class T>
+void benchmark(const char* a_name, const T& a_controller, const cDriftTrajectory& a_trajectory, int a_passes)
+{
+    const vector<cDriftSample>& samples = a_trajectory.m_samples;
+    const size_t numSamples = samples.size();
+
+    cWorkspaceDriftState state;
+    state.m_devicePosIni = a_trajectory.m_devicePosIni;
+    state.m_workspaceScaleFactor = a_trajectory.m_workspaceScaleFactor;
+
+    // warm up caches and branch predictors
+    for (size_t i=0; i<numSamples; i++)
+    {
+        a_controller.update(state, samples[i].m_pos, samples[i].m_vel);
+    }
+
+    cPerfCounters counters;
+    double acc = 0.0;
+    size_t rateControlTicks = 0;
+
+    counters.start();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int pass=0; pass<a_passes; pass++)
+    {
+        for (size_t i=0; i<numSamples; i++)
+        {
+            a_controller.update(state, samples[i].m_pos, samples[i].m_vel);
+            acc += state.m_avatarPos(0) + state.m_driftForce(1);
+            rateControlTicks += state.m_rateControl ? 1 : 0;
+        }
+    }
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    counters.stop();
+    sink = sink + acc;
+
+    double ticks = (double)numSamples * (double)a_passes;
+    printCost(a_name, chrono::duration<double>(stop - start).count(), counters, ticks);
+    printf("  (%.1f%% rate control)\n", 100.0 * (double)rateControlTicks / ticks);
+}
+
+//------------------------------------------------------------------------------
+
+// runs a workspace constraint over a trajectory and prints its cost per tick
+void benchmarkConstraint(const char* a_name, const cWorkspaceConstraint& a_constraint, const cDriftTrajectory& a_trajectory, int a_passes)
+{
+    const vector<cDriftSample>& samples = a_trajectory.m_samples;
+    const size_t numSamples = samples.size();
+
+    // relative device positions, as computed by the drift controllers
+    vector<cVector3d> positions(numSamples);
+    for (size_t i=0; i<numSamples; i++)
+    {
+        positions[i] = samples[i].m_pos - a_trajectory.m_devicePosIni;
+    }
+
+    cVector3d force;
+    for (size_t i=0; i<numSamples; i++)
+    {
+        a_constraint.computeForce(positions[i], force);
+    }
+
+    cPerfCounters counters;
+    double acc = 0.0;
+    size_t activeTicks = 0;
+
+    counters.start();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int pass=0; pass<a_passes; pass++)
+    {
+        for (size_t i=0; i<numSamples; i++)
+        {
+            a_constraint.computeForce(positions[i], force);
+            acc += force(0) + force(2);
+            activeTicks += (force(0) != 0.0) || (force(1) != 0.0) || (force(2) != 0.0);
+        }
+    }
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    counters.stop();
+    sink = sink + acc;
+
+    double ticks = (double)numSamples * (double)a_passes;
+    printCost(a_name, chrono::duration<double>(stop - start).count(), counters, ticks);
+    printf("  (%.1f%% outside)\n", 100.0 * (double)activeTicks / ticks);
+}
+
+//------------------------------------------------------------------------------
+
+// runs the four variants and the workspace constraints over a trajectory
+void benchmarkTrajectory(const cDriftTrajectory& a_trajectory, int a_passes)
+{
+    printf("%s trajectory: %lu ticks x %d passes\n", a_trajectory.m_name.c_str(),
+           (unsigned long)a_trajectory.m_samples.size(), a_passes);
+
+    const double force = a_trajectory.m_maxLinearForce;
+
+    cTranslationalDrift drift(0.2, R, force, cConstantDriftGain(0.2));
+    cEdgeGainDrift edge(0.2, R, force, cEdgeDriftGain(0.2, 0.8));
+    cBubbleDrift bubble(0.2, R, force, cConstantDriftGain(0.2), cBubbleRateControl(Kb));
+    cExpansionDrift expansion(0.15, R, force, cConstantDriftGain(0.3), cNoRateControl(),
+                              cExpansionScale(a_trajectory.m_workspaceScaleFactor, Re));
+
+    benchmark("drift", drift, a_trajectory, a_passes);
+    benchmark("edge", edge, a_trajectory, a_passes);
+    benchmark("bubble", bubble, a_trajectory, a_passes);
+    benchmark("expansion", expansion, a_trajectory, a_passes);
+
+    // virtual workspaces, with the stiffness used by the example
+    const double stiffness = 1.5 * 5000.0 * a_trajectory.m_workspaceScaleFactor;
+
+    cWorkspaceConstraint box;
+    box.setBox(cVector3d(R, R, R), stiffness);
+    cWorkspaceConstraint sphere;
+    sphere.setSphere(R, stiffness);
+    cWorkspaceConstraint ellipsoid;
+    ellipsoid.setEllipsoid(cVector3d(R, 1.2 * R, 0.8 * R), stiffness);
+
+    benchmarkConstraint("box", box, a_trajectory, a_passes);
+    benchmarkConstraint("sphere", sphere, a_trajectory, a_passes);
+    benchmarkConstraint("ellipsoid", ellipsoid, a_trajectory, a_passes);
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+    string recordFile = (argc > 1) ? argv[1] : "";
+    int passes = (argc > 2) ? atoi(argv[2]) : 50;
+    if (passes < 1) { passes = 1; }
+
+    cPerfCounters probe;
+    if (!probe.isAvailable())
+    {
+        printf("hardware counters unavailable, reporting time only\n");
+    }
+
+    benchmarkTrajectory(createSyntheticTrajectory(40000), passes);
+
+    if (!recordFile.empty())
+    {
+        cDriftTrajectory recorded;
+        if (!loadRecordedTrajectory(recordFile, recorded))
+        {
+            printf("Error - failed to load device record: %s\n", recordFile.c_str());
+            return 1;
+        }
+        benchmarkTrajectory(recorded, passes);
+    }
+
+    return 0;
+}